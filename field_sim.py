@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Frame delivery simulator for a walk through the ponds (uplink, backup queue).
+
+  field_sim.py                           40 ponds, 30 % loss, Socket.IO
+  field_sim.py --ponds 60 --loss 0.5     heavier run
+  field_sim.py --transport http          every frame as an HTTP POST
+  field_sim.py --outage 600:900          no coverage from 600 s to 900 s
+
+Models what the Frame task does with a reading: one live upload attempt,
+the backup queue on failure, and the drain every BACKUP_UPLOAD_INTERVAL_MS
+in batches of FRAME_UPLINK_BATCH_MAX over Socket.IO (one frame over HTTP).
+The Frame task is single threaded, so a reading taken while it waits for
+an ack waits too. Queue size, batch size and timeouts are read from the
+headers, so the model follows the firmware.
+
+Reported per run: reading-to-ack latency, frames lost to queue overflow,
+throughput, peak queue depth, flash writes and time the Frame task spent
+blocked on timeouts.
+
+This is a model of the delivery path, not firmware. The firmware modules
+that run off-target are built by [env:native] in platformio.ini; the walk
+itself (GPS filter, pond lookup, frame writer) is test/test_field_walk.
+"""
+
+import argparse
+import random
+import re
+from pathlib import Path
+
+SRC = Path(__file__).resolve().parent / "src"
+HEADERS = ("CApplication.h", "CBackupStorage.h", "frame_uplink.h", "cTftDisplay.h")
+
+RTT_S = {"socket": 0.4, "http": 1.5}    # Round trip of a delivered frame
+HTTP_TIMEOUT_S = 30.0                   # http_ops setTimeout()
+DRAIN_LIMIT_S = 3600                    # Give up draining after the walk
+
+
+def load_constants():
+    consts = {}
+    for name in HEADERS:
+        for key, value in re.findall(r"#define (\w+) \(?([0-9.]+)\)?", (SRC / name).read_text()):
+            consts[key] = float(value)
+    return consts
+
+
+def parse_outage(text):
+    if not text:
+        return None
+    start, end = text.split(":")
+    return float(start), float(end)
+
+
+class Link:
+    def __init__(self, args, c, rng):
+        self.loss = args.loss
+        self.outage = parse_outage(args.outage)
+        self.rtt = RTT_S[args.transport]
+        self.timeout = c["FRAME_UPLINK_ACK_TIMEOUT_MS"] / 1000 if args.transport == "socket" else HTTP_TIMEOUT_S
+        self.rng = rng
+
+    def send(self, now):
+        """Seconds the Frame task is blocked, and whether the server acked."""
+        if self.outage and self.outage[0] <= now < self.outage[1]:
+            return 0.0, False           # isOnline is false: no attempt
+        if self.rng.random() < self.loss:
+            return self.timeout, False
+        return self.rtt * (0.5 + self.rng.random()), True
+
+
+def readings(args, c, rng):
+    """Time of each reading: walk to the pond, then the capture countdown."""
+    t = 0.0
+    for _ in range(args.ponds):
+        t += rng.uniform(0.5, 1.5) * args.walk + c["FRAME_CAPTURE_COUNTDOWN"]
+        yield t
+
+
+def simulate(args, c, seed):
+    rng = random.Random(seed)
+    link = Link(args, c, rng)
+    capacity = int(c["MAXFILES"]) - 1   # writeInBS pushes rPos when wPos catches up
+    batch = int(c["FRAME_UPLINK_BATCH_MAX"]) if args.transport == "socket" else 1
+    interval = c["BACKUP_UPLOAD_INTERVAL_MS"] / 1000
+
+    queue = []                          # Reading time of each stored frame, oldest first
+    latencies, lost = [], 0
+    flash_writes = peak = 0
+    blocked = 0.0
+    busy_until = 0.0
+    next_drain = interval
+    pending = list(readings(args, c, rng))
+    end = pending[-1] + DRAIN_LIMIT_S
+
+    while pending or (queue and busy_until < end):
+        if pending and pending[0] <= next_drain:
+            taken = pending.pop(0)
+            now = max(taken, busy_until)
+            spent, ok = link.send(now)
+            blocked += 0 if ok else spent
+            busy_until = now + spent
+            if ok:
+                latencies.append(busy_until - taken)
+            else:
+                if len(queue) == capacity:
+                    queue.pop(0)
+                    lost += 1
+                queue.append(taken)
+                flash_writes += 1
+                peak = max(peak, len(queue))
+            continue
+
+        now = max(next_drain, busy_until)
+        next_drain = now + interval
+        if not queue:
+            continue
+        spent, ok = link.send(now)
+        busy_until = now + spent
+        if ok:
+            for taken in queue[:batch]:
+                latencies.append(busy_until - taken)
+            flash_writes += min(batch, len(queue))  # moveToNextFile rewrites the slot
+            del queue[:batch]
+        else:
+            blocked += spent
+
+    return {
+        "latencies": sorted(latencies),
+        "lost": lost,
+        "stranded": len(queue),
+        "peak": peak,
+        "flash_writes": flash_writes,
+        "blocked": blocked,
+        "duration": busy_until,
+    }
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    return values[min(len(values) - 1, int(p / 100 * len(values)))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--ponds", type=int, default=40)
+    parser.add_argument("--loss", type=float, default=0.3, help="fraction of uploads that time out")
+    parser.add_argument("--walk", type=float, default=90, help="mean seconds between ponds")
+    parser.add_argument("--transport", choices=("socket", "http"), default="socket")
+    parser.add_argument("--outage", help="start:end seconds without coverage")
+    parser.add_argument("--runs", type=int, default=20)
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    c = load_constants()
+    results = [simulate(args, c, args.seed + i) for i in range(args.runs)]
+    latencies = sorted(l for r in results for l in r["latencies"])
+    frames = args.ponds * args.runs
+    minutes = sum(r["duration"] for r in results) / 60
+
+    print(f"scenario     {args.ponds} ponds, {100 * args.loss:.0f} % loss, {args.transport}, {args.runs} runs")
+    print(f"delivered    {len(latencies)}/{frames}  lost {sum(r['lost'] for r in results)}"
+          f"  stranded {sum(r['stranded'] for r in results)}")
+    print(f"latency s    p50 {percentile(latencies, 50):6.1f}  p90 {percentile(latencies, 90):6.1f}"
+          f"  p99 {percentile(latencies, 99):6.1f}  max {percentile(latencies, 100):6.1f}")
+    print(f"throughput   {len(latencies) / max(minutes, 1e-9):.2f} frames/min")
+    print(f"queue        peak {max(r['peak'] for r in results)} of {int(c['MAXFILES']) - 1}")
+    print(f"per run      {sum(r['flash_writes'] for r in results) / args.runs:.0f} flash writes, "
+          f"{sum(r['blocked'] for r in results) / args.runs:.0f} s Frame task blocked on timeouts")
+
+
+if __name__ == "__main__":
+    main()
@@ -12,6 +12,21 @@
 
 #include "FILESYSTEM.h"
 #include "SPIFFS.h"
+#include <string.h>
+
+/**
+ * FNV-1a hash of a path, the stat cache key
+ */
+static uint32_t pathHash(const char *path)
+{
+    uint32_t h = 2166136261u;
+    while (*path)
+    {
+        h ^= (uint8_t)*path++;
+        h *= 16777619u;
+    }
+    return h;
+}
 
 /**
  * constructor
@@ -19,6 +34,12 @@
 FILESYSTEM::FILESYSTEM()
 {
     fsMounted = false;
+    m_xStatLock = portMUX_INITIALIZER_UNLOCKED;
+    for (int i = 0; i < FS_STAT_CACHE_SIZE; i++)
+    {
+        m_oStat[i].hash = 0;
+        m_oStat[i].size = -1;
+    }
 }
 
 /**
@@ -29,6 +50,45 @@ FILESYSTEM::~FILESYSTEM()
     fsMounted = false;
 }
 
+/**
+ * Cached size of a file
+ * @param path Path of file
+ * @param size Output size, 0 for a missing file
+ * @return true on a hit
+ */
+bool FILESYSTEM::statLookup(const char *path, int *size)
+{
+    uint32_t h = pathHash(path);
+    StatEntry *e = &m_oStat[h % FS_STAT_CACHE_SIZE];
+    bool hit = false;
+    portENTER_CRITICAL(&m_xStatLock);
+    if (e->size >= 0 && e->hash == h)
+    {
+        *size = e->size;
+        hit = true;
+    }
+    portEXIT_CRITICAL(&m_xStatLock);
+    return hit;
+}
+
+/**
+ * Remember a file's size, -1 forgets it
+ * @param path Path of file
+ * @param size Size in bytes, 0 for a missing file
+ */
+void FILESYSTEM::statStore(const char *path, int size)
+{
+    uint32_t h = pathHash(path);
+    StatEntry *e = &m_oStat[h % FS_STAT_CACHE_SIZE];
+    portENTER_CRITICAL(&m_xStatLock);
+    if (size >= 0 || e->hash == h)
+    {
+        e->hash = h;
+        e->size = size;
+    }
+    portEXIT_CRITICAL(&m_xStatLock);
+}
+
 /**
  * Write data to file,If file not preset Create and Write 
  * @param path Path of file
@@ -42,56 +102,218 @@ int FILESYSTEM::writeFile(const char *path, const char *message)
         File file = SPIFFS.open(path, FILE_WRITE);
         if (!file)
         {
+            invalidate(path);
             return FILE_OPEN_FAILED;
         }
-        if (file.print(message))
+        size_t len = strlen(message);
+        size_t written = file.write((const uint8_t *)message, len);
+        file.close();
+        if (written == len)
         {
+            statStore(path, len);
             return FILE_WRITE_SUCCESSFUL;
         }
         else
         {
+            invalidate(path);
+            return FILE_WRITE_FAILED;
+        }
+    }
+    return FS_NOT_MOUNTED;
+}
+
+/**
+ * Staging names of an atomic write
+ * @return false if path is too long for them
+ */
+static bool stagingPaths(const char *path, char *tmp, char *staged)
+{
+    if (strlen(path) + sizeof(FS_TMP_SUFFIX) > FS_PATH_MAX)
+    {
+        return false;
+    }
+    snprintf(tmp, FS_PATH_MAX, "%s%s", path, FS_TMP_SUFFIX);
+    snprintf(staged, FS_PATH_MAX, "%s%s", path, FS_NEW_SUFFIX);
+    return true;
+}
+
+/**
+ * Write data to a staging file and rename it over path, so a reset
+ * leaves either the old or the new content, never part of it.
+ * SPIFFS rename does not replace an existing file, so the complete copy
+ * is first renamed to "<path>.new"; a reset between removing path and the
+ * last rename is finished by recoverAtomic()
+ * @param path Path of file
+ * @param data String to be written
+ * @return FILE/FS ERRORS
+ */
+int FILESYSTEM::writeFileAtomic(const char *path, const char *message)
+{
+    if (fsMounted)
+    {
+        char tmp[FS_PATH_MAX], staged[FS_PATH_MAX];
+        if (!stagingPaths(path, tmp, staged))
+        {
+            return FILE_OPEN_FAILED;
+        }
+        int ret = writeFile(tmp, message);
+        invalidate(tmp);
+        if (ret != FILE_WRITE_SUCCESSFUL)
+        {
+            SPIFFS.remove(tmp);
+            return ret;
+        }
+        SPIFFS.remove(staged);
+        if (!SPIFFS.rename(tmp, staged))
+        {
+            SPIFFS.remove(tmp);
+            return FILE_WRITE_FAILED;
+        }
+        SPIFFS.remove(path);
+        if (!SPIFFS.rename(staged, path))
+        {
+            invalidate(path);
             return FILE_WRITE_FAILED;
         }
+        statStore(path, strlen(message));
+        return FILE_WRITE_SUCCESSFUL;
     }
     return FS_NOT_MOUNTED;
 }
 
 /**
- * Read data from file
+ * Settle a writeFileAtomic() cut short by a reset: a "<path>.new" copy is
+ * complete and replaces path, a "<path>.tmp" one may be partial and is deleted
+ * @param path Path of file
+ * @return true if path now holds the staged copy
+ */
+bool FILESYSTEM::recoverAtomic(const char *path)
+{
+    char tmp[FS_PATH_MAX], staged[FS_PATH_MAX];
+    if (!fsMounted || !stagingPaths(path, tmp, staged))
+    {
+        return false;
+    }
+    bool restored = false;
+    if (SPIFFS.exists(tmp))
+    {
+        SPIFFS.remove(tmp);
+    }
+    if (SPIFFS.exists(staged))
+    {
+        SPIFFS.remove(path);
+        restored = SPIFFS.rename(staged, path);
+    }
+    invalidate(path);
+    return restored;
+}
+
+/**
+ * Read a whole file in one flash read and NUL terminate it
  * @param path Path of file
  * @param data Pointer to buff 
+ * @param cap Size of buff, including the terminator
  * @return File Error , No of Bytes read
  */
-int FILESYSTEM::readFile(const char *path, char *data)
+int FILESYSTEM::readFile(const char *path, char *data, size_t cap)
 {
     if (fsMounted)
     {
+        if (!data || !cap)
+        {
+            return FILE_TOO_LARGE;
+        }
         File file = SPIFFS.open(path);
-        int bRead = 0;
         if (!file || file.isDirectory())
         {
             return FILE_OPEN_FAILED;
         }
 
         size_t fileSize = file.size();
+        statStore(path, fileSize);
+        if (fileSize >= cap)
+        {
+            file.close();
+            data[0] = '\0';
+            return FILE_TOO_LARGE;
+        }
 
-        while (file.available())
+        int bRead = file.read((uint8_t *)data, fileSize);
+        file.close();
+        if (bRead < 0)
+        {
+            bRead = 0;
+        }
+        data[bRead] = '\0';
+        return bRead;
+    }
+    return FS_NOT_MOUNTED;
+}
+
+/**
+ * Pass a file to sink in FS_READ_CHUNK blocks, so its size is not limited by RAM
+ * @param path Path of file
+ * @param sink Called per block, return 0 to stop
+ * @param ctx Passed to sink
+ * @return File Error , No of Bytes passed to sink
+ */
+int FILESYSTEM::readStream(const char *path, fs_sink_fn sink, void *ctx)
+{
+    if (fsMounted)
+    {
+        File file = SPIFFS.open(path);
+        if (!file || file.isDirectory() || !sink)
         {
-            (*data) = file.read();
-            data++;
-            bRead++;
+            return FILE_OPEN_FAILED;
+        }
 
-            if (bRead > fileSize + 1)
+        uint8_t chunk[FS_READ_CHUNK];
+        int total = 0;
+        while (file.available())
+        {
+            int n = file.read(chunk, sizeof(chunk));
+            if (n <= 0)
+            {
+                break;
+            }
+            total += n;
+            if (!sink(ctx, chunk, n))
             {
-                return FILE_READ_OVERFLOW;
+                break;
             }
         }
-        (*data) = '\0';
-        return bRead;
+        file.close();
+        return total;
     }
     return FS_NOT_MOUNTED;
 }
 
+/**
+ * Delete a file
+ * @param path Path of file
+ * @return true if it is gone
+ */
+bool FILESYSTEM::removeFile(const char *path)
+{
+    if (!fsMounted)
+    {
+        return false;
+    }
+    SPIFFS.remove(path);
+    bool gone = !SPIFFS.exists(path);
+    statStore(path, gone ? 0 : -1);
+    return gone;
+}
+
+/**
+ * Forget the cached size of a file changed without this class
+ * @param path Path of file
+ */
+void FILESYSTEM::invalidate(const char *path)
+{
+    statStore(path, -1);
+}
+
 /**
  * Mount SPIFFS
  * @param void
@@ -113,7 +335,7 @@ bool FILESYSTEM::begin()
 }
 
 /**
- * check if mounted and read the file size
+ * check if mounted and read the file size, from the stat cache when it has it
  * @param fname file name
  * @return file Size
  */
@@ -121,13 +343,22 @@ int FILESYSTEM::getFileSize(const char *fname)
 {
     if (fsMounted)
     {
+        int size;
+        if (statLookup(fname, &size))
+        {
+            return size;
+        }
         File file = SPIFFS.open(fname);
         if (!file || file.isDirectory())
         {
             /*File Not Found*/
+            statStore(fname, 0);
             return 0;
         }
-        return file.size();
+        size = file.size();
+        file.close();
+        statStore(fname, size);
+        return size;
     }
     return 0;
 }
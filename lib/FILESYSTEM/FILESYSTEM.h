@@ -15,6 +15,7 @@
 
 #include "Arduino.h"
 #include "FS.h"
+#include "freertos/FreeRTOS.h"
 
 #define MAXFILES 50
 #define FS_NOT_MOUNTED (0)
@@ -22,28 +23,56 @@
 #define FILE_OPEN_FAILED_2 (-2)
 #define FILE_WRITE_FAILED (-3)
 #define FILE_NOT_FOUND (-4)
+#define FILE_TOO_LARGE (-5)
 #define FILE_WRITE_SUCCESSFUL (1)
 #define FILE_READ_OVERFLOW (2)
 #define FILE_CORRUPTED (3)
 #define FILE_REMOVE_FAILED (4)
 
+#define FS_READ_CHUNK 256        // bytes per flash read when streaming
+#define FS_STAT_CACHE_SIZE 64    // direct-mapped file size cache slots
+#define FS_TMP_SUFFIX ".tmp"     // atomic writes stage here, partial until renamed to FS_NEW_SUFFIX
+#define FS_NEW_SUFFIX ".new"     // complete staged copy, recoverAtomic() finishes its rename after a reset
+#define FS_PATH_MAX 40           // staging path buffer, SPIFFS names are 31 chars
+
+/* Chunk sink for readStream, same shape as http_sink_fn: return 0 to stop */
+typedef uint8_t (*fs_sink_fn)(void *ctx, const uint8_t *data, size_t len);
+
 class FILESYSTEM
 {
 private:
   /* data */
   bool fsMounted;
 
+  /* Size of files written or sized through this class, so polling a file's
+     size does not reopen it. Keyed by a hash of the path; a file that is
+     written around this class must be invalidate()d. */
+  struct StatEntry
+  {
+    uint32_t hash;
+    int32_t size; // -1: slot empty
+  };
+  StatEntry m_oStat[FS_STAT_CACHE_SIZE];
+  portMUX_TYPE m_xStatLock;
+  bool statLookup(const char *path, int *size);
+  void statStore(const char *path, int size);
+
 public:
   FILESYSTEM(/* args */);
   ~FILESYSTEM();
   bool begin();
   int writeFile(const char *path, const char *message);
-  int readFile(const char *path, char *data);
+  int writeFileAtomic(const char *path, const char *message);
+  bool recoverAtomic(const char *path);
+  int readFile(const char *path, char *data, size_t cap);
+  int readStream(const char *path, fs_sink_fn sink, void *ctx);
   int getFileSize(const char *fname);
+  bool removeFile(const char *path);
+  void invalidate(const char *path);
   bool isMounted(void);
   // File openFile(const char *fname); 
 
   //protected:
 };
 
-#endif
\ No newline at end of file
+#endif
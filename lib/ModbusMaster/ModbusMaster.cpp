@@ -46,6 +46,8 @@ ModbusMaster::ModbusMaster(void)
   _idle = 0;
   _preTransmission = 0;
   _postTransmission = 0;
+  _trace = 0;
+  _bResponseInADU = false;
 }
 
 /**
@@ -153,7 +155,7 @@ uint16_t ModbusMaster::receive(void)
 {
   if (_u8ResponseBufferIndex < _u8ResponseBufferLength)
   {
-    return _u16ResponseBuffer[_u8ResponseBufferIndex++];
+    return getResponseBuffer(_u8ResponseBufferIndex++);
   }
   else
   {
@@ -216,6 +218,20 @@ void ModbusMaster::postTransmission(void (*postTransmission)())
   _postTransmission = postTransmission;
 }
 
+/**
+Set trace callback function.
+
+This function gets called with the request ADU just before it is sent
+(false), and with the response bytes received when the transaction ends
+(true), whatever its status. The bytes are only valid during the call.
+
+@see ModbusMaster::ModbusMasterTransaction()
+*/
+void ModbusMaster::trace(void (*trace)(bool, const uint8_t *, uint8_t))
+{
+  _trace = trace;
+}
+
 
 /**
 Retrieve data from response buffer.
@@ -229,6 +245,11 @@ uint16_t ModbusMaster::getResponseBuffer(uint8_t u8Index)
 {
   if (u8Index < ku8MaxBufferSize)
   {
+    if (_bResponseInADU)
+    {
+      // register data: bytes are ordered H, L after slave, function, byte count
+      return word(_u8ModbusADU[2 * u8Index + 3], _u8ModbusADU[2 * u8Index + 4]);
+    }
     return _u16ResponseBuffer[u8Index];
   }
   else
@@ -238,6 +259,35 @@ uint16_t ModbusMaster::getResponseBuffer(uint8_t u8Index)
 }
 
 
+/**
+Retrieve the raw register bytes of the last register read without copying.
+
+The view points into the response ADU and stays valid until the next
+transaction. Bytes are in wire order (H, L per register).
+
+@param u8Length set to the number of bytes in the view (0 if none)
+@return pointer to the first data byte, NULL if the last response held no
+register data
+@ingroup buffer
+*/
+const uint8_t* ModbusMaster::getResponseBytes(uint8_t* u8Length)
+{
+  if (!_bResponseInADU)
+  {
+    if (u8Length)
+    {
+      *u8Length = 0;
+    }
+    return NULL;
+  }
+  if (u8Length)
+  {
+    *u8Length = _u8ResponseBufferLength << 1;
+  }
+  return &_u8ModbusADU[3];
+}
+
+
 /**
 Clear Modbus response buffer.
 
@@ -248,6 +298,7 @@ void ModbusMaster::clearResponseBuffer()
 {
   uint8_t i;
   
+  _bResponseInADU = false;
   for (i = 0; i < ku8MaxBufferSize; i++)
   {
     _u16ResponseBuffer[i] = 0;
@@ -599,7 +650,7 @@ Sequence:
 */
 uint8_t ModbusMaster::ModbusMasterTransaction(uint8_t u8MBFunction)
 {
-  uint8_t u8ModbusADU[256];
+  uint8_t *u8ModbusADU = _u8ModbusADU;
   uint8_t u8ModbusADUSize = 0;
   uint8_t i, u8Qty;
   uint16_t u16CRC;
@@ -607,6 +658,9 @@ uint8_t ModbusMaster::ModbusMasterTransaction(uint8_t u8MBFunction)
   uint8_t u8BytesLeft = 8;
   uint8_t u8MBStatus = ku8MBSuccess;
   
+  // the ADU buffer is about to be overwritten by the request
+  _bResponseInADU = false;
+  
   // assemble Modbus Request Application Data Unit
   u8ModbusADU[u8ModbusADUSize++] = _u8MBSlave;
   u8ModbusADU[u8ModbusADUSize++] = u8MBFunction;
@@ -692,11 +746,7 @@ uint8_t ModbusMaster::ModbusMasterTransaction(uint8_t u8MBFunction)
   }
   
   // append CRC
-  u16CRC = 0xFFFF;
-  for (i = 0; i < u8ModbusADUSize; i++)
-  {
-    u16CRC = crc16_update(u16CRC, u8ModbusADU[i]);
-  }
+  u16CRC = crc16_buffer(0xFFFF, u8ModbusADU, u8ModbusADUSize);
   u8ModbusADU[u8ModbusADUSize++] = lowByte(u16CRC);
   u8ModbusADU[u8ModbusADUSize++] = highByte(u16CRC);
   u8ModbusADU[u8ModbusADUSize] = 0;
@@ -704,15 +754,17 @@ uint8_t ModbusMaster::ModbusMasterTransaction(uint8_t u8MBFunction)
   // flush receive buffer before transmitting request
   while (_serial->read() != -1);
 
+  if (_trace)
+  {
+    _trace(false, u8ModbusADU, u8ModbusADUSize);
+  }
+
   // transmit request
   if (_preTransmission)
   {
     _preTransmission();
   }
-  for (i = 0; i < u8ModbusADUSize; i++)
-  {
-    _serial->write(u8ModbusADU[i]);
-  }
+  _serial->write(u8ModbusADU, u8ModbusADUSize);
   
   u8ModbusADUSize = 0;
   _serial->flush();    // flush transmit buffer
@@ -803,15 +855,16 @@ uint8_t ModbusMaster::ModbusMasterTransaction(uint8_t u8MBFunction)
     }
   }
   
+  if (_trace)
+  {
+    _trace(true, u8ModbusADU, u8ModbusADUSize);
+  }
+
   // verify response is large enough to inspect further
   if (!u8MBStatus && u8ModbusADUSize >= 5)
   {
     // calculate CRC
-    u16CRC = 0xFFFF;
-    for (i = 0; i < (u8ModbusADUSize - 2); i++)
-    {
-      u16CRC = crc16_update(u16CRC, u8ModbusADU[i]);
-    }
+    u16CRC = crc16_buffer(0xFFFF, u8ModbusADU, u8ModbusADUSize - 2);
     
     // verify CRC
     if (!u8MBStatus && (lowByte(u16CRC) != u8ModbusADU[u8ModbusADUSize - 2] ||
@@ -855,16 +908,14 @@ uint8_t ModbusMaster::ModbusMasterTransaction(uint8_t u8MBFunction)
       case ku8MBReadInputRegisters:
       case ku8MBReadHoldingRegisters:
       case ku8MBReadWriteMultipleRegisters:
-        // load bytes into word; response bytes are ordered H, L, H, L, ...
-        for (i = 0; i < (u8ModbusADU[2] >> 1); i++)
+        // response bytes are ordered H, L, H, L, ...; leave them in the ADU and
+        // decode on access in getResponseBuffer() instead of copying every word
+        _u8ResponseBufferLength = u8ModbusADU[2] >> 1;
+        if (_u8ResponseBufferLength > ku8MaxBufferSize)
         {
-          if (i < ku8MaxBufferSize)
-          {
-            _u16ResponseBuffer[i] = word(u8ModbusADU[2 * i + 3], u8ModbusADU[2 * i + 4]);
-          }
-          
-          _u8ResponseBufferLength = i;
+          _u8ResponseBufferLength = ku8MaxBufferSize;
         }
+        _bResponseInADU = true;
         break;
     }
   }
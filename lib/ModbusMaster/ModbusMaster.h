@@ -75,6 +75,7 @@ class ModbusMaster
     void idle(void (*)());
     void preTransmission(void (*)());
     void postTransmission(void (*)());
+    void trace(void (*)(bool, const uint8_t *, uint8_t));
 
     // Modbus exception codes
     /**
@@ -189,6 +190,7 @@ class ModbusMaster
     static const uint8_t ku8MBInvalidCRC                 = 0xE3;
     
     uint16_t getResponseBuffer(uint8_t);
+    const uint8_t* getResponseBytes(uint8_t*);
     void     clearResponseBuffer();
     uint8_t  setTransmitBuffer(uint8_t, uint16_t);
     void     clearTransmitBuffer();
@@ -233,6 +235,8 @@ class ModbusMaster
     uint16_t* rxBuffer; // from Wire.h -- need to clean this up Rx
     uint8_t _u8ResponseBufferIndex;
     uint8_t _u8ResponseBufferLength;
+    uint8_t _u8ModbusADU[256];                                   ///< last request/response ADU; register reads are decoded from it in place
+    bool _bResponseInADU;                                        ///< true when the response words live in _u8ModbusADU, not _u16ResponseBuffer
     
     // Modbus function codes for bit access
     static const uint8_t ku8MBReadCoils                  = 0x01; ///< Modbus function 0x01 Read Coils
@@ -260,6 +264,8 @@ class ModbusMaster
     void (*_preTransmission)();
     // postTransmission callback function; gets called after a Modbus message has been sent
     void (*_postTransmission)();
+    // trace callback function; gets the request ADU and the response ADU as received
+    void (*_trace)(bool, const uint8_t *, uint8_t);
 };
 #endif
 
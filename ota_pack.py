@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""Encode firmware images for the device OTA (see src/ota_engine.h).
+
+  ota_pack.py zip   new.bin out.bin           zlib-compressed full image
+  ota_pack.py delta old.bin new.bin out.bin   zlib-compressed delta against old.bin
+  ota_pack.py apply old.bin patch.bin out.bin decode a package, as the device does
+
+The delta base must be the exact image running on the device. The printed
+sha256 is that of the new image; pass it as "sha256" in the FOTA request.
+"""
+
+import hashlib
+import struct
+import sys
+import zlib
+
+BLOCK = 16          # match seed length
+MAX_MISS = 8        # mismatches tolerated per BLOCK bytes when extending a match
+
+
+def find_matches(old, new):
+    """Greedy bsdiff-style matching: (new_pos, old_pos, length) triples."""
+    index = {}
+    for i in range(0, len(old) - BLOCK + 1, 4):
+        index.setdefault(old[i:i + BLOCK], i)
+
+    matches = []
+    pos = 0
+    while pos + BLOCK <= len(new):
+        o = index.get(new[pos:pos + BLOCK])
+        if o is None:
+            pos += 1
+            continue
+        # Extend forward, allowing scattered differences (relocated addresses)
+        n = BLOCK
+        last_good = n
+        misses = []
+        while pos + n < len(new) and o + n < len(old):
+            if new[pos + n] != old[o + n]:
+                misses.append(n)
+                while misses and misses[0] <= n - BLOCK:
+                    misses.pop(0)
+                if len(misses) > MAX_MISS:
+                    break
+            else:
+                last_good = n + 1
+            n += 1
+        matches.append((pos, o, last_good))
+        pos += last_good
+    return matches
+
+
+def make_delta(old, new):
+    out = bytearray(b"WMD1")
+    out += struct.pack("<II", len(old), len(new))
+    out += hashlib.sha256(old).digest()
+
+    matches = find_matches(old, new)
+    # Bytes before the first match, and the seek to it
+    first = matches[0] if matches else (len(new), 0, 0)
+    out += struct.pack("<IIi", 0, first[0], first[1]) + new[:first[0]]
+    for i, (npos, opos, length) in enumerate(matches):
+        nxt = matches[i + 1] if i + 1 < len(matches) else (len(new), opos + length)
+        diff = bytes((new[npos + k] - old[opos + k]) & 0xFF for k in range(length))
+        extra = new[npos + length:nxt[0]]
+        out += struct.pack("<IIi", length, len(extra), nxt[1] - (opos + length))
+        out += diff + extra
+    return bytes(out)
+
+
+def apply(old, package):
+    data = zlib.decompress(package)
+    if data[:1] == b"\xe9":
+        return data
+    if data[:4] != b"WMD1":
+        raise ValueError("unknown payload")
+    old_size, new_size = struct.unpack_from("<II", data, 4)
+    if old_size != len(old) or data[12:44] != hashlib.sha256(old).digest():
+        raise ValueError("patch is for a different base image")
+    out = bytearray()
+    p = 44
+    old_pos = 0
+    while len(out) < new_size:
+        add, extra, seek = struct.unpack_from("<IIi", data, p)
+        p += 12
+        for k in range(add):
+            out.append((old[old_pos + k] + data[p + k]) & 0xFF)
+        p += add
+        out += data[p:p + extra]
+        p += extra
+        old_pos += add + seek
+    if p != len(data) or len(out) != new_size:
+        raise ValueError("corrupt patch")
+    return bytes(out)
+
+
+def main(argv):
+    if len(argv) == 4 and argv[1] == "zip":
+        new = open(argv[2], "rb").read()
+        pkg = zlib.compress(new, 9)
+    elif len(argv) == 5 and argv[1] == "delta":
+        old = open(argv[2], "rb").read()
+        new = open(argv[3], "rb").read()
+        pkg = zlib.compress(make_delta(old, new), 9)
+        if apply(old, pkg) != new:
+            raise SystemExit("delta round trip failed")
+    elif len(argv) == 5 and argv[1] == "apply":
+        old = open(argv[2], "rb").read()
+        new = apply(old, open(argv[3], "rb").read())
+        open(argv[4], "wb").write(new)
+        print("sha256 %s" % hashlib.sha256(new).hexdigest())
+        return
+    else:
+        raise SystemExit(__doc__)
+
+    if new[:1] != b"\xe9":
+        raise SystemExit("%s is not an ESP32 image" % argv[-2])
+    open(argv[-1], "wb").write(pkg)
+    print("%d -> %d bytes" % (len(new), len(pkg)))
+    print("sha256 %s" % hashlib.sha256(new).hexdigest())
+
+
+if __name__ == "__main__":
+    main(sys.argv)
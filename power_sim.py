@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Duty-cycle and energy-budget simulator for the power manager (src/power_manager.h).
+
+  power_sim.py                  replay the built-in field shift
+  power_sim.py profile.csv      replay "minutes,activity" lines
+
+Activities:
+  measure   operator at a pond: button press, countdown, reading
+  pond      standing in a pond without touching the device
+  walk      moving between ponds
+  still     device set down or in a bag outside any pond
+  charge    on the charger
+
+Thresholds and the mA budget are read from power_manager.h, so the model
+follows the firmware. The "always on" line is the draw before duty cycling.
+"""
+
+import re
+import sys
+from pathlib import Path
+
+HEADER = Path(__file__).resolve().parent / "src" / "power_manager.h"
+
+SHIFT = [
+    (10, "walk"), (3, "measure"), (2, "pond"),
+    (8, "walk"), (3, "measure"),
+    (45, "still"),
+    (12, "walk"), (3, "measure"), (3, "measure"),
+    (6, "walk"), (3, "measure"),
+    (90, "still"),
+    (15, "walk"), (3, "measure"), (5, "pond"), (3, "measure"),
+    (20, "walk"),
+    (120, "still"),
+]
+
+
+def load_constants():
+    consts = {}
+    for name, value in re.findall(r"#define (PWR_\w+) ([0-9.]+)f?", HEADER.read_text()):
+        consts[name] = float(value)
+    return consts
+
+
+def load_profile(path):
+    profile = []
+    for line in Path(path).read_text().splitlines():
+        line = line.split("#")[0].strip()
+        if line:
+            minutes, kind = line.split(",")
+            profile.append((float(minutes), kind.strip()))
+    return profile
+
+
+def simulate(profile, c):
+    """Step the state machine once a second, as the App task does every tick."""
+    time_in = {"active": 0, "walking": 0, "idle": 0}
+    charge_mas = 0.0
+    always_on_mas = 0.0
+    transitions = 0
+    state = "active"
+    last_activity = last_moving = 0
+    gps_window_end = next_gps_window = 0
+    now = 0
+
+    for minutes, kind in profile:
+        for _ in range(int(minutes * 60)):
+            if kind == "measure":
+                last_activity = now
+            gps_fresh = state != "idle" or now < gps_window_end
+            if gps_fresh and kind == "walk":
+                last_moving = now
+
+            busy = kind in ("measure", "charge")
+            in_pond = kind in ("measure", "pond")
+            if busy or now < last_activity + c["PWR_ACTIVE_HOLD_MS"] / 1000:
+                new = "active"
+            elif in_pond or now < last_moving + c["PWR_IDLE_AFTER_MS"] / 1000:
+                new = "walking"
+            else:
+                new = "idle"
+            if new != state:
+                transitions += 1
+                if new == "idle":
+                    gps_window_end = now
+                    next_gps_window = now + c["PWR_GPS_CHECK_MS"] / 1000
+            state = new
+
+            if state == "idle" and now >= next_gps_window:
+                gps_window_end = now + c["PWR_GPS_WINDOW_MS"] / 1000
+                next_gps_window = now + c["PWR_GPS_CHECK_MS"] / 1000
+            awake = state != "idle" or now < gps_window_end
+
+            if state == "active":
+                ma = c["PWR_MA_ACTIVE"]
+            elif state == "walking":
+                ma = c["PWR_MA_WALKING"]
+            else:
+                ma = c["PWR_MA_IDLE_AWAKE"] if awake else c["PWR_MA_IDLE_SLEEP"]
+            if kind != "charge":
+                charge_mas += ma
+                always_on_mas += c["PWR_MA_ACTIVE"]
+            time_in[state] += 1
+            now += 1
+
+    return time_in, charge_mas / 3600, always_on_mas / 3600, transitions, now
+
+
+def main():
+    c = load_constants()
+    profile = load_profile(sys.argv[1]) if len(sys.argv) > 1 else SHIFT
+    time_in, mah, always_mah, transitions, seconds = simulate(profile, c)
+
+    hours = seconds / 3600
+    print(f"profile      {hours:.1f} h, {transitions} transitions")
+    for state, s in time_in.items():
+        print(f"{state:<12} {s / 60:6.1f} min  {100 * s / max(seconds, 1):5.1f} %")
+    for label, used in (("duty cycled", mah), ("always on", always_mah)):
+        avg = used / hours if hours else 0
+        life = c["PWR_BATTERY_MAH"] / avg if avg else 0
+        print(f"{label:<12} {used:6.0f} mAh  avg {avg:5.1f} mA  "
+              f"{life:5.1f} h per {c['PWR_BATTERY_MAH']:.0f} mAh charge")
+
+
+if __name__ == "__main__":
+    main()
@@ -7,7 +7,15 @@
 #include <WebServer.h>
 #include <DNSServer.h>
 #include "RPCHandlers.h"
+#include "rpc_dispatch.h"
 #include "http_ops.h"
+#include "CFrameWriter.h"
+#include "json_stream.h"
+#include "pond_bounds.h"
+#include "esp_wifi.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "soc/gpio_struct.h"
 
 // #define SERIAL_DEBUG  // Disabled to save flash memory - Enable only for debugging
 #ifdef SERIAL_DEBUG
@@ -24,12 +32,8 @@
 #define WAITTIME 6
 #endif
 
-#define INTERVAL_TIME_IN_SECONDS 180
-#define INTERVAL_WAKEUP_TIME_IN_SECONDS 180
-#define TIMER_WAKEUP_ENABLE
-#define SLEEP_TIME_IN_MICROSECONDS INTERVAL_TIME_IN_SECONDS * 1000000
-
 #define HOOTER_ON 0
+#define GPS_BAUD 38400
 
 SocketIOclient socketIO;
 const char *protocol = "arduino";
@@ -42,6 +46,10 @@ FILESYSTEM m_oFileSystem;
 CBackupStorage m_oBackupStore;
 struct http_device g_http_dev; // HTTP device with ops structure (C-style)
 struct do_sensor_device g_do_sensor; // DO sensor with ops structure (C-style)
+struct do_sensor_device g_aux_sensor; // Optional second probe on the same RS-485 pair
+struct sensor_bus g_sensor_bus; // RS-485 bus shared by all Modbus probes
+struct sample_trace g_sampleTrace; // DO/temp settling curve recorded during the countdown
+struct cal_engine g_calEngine; // Air-saturation calibration state machine for the primary probe
 struct geofence_device g_geofence; // Geofence with ops structure (C-style)
 CGps m_oGps;
 CDisplay m_oDisp;
@@ -66,14 +74,19 @@ AppTimers g_timers;
 AppConfig g_config;
 // Device Configuration
 DeviceConfig g_deviceConfig;
-// Sensor data struct
-SensorData g_sensorData;
-// Current pond information struct
+// Sensor data snapshot, published by the Modbus task
+CSnapshot<SensorData> g_sensorData;
+// Current pond information struct (App task working copy)
 CurrentPondInfo g_currentPond;
+// Current pond snapshot for the Frame task and RPC readers
+CSnapshot<CurrentPondInfo> g_pondSnapshot;
 
 int LoadedPondsWhileCheckingCurrentPond = 0;
 
-char sendResult[4000];
+struct rpc_reply_queue g_rpcReplies; // Framed replies waiting for the Socket.IO link
+struct frame_uplink g_frameUplink; // Data frames handed from the Frame task to the Socket.IO link
+struct wifi_manager g_wifiMgr; // Station reconnects, known networks and roaming
+struct power_manager g_power; // Active / walking / idle duty cycling
 char timebuffer[6];
 
 double SimulatedLat = 0.00000;
@@ -94,7 +107,10 @@ char m_cWifiSsid[20]; /*wifi name*/
  *******************/
 cApplication::cApplication()
 {
-    m_u8SendBackUpFrameConter = 0;
+    m_u32LastPingMs = 0;
+    m_u32LastBackupUploadMs = 0;
+    m_u32SalinityTicket = 0;
+    m_fProbeSalinity = 0;
     m_iRtcSyncCounter = 0;
     m_iFrameInProcess = NO_FRAME;
 }
@@ -135,6 +151,7 @@ static void onConnected()
         pingNow = true;
         xSemaphoreGive(xSharedVarMutex);
     }
+    app_events_signal(APP_EV_CONFIG_CHANGED);
 
     char LocalIp[25];
     String ipStr = WiFi.localIP().toString();
@@ -160,18 +177,6 @@ static void onDisConnected()
     strncpy(m_oDisp.DisplayFooterData.LocalIp, ipStr.c_str(), sizeof(m_oDisp.DisplayFooterData.LocalIp));
 }
 
-/************************************************************************
- * Wifi setup function which is called by the mDash library
- * wifi_network_name-> string holds wifi name
- * wifi_pass-> string holds wifi password
- * @param [in] wifi network name, wifi network password
- * @param [out] None
- *************************************************************************/
-static void init_wifi(const char *wifi_network_name, const char *wifi_pass)
-{
-    WiFi.begin(wifi_network_name, wifi_pass);
-}
-
 /***********************************************
  *  RPC Function to set the Calibration values to the DO sensor
  *  r-> pointer holds the Item data buffer
@@ -186,95 +191,41 @@ static void init_wifi(const char *wifi_network_name, const char *wifi_pass)
  ***************************************************************************************/
 void cApplication::wifiInitialization(void)
 {
-    init_wifi(m_cWifiSsid, m_cWifiPass);
-}
-
-void allRpcInit(void)
-{
-    debugPrintln("@@ [INIT] Registering RPC handlers");
-    jsonrpc_export("wifiConfig", RPChandler_setWifiCredentials);
-    jsonrpc_export("serverConfig", RPChandler_setServerCredntials);
-    jsonrpc_export("getSalinity", RPChandler_getSalinity);
-    jsonrpc_export("setOperationMode", RPChandler_setOperationMode);
-    jsonrpc_export("getPressure", RPChandler_getPressure);
-    jsonrpc_export("setLocalTimeOffset", RPChandler_setLocalTimeOffset);
-    jsonrpc_export("ClearBackupFiles", RPChandler_ClearBackupFiles);
-    jsonrpc_export("syncRTC", RPChandler_syncRTC);
-    jsonrpc_export("whoAreYou", RPChandler_whoAreYou);
-    jsonrpc_export("setCalValues", RPChandler_setCalValues);
-    jsonrpc_export("setSalinity", RPChandler_setSalinity);
-    jsonrpc_export("getCalValues", RPChandler_getCalValues);
-    jsonrpc_export("setPressure", RPChandler_setPressure);
-    jsonrpc_export("getConfig", RPChandler_getConfigIDs);
-    jsonrpc_export("FOTA", RPChandler_firmwareUpdate);
-    jsonrpc_export("getLiveFrame", RPChandler_refreshFrame);
-    jsonrpc_export("sysReboot", RPChandler_sysReboot);
-    jsonrpc_export("setDataFrequency", RPChandler_setInterval);
-    jsonrpc_export("ResetPondStatus", RPChandler_ResetPondStatus);
-    jsonrpc_export("SetPondMapResetTime", RPChandler_SetPondMapResetTime);
-    jsonrpc_export("ClearNonBackupFiles", RPChandler_ClearNonBackupFiles);
-    jsonrpc_export("SimulatePosts", RPChandler_SimulatedPosts);
-    jsonrpc_export("getFileList", RPChandler_getFileList);
-    jsonrpc_export("getFileContent", RPChandler_getFileContent);
-    jsonrpc_export("deleteFile", RPChandler_deleteFile);
-    jsonrpc_export("updateConfig", RPChandler_updateConfig);
-    jsonrpc_export("ActivateSafeMode", RPChandler_runSafeMode);
-    debugPrintln("@@ [INIT] RPC handlers registered");
-}
-
-static int sender(const char *frame, int frame_len, void *privdata)
-{
-    debugPrintf("@@ [SENDER] Called with frame_len=%d\n", frame_len);
-    
-    // Calculate current length and remaining space
-    size_t currentLen = strlen(sendResult);
-    size_t remainingSpace = sizeof(sendResult) - currentLen - 1; // -1 for null terminator
-    
-    debugPrintf("@@ [SENDER] currentLen=%d, remainingSpace=%d\n", currentLen, remainingSpace);
-    
-    // Only append if there's enough space
-    if (frame_len <= remainingSpace)
-    {
-        strncat(sendResult, frame, frame_len);
-        debugPrintln("@@ [SENDER] Frame appended successfully");
-    }
-    else
-    {
-        // Append what we can and log overflow
-        strncat(sendResult, frame, remainingSpace);
-        debugPrintf("@@ [SENDER] Buffer overflow! Needed %d bytes, had %d\n", frame_len, remainingSpace);
-    }
-    
-    debugPrintln("@@ [SENDER] Returning");
-    return 1;
+    /*Connects from the App task: cached AP first, then a scan of the known networks*/
+    wifi_manager_init(&g_wifiMgr, m_cWifiSsid, m_cWifiPass);
+}
+
+/*Hand one framed reply to the Socket.IO link*/
+static uint8_t sendRpcReply(const char *data, size_t len)
+{
+    debugPrintf("@@ [RPC] Reply: %.*s\n", (int)len, data);
+    return socketIO.sendEVENT(data, len) ? 1 : 0;
+}
+/*Hand one data frame event to the Socket.IO link*/
+static uint8_t sendFrameEvent(const char *data, size_t len)
+{
+    return socketIO.sendEVENT(data, len) ? 1 : 0;
 }
 /*Process RPC and call the function*/
-void processRPC(char *jsonString)
+void processRPC(const char *payload, size_t length)
 {
-    // debugPrint("Received JSON: ");
-    // debugPrintln(jsonString);
-    // Parse the outer array using ArduinoJson
-    DynamicJsonDocument outerDoc(2500); // Adjust the size according to your needs
-    DeserializationError outerError = deserializeJson(outerDoc, jsonString);
-    if (outerError == DeserializationError::Ok)
+    // Socket.IO event is ["<event>", {rpc object}]; point at the object in place
+    int rpcObjectLen = 0;
+    const char *rpcObject = rpc_event_object(payload, length, &rpcObjectLen);
+    if (rpcObject)
     {
-        // Access the second element (inner JSON string)
-        JsonObject innerJsonString = outerDoc[1];
-
-        String serializedRpcObject;
-        serializeJson(innerJsonString, serializedRpcObject);
-
         debugPrint("@@ [RPC] Complete RPC Object: ");
-        debugPrintln(serializedRpcObject);
+        debugPrintf("%.*s\n", rpcObjectLen, rpcObject);
 
-        jsonrpc_process(serializedRpcObject.c_str(), serializedRpcObject.length(), sender, NULL, NULL);
+        // Reply is printed straight into its own framed slot and sent right away
+        rpc_reply_slot_t *slot = rpc_reply_begin(&g_rpcReplies);
+        dispatchRPC(rpcObject, rpcObjectLen, rpc_reply_write, slot);
+        rpc_reply_commit(&g_rpcReplies, slot, rpcObject, rpcObjectLen);
+        rpc_reply_flush(&g_rpcReplies, sendRpcReply);
     }
     else
     {
-        // Failed to parse the outer array
-        debugPrint("Error: Unable to parse the Outer JSON (");
-        debugPrint(outerError.c_str());
-        debugPrintln(").");
+        debugPrintln("Error: Unable to find the RPC object in the event.");
     }
 }
 void socketIOEvent(const socketIOmessageType_t &type, uint8_t *payload, const size_t &length)
@@ -284,6 +235,8 @@ void socketIOEvent(const socketIOmessageType_t &type, uint8_t *payload, const si
     case sIOtype_DISCONNECT:
         debugPrintln("[IOc] Disconnected");
         m_oDisp.DisplayFooterData.isWebScoketsConnected = false;
+        rpc_reply_queue_reset(&g_rpcReplies);
+        frame_uplink_set_link(&g_frameUplink, 0);
         break;
 
     case sIOtype_CONNECT:
@@ -292,20 +245,19 @@ void socketIOEvent(const socketIOmessageType_t &type, uint8_t *payload, const si
         // join default namespace (no auto join in Socket.IO V3)
         socketIO.send(sIOtype_CONNECT, "/");
         m_oDisp.DisplayFooterData.isWebScoketsConnected = true;
+        frame_uplink_set_link(&g_frameUplink, 1);
         break;
 
     case sIOtype_EVENT:
         debugPrint("[IOc] Get event: ");
         debugPrintln((char *)payload);
-        processRPC((char *)payload);
+        processRPC((const char *)payload, length);
         break;
 
     case sIOtype_ACK:
         debugPrint("[IOc] Get ack: ");
         debugPrintln(length);
-
-        // hexdump(payload, length);
-
+        frame_uplink_on_ack(&g_frameUplink, (const char *)payload, length);
         break;
     case sIOtype_ERROR:
         debugPrint("[IOc] Get error: ");
@@ -412,6 +364,8 @@ void IRAM_ATTR handleButtonInterrupt()
     if (currentPhysicalState != lastPhysicalState)
     {
         unsigned long now = millis();
+        uint8_t pressed = (currentPhysicalState == LOW);
+        field_trace_record(FIELD_TRACE_BUTTON, &pressed, sizeof(pressed));
 
         if (currentPhysicalState == LOW)
         {
@@ -427,6 +381,16 @@ void IRAM_ATTR handleButtonInterrupt()
     }
 }
 
+/*While idle the button is a level wake-up source: the press that wakes the CPU
+  is latched here, as it may be released long before the next PowerHandler tick.
+  The level interrupt is masked at once so a held button does not refire it;
+  PowerHandler re-arms the pin when it leaves idle*/
+void IRAM_ATTR handleButtonWake()
+{
+    GPIO.pin[BSP_BTN_1].int_type = GPIO_INTR_DISABLE;
+    ButtonState.wakeLatched = true;
+}
+
 void cApplication::CheckForButtonEvent()
 {
     static bool isButtonPressed = false;
@@ -435,6 +399,10 @@ void cApplication::CheckForButtonEvent()
 
     unsigned long now = millis();
 
+    /*A press, a release or a running countdown keeps the device active*/
+    if (!ButtonState.buttonReleased || ButtonState.buttonChanged || isButtonPressed)
+        power_manager_activity(&g_power, now);
+
     // Countdown handler - update timer continuously
     if (isButtonPressed)
     {
@@ -447,9 +415,12 @@ void cApplication::CheckForButtonEvent()
     {
         g_timers.countDownTimer = 0;
         isButtonPressed = false;
+        sample_trace_stop(&g_sampleTrace);
+        sensor_bus_set_interval(&g_sensor_bus, PRIMARY_PROBE_SLAVE_ID, SENSOR_BUS_DEFAULT_INTERVAL_MS);
         m_oDisp.DisplayGeneralVariables.Counter = 0; // Reset counter display
         buzz = 10;
         sendFrameType = VDIFF_FRAME;
+        app_events_signal(APP_EV_FRAME_REQUEST);
         m_oDisp.PopUpDisplayData.UploadStatus = NO_FRAME_IN_PROCESS;
         debugPrintln("Generated Frame");
     }
@@ -531,6 +502,13 @@ void cApplication::CheckForButtonEvent()
             {
                 isButtonPressed = true;
                 countdownStartTime = now; // Store countdown start time
+                /*Poll the primary probe at the trace rate while the curve is recorded*/
+                sample_trace_start(&g_sampleTrace, now);
+                if (g_sampleTrace.length)
+                {
+                    sensor_bus_set_interval(&g_sensor_bus, PRIMARY_PROBE_SLAVE_ID, g_sampleTrace.rate_ms);
+                    app_events_signal(APP_EV_SENSOR_BUS);
+                }
                 buzz = 5;
                 debugPrintln(" Button Pressed CountDown Start");
                 m_oDisp.PopUpDisplayData.UploadStatus = FRAME_CAPTURE_COUNTDOWN;
@@ -649,6 +627,9 @@ void cApplication::print_restart_reason()
  *******************************************************************************/
 time_t cApplication::SendPing(void)
 {
+    /*Metrics summary rides along when enabled through setPingMetrics*/
+    if (!g_config.pingMetrics || !perf_metrics_ping_query(g_http_dev.ping_query, sizeof(g_http_dev.ping_query)))
+        g_http_dev.ping_query[0] = '\0';
     return http_upload_ping_frame(&g_http_dev);
 }
 
@@ -663,12 +644,79 @@ void cApplication::updatePopUpDisplay(uint8_t uploadStatus, const char *timeStr,
     m_oDisp.PopUpDisplayData.doValue = doValue;
 }
 
+/*******************************************************************************
+ * Upload one data frame over the Socket.IO link when it is up, HTTP otherwise
+ * A frame the socket did not confirm is posted over HTTP before it goes to backup
+ *******************************************************************************/
+bool cApplication::uploadFrame(char *frame, size_t len)
+{
+    if (!g_appState.isOnline)
+        return false;
+
+    uint32_t start = millis();
+    bool uploaded;
+    if (g_config.frameTransport == FRAME_TRANSPORT_SOCKET && frame_uplink_link_up(&g_frameUplink))
+    {
+        if (frame_uplink_open(&g_frameUplink, FRAME_UPLINK_EVENT_SINGLE, 0))
+        {
+            if (frame_uplink_append(&g_frameUplink, frame, len))
+            {
+                uploaded = frame_uplink_transmit(&g_frameUplink, FRAME_UPLINK_ACK_TIMEOUT_MS);
+                traceUplink(FRAME_TRANSPORT_SOCKET, uploaded, 1, start);
+                if (uploaded)
+                    return true;
+            }
+            else
+            {
+                frame_uplink_discard(&g_frameUplink);
+            }
+        }
+        debugPrintln("[App][uploadFrame] socket failed, trying HTTP");
+        start = millis();
+    }
+    uploaded = http_upload_data_frame(&g_http_dev, frame);
+    traceUplink(FRAME_TRANSPORT_HTTP, uploaded, 1, start);
+    return uploaded;
+}
+
+/*Uplink outcome for the field trace, nothing is kept unless a recording runs*/
+void cApplication::traceUplink(uint8_t transport, bool ok, uint16_t frames, uint32_t startMs)
+{
+    struct field_trace_uplink rec = {transport, (uint8_t)ok, frames, millis() - startMs};
+    field_trace_record(FIELD_TRACE_UPLINK, &rec, sizeof(rec));
+}
+
+/*Pull the display and pond map fields out of a stored frame, false if it is not a frame*/
+static bool readBackupFrame(const char *frame, int len, BackupEntry_t *entry, bool *dataError)
+{
+    const char *obj = NULL;
+    int objLen = 0;
+    if (len <= 0 || mjson_find(frame, len, "$", &obj, &objLen) != MJSON_TOK_OBJECT)
+        return false;
+
+    memset(entry, 0, sizeof(BackupEntry_t));
+    mjson_get_string(frame, len, "$.timeBuffer", entry->time, sizeof(entry->time));
+    mjson_get_string(frame, len, "$.PondName", entry->pName, sizeof(entry->pName));
+    double val = 0;
+    if (mjson_get_number(frame, len, "$.do", &val))
+        entry->doValue = val;
+    val = 0;
+    mjson_get_number(frame, len, "$.DataError", &val);
+    *dataError = ((int)val == PONDMAP_VALUE_TAKEN_BUT_ERROR);
+    return true;
+}
+
 /***********************************************************
  *   Send data from backup storage periodically if available
+ *   Over Socket.IO up to FRAME_UPLINK_BATCH_MAX frames go in one event
  ************************************************************/
 void cApplication::uploadframeFromBackUp(void)
 {
-    if (g_appState.isOnline)
+    if (!g_appState.isOnline)
+        return;
+
+    bool overSocket = (g_config.frameTransport == FRAME_TRANSPORT_SOCKET) && frame_uplink_link_up(&g_frameUplink);
+    if (!overSocket)
     {
         if (g_http_dev.is_busy)
         {
@@ -682,41 +730,66 @@ void cApplication::uploadframeFromBackUp(void)
             g_deviceConfig.pingEpoch = SendPing();
             return;
         }
-        if (m_oBackupStore.available())
+    }
+    if (!m_oBackupStore.available())
+        return;
+    if (overSocket && !frame_uplink_open(&g_frameUplink, FRAME_UPLINK_EVENT_BATCH, 1))
+        return;
+
+    debugPrintln("files in Backup Available..");
+    char fdata[2200] = {0};
+    BackupEntry_t entries[FRAME_UPLINK_BATCH_MAX];
+    bool dataError[FRAME_UPLINK_BATCH_MAX];
+    int maxFrames = overSocket ? FRAME_UPLINK_BATCH_MAX : 1;
+    int pending = m_oBackupStore.pendingFiles();
+    int n = 0;
+    while (n < maxFrames && n < pending)
+    {
+        int len = m_oBackupStore.peekFromBS(&m_oFileSystem, n, fdata, sizeof(fdata));
+        debugPrint(" [upload frame from backup] :\n");
+        debugPrintln(fdata);
+        if (!readBackupFrame(fdata, len, &entries[n], &dataError[n]))
         {
-            char fdata[1300] = {0};
-            debugPrintln("files in Backup Available..");
-            m_oBackupStore.readFromBS(&m_oFileSystem, fdata);
-
-            // Function to read pondName and timebuffer from the frame and print on display till the frame is sent
-            StaticJsonDocument<1300> doc;
-            DeserializationError error = deserializeJson(doc, fdata);
-            if (error)
-            {
-                debugPrintln("JSON parse error");
-            }
-            char Data[1300];
-            serializeJson(doc, Data);
-            debugPrint(" [upload frame from backup][fdata] :\n");
-            debugPrintln(fdata);
-            debugPrint(" [upload frame from backup][Data] :\n");
-            debugPrintln(Data);
-            if (http_upload_data_frame(&g_http_dev, Data)) //
+            /*An unreadable file would block the queue forever, skip it*/
+            if (n == 0)
             {
-                updatePopUpDisplay(BACKUP_FRAME_UPLOAD_SUCCESS, doc["timeBuffer"], doc["PondName"], doc["do"]);
+                debugPrintln("Skipping unreadable backup file");
                 m_oBackupStore.moveToNextFile(&m_oFileSystem);
-
-                if (doc["DataError"] != PONDMAP_VALUE_TAKEN_BUT_ERROR && (doc["PondName"][0] != '\0'))
-                {
-                    m_oPondConfig.updatePondStatus(doc["PondName"], PONDMAP_VALUE_FRAME_SENT_SUCESSFULLY);
-                }
             }
-            else
+            break;
+        }
+        if (overSocket && !frame_uplink_append(&g_frameUplink, fdata, len))
+            break;
+        n++;
+    }
+    if (n == 0)
+    {
+        if (overSocket)
+            frame_uplink_discard(&g_frameUplink);
+        return;
+    }
+
+    uint32_t start = millis();
+    bool uploaded = overSocket ? frame_uplink_transmit(&g_frameUplink, FRAME_UPLINK_ACK_TIMEOUT_MS)
+                               : http_upload_data_frame(&g_http_dev, fdata);
+    traceUplink(overSocket ? FRAME_TRANSPORT_SOCKET : FRAME_TRANSPORT_HTTP, uploaded, n, start);
+    BackupEntry_t *last = &entries[n - 1];
+    if (uploaded)
+    {
+        updatePopUpDisplay(BACKUP_FRAME_UPLOAD_SUCCESS, last->time, last->pName, last->doValue);
+        for (int i = 0; i < n; i++)
+        {
+            m_oBackupStore.moveToNextFile(&m_oFileSystem);
+            if (!dataError[i] && (entries[i].pName[0] != '\0'))
             {
-                updatePopUpDisplay(BACKUP_FRAME_UPLOAD_FAIL, doc["timeBuffer"], doc["PondName"], doc["do"]);
+                m_oPondConfig.updatePondStatus(entries[i].pName, PONDMAP_VALUE_FRAME_SENT_SUCESSFULLY);
             }
         }
     }
+    else
+    {
+        updatePopUpDisplay(BACKUP_FRAME_UPLOAD_FAIL, last->time, last->pName, last->doValue);
+    }
 }
 
 /*****************************************************************
@@ -739,98 +812,144 @@ void cApplication::updateJsonAndSendFrame(void)
         return;
     }
 
-    DynamicJsonDocument Data(1400);
-    /*****************************************************/
-    Data["reasonForPacket"] = "T";
-    if (sendFrameType == VDIFF_FRAME)
-    {
-        Data["reasonForPacket"] = "V";
-    }
-    Data["name"] = "DO";
-    Data["deviceId"] = WiFi.macAddress();
-    Data["routerMacId"] = WiFi.BSSIDstr();
-    Data["localIp"] = WiFi.localIP();
-    Data["fwVer"] = FW_VERSION;
-    Data["isReboot"] = -1;
+    /*Take one consistent copy of each shared record, the owning tasks keep running*/
+    const GpsFix fix = m_oGps.m_oFix.read();
+    const SensorData sensor = g_sensorData.read();
+    const CurrentPondInfo pond = g_pondSnapshot.read();
+    const float doMgl = roundToDecimals(sensor.doMglValue, 5);
+    const bool hasPond = (pond.CurrentPondName[0] != '\0');
+
+    /*Link details straight from the driver, no String temporaries*/
+    wifi_ap_record_t ap = {};
+    bool linkUp = (esp_wifi_sta_get_ap_info(&ap) == ESP_OK);
+    char routerMac[18];
+    snprintf(routerMac, sizeof(routerMac), "%02X:%02X:%02X:%02X:%02X:%02X",
+             ap.bssid[0], ap.bssid[1], ap.bssid[2], ap.bssid[3], ap.bssid[4], ap.bssid[5]);
+    IPAddress ip = WiFi.localIP();
+    char localIp[16];
+    snprintf(localIp, sizeof(localIp), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+
+    int isReboot = -1;
     if (g_deviceConfig.m_u8IsReboot)
     {
         g_deviceConfig.m_u8IsReboot = 0;
-        Data["isReboot"] = g_deviceConfig.espResetReason;
-    }
-    Data["FramesInBackUp"] = m_oDisp.DisplayGeneralVariables.backUpFramesCnt;
-    Data["wifiSSId"] = WiFi.SSID();
-    Data["rssi"] = WiFi.RSSI();
-    Data["epoch"] = g_deviceConfig.m_tEpoch;
-    Data["operationMode"] = g_config.operationMode;  // Using struct
-    Data["lat"] = m_oGps.mPosition.m_lat;
-    Data["lng"] = m_oGps.mPosition.m_lng;
-    Data["HDop"] = m_oGps.mPosition.hDop;
-    Data["Satellites"] = m_oGps.mPosition.m_iSatellites;
-    Data["IsGpsValid"] = m_oGps.m_bIsValid;
-    Data["rfId"] = "NO RFID";
-    Data["PondName"] = g_currentPond.CurrentPondName;  // Using struct
-    Data["pondId"] = g_currentPond.CurrentPondID;  // Using struct
-    Data["locationId"] = g_currentPond.CurrentLocationId;  // Using struct
-    Data["localOffsetTimeInMin"] = g_config.totalMinsOffSet;  // Using struct
-    Data["do"] = roundToDecimals(g_sensorData.doMglValue, 5);  // Using struct
-    Data["temp"] = g_sensorData.tempVal;  // Using struct
-    Data["saturationPCT"] = roundToDecimals(g_sensorData.doSaturationVal, 5);  // Using struct
-    Data["salinity"] = g_currentPond.CurrentPondSalinity;  // Using struct
-    Data["BatPercent"] = m_oDisp.DisplayHeaderData.batteryPercentage;
-    Data["isHistory"] = LIVE_FRAME;
-    Data["Nearest"] = getNearestPondString();
-    Data["timeBuffer"] = timebuffer;
-    Data["UpTime"] = millis()/1000;
-    Data["LstPNameChkTime"] = g_timers.lastPondNameCheckEpoch;  // Using struct
-    Data["PNameCheckingCntr"] = LoadedPondsWhileCheckingCurrentPond;
-    /*****************************************************/
+        isReboot = g_deviceConfig.espResetReason;
+    }
 
     /*CHeck Here whether the DO value have any error or not*/
-    if ((Data["do"] <= 0 || (Data["temp"] <= 10 || Data["temp"] >= 55)) && (Data["PondName"][0] != '\0'))
+    bool dataError = (doMgl <= 0 || sensor.tempVal <= 10 || sensor.tempVal >= 55) && hasPond;
+    if (dataError)
     {
-        m_oPondConfig.updatePondStatus(Data["PondName"], PONDMAP_VALUE_TAKEN_BUT_ERROR);
-        Data["DataError"] = PONDMAP_VALUE_TAKEN_BUT_ERROR;
+        m_oPondConfig.updatePondStatus(pond.CurrentPondName, PONDMAP_VALUE_TAKEN_BUT_ERROR);
+    }
+
+    /*****************************************************/
+    uint32_t buildStart = PERF_NOW();
+    char frame[2200];
+    CFrameWriter w(frame, sizeof(frame));
+    w.beginObject();
+    w.addString(FK_REASON_FOR_PACKET, (sendFrameType == VDIFF_FRAME) ? "V" : "T");
+    w.addString(FK_NAME, DEVICE_TYPE);
+    w.addString(FK_DEVICE_ID, m_cDeviceId);
+    w.addString(FK_ROUTER_MAC_ID, routerMac);
+    w.addString(FK_LOCAL_IP, localIp);
+    w.addInt(FK_FW_VER, FW_VERSION);
+    w.addInt(FK_IS_REBOOT, isReboot);
+    w.addInt(FK_FRAMES_IN_BACKUP, m_oDisp.DisplayGeneralVariables.backUpFramesCnt);
+    w.addString(FK_WIFI_SSID, linkUp ? (const char *)ap.ssid : "");
+    w.addInt(FK_RSSI, linkUp ? ap.rssi : 0);
+    w.addInt(FK_EPOCH, (long)g_deviceConfig.m_tEpoch);
+    w.addInt(FK_OPERATION_MODE, g_config.operationMode);
+    w.addFloat(FK_LAT, Is_Simulated_Lat_Longs ? SimulatedLat : fix.lat, 7);
+    w.addFloat(FK_LNG, Is_Simulated_Lat_Longs ? SimulatedLongs : fix.lng, 7);
+    w.addFloat(FK_HDOP, fix.hDop, 2);
+    w.addInt(FK_SATELLITES, fix.satellites);
+    w.addBool(FK_IS_GPS_VALID, fix.isValid);
+    w.addFloat(FK_POS_RADIUS, Is_Simulated_Lat_Longs ? 0.0f : fix.radiusM, 1);
+    w.addString(FK_RFID, "NO RFID");
+    w.addString(FK_POND_NAME, pond.CurrentPondName);
+    w.addString(FK_POND_ID, pond.CurrentPondID);
+    w.addString(FK_LOCATION_ID, pond.CurrentLocationId);
+    w.addInt(FK_POND_CONFIDENCE, pond.PondConfidence);
+    w.addInt(FK_LOCAL_OFFSET_MIN, g_config.totalMinsOffSet);
+    w.addFloat(FK_DO, doMgl, 5);
+    w.addFloat(FK_TEMP, sensor.tempVal, 3);
+    w.addFloat(FK_SATURATION_PCT, roundToDecimals(sensor.doSaturationVal, 5), 5);
+    w.addFloat(FK_SALINITY, pond.CurrentPondSalinity, 3);
+    w.addInt(FK_BAT_PERCENT, m_oDisp.DisplayHeaderData.batteryPercentage);
+    /*Single digit, flipped in place when the frame goes to backup*/
+    w.addInt(FK_IS_HISTORY, LIVE_FRAME);
+    size_t isHistoryPos = w.position() - 1;
+    w.addString(FK_NEAREST, pond.NearestPonds);
+    w.addString(FK_TIME_BUFFER, timebuffer);
+    w.addInt(FK_UP_TIME, millis() / 1000);
+    w.addInt(FK_LAST_PNAME_CHECK_TIME, (long)g_timers.lastPondNameCheckEpoch);
+    w.addInt(FK_PNAME_CHECKING_CNTR, LoadedPondsWhileCheckingCurrentPond);
+    /*Settling curve of the button capture, base64 of the delta-encoded sample blob*/
+    static char traceB64[SAMPLE_TRACE_MAX_B64];
+    if (sendFrameType == VDIFF_FRAME && sample_trace_encode_base64(&g_sampleTrace, traceB64, sizeof(traceB64)))
+    {
+        w.addString(FK_TRACE, traceB64);
+    }
+    sample_trace_clear(&g_sampleTrace);
+    /*Readings of every probe on the RS-485 bus, only when more than one is attached*/
+    if (g_sensor_bus.num_slots > 1)
+    {
+        w.beginArray(FK_PROBES);
+        for (uint8_t i = 0; i < g_sensor_bus.num_slots; i++)
+        {
+            struct do_sensor_device *probe = g_sensor_bus.slots[i].sensor;
+            w.beginObject();
+            w.addInt(FK_ID, g_sensor_bus.slots[i].slave_id);
+            w.addString(FK_NAME, probe->name);
+            w.addFloat(FK_DO, roundToDecimals(probe->do_mgl, 5), 5);
+            w.addFloat(FK_SATURATION_PCT, roundToDecimals(probe->do_percent, 5), 5);
+            w.addFloat(FK_TEMP, probe->temp, 3);
+            w.addBool(FK_CONNECTED, do_sensor_is_connected(probe));
+            w.endObject();
+        }
+        w.endArray();
+    }
+    if (dataError)
+    {
+        w.addInt(FK_DATA_ERROR, PONDMAP_VALUE_TAKEN_BUT_ERROR);
+    }
+    w.endObject();
+    PERF_RECORD(PERF_FRAME_BUILD, buildStart);
+    /*****************************************************/
+    if (!w.ok())
+    {
+        debugPrintln("[App][updateJsonAndSendFrame] frame does not fit the buffer");
+        m_iFrameInProcess = NO_FRAME;
+        sendFrameType = NO_FRAME;
+        m_oDisp.PopUpDisplayData.UploadStatus = FRAME_GEN_FAILED;
+        return;
     }
 
     debugPrintln(" Document ready with data");
     /*Try to send frame if device is online or save to backup memory*/
-    char frame[1400];
-    if (g_appState.isOnline)
+    debugPrint(frame);
+    bool uploaded = uploadFrame(frame, w.length());
+    if (uploaded)
     {
-        serializeJson(Data, frame);
-        debugPrint(frame);
-        if (!http_upload_data_frame(&g_http_dev, frame))
-        {
-            Data["isHistory"] = HISTORY_FRAME;
-            serializeJson(Data, frame);
-            m_oBackupStore.writeInBS(&m_oFileSystem, frame);
-
-            updatePopUpDisplay(FRAME_UPLOAD_FAIL, Data["timeBuffer"], Data["PondName"], Data["do"]);
-            if ((Data["DataError"] != PONDMAP_VALUE_TAKEN_BUT_ERROR) && (Data["PondName"][0] != '\0'))
-            {
-                m_oPondConfig.updatePondStatus(Data["PondName"], PONDMAP_VALUE_FRAME_STORED_TO_BACKUP);
-            }
-        }
-        else
+        updatePopUpDisplay(FRAME_UPLOAD_SUCCESS, timebuffer, pond.CurrentPondName, doMgl);
+        debugPrintln("[App][updateJsonAndSendFrame][uploadDataFrame][Success]");
+        if (!dataError && hasPond)
         {
-            updatePopUpDisplay(FRAME_UPLOAD_SUCCESS, Data["timeBuffer"], Data["PondName"], Data["do"]);
-            debugPrintln("[App][updateJsonAndSendFrame][uploadDataFrame][Success]");
-            if (Data["DataError"] != PONDMAP_VALUE_TAKEN_BUT_ERROR && (Data["PondName"][0] != '\0'))
-            {
-                m_oPondConfig.updatePondStatus(Data["PondName"], PONDMAP_VALUE_FRAME_SENT_SUCESSFULLY);
-            }
+            m_oPondConfig.updatePondStatus(pond.CurrentPondName, PONDMAP_VALUE_FRAME_SENT_SUCESSFULLY);
         }
     }
     else
     {
-        Data["isHistory"] = HISTORY_FRAME;
-        serializeJson(Data, frame);
+        frame[isHistoryPos] = '0' + HISTORY_FRAME;
         m_oBackupStore.writeInBS(&m_oFileSystem, frame);
+        PERF_COUNT(PERF_CNT_FRAME_BACKUP);
 
-        updatePopUpDisplay(FRAME_UPLOAD_FAIL_NO_INTERNET, Data["timeBuffer"], Data["PondName"], Data["do"]);
-        if ((Data["DataError"] != PONDMAP_VALUE_TAKEN_BUT_ERROR) && (Data["PondName"][0] != '\0'))
+        updatePopUpDisplay(g_appState.isOnline ? FRAME_UPLOAD_FAIL : FRAME_UPLOAD_FAIL_NO_INTERNET,
+                           timebuffer, pond.CurrentPondName, doMgl);
+        if (!dataError && hasPond)
         {
-            m_oPondConfig.updatePondStatus(Data["PondName"], PONDMAP_VALUE_FRAME_STORED_TO_BACKUP);
+            m_oPondConfig.updatePondStatus(pond.CurrentPondName, PONDMAP_VALUE_FRAME_STORED_TO_BACKUP);
         }
     }
 
@@ -994,6 +1113,16 @@ void cApplication::ResetPondBackupStatusMap(int day, int hour)
     }
 }
 
+/**************************************************
+ *   Function to put a posted frame event on the link between App ticks (APP_EV_LINK_TX)
+ **************************************************/
+void cApplication::serviceLink(void)
+{
+    if (m_oDisp.m_bSmartConfigMode || g_appState.doFota)
+        return;
+    frame_uplink_service(&g_frameUplink, sendFrameEvent);
+}
+
 /**************************************************
  *   Function to complete cApplication related tasks
  **************************************************/
@@ -1003,37 +1132,33 @@ void cApplication::applicationTask(void)
         return;
     m_oBsp.wdtfeed();
     socketIO.loop();
+    /*Reconnect and roam, also while a FOTA download runs*/
+    wifi_manager_service(&g_wifiMgr, millis());
 
     if (g_appState.doFota)
         return;
-    /* Update the display every 100millisecond*/
-    RunDisplay();
-    CheckForButtonEvent();
-
-    if (getSharedFlag(g_appState.sendFrame))
+    PowerHandler();
+    /*Field trace: follow the setFieldTrace RPC, then write out a full buffer*/
+    if (g_config.fieldTrace != field_trace_enabled())
     {
-        debugPrintln("@@ [APP] sendFrame flag detected - preparing RPC response");
-        debugPrint("@@ [APP] sendResult content: ");
-        debugPrintln(sendResult);
-        
-        String output = String("[\"rpcr\"," + String(sendResult) + "]");
-        
-        debugPrintln("@@ [APP] Sending RPC response via socketIO");
-        // Send event
-        socketIO.sendEVENT(output);
-        
-        debugPrintln("@@ [APP] RPC response sent");
-        // Print the serialized JSON for debugging
-        debugPrintln(output);
-        
-        debugPrintln("@@ [APP] Clearing sendResult buffer");
-        memset(sendResult, 0, sizeof(sendResult));
-        
-        debugPrintln("@@ [APP] Clearing sendFrame flag");
-        setSharedFlag(g_appState.sendFrame, false);
-        
-        debugPrintln("@@ [APP] RPC response handling complete");
+        if (g_config.fieldTrace && !field_trace_start())
+            g_config.fieldTrace = 0;
+        else if (!g_config.fieldTrace)
+            field_trace_stop();
     }
+    field_trace_flush(0);
+    /* Update the display every 100millisecond, less often while walking or idle*/
+    if (power_manager_display_due(&g_power, millis()))
+    {
+        PERF_SCOPE(PERF_DISPLAY);
+        RunDisplay();
+    }
+    CheckForButtonEvent();
+
+    /* Retry replies the link could not take when they were ready */
+    rpc_reply_flush(&g_rpcReplies, sendRpcReply);
+    /* Data frame or backup batch posted by the Frame task */
+    frame_uplink_service(&g_frameUplink, sendFrameEvent);
 
     /*Reset Device on receipt of devicedata ,like Clamps type Siteid,name*/
     if (rebootAfterSetDataCmd > 0)
@@ -1052,7 +1177,11 @@ void cApplication::applicationTask(void)
     if (m_u8AppConter1Sec >= 10)
     {
         convertTime(g_config.totalMinsOffSet);
-        m_oDisp.DisplayGeneralVariables.backUpFramesCnt = m_oBackupStore.countStoredFiles(&m_oFileSystem);
+        /*Only when a backup write, upload or clear moved the cursors*/
+        if (m_oBackupStore.countChanged())
+        {
+            m_oDisp.DisplayGeneralVariables.backUpFramesCnt = m_oBackupStore.pendingFiles();
+        }
 
         static int sec5timer = 0;
         sec5timer++;
@@ -1063,10 +1192,11 @@ void cApplication::applicationTask(void)
             //     Serial.printf("Pond: %s, isBoundariesAvailable: %d, BackupState: %d\n", pair.first.c_str(), pair.second.isBoundariesAvailable,pair.second.PondDataStatus);
             // }
 
-            long st = millis();
-            GetCurrentPondName();
+            {
+                PERF_SCOPE(PERF_POND_LOOKUP);
+                GetCurrentPondName();
+            }
             g_timers.lastPondNameCheckEpoch = g_deviceConfig.m_tEpoch;
-            debugPrint(" TIme taken to get all the ponds data: ");debugPrintln(millis() - st);
             sec5timer = 0;
             Serial.print(" Nearest Ponds: ");Serial.println(getNearestPondString());
         }
@@ -1082,12 +1212,10 @@ void cApplication::applicationTask(void)
         if ((g_appState.isOnline == false) || (g_http_dev.is_connected == false))
         {
             g_timers.rebootAfterOfflineCnt++;
-            g_timers.netCheckCounter++;
         }
         else
         {
             g_timers.rebootAfterOfflineCnt = 0;
-            g_timers.netCheckCounter = 0;
         }
 
         if (g_appState.isGPS)
@@ -1110,6 +1238,19 @@ void cApplication::GpsTask(void)
     m_oGps.gpstask();
 }
 
+/*****************************************************************************************************
+ * Chance that the true position lies within INSIDE_POND_TOLERANCE of a pond, in percent
+ * edgeDistance: signed distance to the pond edge, negative inside
+ * sigmaM: 1-sigma position uncertainty, taken along the edge normal; 0 for an exact position
+ ******************************************************************************************************/
+static uint8_t pondConfidence(double edgeDistance, float sigmaM)
+{
+    double margin = INSIDE_POND_TOLERANCE - edgeDistance;
+    if (sigmaM <= 0.0f)
+        return (margin >= 0) ? 100 : 0;
+    return (uint8_t)lround(50.0 * (1.0 + erf(margin / (sigmaM * M_SQRT2))));
+}
+
 /*****************************************************************************************************
  *Function to check my current coordinates with the coords present in the pondBoundaries and
   get the current pondName if the distance between me and the coords is less than 1 metre
@@ -1119,32 +1260,53 @@ void cApplication::GetCurrentPondName(void)
 {
     int cntr = 0;
     allPondsWithDistance.clear();
-    /*set the current location coordinates*/
+    /*set the current location coordinates, simulated ones override the GPS fix and are exact*/
+    const GpsFix fix = m_oGps.m_oFix.read();
+    m_oPosition location = {fix.lat, fix.lng};
+    float sigmaM = fix.radiusM;
     if (Is_Simulated_Lat_Longs)
     {
-        m_oGps.mPosition.m_lat = SimulatedLat;
-        m_oGps.mPosition.m_lng = SimulatedLongs;
+        location.m_lat = SimulatedLat;
+        location.m_lng = SimulatedLongs;
+        sigmaM = 0.0f;
     }
-
-    m_oPosition location = {m_oGps.mPosition.m_lat, m_oGps.mPosition.m_lng};
     debugPrintf("lat: %f, lng : %f\n", location.m_lat, location.m_lng);
-    int len = m_oPondConfig.m_u8TotalNoOfPonds;
-    debugPrintf("location versions size : %d \n", len);
-    /*read the data from the locationID file*/
-    for (int i = 0; i < len; i++)
-    {
-        char fileName[20] = "";
-        snprintf(fileName, sizeof(fileName), "/%s.txt", m_oPondConfig.m_oPondList[i].m_cPondname);
-        debugPrintf("Current FileName to check distance: %s\n", fileName);
-        int distanceFromNearestPond = readPondNameFromFile(fileName, location);
-        if(distanceFromNearestPond >= 0)
+    position_t point = {location.m_lat, location.m_lng};
+    /*walk the boundary of every pond the index says is on flash; the Frame task may be reloading the list*/
+    if (m_oPondConfig.lockPondList())
+    {
+        debugPrintf("location versions size : %d \n", (int)m_oPondConfig.m_oPondList.size());
+        for (const CPond &pond : m_oPondConfig.m_oPondList)
         {
-            cntr++;
-            updateAllPondsDistance(m_oPondConfig.m_oPondList[i].m_cPondname, distanceFromNearestPond);
+            if (!pond.m_u32BoundaryPoints)
+                continue;
+            double edgeDistance;
+            if (pond_bounds_edge_distance(pond.m_cPondname, point, &edgeDistance))
+            {
+                int distanceFromNearestPond = (edgeDistance > 0) ? (int)edgeDistance : 0;
+                uint8_t confidence = pondConfidence(edgeDistance, sigmaM);
+                debugPrintf("Distance to %s: %d (%d%%)\n", pond.m_cPondname, distanceFromNearestPond, confidence);
+                cntr++;
+                updateAllPondsDistance(pond.m_cPondname, distanceFromNearestPond, confidence);
+            }
         }
+        m_oPondConfig.unlockPondList();
     }
     finalizeNearestPonds();
     LoadedPondsWhileCheckingCurrentPond = cntr;
+
+    /*Publish the pond state, the Frame task must not walk allPondsWithDistance*/
+    safeStrcpy(g_currentPond.NearestPonds, getNearestPondString().c_str(), sizeof(g_currentPond.NearestPonds));
+    g_pondSnapshot.write(g_currentPond);
+
+    if (field_trace_enabled())
+    {
+        uint8_t rec[1 + sizeof(g_currentPond.CurrentPondName)];
+        size_t nameLen = strnlen(g_currentPond.CurrentPondName, sizeof(g_currentPond.CurrentPondName));
+        rec[0] = g_currentPond.PondConfidence;
+        memcpy(rec + 1, g_currentPond.CurrentPondName, nameLen);
+        field_trace_record(FIELD_TRACE_POND, rec, 1 + nameLen);
+    }
 }
 
 /*******************************************************************************************************************************
@@ -1165,6 +1327,7 @@ void cApplication::GetPondBoundaries(void)
             m_oDisp.printSavingCoordinates();
             if (response)
             {
+                m_oPondConfig.updateBoundaryIndex(it->second.c_str());
                 m_oPondConfig.m_pondStatusMap[it->second.c_str()].isBoundariesAvailable = AVAILABLE;
                 m_oPondConfig.m_pondStatusMap[it->second.c_str()].PondDataStatus = m_oPondConfig.m_pondStatusMap[it->second.c_str()].isActive;
                 // Erase the pair and move the iterator to the next element
@@ -1181,6 +1344,60 @@ void cApplication::GetPondBoundaries(void)
     }
 }
 
+/****************************************************************************************************
+ * Function to pass the calibration requests made in the config menu to the calibration engine
+ ****************************************************************************************************/
+void cApplication::CalibrationRequestHandler(void)
+{
+    bool request = m_oDisp.m_bStartCalibration || m_oDisp.m_bFinishCalibration ||
+                   m_oDisp.m_bAbortCalibration || m_oDisp.m_bAckCalibration;
+    if (m_oDisp.m_bStartCalibration)
+    {
+        m_oDisp.m_bStartCalibration = false;
+        cal_engine_start(&g_calEngine);
+    }
+    if (m_oDisp.m_bFinishCalibration)
+    {
+        m_oDisp.m_bFinishCalibration = false;
+        cal_engine_finish(&g_calEngine);
+    }
+    if (m_oDisp.m_bAbortCalibration)
+    {
+        m_oDisp.m_bAbortCalibration = false;
+        cal_engine_abort(&g_calEngine);
+    }
+    if (m_oDisp.m_bAckCalibration)
+    {
+        m_oDisp.m_bAckCalibration = false;
+        cal_engine_ack(&g_calEngine);
+    }
+    if (request)
+        app_events_signal(APP_EV_SENSOR_BUS);
+}
+
+/****************************************************************************************************
+ * Function to append the finished calibration to the history kept in NVS ("calHist")
+ ****************************************************************************************************/
+void cApplication::saveCalibrationRecord(void)
+{
+    cal_history_t history = {};
+    if (m_oMemory.getBytes("calHist", &history, sizeof(history)) != sizeof(history))
+    {
+        memset(&history, 0, sizeof(history));
+    }
+
+    cal_record_t record;
+    cal_engine_get_record(&g_calEngine, &record);
+    record.epoch = g_deviceConfig.m_tEpoch;
+
+    history.records[history.next % CAL_HISTORY_MAX] = record;
+    history.next = (history.next + 1) % CAL_HISTORY_MAX;
+    if (history.count < CAL_HISTORY_MAX)
+        history.count++;
+    m_oMemory.putBytes("calHist", &history, sizeof(history));
+    debugPrintf("[Calibration] saved record ok=%d k=%.5f\n", record.ok, record.k);
+}
+
 /****************************************************************************************************
  * Function to handle the reset actions that are made in display or buttons menu in config mode
  ****************************************************************************************************/
@@ -1198,15 +1415,31 @@ void cApplication::ResetHandler(void)
 
 void cApplication::AssignDataToDisplayStructs()
 {
+    /*Sensor panel only changes when the Modbus task publishes a new reading*/
+    static uint32_t sensorVersion = 0;
+    if (g_sensorData.version() != sensorVersion)
+    {
+        sensorVersion = g_sensorData.version();
+        const SensorData sensor = g_sensorData.read();
+        m_oDisp.DisplayLeftPanelData.DoSaturationValue = roundToDecimals(sensor.doSaturationVal, 2);
+        m_oDisp.DisplayLeftPanelData.DoValueMgL = roundToDecimals(sensor.doMglValue, 2);
+        m_oDisp.DisplayLeftPanelData.TempValue = roundToDecimals(sensor.tempVal, 1);
+        m_oDisp.DisplayLeftPanelData.Salinity = sensor.salinity;
+        m_oDisp.DisplayGeneralVariables.IsSensorConnected = sensor.isConnected;
+    }
+
+    cal_engine_get_progress(&g_calEngine, &m_oDisp.DisplayCalibrationData, millis());
+
+    const GpsFix fix = m_oGps.m_oFix.read();
     safeStrcpy(m_oDisp.DisplayLeftPanelData.pName, g_currentPond.CurrentPondName, sizeof(m_oDisp.DisplayLeftPanelData.pName));  // Using struct
     safeStrcpy(m_oDisp.DisplayLeftPanelData.nearestPonds, String(getNearestPondString()).c_str(), sizeof(m_oDisp.DisplayLeftPanelData.nearestPonds));
-    m_oDisp.DisplayHeaderData.Satellites = m_oGps.mPosition.m_iSatellites;
+    m_oDisp.DisplayHeaderData.Satellites = fix.satellites;
     m_oDisp.DisplayHeaderData.rssi = WiFi.RSSI();
     /* Check whether the GPS Coordinates are found or not*/
     // g_appState.isGPS = ((m_oGps.mPosition.m_lat != 0.0) && (m_oGps.mPosition.m_lng != 0.0)) ? true : false;
     // if (Is_Simulated_Lat_Longs)
     //     g_appState.isGPS = ((SimulatedLat != 0.0) && (SimulatedLongs != 0.0)) ? true : false;
-    g_appState.isGPS = m_oGps.m_bIsValid;
+    g_appState.isGPS = fix.isValid;
     m_oDisp.DisplayHeaderData.LocationStatus = g_appState.isGPS;
     m_oDisp.DisplayFooterData.isHttpConnected = g_http_dev.is_connected;
     /*Footer Data*/
@@ -1220,11 +1453,70 @@ void cApplication::AssignDataToDisplayStructs()
  ****************************************************************************************************/
 void cApplication::RunDisplay(void)
 {
+    CalibrationRequestHandler();
     AssignDataToDisplayStructs();
     unsigned long st = millis();
     m_oDisp.renderDisplay(currentScreen, &m_oPondConfig);
 }
 
+/****************************************************************************************************
+ * Function to pick the power state and apply it to the button wake-up and the probe poll rate
+ ****************************************************************************************************/
+void cApplication::PowerHandler(void)
+{
+    static uint8_t lastState = PWR_ACTIVE;
+    static bool sensorPaused = false;
+    uint32_t now = millis();
+
+    /*The button press that woke an idle CPU counts as activity, even if already released*/
+    if (lastState == PWR_IDLE && (ButtonState.wakeLatched || digitalRead(BSP_BTN_1) == LOW))
+    {
+        ButtonState.wakeLatched = false;
+        power_manager_activity(&g_power, now);
+    }
+
+    const GpsFix fix = m_oGps.m_oFix.read();
+    struct power_inputs in;
+    in.busy = (currentScreen != 1) || g_appState.isCharging || g_appState.doFota ||
+              cal_engine_is_busy(&g_calEngine) || (m_iFrameInProcess != NO_FRAME);
+    in.in_pond = (g_pondSnapshot.read().CurrentPondID[0] != '\0');
+    in.gps_valid = fix.isValid;
+    in.speed_mps = fix.speedMps;
+    uint8_t state = power_manager_update(&g_power, &in, now);
+    /*Faster fixes while walking between ponds, no effect with NMEA*/
+    m_oGps.setNavRate(state == PWR_WALKING ? GPS_RATE_WALKING_HZ : GPS_RATE_IDLE_HZ);
+
+    /*While idle the edge interrupt would miss a press during light sleep, so the
+      button becomes a level wake-up source whose ISR latches the press for the check above*/
+    if (state != lastState && (state == PWR_IDLE || lastState == PWR_IDLE))
+    {
+        if (state == PWR_IDLE)
+        {
+            detachInterrupt(digitalPinToInterrupt(BSP_BTN_1));
+            ButtonState.wakeLatched = false;
+            attachInterrupt(digitalPinToInterrupt(BSP_BTN_1), handleButtonWake, ONLOW);
+            gpio_wakeup_enable((gpio_num_t)BSP_BTN_1, GPIO_INTR_LOW_LEVEL);
+            esp_sleep_enable_gpio_wakeup();
+        }
+        else
+        {
+            gpio_wakeup_disable((gpio_num_t)BSP_BTN_1);
+            detachInterrupt(digitalPinToInterrupt(BSP_BTN_1));
+            attachInterrupt(digitalPinToInterrupt(BSP_BTN_1), handleButtonInterrupt, CHANGE);
+        }
+    }
+    lastState = state;
+
+    /*Slow the probe outside ponds, the countdown trace sets its own rate*/
+    bool pause = power_manager_sensor_paused(&g_power);
+    if (pause != sensorPaused && !g_sampleTrace.active)
+    {
+        sensor_bus_set_interval(&g_sensor_bus, PRIMARY_PROBE_SLAVE_ID, pause ? PWR_SENSOR_PAUSED_MS : SENSOR_BUS_DEFAULT_INTERVAL_MS);
+        app_events_signal(APP_EV_SENSOR_BUS);
+        sensorPaused = pause;
+    }
+}
+
 // TODO: seperate function for GPS and read the values every single time and update the gloabal variables in app.cpp instead from gps.cpp
 void convertEpoch(time_t epoch)
 {
@@ -1268,25 +1560,25 @@ void printSystemInfo()
 
 /****************************************************************************************************
  * Function to parse the commands from sensor comm:modbus RTU, when it is not in calibration mode
+ * Returns how long the task may sleep, a rate or calibration request (APP_EV_SENSOR_BUS) cuts it short
  ****************************************************************************************************/
-void cApplication::commandParseTask(void)
+uint32_t cApplication::commandParseTask(void)
 {
     if (g_appState.doFota)
     {
         m_oDisp.printFOTA(g_http_dev.curr_progress);
-        return;
+        return TASK_TICK_MS;
     }
     // printSystemInfo();
     m_oBsp.wdtfeed();
-    /*function to read the DO and Temp values only when not setting the calibration values to the sensor*/
-    if (!m_oDisp.StopReadingSensor)
-    {
-        do_sensor_read_values(&g_do_sensor);
-    }
-    else if (m_oDisp.StopReadingSensor)
+    /*read the DO and Temp values, then let the calibration engine use them or write to the sensor*/
+    sensor_bus_service(&g_sensor_bus);
+    /*Slots follow attach order and a probe that failed setup has none, so look the primary up by ID*/
+    const sensor_bus_slot_t *primary = sensor_bus_find_slot(&g_sensor_bus, PRIMARY_PROBE_SLAVE_ID);
+    uint32_t lastReadMs = primary ? primary->last_ok_ms : 0;
+    if (cal_engine_step(&g_calEngine, millis(), lastReadMs))
     {
-        m_oDisp.m_bCalibrationResponse = (do_sensor_set_calibration(&g_do_sensor) ? 1 : (do_sensor_set_calibration(&g_do_sensor) ? 1 : 0));
-        debugPrintf(" Calibration response values: %d \n", m_oDisp.m_bCalibrationResponse);
+        saveCalibrationRecord();
     }
 
     // Check sensor connection status (disconnected after 10 consecutive failures)
@@ -1300,46 +1592,68 @@ void cApplication::commandParseTask(void)
 
     if (validSensorData)
     {
-        // Update sensor data struct
-        g_sensorData.doMglValue = g_do_sensor.do_mgl;
-        g_sensorData.doSaturationVal = g_do_sensor.do_percent;
-        g_sensorData.tempVal = g_do_sensor.temp;
+        // Feed the countdown trace, duplicates of the same read are dropped by its rate check
+        sample_trace_record(&g_sampleTrace, lastReadMs,
+                            g_do_sensor.do_mgl, g_do_sensor.do_percent, g_do_sensor.temp);
 
-        // Update display
-        m_oDisp.DisplayLeftPanelData.DoSaturationValue = roundToDecimals(g_do_sensor.do_percent, 2);
-        m_oDisp.DisplayLeftPanelData.DoValueMgL = roundToDecimals(g_do_sensor.do_mgl, 2);
-        m_oDisp.DisplayLeftPanelData.TempValue = roundToDecimals(g_do_sensor.temp, 1);
-        m_oDisp.DisplayLeftPanelData.Salinity = g_do_sensor.salinity;
-        
-        // Sensor is connected
-        m_oDisp.DisplayGeneralVariables.IsSensorConnected = true;
+        // Publish the reading as one record, the display picks it up in the App task
+        SensorData reading;
+        reading.doMglValue = g_do_sensor.do_mgl;
+        reading.doSaturationVal = g_do_sensor.do_percent;
+        reading.tempVal = g_do_sensor.temp;
+        reading.salinity = g_do_sensor.salinity;
+        reading.isConnected = true;
+        g_sensorData.write(reading);
     }
     else if (!sensorConnected)
     {
         // Sensor disconnected (10 consecutive failures) - reset working values
         debugPrintln(" [App][commandParseTask] Sensor disconnected - resetting working values");
         
-        // Reset sensor data struct
-        g_sensorData.tempVal = 0.0;
-        g_sensorData.doSaturationVal = 0.0;
-        g_sensorData.doMglValue = 0.0;
-        
-        // Reset display
-        m_oDisp.DisplayLeftPanelData.TempValue = 0.0;
-        m_oDisp.DisplayLeftPanelData.DoSaturationValue = 0;
-        m_oDisp.DisplayLeftPanelData.DoValueMgL = 0;
-        m_oDisp.DisplayLeftPanelData.Salinity = 0.0;
-        
-        // Update connection status
-        m_oDisp.DisplayGeneralVariables.IsSensorConnected = false;
+        // Publish zeroed values with the disconnected state, only on the transition
+        if (g_sensorData.read().isConnected || !g_sensorData.version())
+        {
+            SensorData reading;
+            g_sensorData.write(reading);
+        }
     }
+
+    /*Sleep until the next probe is due; the calibration engine also times its own steps*/
+    if (cal_engine_is_busy(&g_calEngine))
+        return TASK_TICK_MS;
+    uint32_t idle = sensor_bus_idle_ms(&g_sensor_bus, millis());
+    if (idle < SENSOR_IDLE_MIN_MS)
+        return SENSOR_IDLE_MIN_MS;
+    return (idle < SENSOR_IDLE_MAX_MS) ? idle : SENSOR_IDLE_MAX_MS;
+}
+
+// -----------------------------------------------------
+// Purpose : Hand the pond salinity to the probe through the Modbus task, which owns the
+//           RS-485 bus. Written once per change; a failed write is posted again on the
+//           next pond check
+// -----------------------------------------------------
+void cApplication::postPondSalinity(float salinity)
+{
+    float written;
+    uint8_t res = sensor_bus_result(&g_sensor_bus, m_u32SalinityTicket, &written, NULL);
+    if (res == SENSOR_BUS_RES_PENDING)
+        return;
+    if (res == SENSOR_BUS_RES_OK)
+        m_fProbeSalinity = written;
+    m_u32SalinityTicket = 0;
+
+    if (salinity == m_fProbeSalinity)
+        return;
+    m_u32SalinityTicket = sensor_bus_post(&g_sensor_bus, PRIMARY_PROBE_SLAVE_ID, SENSOR_BUS_OP_SET_SALINITY, salinity);
+    if (m_u32SalinityTicket)
+        app_events_signal(APP_EV_SENSOR_BUS);
 }
 
 // -----------------------------------------------------
 // Function: updateAllPondsDistance
 // Purpose : Add each pond’s distance to the list
 // -----------------------------------------------------
-void cApplication::updateAllPondsDistance(const char *pondName, int distance)
+void cApplication::updateAllPondsDistance(const char *pondName, int distance, uint8_t confidence)
 {
     if (distance < 0.0f || distance > NEAREST_POND_MAX_VALUE)
         return;
@@ -1348,47 +1662,62 @@ void cApplication::updateAllPondsDistance(const char *pondName, int distance)
     strncpy(p.name, pondName, sizeof(p.name));
     p.name[sizeof(p.name) - 1] = '\0';
     p.distance = distance;
+    p.confidence = confidence;
 
     allPondsWithDistance.push_back(p);
 }
 
 // -----------------------------------------------------
-// Purpose : Sort ponds and detect current pond (if distance is less than the Inside the pond tolerance value)
+// Purpose : Sort ponds and detect current pond (by confidence, with hysteresis so a pond
+//           does not flap while the operator stands on a bund)
 // -----------------------------------------------------
 void cApplication::finalizeNearestPonds()
 {
     if (allPondsWithDistance.empty())
         return;
 
-    // Sort by ascending distance
+    // Sort by ascending distance, deepest inside first
     std::sort(allPondsWithDistance.begin(), allPondsWithDistance.end(),
               [](const PondDistance &a, const PondDistance &b)
-              { return a.distance < b.distance; });
+              { return (a.distance != b.distance) ? a.distance < b.distance : a.confidence > b.confidence; });
+
+    // Keep the current pond while it stays plausible, switch only on a confident position
+    int current = -1;
+    int best = 0;
+    for (size_t i = 0; i < allPondsWithDistance.size(); i++)
+    {
+        if (!strcmp(allPondsWithDistance[i].name, g_currentPond.CurrentPondName) &&
+            allPondsWithDistance[i].confidence >= POND_EXIT_CONFIDENCE)
+            current = (int)i;
+        if (allPondsWithDistance[i].confidence > allPondsWithDistance[best].confidence)
+            best = (int)i;
+    }
+    if (current < 0 && allPondsWithDistance[best].confidence >= POND_ENTER_CONFIDENCE)
+        current = best;
 
     // Check if the device is inside a pond
-    if (allPondsWithDistance[0].distance <= INSIDE_POND_TOLERANCE)
+    if (current >= 0)
     {
+        // The current pond leads the list, getNearestPondString() lists the others
+        std::rotate(allPondsWithDistance.begin(), allPondsWithDistance.begin() + current, allPondsWithDistance.begin() + current + 1);
+        g_currentPond.PondConfidence = allPondsWithDistance[0].confidence;
+
         // Update pond info struct
         strncpy(g_currentPond.CurrentPondName, allPondsWithDistance[0].name, sizeof(g_currentPond.CurrentPondName));
         Serial.print("Current Pond Name: "); Serial.println(g_currentPond.CurrentPondName);
         g_currentPond.CurrentPondName[sizeof(g_currentPond.CurrentPondName) - 1] = '\0';
 
-        for (int j = 0; j < m_oPondConfig.m_u8TotalNoOfPonds; j++)
+        CPond pond;
+        if (m_oPondConfig.findPond(g_currentPond.CurrentPondName, pond))
         {
-            if (strcmp(m_oPondConfig.m_oPondList[j].m_cPondname, g_currentPond.CurrentPondName) == 0)
-            {
-                // Found the pond — copy details to struct
-                strcpy(g_currentPond.CurrentPondID, m_oPondConfig.m_oPondList[j].m_cPondId);
-                strcpy(g_currentPond.CurrentLocationId, m_oPondConfig.m_oPondList[j].m_cLocationID);
-                g_currentPond.CurrentPondSalinity = m_oPondConfig.m_oPondList[j].m_iSalinity;
-                g_do_sensor.salinity = g_currentPond.CurrentPondSalinity;
-            }
+            // Found the pond — copy details to struct
+            strcpy(g_currentPond.CurrentPondID, pond.m_cPondId);
+            strcpy(g_currentPond.CurrentLocationId, pond.m_cLocationID);
+            g_currentPond.CurrentPondSalinity = pond.m_iSalinity;
         }
-        if (g_do_sensor.salinity)
+        if (g_currentPond.CurrentPondSalinity)
         {
-            int val = do_sensor_set_salinity(&g_do_sensor, g_do_sensor.salinity);
-            if (!val)
-                do_sensor_set_salinity(&g_do_sensor, g_do_sensor.salinity);
+            postPondSalinity(g_currentPond.CurrentPondSalinity);
         }
     }
     else
@@ -1399,7 +1728,7 @@ void cApplication::finalizeNearestPonds()
         strcpy(g_currentPond.CurrentLocationId, "");
         strcpy(g_currentPond.CurrentPondID, "");
         g_currentPond.CurrentPondSalinity = 0;
-        g_do_sensor.salinity = 0;
+        g_currentPond.PondConfidence = 0;
         debugPrintln("There is No pond for the current coordinates");
     }
 
@@ -1479,77 +1808,6 @@ String cApplication::getNearestPondString()
     return msg;
 }
 
-/****************************************************************************************************
- * Function to read pond name from file
- ****************************************************************************************************/
-int cApplication::readPondNameFromFile(const char *path, m_oPosition data)
-{
-    char output[3500];
-    /*read the file and copy to output buffer*/
-    int ret = m_oFileSystem.readFile(path, output);
-    // Serial.println(output);
-    if (ret > 0)
-    {
-        debugPrintln("File read succesfully");
-        StaticJsonDocument<7000> deviceInfo;
-        DeserializationError err = deserializeJson(deviceInfo, output); /*Deserialize the json document*/
-        if (err.code() == DeserializationError::Ok)                     /*check for deserialization error*/
-        {
-            if (deviceInfo.containsKey("config"))
-            {
-                JsonObject config = deviceInfo["config"];
-                if (config.containsKey("posts"))
-                {
-                    int length = deviceInfo["config"]["posts"].size();
-                    debugPrintf("@@ length : %d\n", length);
-                    if (length)
-                    {
-                        m_oPosition m_aPosts[length] = {};
-                        for (int i = 0; i < length; i++)
-                        {
-                            m_aPosts[i].m_lat = config["posts"][i]["lat"].as<double>();
-                            m_aPosts[i].m_lng = config["posts"][i]["lng"].as<double>();
-                        }
-                        /*Geo fencing*/
-                        double value = geofence_is_bot_inside_geofence(&g_geofence, m_aPosts, length, data);
-                        debugPrintf("value = %f\n", value);
-                        return value;
-                    }
-                }
-                else
-                {
-                    debugPrintln("[App][ReadPNameFromFile]: There is no key named posts in the JSON");
-                }
-            }
-            else
-            {
-                debugPrintln("@@ not found");
-            }
-        }
-        else
-        {
-            debugPrintln("[App][ReadPNameFromFile]: Deserialization error...");
-        }
-    }
-    else
-    {
-        debugPrintln("[App][ReadPNameFromFile]: File reading failed..");
-    }
-    return -1;
-}
-
-/*********************************************************
- * Function for Switch wifi Networks
- * @param [in] None
- * @param [out] None
- *********************************************************/
-void cApplication::reconnectWifi(void)
-{
-    debugPrintln("@@ reconnectWifi  network....");
-    WiFi.disconnect();
-    WiFi.begin(m_cWifiSsid, m_cWifiPass);
-}
-
 /**************************************************************
  * funciton to check esp32 is connected to wifi
  * @param [in] None
@@ -1593,30 +1851,22 @@ void cApplication::frameHandlingTask(void)
     }
     m_oBsp.wdtfeed();
 
-    /*Check for multiple Wifi Networks when device is offline every 15sec*/
-    if (g_timers.netCheckCounter > 15)
-    {
-        g_timers.netCheckCounter = 0;
-        reconnectWifi();
-    }
-
-    static int cntr = 0;
-    if (cntr >= 50 && g_http_dev.is_connected)
+    /*Timed by the clock, a frame request wakes this task early*/
+    uint32_t now = millis();
+    if (now - m_u32LastPingMs >= PING_INTERVAL_MS && g_http_dev.is_connected)
     {
         SendPing();
-        cntr = 0;
+        m_u32LastPingMs = now;
     }
-    cntr++;
 
     /*Sends frame from backup if any, and if not connceted ping*/
-    m_u8SendBackUpFrameConter++;
-    if (m_u8SendBackUpFrameConter >= 10)
+    if (now - m_u32LastBackupUploadMs >= BACKUP_UPLOAD_INTERVAL_MS)
     {
-        m_u8SendBackUpFrameConter = 0;
+        m_u32LastBackupUploadMs = now;
         uploadframeFromBackUp();
     }
 
-    if (g_timers.timeOutFrameCounter > 5 * 60 && sendFrameType == NO_FRAME && strcmp(g_currentPond.CurrentPondID, "") == 0)
+    if (g_timers.timeOutFrameCounter > 5 * 60 && sendFrameType == NO_FRAME && g_pondSnapshot.read().CurrentPondID[0] == '\0')
     {
         debugPrintln("@ generating T T T frame");
         g_timers.timeOutFrameCounter = 0;
@@ -1635,16 +1885,23 @@ void cApplication::frameHandlingTask(void)
 /***********************************************************
  * Function to get firmware and update device
  * @param [in] None
- * @param [out] None
+ * @param [out] How long the task may sleep, APP_EV_OTA_REQUEST wakes it
  ***********************************************************/
-void cApplication::fotaTask(void)
+uint32_t cApplication::fotaTask(void)
 {
     if (m_oDisp.m_bSmartConfigMode)
-        return;
+        return TASK_TICK_MS;
 
     m_oBsp.wdtfeed();
+    static unsigned long otaRetryAt = 0;
     if (g_appState.doFota)
     {
+        /*An interrupted download waits for the link, then resumes where it stopped*/
+        if (!g_appState.isOnline)
+            return TASK_TICK_MS;
+        long retryInMs = (long)(otaRetryAt - millis());
+        if (retryInMs > 0)
+            return (uint32_t)retryInMs;
         m_oBsp.wdtfeed();
         sendFrameType = NO_FRAME;
         debugPrintln("Calling performOTA()");
@@ -1658,11 +1915,17 @@ void cApplication::fotaTask(void)
         case 5:
             debugPrintln("OTA fail due to http busy, retrying...");
             break;
+        case 6:
+            debugPrintln("OTA interrupted, resuming shortly...");
+            otaRetryAt = millis() + OTA_RETRY_DELAY_MS;
+            break;
         default:
             g_appState.doFota = false;
             break;
         }
     }
+    /*Dormant until firmwareUpdate, waking only to feed the watchdog*/
+    return g_appState.doFota ? TASK_TICK_MS : APP_EVENTS_IDLE_MS;
 }
 /*
  * Check and sync rTc
@@ -1709,6 +1972,44 @@ void cApplication::CheckAndSyncRTC(void)
 }
 
 
+/****************************************************************
+ * Config download in progress: the body is written to a staging
+ * file as it arrives while the tokenizer picks the header fields
+ *****************************************************************/
+struct ConfigIngest
+{
+    struct json_stream js;
+    File file;
+    int64_t version;
+    int operationMode;
+    bool writeError;
+};
+
+static uint8_t configEvent(struct json_stream *js, uint8_t ev, const char *value, size_t len)
+{
+    ConfigIngest *in = (ConfigIngest *)js->ctx;
+    if (json_stream_depth(js) == 1 && ev == JSON_EV_NUMBER)
+    {
+        const char *key = json_stream_key(js, 0);
+        if (!strcmp(key, "version"))
+            in->version = strtoll(value, NULL, 10);
+        else if (!strcmp(key, "operationMode"))
+            in->operationMode = atoi(value);
+    }
+    return 1;
+}
+
+static uint8_t configSink(void *ctx, const uint8_t *data, size_t len)
+{
+    ConfigIngest *in = (ConfigIngest *)ctx;
+    if (in->file.write(data, len) != len)
+    {
+        in->writeError = true;
+        return 0;
+    }
+    return json_stream_feed(&in->js, (const char *)data, len);
+}
+
 /****************************************************************
  * Function to get the devic configuration from the server
  * @param [in] None
@@ -1718,141 +2019,99 @@ uint8_t cApplication::getConfigurationDeviceId(void)
 {
     uint8_t ret = 0;
     char deviceid[256];
-    String macAdress = WiFi.macAddress();
-    // String macAdress = "10:06:1C:07:D9:F4";//WARNING
-    sprintf(deviceid, "deviceId=%s", String(macAdress).c_str());
-    if (http_get_config(&g_http_dev, deviceid))
-    {
-        const char *payload = http_get_payload(&g_http_dev);
-        String responseData = String(payload ? payload : "");
-        debugPrintln(responseData);
-        int PayLoadSize = responseData.length();
-        Serial.printf(" PayLoad Size : %d \n", PayLoadSize);
-        /*deserialize the json document*/
-        DynamicJsonDocument configInfo(PayLoadSize * 2);
-        DeserializationError err = deserializeJson(configInfo, responseData); /*Deserialize the json document*/
-        if (err.code() == DeserializationError::Ok)                           /*check for deserialization error*/
+    sprintf(deviceid, "deviceId=%s", m_cDeviceId);
+
+    ConfigIngest *in = new ConfigIngest;
+    json_stream_init(&in->js, configEvent, in);
+    in->version = 0;
+    in->operationMode = EVENT_BASED_MODE;
+    in->writeError = false;
+    in->file = SPIFFS.open(FILENAME_IDSCONFIG_NEW, FILE_WRITE);
+    if (!in->file)
+    {
+        debugPrintln("cannot create config staging file");
+        delete in;
+        return 0;
+    }
+
+    bool received = http_get_config(&g_http_dev, deviceid, configSink, in);
+    Serial.printf(" PayLoad Size : %u \n", (unsigned)in->file.size());
+    in->file.close();
+    bool parsed = received && json_stream_finish(&in->js);
+
+    if (parsed)
+    {
+        g_config.operationMode = in->operationMode;
+        debugPrintf("@@ operationMode %d\n", g_config.operationMode);
+        Serial.print("   Version from payload:   ");
+        Serial.print(in->version);
+        Serial.print("   Version from Saved File:   ");
+        Serial.println(m_oPondConfig.m_i64ConfigIdsVersion);
+        if (in->version != m_oPondConfig.m_i64ConfigIdsVersion)
         {
-            /*read operationMode*/
-            if (configInfo.containsKey("operationMode"))
-            {
-                g_config.operationMode = configInfo["operationMode"];
-                debugPrintf("@@ operationMode found %d\n", g_config.operationMode);
-            }
-            else
-            {
-                g_config.operationMode = EVENT_BASED_MODE;
-                debugPrintln("@@ operationMode not found");
-            }
-            /* Read Pond Setting Version */
-            int64_t iVersionInFrame = 0;
-            if (configInfo.containsKey("version"))
+            /*replace the config file when version changes*/
+            m_oBackupStore.clearNonBackupFiles(&m_oFileSystem);
+            m_oFileSystem.removeFile(FILENAME_IDSCONFIG);
+            bool renamed = SPIFFS.rename(FILENAME_IDSCONFIG_NEW, FILENAME_IDSCONFIG);
+            m_oFileSystem.invalidate(FILENAME_IDSCONFIG);
+            if (renamed)
             {
-                iVersionInFrame = configInfo["version"];
-                debugPrintln("@@ version found in file");
-            }
-            else
-            {
-                iVersionInFrame = 0;
-                debugPrintln("@@ version not found in file");
-            }
-            /***********************************************************************************************
-                check for the operation mode in the payload
-                if it is EventBasedMode, load the FILE of EventMode config and check for the version
-            ************************************************************************************************/
-            if (configInfo.containsKey("version"))
-            {
-                iVersionInFrame = configInfo["version"];
-                debugPrintln("EVENT: Obtained Version from payload");
-            }
-            Serial.print("   Version from payload:   ");
-            Serial.print(iVersionInFrame);
-            Serial.print("   Version from Saved File:   ");
-            Serial.println(m_oPondConfig.m_i64ConfigIdsVersion);
-            if (iVersionInFrame != m_oPondConfig.m_i64ConfigIdsVersion)
-            {
-                /*write to file when version changes*/
-                Serial.printf(" Response data length : %d \n", responseData.length());
-                if (responseData.length() > 2500)
-                {
-                    return 0;
-                }
-                m_oBackupStore.clearNonBackupFiles(&m_oFileSystem);
-                m_oFileSystem.writeFile(FILENAME_IDSCONFIG, String(responseData).c_str());
                 debugPrintln("@@ file saved in file");
                 /*Clear the existing pond status map file in the Filesystem*/
-                SPIFFS.remove(PONDS_STATUS_CONFIG);
-                m_oPondConfig.m_pondStatusMap.clear();
+                m_oPondConfig.clearPondStatus();
                 /*load location ids from file*/
                 m_oPondConfig.loadPondConfig();
                 debugPrintln("@@ location ids loaded from file here");
+                ret = 1;
             }
-            else
-            {
-                Serial.println(" Version not changed...");
-            }
-            g_appState.getConfig = false;
         }
         else
         {
-            debugPrintln("deserialization error");
-            ret = 0;
+            Serial.println(" Version not changed...");
+            ret = 1;
         }
+        g_appState.getConfig = false;
+    }
+    else if (received)
+    {
+        debugPrintf("config parse error %u at byte %lu%s\n", in->js.error, (unsigned long)in->js.pos,
+                    in->writeError ? " (flash full)" : "");
     }
     else
     {
-        ret = 0;
         debugPrintln("failed to get DO config..:-(");
-        debugPrintln("@@ location ids loaded from file");
     }
+    SPIFFS.remove(FILENAME_IDSCONFIG_NEW);
+    delete in;
     return ret;
 }
 
 /****************************************************************
  * Function to get the pond boundaries configuration from the server with pondID
- * create if the pond is
+ * and store them in the pond's boundary file
  * @param [in] None
  * @param [out] None
  *****************************************************************/
 uint8_t cApplication::getConfigurationPondBoundaries(const char *pondID, const char *pName)
 {
     debugPrintln(" In the getconfiguration pondBoundaries");
-    uint8_t ret = 0;
     char pondid[256];
     sprintf(pondid, "pondId=%s", pondID);
-    if (http_get_pond_boundaries(&g_http_dev, pondid))
-    {
-        const char *payload = http_get_payload(&g_http_dev);
-        String responseData = String(payload ? payload : "");
-        debugPrintln(payload);
-        int Size = responseData.length();
-        if (Size > 3000)
-            return 0;
-
-        /*deserialize the json document*/
-        DynamicJsonDocument configInfo(Size * 2);
-        DeserializationError err = deserializeJson(configInfo, responseData); /*Deserialize the json document*/
-        if (err.code() == DeserializationError::Ok)                           /*check for deserialization error*/
-        {
-            char fileName[20] = "";
-            snprintf(fileName, sizeof(fileName), "/%s.txt", pName);
-            debugPrintf("PondName: %s\n", fileName);
-            /*write to file when version changes*/
-            m_oFileSystem.writeFile(fileName, String(responseData).c_str());
-            debugPrintln("@@ file saved in file");
-            ret = 1;
-        }
-        else
-        {
-            debugPrintln("deserialization error");
-            ret = 0;
-        }
+
+    struct pond_bounds_ingest *in = new pond_bounds_ingest;
+    if (!pond_bounds_ingest_begin(in, pName))
+    {
+        debugPrintln("cannot create pond boundary file");
+        delete in;
+        return 0;
     }
-    else
+    uint8_t received = http_get_pond_boundaries(&g_http_dev, pondid, pond_bounds_ingest_feed, in);
+    uint8_t ret = pond_bounds_ingest_end(in, received);
+    if (!ret)
     {
-        ret = 0;
         debugPrintln("failed to get pond boundaries config..:-(");
     }
+    delete in;
     return ret;
 }
 
@@ -1868,6 +2127,10 @@ void cApplication::readDeviceConfig(void)
     String sSeverIP = m_oMemory.getString("serverIP", g_http_dev.default_server_ip); // get server IP
     g_config.totalMinsOffSet = m_oMemory.getInt("LocalMins", 180);                 // get offset time
     g_config.dataFrequencyInterval = m_oMemory.getInt("interval", 5);              // To post the data that frequently
+    g_config.frameTransport = m_oMemory.getUChar("frameTransport", FRAME_TRANSPORT_HTTP); // Socket.IO is opt-in, see setFrameTransport
+    g_config.pingMetrics = m_oMemory.getUChar("pingMetrics", 0); // Metrics summary in the ping
+    g_config.gpsProtocol = m_oMemory.getUChar("gpsProto", GPS_PROTOCOL_NMEA); // NMEA or u-blox NAV-PVT
+    g_config.fieldTrace = m_oMemory.getUChar("fieldTrace", 0); // Keeps recording across a reset
 
     safeStrcpy(m_cWifiPass, sWifiPASS.c_str(), sizeof(m_cWifiPass));
     safeStrcpy(m_cWifiSsid, sWifiSSID.c_str(), sizeof(m_cWifiSsid));
@@ -1930,6 +2193,10 @@ int cApplication::appInit(void)
     debugPrint("millis after serial begin: ");
     debugPrintln(millis());
     
+    /*Latency probes start counting before the first HTTP call*/
+    perf_metrics_init();
+    /*Flags set from here on also wake the task that acts on them*/
+    app_events_init();
     // Create mutex for shared variable protection
     xSharedVarMutex = xSemaphoreCreateMutex();
     if (xSharedVarMutex == NULL)
@@ -1952,13 +2219,20 @@ int cApplication::appInit(void)
      * 6mm - Serial2(9600);
      * Change the baudrates based on the GPS module Connected.
      * **********************************************************/
-    Serial2.begin(38400, SERIAL_8N1, 26, 27);
-    m_oGps.gpsInit(&Serial2);
-    /*Modbus and sensor initialization*/
+    Serial2.begin(GPS_BAUD, SERIAL_8N1, 26, 27);
+    m_oGps.gpsInit(&Serial2, GPS_BAUD, g_config.gpsProtocol);
+    /*Modbus bus and primary DO sensor initialization*/
+    sensor_bus_init(&g_sensor_bus, "RS485", &Serial1);
     do_sensor_init(&g_do_sensor, "FLDBH-505A", &modbus_do_sensor_ops);
-    do_sensor_setup(&g_do_sensor, &Serial1, 0x01);
+    sensor_bus_attach(&g_sensor_bus, &g_do_sensor, PRIMARY_PROBE_SLAVE_ID, SENSOR_BUS_DEFAULT_INTERVAL_MS);
+    cal_engine_init(&g_calEngine, &g_do_sensor);
+    /*Station MAC never changes, format it once for frames and the socket URI*/
+    uint8_t staMac[6];
+    WiFi.macAddress(staMac);
+    snprintf(m_cDeviceId, sizeof(m_cDeviceId), "%02X:%02X:%02X:%02X:%02X:%02X",
+             staMac[0], staMac[1], staMac[2], staMac[3], staMac[4], staMac[5]);
     char hostName[50] = {0};
-    sprintf(hostName, "NA_IOT_DO_%s", WiFi.macAddress().c_str());
+    sprintf(hostName, "NA_IOT_DO_%s", m_cDeviceId);
     WiFi.setHostname(hostName);
     /*Print the restart reason and if it is Brownout goes to sleepMode*/
     print_restart_reason();
@@ -1990,12 +2264,34 @@ int cApplication::appInit(void)
     
     /*read device memory and load Do config - this will update g_http_dev.server_ip*/
     readDeviceConfig();
+
+    /*Countdown trace, rate and length set through the setTraceConfig RPC*/
+    sample_trace_init(&g_sampleTrace, m_oMemory.getUShort("traceRate", SAMPLE_TRACE_DEFAULT_RATE_MS),
+                      m_oMemory.getUShort("traceLen", SAMPLE_TRACE_DEFAULT_LENGTH));
+    /*Field trace, the App task starts it when setFieldTrace left it enabled*/
+    field_trace_init();
+
+    /*Attach the optional second probe configured through the setAuxProbe RPC*/
+    uint8_t auxSlaveId = m_oMemory.getUChar("auxSlave", 0);
+    if (auxSlaveId && auxSlaveId != PRIMARY_PROBE_SLAVE_ID)
+    {
+        do_sensor_init(&g_aux_sensor, "AUX_PROBE", &modbus_do_sensor_ops);
+        sensor_bus_attach(&g_sensor_bus, &g_aux_sensor, auxSlaveId, SENSOR_BUS_DEFAULT_INTERVAL_MS);
+    }
     
     /*Wifi initailization */
     wifiInitialization();
     /*Generate the URI path with esp32 MacAddress*/
-    sprintf(m_cUriPath, "/socket.io/?deviceId=%s&deviceType=%s&fwVersion=%d&EIO=4", String(WiFi.macAddress()).c_str(), DEVICE_TYPE, FW_VERSION);
+    sprintf(m_cUriPath, "/socket.io/?deviceId=%s&deviceType=%s&fwVersion=%d&EIO=4", m_cDeviceId, DEVICE_TYPE, FW_VERSION);
     /*Init Socket Connection*/
+    rpc_reply_queue_init(&g_rpcReplies);
+    frame_uplink_init(&g_frameUplink);
+    /*Resume a firmware download cut short by a reboot*/
+    if (ota_engine_pending(g_http_dev.uri_firmware_fota, sizeof(g_http_dev.uri_firmware_fota)))
+    {
+        debugPrintf("Unfinished OTA found, resuming %s\n", g_http_dev.uri_firmware_fota);
+        g_appState.doFota = true;
+    }
     socketIO.setReconnectInterval(10000);
     socketIO.setExtraHeaders("Authorization: 1234567890");
     socketIO.begin(g_http_dev.server_ip, g_http_dev.server_port, m_cUriPath, protocol);
@@ -2005,7 +2301,6 @@ int cApplication::appInit(void)
     /*to know device is rebooted*/
     g_deviceConfig.m_u8IsReboot = 1;
     m_oBsp.hooterInit();
-    allRpcInit();
     /*I2C initialization*/
     m_oBsp.i2cInitialization();
     debugPrintln("initialization completed :-)");
@@ -2042,6 +2337,8 @@ int cApplication::appInit(void)
     }
     listSPIFFSFiles();
     attachInterrupt(digitalPinToInterrupt(BSP_BTN_1), handleButtonInterrupt, CHANGE);
+    /*Frequency scaling and light sleep between operator actions*/
+    power_manager_init(&g_power, millis());
     debugPrint("millis before the button detection ");
     debugPrintln(millis());
     return 1;
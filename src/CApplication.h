@@ -18,10 +18,25 @@
 #include "geofence_ops.h"
 #include "CPondConfig.h"    
 #include "do_sensor_ops.h"
+#include "sensor_bus_ops.h"
+#include "sample_trace.h"
+#include "field_trace.h"
+#include "calibration_engine.h"
+#include "rpc_reply_queue.h"
+#include "frame_uplink.h"
+#include "ota_engine.h"
+#include "wifi_manager.h"
+#include "perf_metrics.h"
+#include "app_events.h"
+#include "power_manager.h"
+
+#define PRIMARY_PROBE_SLAVE_ID 0x01
 
 #define MAX_NEAREST_PONDS 3
 #define NEAREST_POND_MAX_VALUE 1500
 #define INSIDE_POND_TOLERANCE 6
+#define POND_ENTER_CONFIDENCE 90        /* % before a pond becomes the current one */
+#define POND_EXIT_CONFIDENCE 10         /* % below which the current pond is left */
 
 #define NO_FRAME 0
 #define TOUT_FRAME 1
@@ -40,10 +55,20 @@
 
 #define EVENT_BASED_MODE 1
 
+#define OTA_RETRY_DELAY_MS 5000
+
+#define TASK_TICK_MS 100                /* App task period, and the others while busy */
+#define FRAME_TASK_PERIOD_MS 1000       /* Frame task housekeeping, frame requests wake it early */
+#define SENSOR_IDLE_MIN_MS 10           /* Modbus task always yields, the idle task runs on core 0 too */
+#define SENSOR_IDLE_MAX_MS 1000         /* Longest Modbus task sleep between probe polls */
+#define PING_INTERVAL_MS 50000
+#define BACKUP_UPLOAD_INTERVAL_MS 10000
+
 typedef struct
 {
     char name[10];
     int distance;
+    uint8_t confidence; /* % that the position is within INSIDE_POND_TOLERANCE */
 } PondDistance;
 
 struct ButtonState_t
@@ -51,13 +76,13 @@ struct ButtonState_t
     bool buttonReleased = true;
     unsigned long buttonPressedMillis = 0;
     bool buttonChanged = false;
+    bool wakeLatched = false; // set by the idle wake-up ISR, however short the press
 };
 
 // Grouped application timers and counters
 struct AppTimers
 {
     int timeOutFrameCounter = 0;
-    int netCheckCounter = 0;
     int countDownTimer = 0;
     int rebootAfterOfflineCnt = 0;
     time_t lastPondNameCheckEpoch = 0;
@@ -82,6 +107,10 @@ struct AppConfig
     uint8_t eveningPondMapResetTime = 14;
     int lastMorningDay = -1;
     int lastEveningDay = -1;
+    uint8_t frameTransport = FRAME_TRANSPORT_HTTP;
+    uint8_t pingMetrics = 0;
+    uint8_t gpsProtocol = GPS_PROTOCOL_NMEA;
+    uint8_t fieldTrace = 0; /* Field trace recording, applied by the App task */
 };
 
 // Application state flags
@@ -91,7 +120,6 @@ struct AppState
     bool isCharging = false;
     bool isOnline = false;
     bool getConfig = true;
-    bool sendFrame = false;
     bool rtcSyncNow = false;
     bool resetEntireMap = false;
     bool pingNow = false;
@@ -107,6 +135,8 @@ struct SensorData
     float doMglValue = 0.0;
     float doSaturationVal = 0.0;
     float tempVal = 0.0;
+    float salinity = 0.0;
+    bool isConnected = false;
 };
 
 // Current pond information
@@ -116,6 +146,8 @@ struct CurrentPondInfo
     char CurrentLocationId[100] = {0};
     char CurrentPondID[100] = {0};
     float CurrentPondSalinity = 0.0;
+    uint8_t PondConfidence = 0; /* % for CurrentPondName, 0 when there is none */
+    char NearestPonds[64] = "No Ponds in range";
 };
 
 // Smart configuration data
@@ -134,10 +166,14 @@ struct SmartConfigData
 class cApplication
 {
 private:
-    uint8_t m_u8SendBackUpFrameConter;
+    uint32_t m_u32LastPingMs;
+    uint32_t m_u32LastBackupUploadMs;
+    uint32_t m_u32SalinityTicket;       // pond salinity write queued on the sensor bus, 0 if none
+    float m_fProbeSalinity;             // last salinity the probe acknowledged
     int m_iRtcSyncCounter;
     int m_iFrameInProcess;
     char m_cUriPath[150] = "";
+    char m_cDeviceId[18] = "";
     bool m_bButtonPressed;
     uint8_t buzz = 0;
 
@@ -147,6 +183,8 @@ private:
     time_t SendPing(void);
     void uploadframeFromBackUp(void);
     void updateJsonAndSendFrame(void);
+    bool uploadFrame(char *frame, size_t len);
+    void traceUplink(uint8_t transport, bool ok, uint16_t frames, uint32_t startMs);
     void staLEDHandler(void);
     void AppTimerHandler100ms(void);
     void inActivityChecker(void);
@@ -159,14 +197,15 @@ private:
     uint8_t getConfigurationPondBoundaries(const char *pondID, const char *pName);
     uint8_t getConfigurationDeviceId(void);
     void readDeviceConfig(void);
-    void reconnectWifi(void);
     float roundToDecimals(float value, int decimals);
     void checkBattteryVoltage(void);
-    int readPondNameFromFile(const char *path, m_oPosition data);
     void RunDisplay(void);
+    void PowerHandler(void);
     void ResetWifiCredentials(void);
     void ResetServerCredentials(void);
     void ResetHandler(void);
+    void CalibrationRequestHandler(void);
+    void saveCalibrationRecord(void);
     void rfidTask(void);
     void CheckAndSyncRTC(void);
     int mapFloatToInt(float x, float in_min, float in_max, int out_min, int out_max);
@@ -179,8 +218,9 @@ private:
     void startWebServer(void);
     // to save the nearest pond details
     std::vector<PondDistance> allPondsWithDistance;
-    void updateAllPondsDistance(const char *pondName, int distance);
+    void updateAllPondsDistance(const char *pondName, int distance, uint8_t confidence);
     void finalizeNearestPonds();
+    void postPondSalinity(float salinity);
     String getNearestPondString();
     void AssignDataToDisplayStructs();
     void ResetPondBackupStatusMap(int day, int hour);
@@ -200,9 +240,10 @@ public:
     /*Functions*/
     int appInit(void);
     void applicationTask(void);
+    void serviceLink(void);
     void frameHandlingTask(void);
-    void commandParseTask(void);
-    void fotaTask(void);
+    uint32_t commandParseTask(void);
+    uint32_t fotaTask(void);
     void GpsTask(void);
     void SmartConfigTask(void);
     void AppWatchdogInit(TaskHandle_t *taskhandle1, TaskHandle_t *taskhandle2);
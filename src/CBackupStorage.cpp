@@ -12,6 +12,7 @@
 
 #include "CBackupStorage.h"
 #include <ArduinoJson.h>
+#include "perf_metrics.h"
 
 // #define SERIAL_DEBUG
 #ifdef SERIAL_DEBUG
@@ -32,6 +33,7 @@ CBackupStorage::CBackupStorage()
 {
     m_irPos = 0;
     m_iwPos = 0;
+    m_bCountChanged = false;
 }
 
 /**
@@ -69,6 +71,12 @@ int CBackupStorage::InitilizeBS(FILESYSTEM *fileSystem)
         {
             char fname[20] = {0};
             sprintf(fname, "/BAK_%d.txt", i);
+            /* Finish or drop a frame write cut short by a reset */
+            if (fileSystem->recoverAtomic(fname))
+            {
+                debugPrint("Restored staged ");
+                debugPrintln(fname);
+            }
             File file = SPIFFS.open(fname); // fileSystem->openFile(fname);
             if (!file || file.isDirectory())
             {
@@ -143,6 +151,7 @@ int CBackupStorage::InitilizeBS(FILESYSTEM *fileSystem)
         debugPrintln(m_irPos);
         debugPrint("wPos : ");
         debugPrintln(m_iwPos);
+        m_bCountChanged = true;
         delete[] Wtime;
         return 1;
     }
@@ -158,10 +167,12 @@ int CBackupStorage::InitilizeBS(FILESYSTEM *fileSystem)
  *******************************************************************/
 int CBackupStorage::writeInBS(FILESYSTEM *fileSystem, const char *frame)
 {
+    PERF_SCOPE(PERF_FS_IO);
     char fname[20] = {0};
     sprintf(fname, "/BAK_%d.txt", m_iwPos);
     debugPrintln(fname);
-    if (fileSystem->writeFile(fname, frame))
+    /*Staged and renamed, a reset mid-write must not leave half a frame in the queue*/
+    if (fileSystem->writeFileAtomic(fname, frame) == FILE_WRITE_SUCCESSFUL)
     {
         m_iwPos = (m_iwPos + 1) % MAXFILES;
         if (m_iwPos == m_irPos)
@@ -171,11 +182,13 @@ int CBackupStorage::writeInBS(FILESYSTEM *fileSystem, const char *frame)
             debugPrintln(m_iwPos);
             debugPrintln(m_irPos);
         }
+        m_bCountChanged = true;
         return 1;
     }
     else
     {
         debugPrintln("Backup to storage failed");
+        PERF_COUNT(PERF_CNT_FS_ERROR);
     }
     return FS_NOT_MOUNTED;
 }
@@ -195,10 +208,11 @@ bool CBackupStorage::available(void)
 }
 /********************************************************************
  * store data in available file position in Storage,
- * @param[in] frame Data to be saved in file
+ * @param[out] data Buffer for the file content
+ * @param[in] cap Size of data
  * @return File Error/FS error, length of data read from file
  *******************************************************************/
-int CBackupStorage::readFromBS(FILESYSTEM *fileSystem, char *data)
+int CBackupStorage::readFromBS(FILESYSTEM *fileSystem, char *data, size_t cap)
 {
     if (fileSystem->isMounted())
     {
@@ -206,11 +220,59 @@ int CBackupStorage::readFromBS(FILESYSTEM *fileSystem, char *data)
         int fLen = 0;
         sprintf(fname, "/BAK_%d.txt", m_irPos);
         debugPrintln(fname);
-        fLen = fileSystem->readFile(fname, data);
+        PERF_SCOPE(PERF_FS_IO);
+        fLen = fileSystem->readFile(fname, data, cap);
         return fLen;
     }
     return FS_NOT_MOUNTED;
 }
+/********************************************************************
+ * Read an unread file further down the queue without consuming it,
+ * @param[in] ahead 0 for the next file to upload, 1 for the one after..
+ * @param[out] data Buffer for the file content
+ * @param[in] cap Size of data
+ * @return File Error/FS error, length of data read from file
+ *******************************************************************/
+int CBackupStorage::peekFromBS(FILESYSTEM *fileSystem, int ahead, char *data, size_t cap)
+{
+    if (ahead < 0 || ahead >= pendingFiles())
+    {
+        return FILE_OPEN_FAILED;
+    }
+    if (fileSystem->isMounted())
+    {
+        char fname[20] = {0};
+        sprintf(fname, "/BAK_%d.txt", (m_irPos + ahead) % MAXFILES);
+        debugPrintln(fname);
+        PERF_SCOPE(PERF_FS_IO);
+        return fileSystem->readFile(fname, data, cap);
+    }
+    return FS_NOT_MOUNTED;
+}
+/********************************************************************
+ * Number of files written but not uploaded yet,
+ * @param[in] void
+ * @return Count of unread files
+ *******************************************************************/
+int CBackupStorage::pendingFiles(void)
+{
+    return (m_iwPos - m_irPos + MAXFILES) % MAXFILES;
+}
+/********************************************************************
+ * Whether pendingFiles() changed since the last call, clears the flag.
+ * The count itself comes from the cursors, nothing is read from flash
+ * @param[in] void
+ * @return true if the caller should re-read pendingFiles()
+ *******************************************************************/
+bool CBackupStorage::countChanged(void)
+{
+    if (!m_bCountChanged)
+    {
+        return false;
+    }
+    m_bCountChanged = false;
+    return true;
+}
 /********************************************************************
  * Move to next available file in Storage,
  * @param[in] void
@@ -226,6 +288,7 @@ int CBackupStorage::moveToNextFile(FILESYSTEM *fileSystem)
         debugPrintln(fname);
         fileSystem->writeFile(fname, "No data");
         m_irPos = (m_irPos + 1) % MAXFILES;
+        m_bCountChanged = true;
     }
     return FS_NOT_MOUNTED;
 }
@@ -249,6 +312,7 @@ int CBackupStorage::clearAllFiles(FILESYSTEM *fileSystem)
         }
         m_irPos = 0;
         m_iwPos = 0;
+        m_bCountChanged = true;
     }
     return FS_NOT_MOUNTED;
 }
@@ -279,12 +343,13 @@ int CBackupStorage::clearNonBackupFiles(FILESYSTEM *fileSystem)
             {
                 fname = "/" + fname;
             }
-            // Remove only non-backup text files
-            if (!fname.startsWith("/BAK_") && fname.endsWith(".txt"))
+            // Remove only non-backup text files, pond boundaries and unfinished downloads
+            if (!fname.startsWith("/BAK_") &&
+                (fname.endsWith(".txt") || fname.endsWith(".pb") || fname.endsWith(".tmp")))
             {
                 Serial.print("Removing: ");
                 Serial.println(fname);
-                if (SPIFFS.remove(fname))
+                if (fileSystem->removeFile(fname.c_str()))
                 {
                     Serial.println(" -> removed OK");
                 }
@@ -300,27 +365,6 @@ int CBackupStorage::clearNonBackupFiles(FILESYSTEM *fileSystem)
     return 0; // success
 }
 
-/*Function to Count the no of files in the backup*/
-int CBackupStorage::countStoredFiles(FILESYSTEM *fileSystem)
-{
-    int count = 0;
-    if (fileSystem->isMounted())
-    {
-        for (int i = 0; i < MAXFILES; i++)
-        {
-            char fname[20] = {0};
-            sprintf(fname, "/BAK_%d.txt", i);
-            File file = SPIFFS.open(fname); // fileSystem->openFile(fname);
-
-            if (file && !file.isDirectory() && file.size() > 10) // Ensure it's not an empty placeholder
-            {
-                count++;
-            }
-        }
-    }
-    return count;
-}
-
 /********************************************************************
  * Load and parse all backup entries from files
  * @param[in] fileSystem - pointer to filesystem
@@ -343,16 +387,9 @@ int CBackupStorage::loadAllBackupEntries(FILESYSTEM *fileSystem, BackupEntry_t *
         char fname[20] = {0};
         sprintf(fname, "/BAK_%d.txt", i);
         
-        File file = SPIFFS.open(fname);
-        if (!file || file.isDirectory())
-        {
-            continue;
-        }
-
-        size_t fileSize = file.size();
+        int fileSize = fileSystem->getFileSize(fname);
         if (fileSize <= 10) // Empty or placeholder file
         {
-            file.close();
             continue;
         }
 
@@ -361,13 +398,14 @@ int CBackupStorage::loadAllBackupEntries(FILESYSTEM *fileSystem, BackupEntry_t *
         if (!jsonBuffer)
         {
             debugPrintln("Failed to allocate memory for JSON buffer");
-            file.close();
             continue;
         }
 
-        size_t bytesRead = file.readBytes(jsonBuffer, fileSize);
-        jsonBuffer[bytesRead] = '\0';
-        file.close();
+        if (fileSystem->readFile(fname, jsonBuffer, fileSize + 1) <= 0)
+        {
+            delete[] jsonBuffer;
+            continue;
+        }
 
         // Parse JSON
         DynamicJsonDocument doc(1400);
@@ -37,17 +37,20 @@ private:
   /* data */
   int m_irPos;
   int m_iwPos;
+  volatile bool m_bCountChanged; /* Set when pendingFiles() moves, cleared by countChanged() */
 
 public:
   CBackupStorage(/* args */);
   ~CBackupStorage();
   int InitilizeBS(FILESYSTEM *fileSystem);
   int writeInBS(FILESYSTEM *fileSystem, const char *frame);
-  int readFromBS(FILESYSTEM *fileSystem, char *data);
+  int readFromBS(FILESYSTEM *fileSystem, char *data, size_t cap);
+  int peekFromBS(FILESYSTEM *fileSystem, int ahead, char *data, size_t cap);
+  int pendingFiles(void);
   int moveToNextFile(FILESYSTEM *fileSystem);
   bool available(void);
   int clearAllFiles(FILESYSTEM *fileSystem);
-  int countStoredFiles(FILESYSTEM *fileSystem);
+  bool countChanged(void);
   int clearNonBackupFiles(FILESYSTEM *fileSystem);
   int loadAllBackupEntries(FILESYSTEM *fileSystem, BackupEntry_t *entries, int maxEntries);
 };
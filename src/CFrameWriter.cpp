@@ -0,0 +1,160 @@
+/**
+ * @file CFrameWriter.cpp
+ * @brief Bounded JSON writer for the data frame Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "CFrameWriter.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+CFrameWriter::CFrameWriter(char *buf, size_t cap)
+    : m_pBuf(buf), m_uCap(cap), m_uLen(0), m_bOverflow(cap == 0), m_bNeedComma(false)
+{
+    if (cap)
+        m_pBuf[0] = '\0';
+}
+
+/* Append bytes, always leaving room for the terminator */
+void CFrameWriter::put(char c)
+{
+    if (m_bOverflow || m_uLen + 1 >= m_uCap)
+    {
+        m_bOverflow = true;
+        return;
+    }
+    m_pBuf[m_uLen++] = c;
+    m_pBuf[m_uLen] = '\0';
+}
+
+void CFrameWriter::put(const char *s, size_t n)
+{
+    if (m_bOverflow || m_uLen + n >= m_uCap)
+    {
+        m_bOverflow = true;
+        return;
+    }
+    memcpy(m_pBuf + m_uLen, s, n);
+    m_uLen += n;
+    m_pBuf[m_uLen] = '\0';
+}
+
+/* JSON string with quotes, escaping what names, SSIDs and ids may contain */
+void CFrameWriter::putEscaped(const char *s)
+{
+    put('"');
+    for (; s && *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+        {
+            put('\\');
+            put((char)c);
+        }
+        else if (c < 0x20)
+        {
+            char esc[7];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            put(esc, 6);
+        }
+        else
+        {
+            put((char)c);
+        }
+    }
+    put('"');
+}
+
+void CFrameWriter::key(FrameKey k)
+{
+    if (m_bNeedComma)
+        put(',');
+    putEscaped(kFrameKeys[k]);
+    put(':');
+    m_bNeedComma = true;
+}
+
+void CFrameWriter::beginObject(void)
+{
+    if (m_bNeedComma)
+        put(',');
+    put('{');
+    m_bNeedComma = false;
+}
+
+void CFrameWriter::beginObject(FrameKey k)
+{
+    key(k);
+    put('{');
+    m_bNeedComma = false;
+}
+
+void CFrameWriter::endObject(void)
+{
+    put('}');
+    m_bNeedComma = true;
+}
+
+void CFrameWriter::beginArray(FrameKey k)
+{
+    key(k);
+    put('[');
+    m_bNeedComma = false;
+}
+
+void CFrameWriter::endArray(void)
+{
+    put(']');
+    m_bNeedComma = true;
+}
+
+void CFrameWriter::addString(FrameKey k, const char *value)
+{
+    key(k);
+    putEscaped(value);
+}
+
+void CFrameWriter::addInt(FrameKey k, long value)
+{
+    char num[12];
+    int n = snprintf(num, sizeof(num), "%ld", value);
+    key(k);
+    put(num, n);
+}
+
+void CFrameWriter::addBool(FrameKey k, bool value)
+{
+    key(k);
+    if (value)
+        put("true", 4);
+    else
+        put("false", 5);
+}
+
+/* Fixed decimals with trailing zeros trimmed, null for NaN/inf */
+void CFrameWriter::addFloat(FrameKey k, double value, uint8_t decimals)
+{
+    key(k);
+    if (isnan(value) || isinf(value))
+    {
+        put("null", 4);
+        return;
+    }
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%.*f", decimals, value);
+    if (n <= 0 || n >= (int)sizeof(num))
+    {
+        put("null", 4);
+        return;
+    }
+    if (memchr(num, '.', n))
+    {
+        while (n > 1 && num[n - 1] == '0')
+            n--;
+        if (num[n - 1] == '.')
+            n--;
+    }
+    put(num, n);
+}
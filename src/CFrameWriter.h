@@ -0,0 +1,160 @@
+/**
+ * @file CFrameWriter.h
+ * @brief Bounded JSON writer for the data frame
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Writes the data frame straight into a caller buffer: no document tree, no
+ * heap, no String temporaries. Every key the frame can carry is listed once,
+ * in frame order, in the compile-time table below, so field names cannot
+ * drift between the live, history and backup paths.
+ *
+ * Writes past the end of the buffer are dropped and flagged; check ok()
+ * before sending.
+ *
+ * @par Usage Pattern:
+ * @code
+ * char frame[FRAME_BUFFER_SIZE];
+ * CFrameWriter w(frame, sizeof(frame));
+ * w.beginObject();
+ * w.addString(FK_NAME, DEVICE_TYPE);
+ * w.addFloat(FK_DO, doMgl, 5);
+ * w.endObject();
+ * if (w.ok()) send(frame, w.length());
+ * @endcode
+ */
+
+#ifndef CFRAMEWRITER_H
+#define CFRAMEWRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Frame keys, in the order they appear in the frame */
+enum FrameKey : uint8_t
+{
+    FK_REASON_FOR_PACKET = 0,
+    FK_NAME,
+    FK_DEVICE_ID,
+    FK_ROUTER_MAC_ID,
+    FK_LOCAL_IP,
+    FK_FW_VER,
+    FK_IS_REBOOT,
+    FK_FRAMES_IN_BACKUP,
+    FK_WIFI_SSID,
+    FK_RSSI,
+    FK_EPOCH,
+    FK_OPERATION_MODE,
+    FK_LAT,
+    FK_LNG,
+    FK_HDOP,
+    FK_SATELLITES,
+    FK_IS_GPS_VALID,
+    FK_POS_RADIUS,
+    FK_RFID,
+    FK_POND_NAME,
+    FK_POND_ID,
+    FK_LOCATION_ID,
+    FK_POND_CONFIDENCE,
+    FK_LOCAL_OFFSET_MIN,
+    FK_DO,
+    FK_TEMP,
+    FK_SATURATION_PCT,
+    FK_SALINITY,
+    FK_BAT_PERCENT,
+    FK_IS_HISTORY,
+    FK_NEAREST,
+    FK_TIME_BUFFER,
+    FK_UP_TIME,
+    FK_LAST_PNAME_CHECK_TIME,
+    FK_PNAME_CHECKING_CNTR,
+    FK_TRACE,
+    FK_PROBES,
+    FK_DATA_ERROR,
+    /* keys of the objects inside "probes" */
+    FK_ID,
+    FK_CONNECTED,
+    FK_COUNT
+};
+
+static constexpr const char *kFrameKeys[] = {
+    "reasonForPacket",
+    "name",
+    "deviceId",
+    "routerMacId",
+    "localIp",
+    "fwVer",
+    "isReboot",
+    "FramesInBackUp",
+    "wifiSSId",
+    "rssi",
+    "epoch",
+    "operationMode",
+    "lat",
+    "lng",
+    "HDop",
+    "Satellites",
+    "IsGpsValid",
+    "PosRadius",
+    "rfId",
+    "PondName",
+    "pondId",
+    "locationId",
+    "pondConfidence",
+    "localOffsetTimeInMin",
+    "do",
+    "temp",
+    "saturationPCT",
+    "salinity",
+    "BatPercent",
+    "isHistory",
+    "Nearest",
+    "timeBuffer",
+    "UpTime",
+    "LstPNameChkTime",
+    "PNameCheckingCntr",
+    "trace",
+    "probes",
+    "DataError",
+    "id",
+    "connected",
+};
+
+static_assert(sizeof(kFrameKeys) / sizeof(kFrameKeys[0]) == FK_COUNT, "kFrameKeys must list every FrameKey");
+
+class CFrameWriter
+{
+private:
+    char *m_pBuf;
+    size_t m_uCap;
+    size_t m_uLen;
+    bool m_bOverflow;
+    bool m_bNeedComma;
+
+    void put(char c);
+    void put(const char *s, size_t n);
+    void putEscaped(const char *s);
+    void key(FrameKey k);
+
+public:
+    CFrameWriter(char *buf, size_t cap);
+
+    void beginObject(void);
+    void beginObject(FrameKey k);
+    void endObject(void);
+    void beginArray(FrameKey k);
+    void endArray(void);
+
+    void addString(FrameKey k, const char *value);
+    void addInt(FrameKey k, long value);
+    void addBool(FrameKey k, bool value);
+    void addFloat(FrameKey k, double value, uint8_t decimals);
+
+    /* Offset where the next value byte goes, for patching a fixed-width value later */
+    size_t position(void) const { return m_uLen; }
+    size_t length(void) const { return m_uLen; }
+    bool ok(void) const { return !m_bOverflow; }
+};
+
+#endif /* CFRAMEWRITER_H */
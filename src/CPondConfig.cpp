@@ -1,6 +1,9 @@
 #include "CPondConfig.h"
 #include "stdio.h"
-#include <ArduinoJson.h>
+#include <SPIFFS.h>
+#include <iterator>
+#include "json_stream.h"
+#include "pond_bounds.h"
 
 // #define SERIAL_DEBUG
 #ifdef SERIAL_DEBUG
@@ -19,334 +22,276 @@
 CPondConfig::CPondConfig(FILESYSTEM *fs)
 {
   _fileSystem = fs;
+  m_u8TotalNoOfPonds = 0;
+  m_xPondListMutex = xSemaphoreCreateMutex();
+  pond_status_store_init(&m_oStatusStore);
 }
 /* Destruct */
-CPondConfig::~CPondConfig() {}
+CPondConfig::~CPondConfig()
+{
+  if (m_xPondListMutex != NULL)
+    vSemaphoreDelete(m_xPondListMutex);
+}
+
 /************************************************************
- * Load Pond Setting From File in local Veriables
+ * Pond list lock, shared by the Frame and App tasks
  *************************************************************/
-int CPondConfig::loadPondConfig()
+bool CPondConfig::lockPondList()
 {
-  // Serial.println(" In the loading Pondconfiguration");
-  int ret = 0;
-  int FileSize = _fileSystem->getFileSize(FILENAME_IDSCONFIG);
+  return m_xPondListMutex != NULL && xSemaphoreTake(m_xPondListMutex, portMAX_DELAY) == pdTRUE;
+}
 
-  if (FileSize <= 0 || FileSize > 8192) // Validate size: max 8KB
-  {
-    debugPrintln("Invalid Setting file size...");
-    return 0;
-  }
-  
-  // Allocate buffer dynamically with size validation
-  char *rdata = new char[FileSize + 1];
-  if (!rdata)
-  {
-    debugPrintln("Memory allocation failed for config file");
-    return 0;
-  }
-  
-  /* Read File into data stream */
-  ret = _fileSystem->readFile(FILENAME_IDSCONFIG, rdata);
-  if (ret > 0)
+void CPondConfig::unlockPondList()
+{
+  xSemaphoreGive(m_xPondListMutex);
+}
+
+/************************************************************
+ * Copy one pond's entry out of the list, by name
+ *************************************************************/
+bool CPondConfig::findPond(const char *pondName, CPond &pond)
+{
+  bool found = false;
+  if (!lockPondList())
+    return false;
+  for (const auto &entry : m_oPondList)
   {
-    DynamicJsonDocument configInfo(FileSize * 2);
-    /* Deserialize the file JSON */
-    DeserializationError err = deserializeJson(configInfo, rdata);
-    if (err.code() == DeserializationError::Ok)
+    if (!strcmp(entry.m_cPondname, pondName))
     {
-      /* Read Pond Setting Version */
-      if (configInfo.containsKey("version"))
-      {
-        m_i64ConfigIdsVersion = configInfo["version"];
-        debugPrintln("@@ version found in file");
-      }
-      else
-      {
-        m_i64ConfigIdsVersion = 0;
-        debugPrintln("@@ version not found in file");
-      }
-
-      if (configInfo.containsKey("tenantId"))
-      {
-        strcpy(m_cTenantId, configInfo["tenantId"]);
-        debugPrintln("@@ tenantId found in file");
-      }
-      else
-      {
-        strcpy(m_cTenantId, "none");
-        debugPrintln("@@ tenantId not found in file");
-      }
-
-      if (configInfo.containsKey("offset"))
-      {
-        m_iOffset = configInfo["offset"];
-        debugPrintln("@@ offset found in file");
-      }
-      else
-      {
-        m_iOffset = 330;
-        debugPrintln("@@ offset not found in file");
-      }
-
-      /* Read Pond-wise Pond data */
-      if (configInfo.containsKey("config"))
-      {
-        bool updateFile = false;
-        JsonArray slots = configInfo["config"];
-        int length = slots.size();
-        debugPrintf("length: %d\n", length);
-
-        /*Length of config array is total Number of ponds*/
-        m_u8TotalNoOfPonds = length;
-        /* Parse the data in the file system */
-        for (uint8_t i = 0; i < length; i++)
-        {
-          char data[150];
-          bool isPondBoundariesDataAvailable = AVAILABLE;
-          strncpy(data, slots[i], sizeof(data));
-          debugPrintln(data);
-
-          long locationVersion;
-          char pondName[50];
-          char pondId[50];
-          int salinity;
-          char locationId[50];
-          int activeStatus = 0;
-
-          sscanf(data, "%ld|%[^|]|%[^|]|%d|%[^|]|%d", &locationVersion, pondName, pondId, &salinity, locationId, &activeStatus);
-
-          /* Check filesystem for pond boundary file */
-          char pondFileName[100];
-          snprintf(pondFileName, sizeof(pondFileName), "/%s.txt", pondName);
-
-          int fileSize = _fileSystem->getFileSize(pondFileName);
-          if (fileSize > 0 && fileSize <= 4096) // Validate size: max 4KB per pond file
-          {
-            /* File exists, read and check version */
-            char *pondData = new char[fileSize + 1];
-            if (!pondData)
-            {
-              debugPrintf("Memory allocation failed for pond file %s\n", pondName);
-              isPondBoundariesDataAvailable = NOT_AVAILABLE;
-              continue;
-            }
-            
-            int ret = _fileSystem->readFile(pondFileName, pondData);
-            if (ret > 0)
-            {
-              DynamicJsonDocument pondDoc(fileSize * 2);
-              DeserializationError err = deserializeJson(pondDoc, pondData);
-              
-              // Always free pondData after JSON parsing attempt
-              delete[] pondData;
-
-              if (err.code() == DeserializationError::Ok)
-              {
-                if (pondDoc.containsKey("locationVersion"))
-                {
-                  long storedVersion = pondDoc["locationVersion"];
-                  if (storedVersion != locationVersion)
-                  {
-                    debugPrintf("Version mismatch for pond %s: stored=%ld, new=%ld\n", pondName, storedVersion, locationVersion);
-                    isPondBoundariesDataAvailable = NOT_AVAILABLE;
-                  }
-                }
-                else
-                {
-                  debugPrintf("No version field in pond file %s\n", pondName);
-                  isPondBoundariesDataAvailable = NOT_AVAILABLE;
-                }
-              }
-              else
-              {
-                debugPrintf("Failed to parse JSON for pond %s\n", pondName);
-                isPondBoundariesDataAvailable = NOT_AVAILABLE;
-              }
-            }
-            else
-            {
-              // Free memory on read failure
-              delete[] pondData;
-              debugPrintf("Failed to read pond file for %s\n", pondName);
-              isPondBoundariesDataAvailable = NOT_AVAILABLE;
-            }
-          }
-          else
-          {
-            /* File doesn't exist */
-            debugPrintf("Pond file not found for %s\n", pondName);
-            isPondBoundariesDataAvailable = NOT_AVAILABLE;
-          }
-          if (isPondBoundariesDataAvailable == NOT_AVAILABLE)
-          {
-            Serial.println("Pond Boundaries not available so setting the pond colors to blue");
-            m_bGetPondBoundaries = true;
-            updatedPondIds[pondId] = pondName;
-            /*Initially when the pond config is loaded from file keep all the ponds color in blue representing
-            the boundaries are not available for those ponds and later when boundaries are loaded show their state whether active or harvested*/
-            m_pondStatusMap[pondName] = {isPondBoundariesDataAvailable, activeStatus, POND_BOUNDARIES_NOT_AVAILABLE};
-            /*Save only the single pond status*/
-            // saveSinglePondStatusToFile(pondName);
-          }
-          else
-          {
-            Serial.printf("Pond boundaries available , active Status: %d \n", activeStatus);
-            m_pondStatusMap[pondName] = {isPondBoundariesDataAvailable, activeStatus, activeStatus};
-          }
-          // Update the PondSettingList array
-          m_oPondList[i].m_iLocationVersion = locationVersion;
-          strncpy(m_oPondList[i].m_cPondname, pondName, sizeof(m_oPondList[i].m_cPondname));
-          strncpy(m_oPondList[i].m_cPondId, pondId, sizeof(m_oPondList[i].m_cPondId));
-          m_oPondList[i].m_iSalinity = salinity;
-          strncpy(m_oPondList[i].m_cLocationID, locationId, sizeof(m_oPondList[i].m_cLocationID));
-
-        }
-        /*Update Pond Status from Stored values if no file found save the local data in file*/
-        if (!loadPondStatusFromFile())
-        {
-          Serial.println(" Saving the status to the pond map file");
-          savePondStatusToFile();
-        }
-      }
-      else
-      {
-        debugPrintln("No config found in the file...");
-        delete[] rdata;
-        return 0;
-      }
-    }
-    else
-    {
-      debugPrintln("JSON deserialization failed");
-      delete[] rdata;
-      return 0;
+      pond = entry;
+      found = true;
+      break;
     }
   }
-  else
+  unlockPondList();
+  return found;
+}
+
+/************************************************************
+ * Tokenizer callback for the config file: header fields at the
+ * top level, one pond line per "config" array element
+ *************************************************************/
+static uint8_t configFileEvent(struct json_stream *js, uint8_t ev, const char *value, size_t len)
+{
+  CPondConfig *cfg = (CPondConfig *)js->ctx;
+  uint8_t depth = json_stream_depth(js);
+  const char *key = json_stream_key(js, 0);
+
+  if (depth == 1)
   {
-    debugPrintln(" The file is empty ");
-    delete[] rdata;
-    return 0;
+    if (ev == JSON_EV_NUMBER && !strcmp(key, "version"))
+      cfg->m_i64ConfigIdsVersion = strtoll(value, NULL, 10);
+    else if (ev == JSON_EV_STRING && !strcmp(key, "tenantId"))
+      snprintf(cfg->m_cTenantId, sizeof(cfg->m_cTenantId), "%s", value);
+    else if (ev == JSON_EV_NUMBER && !strcmp(key, "offset"))
+      cfg->m_iOffset = atoi(value);
+  }
+  else if (depth == 2 && ev == JSON_EV_STRING && !strcmp(key, "config"))
+  {
+    cfg->addPond(value);
   }
-  
-  delete[] rdata;
   return 1;
 }
 
-void CPondConfig::updatePondStatus(const char* pondName, int status)
+/************************************************************
+ * File chunk sink: feed the tokenizer, stop on a parse error
+ *************************************************************/
+static uint8_t configFileChunk(void *ctx, const uint8_t *data, size_t len)
 {
-    if (pondName == nullptr || pondName[0] == '\0') return; // skip empty pond names
-    m_pondStatusMap[pondName].PondDataStatus = status;
-    savePondStatusToFile();
+  return json_stream_feed((struct json_stream *)ctx, (const char *)data, len);
 }
 
-/*************************************************
- * save pond status in file system
- *************************************************/
-bool CPondConfig::savePondStatusToFile()
+/************************************************************
+ * Load Pond Setting From File in local Veriables
+ * The file is streamed through the tokenizer, so its size
+ * is not limited by RAM. The list is built aside and swapped
+ * in under the lock; readers see no ponds while it loads
+ *************************************************************/
+int CPondConfig::loadPondConfig()
 {
-  DynamicJsonDocument doc(4096); // Adjust size for number of ponds
+  if (_fileSystem->getFileSize(FILENAME_IDSCONFIG) <= 0)
+  {
+    debugPrintln("Invalid Setting file size...");
+    return 0;
+  }
 
-  for (const auto &pair : m_pondStatusMap)
+  m_i64ConfigIdsVersion = 0;
+  strcpy(m_cTenantId, "none");
+  m_iOffset = 330;
+  /*Drop the old list first so only one is ever held in RAM*/
+  if (lockPondList())
   {
-    if (pair.first.empty()) continue;
-    JsonObject obj = doc.createNestedObject(pair.first.c_str());
-    obj["isAct"] = pair.second.isActive;
-    obj["pStat"] = pair.second.PondDataStatus;
+    std::vector<CPond>().swap(m_oPondList);
+    m_u8TotalNoOfPonds = 0;
+    unlockPondList();
   }
+  m_oLoadingPonds.clear();
 
-  std::string jsonStr;
-  serializeJson(doc, jsonStr);
+  struct json_stream js;
+  json_stream_init(&js, configFileEvent, this);
+  bool ok = _fileSystem->readStream(FILENAME_IDSCONFIG, configFileChunk, &js) > 0;
 
-  debugPrintf("  pond status map (%d entries) to file\n", m_pondStatusMap.size());
-  return _fileSystem->writeFile(PONDS_STATUS_CONFIG, jsonStr.c_str());
+  if (!ok || !json_stream_finish(&js))
+  {
+    debugPrintf("JSON parse failed (%u at byte %lu)\n", js.error, (unsigned long)js.pos);
+    std::vector<CPond>().swap(m_oLoadingPonds);
+    return 0;
+  }
+
+  /*Length of config array is total Number of ponds*/
+  uint8_t totalPonds = m_oLoadingPonds.size();
+  if (lockPondList())
+  {
+    m_oPondList.swap(m_oLoadingPonds);
+    m_u8TotalNoOfPonds = totalPonds;
+    unlockPondList();
+  }
+  std::vector<CPond>().swap(m_oLoadingPonds);
+  debugPrintf("length: %d\n", totalPonds);
+  if (!totalPonds)
+  {
+    debugPrintln("No config found in the file...");
+    return 0;
+  }
+
+  /*Update Pond Status from Stored values if no file found save the local data in file*/
+  if (!loadPondStatusFromFile())
+  {
+    Serial.println(" Saving the status to the pond map file");
+    savePondStatusToFile();
+  }
+  return 1;
 }
 
-bool CPondConfig::saveSinglePondStatusToFile(const std::string &pondName)
+/************************************************************
+ * Add one pond from its config line
+ * "locationVersion|pondName|pondId|salinity|locationId|active"
+ * and check its boundary file against the version
+ * Returns false once TOTAL_PONDS are loaded
+ *************************************************************/
+bool CPondConfig::addPond(const char *line)
 {
-  int size = _fileSystem->getFileSize(PONDS_STATUS_CONFIG);
-  if (size <= 0)
+  if (m_oLoadingPonds.size() >= TOTAL_PONDS)
   {
-    debugPrintln("PONDS_STATUS_CONFIG not found or empty");
+    debugPrintln("Too many ponds, ignoring the rest");
     return false;
   }
-  
-  // Validate file size
-  if (size > 4096) // Max 4KB for pond status config
+  debugPrintln(line);
+
+  long locationVersion = 0;
+  char pondName[50] = "";
+  char pondId[50] = "";
+  int salinity = 0;
+  char locationId[50] = "";
+  int activeStatus = 0;
+
+  sscanf(line, "%ld|%49[^|]|%49[^|]|%d|%49[^|]|%d", &locationVersion, pondName, pondId, &salinity, locationId, &activeStatus);
+
+  CPond pond;
+  pond.m_iLocationVersion = locationVersion;
+  snprintf(pond.m_cPondname, sizeof(pond.m_cPondname), "%s", pondName);
+  snprintf(pond.m_cPondId, sizeof(pond.m_cPondId), "%s", pondId);
+  pond.m_iSalinity = salinity;
+  snprintf(pond.m_cLocationID, sizeof(pond.m_cLocationID), "%s", locationId);
+  pond.m_u32BoundaryPoints = 0;
+
+  /* Check the boundary index entry against the version in the config */
+  struct pond_bounds_hdr hdr;
+  bool isPondBoundariesDataAvailable = AVAILABLE;
+  if (!pond_bounds_read(pond.m_cPondname, &hdr))
   {
-    debugPrintln("PONDS_STATUS_CONFIG file too large");
-    return false;
+    debugPrintf("Pond boundary not found for %s\n", pondName);
+    isPondBoundariesDataAvailable = NOT_AVAILABLE;
   }
-
-  // Allocate buffer on heap for file content
-  size_t bufferSize = (size < 2048) ? 2048 : size + 256;
-  if (bufferSize > 4096) bufferSize = 4096; // Cap at 4KB
-  char *buffer = new char[bufferSize];
-  if (!buffer)
+  else if (hdr.location_version != locationVersion)
   {
-    debugPrintf("Heap allocation failed for buffer!\n");
-    return false;
+    debugPrintf("Version mismatch for pond %s: stored=%ld, new=%ld\n", pondName, (long)hdr.location_version, locationVersion);
+    isPondBoundariesDataAvailable = NOT_AVAILABLE;
   }
-  memset(buffer, 0, bufferSize);
-
-  // Read existing pond status file
-  if (_fileSystem->readFile(PONDS_STATUS_CONFIG, buffer) <= 0)
+  else
   {
-    debugPrintf("Pond status file not found. Creating a new one.\n");
-    strcpy(buffer, "{}"); // Start fresh if file missing
+    pond.m_u32BoundaryPoints = hdr.count;
   }
 
-  // Convert to std::string for easier JSON handling
-  std::string jsonContent(buffer);
-
-  // Free the buffer now that we have std::string
-  delete[] buffer;
-
-  // Allocate JSON document on heap
-  DynamicJsonDocument *doc = new DynamicJsonDocument(4096); // adjust if needed
-  if (!doc)
+  if (isPondBoundariesDataAvailable == NOT_AVAILABLE)
   {
-    debugPrintf("Heap allocation failed for JSON document!\n");
-    return false;
+    Serial.println("Pond Boundaries not available so setting the pond colors to blue");
+    m_bGetPondBoundaries = true;
+    updatedPondIds[pondId] = pond.m_cPondname;
+    /*Initially when the pond config is loaded from file keep all the ponds color in blue representing
+    the boundaries are not available for those ponds and later when boundaries are loaded show their state whether active or harvested*/
+    m_pondStatusMap[pond.m_cPondname] = {isPondBoundariesDataAvailable, activeStatus, POND_BOUNDARIES_NOT_AVAILABLE};
   }
-
-  // Parse existing JSON
-  DeserializationError error = deserializeJson(*doc, jsonContent.c_str());
-  if (error)
+  else
   {
-    debugPrintf("Failed to parse existing pond status JSON: %s\n", error.c_str());
-    delete doc;
-    return false;
+    Serial.printf("Pond boundaries available , active Status: %d \n", activeStatus);
+    m_pondStatusMap[pond.m_cPondname] = {isPondBoundariesDataAvailable, activeStatus, activeStatus};
   }
+  m_oLoadingPonds.push_back(pond);
+  return true;
+}
 
-  // Ensure the pond exists in memory map
-  auto it = m_pondStatusMap.find(pondName);
-  if (it == m_pondStatusMap.end())
+/************************************************************
+ * Refresh a pond's boundary index entry after a download
+ *************************************************************/
+void CPondConfig::updateBoundaryIndex(const char *pondName)
+{
+  struct pond_bounds_hdr hdr;
+  uint32_t points = pond_bounds_read(pondName, &hdr) ? hdr.count : 0;
+  if (!lockPondList())
+    return;
+  for (auto &pond : m_oPondList)
   {
-    debugPrintf("Pond '%s' not found in m_pondStatusMap.\n", pondName.c_str());
-    delete doc;
-    return false;
+    if (!strcmp(pond.m_cPondname, pondName))
+      pond.m_u32BoundaryPoints = points;
   }
+  unlockPondList();
+}
 
-  // Update or create JSON entry for this pond
-  JsonObject obj = (*doc)[pondName.c_str()].to<JsonObject>();
-  obj["pb"] = it->second.isBoundariesAvailable;
-  obj["isAct"] = it->second.isActive;
-  obj["pStat"] = it->second.PondDataStatus;
+/*************************************************
+ * Update one pond's map status, appending a few bytes to the status log
+ * A pond the checkpoint does not list yet gets a new checkpoint instead
+ *************************************************/
+void CPondConfig::updatePondStatus(const char* pondName, int status)
+{
+    if (pondName == nullptr || pondName[0] == '\0') return; // skip empty pond names
 
-  // Serialize updated JSON back to string
-  std::string newJson;
-  serializeJson(*doc, newJson);
+    auto it = m_pondStatusMap.find(pondName);
+    if (it == m_pondStatusMap.end() || m_pondStatusMap.size() != m_oStatusStore.count)
+    {
+        m_pondStatusMap[pondName].PondDataStatus = status;
+        savePondStatusToFile();
+        return;
+    }
+    if (it->second.PondDataStatus == status) return;
 
-  // Free JSON document
-  delete doc;
+    it->second.PondDataStatus = status;
+    uint32_t index = std::distance(m_pondStatusMap.begin(), it);
+    if (!pond_status_store_update(&m_oStatusStore, index, it->second.isActive, status) ||
+        pond_status_store_needs_checkpoint(&m_oStatusStore))
+        savePondStatusToFile();
+}
 
-  // Write back to file
-  bool result = _fileSystem->writeFile(PONDS_STATUS_CONFIG, newJson.c_str());
-  debugPrintf("Saved single pond '%s' status to file: %s\n",
-              pondName.c_str(), result ? "SUCCESS" : "FAILURE");
+/*************************************************
+ * save pond status in file system: a checkpoint of the whole map
+ * Deltas refer to ponds by their position in the map
+ *************************************************/
+bool CPondConfig::savePondStatusToFile()
+{
+  std::vector<pond_status_entry> entries;
+  entries.reserve(m_pondStatusMap.size());
+  for (const auto &pair : m_pondStatusMap)
+  {
+    if (entries.size() >= POND_STATUS_MAX_ENTRIES) break;
+    pond_status_entry e;
+    strncpy(e.name, pair.first.c_str(), sizeof(e.name));
+    e.is_active = pair.second.isActive ? 1 : 0;
+    e.status = pair.second.PondDataStatus;
+    entries.push_back(e);
+  }
 
-  return result;
+  debugPrintf("  pond status map (%d entries) to file\n", m_pondStatusMap.size());
+  return pond_status_store_checkpoint(&m_oStatusStore, entries.data(), entries.size());
 }
 
 /*************************************************
@@ -354,56 +299,43 @@ bool CPondConfig::saveSinglePondStatusToFile(const std::string &pondName)
  *************************************************/
 bool CPondConfig::loadPondStatusFromFile()
 {
-  int size = _fileSystem->getFileSize(PONDS_STATUS_CONFIG);
-  if (size <= 0)
-  {
-    debugPrintln("PONDS_STATUS_CONFIG not found or empty");
-    return false;
-  }
-  
-  // Validate file size
-  if (size > 4096) // Max 4KB for pond status config
-  {
-    debugPrintln("PONDS_STATUS_CONFIG file too large");
-    return false;
-  }
-
-  char *buffer = new char[size + 1];
-  if (!buffer)
-  {
-    debugPrintln("Memory allocation failed for pond status buffer");
-    return false;
-  }
-  
-  if (!_fileSystem->readFile(PONDS_STATUS_CONFIG, buffer))
+  std::vector<pond_status_entry> entries(POND_STATUS_MAX_ENTRIES);
+  uint32_t count = 0;
+  if (!pond_status_store_load(&m_oStatusStore, entries.data(), entries.size(), &count))
   {
-    debugPrintln("Failed to read PONDS_STATUS_CONFIG");
-    delete[] buffer;
+    debugPrintln("Pond status checkpoint not found");
+    if (SPIFFS.exists(PONDS_STATUS_LEGACY))
+      SPIFFS.remove(PONDS_STATUS_LEGACY);
     return false;
   }
 
-  DynamicJsonDocument doc(size * 2);
-  DeserializationError err = deserializeJson(doc, buffer);
-  delete[] buffer;
-
-  if (err)
-  {
-    debugPrintf("JSON deserialization failed: %s\n", err.c_str());
-    return false;
-  }
   /*update pond st*/
-  for (JsonPair kv : doc.as<JsonObject>())
+  for (uint32_t i = 0; i < count; i++)
   {
-    const char *pondName = kv.key().c_str();
-    JsonObject obj = kv.value();
-    m_pondStatusMap[pondName].isActive = obj["isAct"];
-    m_pondStatusMap[pondName].PondDataStatus = obj["pStat"];
+    char pondName[POND_STATUS_NAME_LEN + 1];
+    memcpy(pondName, entries[i].name, POND_STATUS_NAME_LEN);
+    pondName[POND_STATUS_NAME_LEN] = '\0';
+    if (pondName[0] == '\0') continue;
+    m_pondStatusMap[pondName].isActive = entries[i].is_active;
+    m_pondStatusMap[pondName].PondDataStatus = entries[i].status;
   }
+  debugPrintf("Loaded %d pond statuses from file\n", count);
 
-  debugPrintf("Loaded %d pond statuses from file\n", m_pondStatusMap.size());
+  /*New ponds in the config, or a damaged log: the deltas need a fresh checkpoint*/
+  if (m_pondStatusMap.size() != m_oStatusStore.count || pond_status_store_needs_checkpoint(&m_oStatusStore))
+    savePondStatusToFile();
   return true;
 }
 
+/*************************************************
+ * Forget the stored status, before a new config is loaded
+ *************************************************/
+void CPondConfig::clearPondStatus()
+{
+  pond_status_store_remove(&m_oStatusStore);
+  m_pondStatusMap.clear();
+}
+
 void CPondConfig::resetAllPondDataStatus()
 {
   Serial.println("Resetting all PondDataStatus values to 1 if they are active");
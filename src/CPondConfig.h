@@ -11,10 +11,14 @@
 #include <cstring> // Include for C-style string functions like strcpy and strncpy
 #include <cstdio>
 #include <vector>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "pond_status_store.h"
 
-#define TOTAL_PONDS 40
+#define TOTAL_PONDS 255 // m_u8TotalNoOfPonds limit
 #define FILENAME_IDSCONFIG "/idsConfig.txt"
-#define PONDS_STATUS_CONFIG "/PondSActiveFile.txt"
+#define FILENAME_IDSCONFIG_NEW "/idsConfig.new" // download staging, swapped in when complete
+#define PONDS_STATUS_LEGACY "/PondSActiveFile.txt" // JSON status of older firmware, dropped on load
 
 /*POND_MAP_FRAME_STORED_STATUS*/
 #define PONDMAP_VALUE_NOT_ACTIVE 0 //harvested - Grey
@@ -49,12 +53,15 @@ public:
     int m_iLocationVersion;
     int m_iSalinity;
     char m_cLocationID[50];
+    uint32_t m_u32BoundaryPoints; // boundary index: posts in the pond's .pb file, 0 if none
 };
 
 class CPondConfig
 {
 private:
     FILESYSTEM *_fileSystem;
+    struct pond_status_store m_oStatusStore; // checkpoint of m_pondStatusMap (in map order) plus delta log
+    std::vector<CPond> m_oLoadingPonds;      // filled while the config file is parsed, then swapped in
 
 public:
     /* Construct */
@@ -62,7 +69,7 @@ public:
     /* Destruct */
     ~CPondConfig();
     int64_t m_i64ConfigIdsVersion;
-    uint8_t m_u8TotalNoOfPonds;
+    uint8_t m_u8TotalNoOfPonds; // m_oPondList.size(), read it under m_xPondListMutex too
 
     // std::map<std::string, int> m_locationVersions;
 
@@ -73,12 +80,20 @@ public:
     char m_cTenantId[20];
     bool m_bGetPondBoundaries = false;
     int m_iOffset;
-    CPond m_oPondList[TOTAL_PONDS];
+    /*The Frame task reloads the list and refreshes boundary entries while the App task walks it:
+    take m_xPondListMutex (lockPondList) around every access*/
+    SemaphoreHandle_t m_xPondListMutex;
+    std::vector<CPond> m_oPondList;
     double m_dPondSettingVer;
     int loadPondConfig();
+    bool addPond(const char *line);
+    void updateBoundaryIndex(const char *pondName);
+    bool lockPondList();
+    void unlockPondList();
+    bool findPond(const char *pondName, CPond &pond);
     bool savePondStatusToFile();
-    bool saveSinglePondStatusToFile(const std::string &pondName);
     bool loadPondStatusFromFile();
+    void clearPondStatus();
     void resetAllPondDataStatus();
     void updatePondStatus(const char* pondName, int status);
 };
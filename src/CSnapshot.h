@@ -0,0 +1,92 @@
+/**
+ * @file CSnapshot.h
+ * @brief Single-writer seqlock snapshot for state shared across tasks
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * One task owns a value and publishes it with write(); any number of tasks
+ * on either core take consistent copies with read(). Readers never block the
+ * writer and never take a mutex: they retry only if a write overlapped the
+ * copy, which at our 1 Hz - 10 Hz publish rates is rare and short.
+ *
+ * T must be trivially copyable (plain structs, fixed char arrays).
+ * A reader that keeps colliding sleeps a tick, so a higher priority reader
+ * on the writer's core cannot starve the write it is waiting for.
+ *
+ * @par Usage Pattern:
+ * @code
+ * CSnapshot<SensorData> g_sensorData;
+ *
+ * // writer task
+ * SensorData s = {...};
+ * g_sensorData.write(s);
+ *
+ * // reader tasks
+ * SensorData now = g_sensorData.read();
+ * @endcode
+ */
+
+#ifndef CSNAPSHOT_H
+#define CSNAPSHOT_H
+
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define SNAPSHOT_SPIN_BEFORE_SLEEP 8
+
+template <typename T>
+class CSnapshot
+{
+    static_assert(std::is_trivially_copyable<T>::value, "CSnapshot<T> needs a trivially copyable T");
+
+private:
+    std::atomic<uint32_t> m_u32Seq;   /* odd while a write is in progress */
+    T m_tValue;
+
+public:
+    CSnapshot() : m_u32Seq(0), m_tValue() {}
+
+    /* Publish a new value, must only be called from the owning task */
+    void write(const T &value)
+    {
+        uint32_t seq = m_u32Seq.load(std::memory_order_relaxed);
+        m_u32Seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy((void *)&m_tValue, &value, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_release);
+        m_u32Seq.store(seq + 2, std::memory_order_relaxed);
+    }
+
+    /* Take a consistent copy, safe from any task */
+    T read(void) const
+    {
+        T copy;
+        uint32_t before, after;
+        for (uint32_t attempt = 1;; attempt++)
+        {
+            before = m_u32Seq.load(std::memory_order_acquire);
+            if (!(before & 1))
+            {
+                memcpy(&copy, (const void *)&m_tValue, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = m_u32Seq.load(std::memory_order_relaxed);
+                if (before == after)
+                    return copy;
+            }
+            if (attempt % SNAPSHOT_SPIN_BEFORE_SLEEP == 0)
+                vTaskDelay(1);
+        }
+    }
+
+    /* Number of writes so far, lets a reader skip work when nothing changed */
+    uint32_t version(void) const
+    {
+        return m_u32Seq.load(std::memory_order_acquire) >> 1;
+    }
+};
+
+#endif /* CSNAPSHOT_H */
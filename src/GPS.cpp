@@ -1,4 +1,5 @@
 #include "GPS.h"
+#include "field_trace.h"
 
 // #define SERIAL_DEBUG
 #ifdef SERIAL_DEBUG
@@ -20,9 +21,50 @@ CGps::CGps() {}
 /* Destruct */
 CGps::~CGps() {}
 
-void CGps::gpsInit(Stream *serialHandle)
+/*****************************************
+ * Select the protocol and configure the receiver port for it
+ * UBX: NAV-DOP and NAV-PVT once per epoch, NMEA output off, GPS_RATE_IDLE_HZ to start
+ * NMEA: output switched back to NMEA in case the receiver kept UBX in backup RAM
+ *****************************************/
+void CGps::gpsInit(Stream *serialHandle, uint32_t baud, uint8_t protocol)
 {
   _gpsSerial = serialHandle;
+  m_u8Protocol = protocol;
+  ubx_parser_init(&m_oUbx);
+  memset(&m_oUbxDop, 0, sizeof(m_oUbxDop));
+  m_oUbxDop.itow_ms = UINT32_MAX;
+  m_u32NmeaEpoch = UINT32_MAX;
+  m_u8NmeaSeen = 0;
+  m_u8NmeaExpect = 0;
+  gps_filter_init(&m_oFilter);
+
+  uint8_t msg[32];
+  sendUbx(msg, ubx_build_cfg_prt(msg, sizeof(msg), baud, protocol == GPS_PROTOCOL_UBX));
+  if (protocol == GPS_PROTOCOL_UBX)
+  {
+    sendUbx(msg, ubx_build_cfg_msg(msg, sizeof(msg), UBX_CLASS_NAV, UBX_ID_NAV_DOP, 1));
+    sendUbx(msg, ubx_build_cfg_msg(msg, sizeof(msg), UBX_CLASS_NAV, UBX_ID_NAV_PVT, 1));
+    setNavRate(GPS_RATE_IDLE_HZ);
+  }
+}
+
+/*****************************************
+ * Change the UBX navigation rate, NMEA keeps the receiver default
+ *****************************************/
+void CGps::setNavRate(uint8_t hz)
+{
+  if (m_u8Protocol != GPS_PROTOCOL_UBX || hz == 0 || hz == m_u8RateHz)
+    return;
+  uint8_t msg[16];
+  sendUbx(msg, ubx_build_cfg_rate(msg, sizeof(msg), (uint16_t)(1000 / hz)));
+  m_u8RateHz = hz;
+  debugPrintf("[GPS] NAV-PVT at %u Hz\n", hz);
+}
+
+void CGps::sendUbx(const uint8_t *msg, size_t len)
+{
+  if (_gpsSerial && len)
+    _gpsSerial->write(msg, len);
 }
 
 /*****************************************
@@ -54,63 +96,176 @@ time_t CGps::ConvertToEpoch(uint16_t year, uint8_t mon, uint8_t date, uint8_t ho
 
 void CGps::gpstask(void)
 {
-  static String nmeaLine;
-  static bool serialStarted = false;
+  if (m_u8Protocol == GPS_PROTOCOL_UBX)
+    ubxTask();
+  else
+    nmeaTask();
+}
+
+/*****************************************
+ * Feed NMEA sentences through TinyGPS++
+ * RMC and GGA both carry the fix of an epoch; it is published once,
+ * when the sentences the previous epoch brought have all arrived with
+ * the same UTC time, so position, HDOP and validity are of one epoch
+ *****************************************/
+void CGps::nmeaTask(void)
+{
+  uint8_t raw[GPS_TRACE_CHUNK];
+  size_t rawLen = 0;
   while (_gpsSerial->available() > 0)
   {
-    serialStarted = true;
     char c = _gpsSerial->read();
-    gps1.encode(c);
+    raw[rawLen++] = (uint8_t)c;
+    if (rawLen == sizeof(raw))
+    {
+      field_trace_record(FIELD_TRACE_GPS, raw, rawLen);
+      rawLen = 0;
+    }
+    if (!gps1.encode(c) || !gps1.time.isUpdated())
+      continue;
+    if (gps1.time.value() != m_u32NmeaEpoch)
+    {
+      m_u32NmeaEpoch = gps1.time.value();
+      if (m_u8NmeaSeen & (NMEA_SEEN_RMC | NMEA_SEEN_GGA))
+        m_u8NmeaExpect = m_u8NmeaSeen & (NMEA_SEEN_RMC | NMEA_SEEN_GGA);
+      m_u8NmeaSeen = 0;
+    }
+    /*Only RMC commits the date, only GGA the satellites*/
+    if (gps1.date.isUpdated())
+    {
+      gps1.date.value();
+      m_u8NmeaSeen |= NMEA_SEEN_RMC;
+    }
+    if (gps1.satellites.isUpdated())
+    {
+      gps1.satellites.value();
+      m_u8NmeaSeen |= NMEA_SEEN_GGA;
+    }
+    if ((m_u8NmeaSeen & NMEA_SEEN_PUBLISHED) || (m_u8NmeaSeen & m_u8NmeaExpect) != m_u8NmeaExpect)
+      continue;
+    m_u8NmeaSeen |= NMEA_SEEN_PUBLISHED;
 
-    if (gps1.location.isUpdated() || gps1.time.isUpdated())
+    /*Lats and Longs*/
+    mPosition.m_lat = gps1.location.lat();
+    mPosition.m_lng = gps1.location.lng();
+    /*Whether the GPS is valid or not*/
+    if (gps1.location.isValid() && gps1.satellites.value() >= 4 && (gps1.hdop.hdop() < 3.0 && gps1.hdop.hdop() > 0.0))
+    {
+        m_bIsValid = true;
+    }
+    else
     {
-      /*Lats and Longs*/
-      mPosition.m_lat = gps1.location.lat();
-      mPosition.m_lng = gps1.location.lng();
-      /*Whether the GPS is valid or not*/
-      if (gps1.location.isValid() && gps1.satellites.value() >= 4 && (gps1.hdop.hdop() < 3.0 && gps1.hdop.hdop() > 0.0))
-      {
-          m_bIsValid = true;
-      }
-      else
-      {
-          m_bIsValid = false;
-      }
-      /*HDop and Satellites*/
-      if (gps1.hdop.isValid()) {
-          mPosition.hDop = gps1.hdop.hdop();
-      }
-      
-
-      mPosition.m_iSatellites = gps1.satellites.value();
+        m_bIsValid = false;
+    }
+    /*HDop and Satellites*/
+    if (gps1.hdop.isValid()) {
+        mPosition.hDop = gps1.hdop.hdop();
+    }
     
-      GpsHour = gps1.time.hour();
-      GpsMins = gps1.time.minute();
-      GpsDay = gps1.date.day();
-      uint8_t GpsSec = gps1.time.second();
-
-      uint8_t month = gps1.date.month();
-      uint32_t year = gps1.date.year();
-
-      Epoch = ConvertToEpoch(year, month, GpsDay, GpsHour, GpsMins, GpsSec);
-
-      debugPrint(GpsHour);
-      debugPrint(" : ");
-      debugPrint(GpsMins);
-      debugPrint(" : ");
-      debugPrint(GpsSec);
-      debugPrint("@ ");
-      debugPrint(GpsDay);
-      debugPrint("/");
-      debugPrint(month);
-      debugPrint("/");
-      debugPrintln(year);
-      debugPrint("Epoch  :");
-      debugPrintln(Epoch);
+
+    mPosition.m_iSatellites = gps1.satellites.value();
+  
+    GpsHour = gps1.time.hour();
+    GpsMins = gps1.time.minute();
+    GpsDay = gps1.date.day();
+    uint8_t GpsSec = gps1.time.second();
+
+    uint8_t month = gps1.date.month();
+    uint32_t year = gps1.date.year();
+
+    Epoch = ConvertToEpoch(year, month, GpsDay, GpsHour, GpsMins, GpsSec);
+
+    debugPrint(GpsHour);
+    debugPrint(" : ");
+    debugPrint(GpsMins);
+    debugPrint(" : ");
+    debugPrint(GpsSec);
+    debugPrint("@ ");
+    debugPrint(GpsDay);
+    debugPrint("/");
+    debugPrint(month);
+    debugPrint("/");
+    debugPrintln(year);
+    debugPrint("Epoch  :");
+    debugPrintln(Epoch);
+
+    /*Publish the fix as one consistent record for the other tasks*/
+    publishFix(gps1.speed.isValid() ? (float)gps1.speed.mps() : 0.0f, 0.0f, m_bIsValid ? UBX_FIX_3D : UBX_FIX_NONE);
+  }
+  if (rawLen)
+    field_trace_record(FIELD_TRACE_GPS, raw, rawLen);
+}
+
+
+/*****************************************
+ * Decode NAV-PVT frames, one complete epoch per frame
+ *****************************************/
+void CGps::ubxTask(void)
+{
+  uint8_t raw[GPS_TRACE_CHUNK];
+  size_t rawLen = 0;
+  while (_gpsSerial->available() > 0)
+  {
+    struct ubx_nav_pvt pvt;
+    uint8_t c = (uint8_t)_gpsSerial->read();
+    raw[rawLen++] = c;
+    if (rawLen == sizeof(raw))
+    {
+      field_trace_record(FIELD_TRACE_GPS, raw, rawLen);
+      rawLen = 0;
     }
+    if (!ubx_parser_feed(&m_oUbx, c))
+      continue;
+    /*The receiver sends NAV-DOP ahead of NAV-PVT in each epoch*/
+    if (ubx_decode_nav_dop(&m_oUbx, &m_oUbxDop) || !ubx_decode_nav_pvt(&m_oUbx, &pvt))
+      continue;
+
+    mPosition.m_lat = pvt.lat * 1e-7;
+    mPosition.m_lng = pvt.lon * 1e-7;
+    /*PDOP is not HDOP: without this epoch's NAV-DOP the HDOP is unknown*/
+    mPosition.hDop = (m_oUbxDop.itow_ms == pvt.itow_ms) ? m_oUbxDop.hdop * 0.01 : 0.0;
+    mPosition.m_iSatellites = pvt.num_sv;
+    /*Same acceptance as NMEA, with the receiver's accuracy estimate in place of HDOP*/
+    m_bIsValid = (pvt.flags & UBX_PVT_GNSS_FIX_OK) && pvt.fix_type >= UBX_FIX_3D && pvt.fix_type != UBX_FIX_TIME_ONLY &&
+                 pvt.num_sv >= 4 && pvt.h_acc_mm <= GPS_UBX_VALID_HACC_MM;
+
+    if ((pvt.valid & (UBX_PVT_VALID_DATE | UBX_PVT_VALID_TIME)) == (UBX_PVT_VALID_DATE | UBX_PVT_VALID_TIME))
+    {
+      GpsHour = pvt.hour;
+      GpsMins = pvt.min;
+      GpsDay = pvt.day;
+      Epoch = ConvertToEpoch(pvt.year, pvt.month, pvt.day, pvt.hour, pvt.min, pvt.sec);
+    }
+    publishFix(pvt.g_speed_mms * 0.001f, pvt.h_acc_mm * 0.001f, pvt.fix_type);
   }
+  if (rawLen)
+    field_trace_record(FIELD_TRACE_GPS, raw, rawLen);
 }
 
+/*****************************************
+ * Filter the working copy and publish it as one consistent record for the other tasks
+ *****************************************/
+void CGps::publishFix(float speedMps, float hAccM, uint8_t fixType)
+{
+  if (m_bIsValid)
+    gps_filter_update(&m_oFilter, mPosition.m_lat, mPosition.m_lng, gps_filter_sigma(hAccM, mPosition.hDop), millis());
+  else
+    gps_filter_predict(&m_oFilter, millis());
+
+  GpsFix fix;
+  fix.lat = m_oFilter.ready ? m_oFilter.lat : mPosition.m_lat;
+  fix.lng = m_oFilter.ready ? m_oFilter.lng : mPosition.m_lng;
+  fix.rawLat = mPosition.m_lat;
+  fix.rawLng = mPosition.m_lng;
+  fix.radiusM = m_oFilter.radius_m;
+  fix.hDop = mPosition.hDop;
+  fix.satellites = mPosition.m_iSatellites;
+  fix.speedMps = speedMps;
+  fix.hAccM = hAccM;
+  fix.fixType = fixType;
+  fix.isValid = m_bIsValid;
+  m_oFix.write(fix);
+}
 
 // time_t CGps:: getEpoch()
 // {
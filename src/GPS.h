@@ -2,6 +2,38 @@
 #define GPS_H
 
 #include "TinyGPS++.h"
+#include "CSnapshot.h"
+#include "ubx_parser.h"
+#include "gps_filter.h"
+
+#define GPS_PROTOCOL_NMEA 0  /* Receiver default sentences through TinyGPS++ */
+#define GPS_PROTOCOL_UBX 1   /* u-blox NAV-PVT only */
+
+#define GPS_UBX_VALID_HACC_MM 10000 /* UBX fix accepted up to this accuracy estimate */
+#define GPS_RATE_WALKING_HZ 5
+#define GPS_RATE_IDLE_HZ 1
+#define GPS_TRACE_CHUNK 64  /* Receiver bytes per field trace record */
+
+#define NMEA_SEEN_RMC 0x01
+#define NMEA_SEEN_GGA 0x02
+#define NMEA_SEEN_PUBLISHED 0x80
+
+/* Consistent view of the last fix, published by the GPS task */
+struct GpsFix
+{
+    double lat = 0.0;    /* Filtered position */
+    double lng = 0.0;
+    double rawLat = 0.0; /* As reported by the receiver */
+    double rawLng = 0.0;
+    float radiusM = 0.0f; /* 1-sigma uncertainty of lat/lng, 0 before the first fix */
+    double hDop = 0.0;  /* HDOP from GGA or NAV-DOP, 0 when the epoch had none */
+    int satellites = 0;
+    float speedMps = 0.0f;
+    float hAccM = 0.0f; /* UBX accuracy estimate, 0 with NMEA */
+    uint8_t fixType = 0; /* ubx_fix_type_t, NMEA reports 3 or 0 */
+    bool isValid = false;
+};
+
 class cPosition
 {
 public:
@@ -24,7 +56,19 @@ class CGps
 {
 private:
     Stream* _gpsSerial; 
+    uint8_t m_u8Protocol = GPS_PROTOCOL_NMEA;
+    uint8_t m_u8RateHz = 0;
+    struct ubx_parser m_oUbx;
+    struct ubx_nav_dop m_oUbxDop; /* last NAV-DOP, used by the NAV-PVT of the same epoch */
+    uint32_t m_u32NmeaEpoch; /* UTC time (hhmmsscc) of the current NMEA epoch */
+    uint8_t m_u8NmeaSeen;    /* NMEA_SEEN_* of the current epoch */
+    uint8_t m_u8NmeaExpect;  /* Sentences the last epoch brought, published once these are in */
+    struct gps_filter m_oFilter;
     time_t ConvertToEpoch(uint16_t year, uint8_t mon, uint8_t date, uint8_t hour, uint8_t min, uint8_t sec);
+    void sendUbx(const uint8_t *msg, size_t len);
+    void nmeaTask(void);
+    void ubxTask(void);
+    void publishFix(float speedMps, float hAccM, uint8_t fixType);
 
 public:
     /* Construct */
@@ -40,7 +84,10 @@ public:
     bool m_bIsValid = false;
 
     cPosition mPosition;
-    void gpsInit(Stream *serialHandle);
+    CSnapshot<GpsFix> m_oFix; /* read this from other tasks, mPosition is the GPS task's working copy */
+    void gpsInit(Stream *serialHandle, uint32_t baud, uint8_t protocol);
+    void setNavRate(uint8_t hz);
+    uint8_t protocol(void) { return m_u8Protocol; }
     time_t getEpoch(void);
     void gpstask(void);
 };
@@ -4,6 +4,23 @@
 #include <WiFi.h>
 #include <SPIFFS.h>
 #include <ArduinoJson.h>
+#include "rpc_dispatch.h"
+#include "config_page.h"
+#include "esp32/rom/crc.h"
+
+#define RPC_FILE_CONTENT_MAX 768 // largest file getFileContent returns in one reply
+#define RPC_FILE_CHUNK_MAX 768   // raw bytes per getFileChunk, 1 KB once base64 encoded
+#define RPC_LIST_PAGE_MAX 16     // entries per listFiles page
+#define RPC_LIST_BUFFER 1024
+#define RPC_METRICS_DOC 4096     // getMetrics document pool
+#define RPC_METRICS_BUFFER 2560  // serialized getMetrics reply, past RPC_REPLY_SLOT_SIZE so it goes out in the large buffer
+static_assert(RPC_METRICS_BUFFER <= RPC_REPLY_MAX_RESULT, "the getMetrics reply must fit the large reply buffer");
+static_assert(CONFIG_PAGE_REPLY_MAX <= RPC_REPLY_MAX_RESULT, "a full getConfig page must fit the large reply buffer");
+#define RPC_OUT_OF_MEMORY "{\"statusCode\":500,\"statusMsg\":\"out of memory.\"}"
+#define RPC_SENSOR_WAIT_MS 5000  // a probe request waits for the poll in flight and its own transaction, each up to the 2 s Modbus timeout
+#define RPC_SENSOR_POLL_MS 20
+#define RPC_SENSOR_ACCEPTED "{\"statusCode\":202,\"statusMsg\":\"accepted, sensor busy.\"}"
+#define RPC_SENSOR_COMM_ERROR "{\"statusCode\":300,\"statusMsg\":\"Not Set due to communicaton error.\"}"
 
 // Debug macros
 // #define SERIAL_DEBUG  // Disabled to save flash memory - Enable only for debugging
@@ -20,68 +37,70 @@
 #endif
 void setSharedFlag(bool &flag, bool value)
 {
-    // debugPrintf("@@ [MUTEX] setSharedFlag attempting to take mutex, value=%d\n", value);
-    if (xSharedVarMutex != NULL && xSemaphoreTake(xSharedVarMutex, portMAX_DELAY) == pdTRUE)
-    {
-        // debugPrintln("@@ [MUTEX] setSharedFlag mutex acquired");
-        flag = value;
-        xSemaphoreGive(xSharedVarMutex);
-        // debugPrintln("@@ [MUTEX] setSharedFlag mutex released");
-    }
-    else
-    {
-        // debugPrintln("@@ [MUTEX] setSharedFlag FAILED to acquire mutex - using fallback");
-        flag = value; // Fallback if mutex not initialized
-    }
+    // Single aligned words are atomic on the ESP32, only ordering is needed - no mutex round trip
+    __atomic_store_n(&flag, value, __ATOMIC_RELEASE);
 }
 
 bool getSharedFlag(bool &flag)
 {
-    bool value = false;
-    // debugPrintln("@@ [MUTEX] getSharedFlag attempting to take mutex");
-    if (xSharedVarMutex != NULL && xSemaphoreTake(xSharedVarMutex, portMAX_DELAY) == pdTRUE)
-    {
-        // debugPrintln("@@ [MUTEX] getSharedFlag mutex acquired");
-        value = flag;
-        xSemaphoreGive(xSharedVarMutex);
-        // debugPrintf("@@ [MUTEX] getSharedFlag mutex released, value=%d\n", value);
-    }
-    else
-    {
-        // debugPrintln("@@ [MUTEX] getSharedFlag FAILED to acquire mutex - using fallback");
-        value = flag; // Fallback if mutex not initialized
-    }
-    return value;
+    return __atomic_load_n(&flag, __ATOMIC_ACQUIRE);
 }
 
 void setSharedInt(int &var, int value)
 {
-    if (xSharedVarMutex != NULL && xSemaphoreTake(xSharedVarMutex, portMAX_DELAY) == pdTRUE)
-    {
-        var = value;
-        xSemaphoreGive(xSharedVarMutex);
-    }
-    else
-    {
-        var = value; // Fallback if mutex not initialized
-    }
+    __atomic_store_n(&var, value, __ATOMIC_RELEASE);
 }
 
 int getSharedInt(int &var)
 {
-    int value = 0;
-    if (xSharedVarMutex != NULL && xSemaphoreTake(xSharedVarMutex, portMAX_DELAY) == pdTRUE)
+    return __atomic_load_n(&var, __ATOMIC_ACQUIRE);
+}
+
+/***********************************************
+ *  Run a request on the primary probe through the Modbus task, which owns the RS-485 UART
+ *  Waits up to RPC_SENSOR_WAIT_MS for the result; on timeout the request is released,
+ *  it still runs but its result is dropped
+ *  Returns sensor_bus_res_t, SENSOR_BUS_RES_PENDING on timeout
+ *************************************************/
+static uint8_t sensorBusCall(uint8_t op, float value, float *out, float *outB)
+{
+    uint32_t ticket = sensor_bus_post(&g_sensor_bus, PRIMARY_PROBE_SLAVE_ID, op, value);
+    if (!ticket)
+        return SENSOR_BUS_RES_FAILED;
+    app_events_signal(APP_EV_SENSOR_BUS);
+
+    uint32_t start = millis();
+    uint8_t res;
+    while ((res = sensor_bus_result(&g_sensor_bus, ticket, out, outB)) == SENSOR_BUS_RES_PENDING)
     {
-        value = var;
-        xSemaphoreGive(xSharedVarMutex);
+        if (millis() - start >= RPC_SENSOR_WAIT_MS)
+        {
+            sensor_bus_release(&g_sensor_bus, ticket);
+            break;
+        }
+        vTaskDelay(pdMS_TO_TICKS(RPC_SENSOR_POLL_MS));
     }
+    return res;
+}
+
+/***********************************************
+ *  Reply to a probe write: done, queued behind a slow bus, or failed
+ *************************************************/
+static void replySensorWrite(struct jsonrpc_request *r, uint8_t res)
+{
+    if (res == SENSOR_BUS_RES_OK)
+        jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\"}");
+    else if (res == SENSOR_BUS_RES_PENDING)
+        jsonrpc_return_success(r, RPC_SENSOR_ACCEPTED);
     else
-    {
-        value = var; // Fallback if mutex not initialized
-    }
-    return value;
+        jsonrpc_return_success(r, RPC_SENSOR_COMM_ERROR);
 }
 
+/***********************************************
+ *  RPC Function to write a manual K/B to the DO sensor
+ *  The calibration engine does the write and the read-back in the Modbus task,
+ *  and refuses while a calibration is running
+ *************************************************/
 void RPChandler_setCalValues(struct jsonrpc_request *r)
 {
     char buff[30];
@@ -90,24 +109,43 @@ void RPChandler_setCalValues(struct jsonrpc_request *r)
     debugPrintln(buff);
 
     double k = -1;
-    double b = -1;
-    if (mjson_get_number(r->params, r->params_len, "$.k", &k) != -1)
+    double b = 0;
+    if (mjson_get_number(r->params, r->params_len, "$.k", &k) == -1 || k <= 0)
     {
-        g_do_sensor.cal_k = k;
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"k must be positive.\"}");
+        return;
     }
-    if (mjson_get_number(r->params, r->params_len, "$.b", &b) != -1)
+    mjson_get_number(r->params, r->params_len, "$.b", &b);
+
+    if (!cal_engine_write(&g_calEngine, k, b))
     {
-        g_do_sensor.cal_b = b;
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"calibration in progress.\"}");
+        return;
     }
-    if (do_sensor_set_calibration(&g_do_sensor))
+    app_events_signal(APP_EV_SENSOR_BUS);
+
+    /*Wait for the write and read-back, the outcome also lands in getCalStatus*/
+    cal_progress_t cal;
+    uint32_t start = millis();
+    do
+    {
+        vTaskDelay(pdMS_TO_TICKS(RPC_SENSOR_POLL_MS));
+        cal_engine_get_progress(&g_calEngine, &cal, millis());
+    } while ((cal.state == CAL_STATE_WRITING || cal.state == CAL_STATE_VERIFYING) &&
+             millis() - start < RPC_SENSOR_WAIT_MS);
+
+    if (cal.state == CAL_STATE_DONE)
     {
         jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\"}");
     }
+    else if (cal.state == CAL_STATE_FAILED)
+    {
+        jsonrpc_return_success(r, RPC_SENSOR_COMM_ERROR);
+    }
     else
     {
-        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"Not Set due to communicaton error.\"}");
+        jsonrpc_return_success(r, RPC_SENSOR_ACCEPTED);
     }
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 /***********************************************
@@ -127,15 +165,7 @@ void RPChandler_setSalinity(struct jsonrpc_request *r)
         // Salinity will be set in the function call
     }
 
-    if (do_sensor_set_salinity(&g_do_sensor, val))
-    {
-        jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\"}");
-    }
-    else
-    {
-        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"Not Set due to communicaton error.\"}");
-    }
-    setSharedFlag(g_appState.sendFrame, true);
+    replySensorWrite(r, sensorBusCall(SENSOR_BUS_OP_SET_SALINITY, val, NULL, NULL));
 }
 
 void RPChandler_setOperationMode(struct jsonrpc_request *r)
@@ -154,12 +184,10 @@ void RPChandler_setOperationMode(struct jsonrpc_request *r)
             xSemaphoreGive(xSharedVarMutex);
         }
         jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
     }
     else
     {
         jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"Not Set due to communicaton error.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
     }
 }
 
@@ -177,7 +205,425 @@ void RPChandler_setInterval(struct jsonrpc_request *r)
         }
     }
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\"}");
-    setSharedFlag(g_appState.sendFrame, true);
+}
+
+/****************************************************************************************
+ * Function to choose how data frames are uploaded
+ * "transport": "socket" sends over the Socket.IO link when connected, HTTP otherwise
+ *   and whenever the socket does not confirm a frame
+ * "transport": "http" always posts over HTTP (default)
+ ***************************************************************************************/
+void RPChandler_setFrameTransport(struct jsonrpc_request *r)
+{
+    char transport[8] = {0};
+    uint8_t mode;
+    mjson_get_string(r->params, r->params_len, "$.transport", transport, sizeof(transport));
+    if (strcmp(transport, "socket") == 0)
+        mode = FRAME_TRANSPORT_SOCKET;
+    else if (strcmp(transport, "http") == 0)
+        mode = FRAME_TRANSPORT_HTTP;
+    else
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"transport must be socket or http.\"}");
+        return;
+    }
+    g_config.frameTransport = mode;
+    m_oMemory.putUChar("frameTransport", mode);
+    jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\",\"transport\":%Q}", transport);
+}
+
+/****************************************************************************************
+ * Function to set the Modbus slave ID of the second probe on the RS-485 bus
+ * "slaveId": 0 removes the probe. Applied on next boot, the bus is owned by the Modbus task
+ ***************************************************************************************/
+void RPChandler_setAuxProbe(struct jsonrpc_request *r)
+{
+    double slaveId = 0;
+    if (mjson_get_number(r->params, r->params_len, "$.slaveId", &slaveId) &&
+        slaveId >= 0 && slaveId <= 247 && (uint8_t)slaveId != PRIMARY_PROBE_SLAVE_ID)
+    {
+        m_oMemory.putUChar("auxSlave", (uint8_t)slaveId);
+        jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success, reboot to apply.\"}");
+    }
+    else
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"invalid slaveId.\"}");
+    }
+}
+
+/****************************************************************************************
+ * Function to set the countdown trace capture rate and length
+ * "rateMs": 100-5000, "length": 0-120 samples (0 disables the trace)
+ ***************************************************************************************/
+void RPChandler_setTraceConfig(struct jsonrpc_request *r)
+{
+    double rateMs = g_sampleTrace.rate_ms;
+    double length = g_sampleTrace.length;
+    mjson_get_number(r->params, r->params_len, "$.rateMs", &rateMs);
+    mjson_get_number(r->params, r->params_len, "$.length", &length);
+
+    /* Range-check before the casts, 70000 would wrap into a valid uint16_t rate */
+    if (rateMs >= SAMPLE_TRACE_MIN_RATE_MS && rateMs <= SAMPLE_TRACE_MAX_RATE_MS &&
+        length >= 0 && length <= SAMPLE_TRACE_MAX_SAMPLES &&
+        sample_trace_configure(&g_sampleTrace, (uint16_t)rateMs, (uint16_t)length))
+    {
+        m_oMemory.putUShort("traceRate", g_sampleTrace.rate_ms);
+        m_oMemory.putUShort("traceLen", g_sampleTrace.length);
+        jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\",\"rateMs\":%d,\"length\":%d}",
+                               g_sampleTrace.rate_ms, g_sampleTrace.length);
+    }
+    else
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"invalid value or capture running.\"}");
+    }
+}
+
+/****************************************************************************************
+ * Function to set the extra WiFi networks tried after the device credentials
+ * "networks": [{"ssid":"..","pass":".."}, ...] up to 3 entries, [] clears them
+ ***************************************************************************************/
+void RPChandler_setWifiNetworks(struct jsonrpc_request *r)
+{
+    const char *arr;
+    int arrLen;
+    if (mjson_find(r->params, r->params_len, "$.networks", &arr, &arrLen) != MJSON_TOK_ARRAY)
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"networks must be an array.\"}");
+        return;
+    }
+
+    struct wifi_network nets[WIFI_MGR_MAX_NETWORKS - 1];
+    memset(nets, 0, sizeof(nets));
+    uint8_t n = 0;
+    for (;; n++)
+    {
+        char path[24];
+        snprintf(path, sizeof(path), "$[%u].ssid", n);
+        char ssid[WIFI_MGR_SSID_MAX + 1];
+        if (mjson_get_string(arr, arrLen, path, ssid, sizeof(ssid)) < 0) break;
+        if (n == WIFI_MGR_MAX_NETWORKS - 1 || strlen(ssid) >= WIFI_MGR_SSID_MAX)
+        {
+            jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"at most 3 networks, ssid up to 32 chars.\"}");
+            return;
+        }
+        safeStrcpy(nets[n].ssid, ssid, sizeof(nets[n].ssid));
+        snprintf(path, sizeof(path), "$[%u].pass", n);
+        mjson_get_string(arr, arrLen, path, nets[n].pass, sizeof(nets[n].pass));
+    }
+
+    if (wifi_manager_set_networks(&g_wifiMgr, nets, n))
+        jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\",\"count\":%d}", n);
+    else
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"invalid network.\"}");
+}
+
+/****************************************************************************************
+ * Function to report the WiFi manager state and reconnect time distribution
+ * "hist": outages that ended online within <1 s, <2 s, <4 s ... <64 s, longer
+ ***************************************************************************************/
+void RPChandler_getWifiStats(struct jsonrpc_request *r)
+{
+    const struct wifi_manager_stats &st = g_wifiMgr.stats;
+
+    StaticJsonDocument<768> doc;
+    doc["statusCode"] = 200;
+    doc["state"] = wifi_manager_state_name(g_wifiMgr.state);
+    doc["ssid"] = WiFi.SSID();
+    doc["bssid"] = WiFi.BSSIDstr();
+    doc["rssi"] = WiFi.RSSI();
+    doc["networks"] = g_wifiMgr.count;
+    doc["outages"] = st.outages;
+    doc["direct"] = st.direct;
+    doc["scanned"] = st.scanned;
+    doc["roams"] = st.roams;
+    doc["scans"] = st.scans;
+    doc["failures"] = st.failures;
+    doc["lastMs"] = st.last_ms;
+    doc["maxMs"] = st.max_ms;
+    JsonArray hist = doc.createNestedArray("hist");
+    for (uint8_t i = 0; i < WIFI_MGR_HIST_BUCKETS; i++)
+    {
+        hist.add(st.hist[i]);
+    }
+
+    char result[768];
+    serializeJson(doc, result, sizeof(result));
+    jsonrpc_return_success(r, "%s", result);
+}
+
+/****************************************************************************************
+ * Function to report the power state, time per state and the modelled battery draw
+ * "fullChargeHours": runtime of a full PWR_BATTERY_MAH pack at the average draw so far
+ ***************************************************************************************/
+void RPChandler_getPower(struct jsonrpc_request *r)
+{
+    const struct power_stats &st = g_power.stats;
+    uint64_t total_ms = st.ms[PWR_ACTIVE] + st.ms[PWR_WALKING] + st.ms[PWR_IDLE];
+    float avgMa = total_ms ? (float)st.charge_mams / (float)total_ms : 0.0f;
+
+    StaticJsonDocument<384> doc;
+    doc["statusCode"] = 200;
+    doc["state"] = power_manager_state_name(g_power.state);
+    doc["lightSleep"] = g_power.light_sleep;
+    doc["activeS"] = (uint32_t)(st.ms[PWR_ACTIVE] / 1000);
+    doc["walkingS"] = (uint32_t)(st.ms[PWR_WALKING] / 1000);
+    doc["idleS"] = (uint32_t)(st.ms[PWR_IDLE] / 1000);
+    doc["transitions"] = st.transitions;
+    doc["mAh"] = (uint32_t)(st.charge_mams / 3600000);
+    doc["avgMa"] = (uint32_t)(avgMa + 0.5f);
+    doc["fullChargeHours"] = (avgMa > 0) ? (uint32_t)(PWR_BATTERY_MAH / avgMa) : 0;
+
+    char result[384];
+    serializeJson(doc, result, sizeof(result));
+    jsonrpc_return_success(r, "%s", result);
+}
+
+/****************************************************************************************
+ * Function to report latency histograms, counters, heap and task stack watermarks
+ * Probe "hist" buckets end at 64 us x 4^n (see perf_metrics.h), percentiles are
+ * bucket upper bounds in us
+ ***************************************************************************************/
+void RPChandler_getMetrics(struct jsonrpc_request *r)
+{
+    DynamicJsonDocument doc(RPC_METRICS_DOC);
+    doc["statusCode"] = 200;
+    doc["uptime"] = millis() / 1000;
+
+    JsonObject heap = doc.createNestedObject("heap");
+    heap["free"] = ESP.getFreeHeap();
+    heap["min"] = ESP.getMinFreeHeap();
+    heap["largest"] = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    JsonObject tasks = doc.createNestedObject("stackFree");
+    const char *taskName;
+    uint32_t stackFree;
+    for (uint8_t i = 0; perf_metrics_task(i, &taskName, &stackFree); i++)
+    {
+        tasks[taskName] = stackFree;
+    }
+
+    JsonObject probes = doc.createNestedObject("probes");
+    for (uint8_t p = 0; p < PERF_PROBE_COUNT; p++)
+    {
+        struct perf_hist h;
+        perf_metrics_get(p, &h);
+        JsonObject item = probes.createNestedObject(perf_metrics_probe_name(p));
+        item["n"] = h.count;
+        item["avgUs"] = h.count ? (uint32_t)(h.total_us / h.count) : 0;
+        item["maxUs"] = h.max_us;
+        item["p50"] = perf_metrics_percentile(&h, 50);
+        item["p90"] = perf_metrics_percentile(&h, 90);
+        item["p99"] = perf_metrics_percentile(&h, 99);
+        JsonArray hist = item.createNestedArray("hist");
+        for (uint8_t b = 0; b < PERF_HIST_BUCKETS; b++)
+        {
+            hist.add(h.buckets[b]);
+        }
+    }
+
+    /* Retries and timeouts counted by the modules themselves */
+    JsonObject counters = doc.createNestedObject("counters");
+    for (uint8_t c = 0; c < PERF_COUNTER_COUNT; c++)
+    {
+        counters[perf_metrics_counter_name(c)] = perf_metrics_counter(c);
+    }
+    counters["uplinkAcked"] = g_frameUplink.acked;
+    counters["uplinkFailed"] = g_frameUplink.failed;
+    counters["uplinkTimeouts"] = g_frameUplink.timeouts;
+    counters["rpcSent"] = g_rpcReplies.sent;
+    counters["rpcDropped"] = g_rpcReplies.dropped;
+    counters["rpcOversized"] = g_rpcReplies.oversized;
+    counters["rpcLarge"] = g_rpcReplies.large_used;
+    counters["wifiOutages"] = g_wifiMgr.stats.outages;
+    counters["wifiFailures"] = g_wifiMgr.stats.failures;
+    counters["wifiLastMs"] = g_wifiMgr.stats.last_ms;
+    JsonArray modbus = counters.createNestedArray("modbus");
+    for (uint8_t i = 0; i < g_sensor_bus.num_slots; i++)
+    {
+        JsonObject slot = modbus.createNestedObject();
+        slot["id"] = g_sensor_bus.slots[i].slave_id;
+        slot["polls"] = g_sensor_bus.slots[i].polls;
+        slot["failures"] = g_sensor_bus.slots[i].failures;
+    }
+
+    /* A cut document or reply would not parse on the server */
+    if (doc.overflowed() || measureJson(doc) >= RPC_METRICS_BUFFER)
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":500,\"statusMsg\":\"metrics too large.\"}");
+        return;
+    }
+    char *result = (char *)malloc(RPC_METRICS_BUFFER);
+    if (!result)
+    {
+        jsonrpc_return_success(r, RPC_OUT_OF_MEMORY);
+        return;
+    }
+    serializeJson(doc, result, RPC_METRICS_BUFFER);
+    jsonrpc_return_success(r, "%s", result);
+    free(result);
+}
+
+/****************************************************************************************
+ * Function to add a metrics summary to the ping query string
+ * "enable": 1 appends up/heap/stack/p90 to GET /ping, 0 sends the bare ping
+ ***************************************************************************************/
+void RPChandler_setPingMetrics(struct jsonrpc_request *r)
+{
+    double enable = -1;
+    if (mjson_get_number(r->params, r->params_len, "$.enable", &enable) && (enable == 0 || enable == 1))
+    {
+        g_config.pingMetrics = (uint8_t)enable;
+        m_oMemory.putUChar("pingMetrics", g_config.pingMetrics);
+        jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\",\"enable\":%d}", g_config.pingMetrics);
+    }
+    else
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"enable must be 0 or 1.\"}");
+    }
+}
+
+/****************************************************************************************
+ * Function to select the GPS protocol, {"protocol":"nmea"|"ubx"}
+ * "ubx" needs a u-blox receiver; the receiver is configured at the next boot
+ ***************************************************************************************/
+void RPChandler_setGpsProtocol(struct jsonrpc_request *r)
+{
+    char protocol[8] = "";
+    mjson_get_string(r->params, r->params_len, "$.protocol", protocol, sizeof(protocol));
+
+    uint8_t value;
+    if (strcmp(protocol, "nmea") == 0)
+        value = GPS_PROTOCOL_NMEA;
+    else if (strcmp(protocol, "ubx") == 0)
+        value = GPS_PROTOCOL_UBX;
+    else
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"protocol must be nmea or ubx.\"}");
+        return;
+    }
+    g_config.gpsProtocol = value;
+    m_oMemory.putUChar("gpsProto", value);
+    jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success, applies after reboot.\",\"protocol\":\"%s\"}", protocol);
+}
+
+/****************************************************************************************
+ * Function to start or stop the field trace recorder, {"enable":0|1} and/or {"erase":1}
+ * The App task applies "enable" on its next tick; "erase" deletes /trace_N.bin once
+ * a recording has stopped. The segments are fetched with getFileChunk
+ ***************************************************************************************/
+void RPChandler_setFieldTrace(struct jsonrpc_request *r)
+{
+    double enable = -1;
+    double erase = 0;
+    bool hasEnable = mjson_get_number(r->params, r->params_len, "$.enable", &enable);
+    mjson_get_number(r->params, r->params_len, "$.erase", &erase);
+    if ((hasEnable && enable != 0 && enable != 1) || (!hasEnable && erase != 1))
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"enable must be 0 or 1.\"}");
+        return;
+    }
+    if (hasEnable)
+    {
+        g_config.fieldTrace = (uint8_t)enable;
+        m_oMemory.putUChar("fieldTrace", g_config.fieldTrace);
+    }
+    if (erase == 1 && (g_config.fieldTrace || !field_trace_erase()))
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"stop the recording first.\"}");
+        return;
+    }
+
+    struct field_trace_stats st;
+    field_trace_get_stats(&st);
+    jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\",\"enable\":%d,\"recording\":%d,"
+                              "\"segment\":%d,\"records\":%d,\"dropped\":%d,\"blocks\":%d,\"errors\":%d}",
+                           g_config.fieldTrace, st.enabled, st.segment, (int)st.records,
+                           (int)st.dropped, (int)st.blocks, (int)st.errors);
+}
+
+/****************************************************************************************
+ * Function to drive the air-saturation calibration remotely
+ * "action": "start" | "finish" (only once the reading is stable) | "abort"
+ * The Modbus task does the work, poll getCalStatus for the outcome
+ ***************************************************************************************/
+void RPChandler_calibrate(struct jsonrpc_request *r)
+{
+    char action[10] = "";
+    mjson_get_string(r->params, r->params_len, "$.action", action, sizeof(action));
+
+    uint8_t ok = 0;
+    if (strcmp(action, "start") == 0)
+    {
+        ok = cal_engine_start(&g_calEngine);
+    }
+    else if (strcmp(action, "finish") == 0)
+    {
+        ok = cal_engine_finish(&g_calEngine);
+    }
+    else if (strcmp(action, "abort") == 0)
+    {
+        cal_engine_abort(&g_calEngine);
+        ok = 1;
+    }
+
+    if (ok)
+    {
+        /*The Modbus task picks the request up on its next step*/
+        app_events_signal(APP_EV_SENSOR_BUS);
+        jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\"}");
+    }
+    else
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"invalid action or not allowed in current state.\"}");
+    }
+}
+
+/****************************************************************************************
+ * Function to report the calibration progress and the stored calibration history
+ ***************************************************************************************/
+void RPChandler_getCalStatus(struct jsonrpc_request *r)
+{
+    cal_progress_t cal;
+    cal_engine_get_progress(&g_calEngine, &cal, millis());
+
+    cal_history_t history = {};
+    if (m_oMemory.getBytes("calHist", &history, sizeof(history)) != sizeof(history))
+    {
+        history.count = 0;
+    }
+
+    StaticJsonDocument<1024> doc;
+    doc["statusCode"] = 200;
+    doc["state"] = cal_engine_state_name(cal.state);
+    doc["error"] = cal.error;
+    doc["elapsed"] = cal.elapsed_s;
+    doc["samples"] = cal.samples;
+    doc["mean"] = roundf(cal.mean_pct * 100) / 100;
+    doc["spread"] = roundf(cal.spread_pct * 100) / 100;
+    doc["converged"] = (bool)cal.converged;
+    doc["k"] = cal.k;
+    doc["b"] = cal.b;
+
+    /* Newest record first */
+    JsonArray hist = doc.createNestedArray("history");
+    for (uint8_t i = 0; i < history.count && i < CAL_HISTORY_MAX; i++)
+    {
+        const cal_record_t &rec = history.records[(history.next + CAL_HISTORY_MAX - 1 - i) % CAL_HISTORY_MAX];
+        JsonObject item = hist.createNestedObject();
+        item["epoch"] = rec.epoch;
+        item["ok"] = (bool)rec.ok;
+        item["error"] = rec.error;
+        item["k"] = rec.k;
+        item["b"] = rec.b;
+        item["mean"] = roundf(rec.mean_pct * 100) / 100;
+        item["temp"] = roundf(rec.temp * 100) / 100;
+        item["duration"] = rec.duration_s;
+        item["samples"] = rec.samples;
+    }
+
+    char result[1024];
+    serializeJson(doc, result, sizeof(result));
+    jsonrpc_return_success(r, "%s", result);
 }
 
 void RPChandler_getSalinity(struct jsonrpc_request *r)
@@ -187,11 +633,14 @@ void RPChandler_getSalinity(struct jsonrpc_request *r)
     debugPrintln("@@ Inside getSalinity...");
     debugPrintln(buff);
 
-    do_sensor_get_salinity(&g_do_sensor);
-    float salinity = g_do_sensor.salinity;
+    float salinity = 0;
+    if (sensorBusCall(SENSOR_BUS_OP_GET_SALINITY, 0, &salinity, NULL) != SENSOR_BUS_RES_OK)
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"sensor not responding.\"}");
+        return;
+    }
 
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\",\"salinity\":\"%s.\"}", String(salinity));
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 void RPChandler_getPressure(struct jsonrpc_request *r)
@@ -201,12 +650,15 @@ void RPChandler_getPressure(struct jsonrpc_request *r)
     debugPrintln("@@ Inside getPressure...");
     debugPrintln(buff);
 
-    do_sensor_get_pressure(&g_do_sensor);
-    float pressure = g_do_sensor.pressure;
+    float pressure = 0;
+    if (sensorBusCall(SENSOR_BUS_OP_GET_PRESSURE, 0, &pressure, NULL) != SENSOR_BUS_RES_OK)
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"sensor not responding.\"}");
+        return;
+    }
 
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\",\"pressure\":\"%s.\"}", String(pressure));
 
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 /***********************************************
@@ -226,15 +678,7 @@ void RPChandler_setPressure(struct jsonrpc_request *r)
         // Pressure will be set in the function call
     }
 
-    if (do_sensor_set_pressure(&g_do_sensor, val))
-    {
-        jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\"}");
-    }
-    else
-    {
-        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"Not Set due to communicaton error.\"}");
-    }
-    setSharedFlag(g_appState.sendFrame, true);
+    replySensorWrite(r, sensorBusCall(SENSOR_BUS_OP_SET_PRESSURE, val, NULL, NULL));
 }
 
 /***********************************************
@@ -246,15 +690,19 @@ void RPChandler_getCalValues(struct jsonrpc_request *r)
     StaticJsonDocument<100> doc;
     debugPrintln("@@ Inside getCalValues...");
 
-    do_sensor_get_calibration(&g_do_sensor);
-    doc["k"] = g_do_sensor.cal_k;
-    doc["b"] = g_do_sensor.cal_b;
+    float k = 0, b = 0;
+    if (sensorBusCall(SENSOR_BUS_OP_GET_CALIBRATION, 0, &k, &b) != SENSOR_BUS_RES_OK)
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"sensor not responding.\"}");
+        return;
+    }
+    doc["k"] = k;
+    doc["b"] = b;
 
     char result[100];
     serializeJson(doc, result);
     debugPrintln(result);
     jsonrpc_return_success(r, "%s", result);
-    setSharedFlag(g_appState.sendFrame, true);
 }
 /*****************************************************************
  *  RPC Function to set device in safe mode
@@ -267,7 +715,6 @@ void RPChandler_runSafeMode(struct jsonrpc_request *r)
     debugPrintln("@@ Inside runSafeMode.....");
     g_deviceConfig.m_bIsSafeModeOn = true;
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\"}");
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 /**************************************************************
@@ -289,24 +736,29 @@ void RPChandler_whoAreYou(struct jsonrpc_request *r)
     doc["FramesInBackup"] = m_oDisp.DisplayGeneralVariables.backUpFramesCnt;
     doc["Wifissid"] = WiFi.SSID();
     doc["rssi"] = WiFi.RSSI();
-    doc["lat"] = m_oGps.mPosition.m_lat;
-    doc["long"] = m_oGps.mPosition.m_lng;
-    doc["HDop"] = m_oGps.mPosition.hDop;
-    doc["Satellite"] = m_oGps.mPosition.m_iSatellites;
-    doc["CurrentPondName"] = g_currentPond.CurrentPondName;
-    doc["DoMg/l"] = g_sensorData.doMglValue;
-    doc["Temp"] = g_sensorData.tempVal;
-    doc["Saturation"] = g_sensorData.doSaturationVal;
-    doc["Salinity"] = g_currentPond.CurrentPondSalinity;
+    const GpsFix fix = m_oGps.m_oFix.read();
+    const SensorData sensor = g_sensorData.read();
+    const CurrentPondInfo pond = g_pondSnapshot.read();
+    doc["lat"] = fix.lat;
+    doc["long"] = fix.lng;
+    doc["HDop"] = fix.hDop;
+    doc["Satellite"] = fix.satellites;
+    doc["posRadius"] = fix.radiusM;
+    doc["CurrentPondName"] = pond.CurrentPondName;
+    doc["pondConfidence"] = pond.PondConfidence;
+    doc["DoMg/l"] = sensor.doMglValue;
+    doc["Temp"] = sensor.tempVal;
+    doc["Saturation"] = sensor.doSaturationVal;
+    doc["Salinity"] = pond.CurrentPondSalinity;
     doc["localOffsetTimeMin"] = g_config.totalMinsOffSet;
     doc["operationMode"] = g_config.operationMode;
+    doc["frameTransport"] = (g_config.frameTransport == FRAME_TRANSPORT_SOCKET) ? "socket" : "http";
     doc["progress"] = g_http_dev.curr_progress;
 
     char result[700];
-    serializeJson(doc, result);
+    serializeJson(doc, result, sizeof(result));
     debugPrintln(result);
     jsonrpc_return_success(r, "%s", result);
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 /**************************************************************
@@ -320,7 +772,6 @@ void RPChandler_syncRTC(struct jsonrpc_request *r)
         xSemaphoreGive(xSharedVarMutex);
     }
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\"}");
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 
@@ -336,7 +787,6 @@ void RPChandler_ResetPondStatus(struct jsonrpc_request *r)
         xSemaphoreGive(xSharedVarMutex);
     }
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\"}");
-    setSharedFlag(g_appState.sendFrame, true);
 }
 /******************************************************************************
  * Set Pond Map reset time to clear the frame saved status on the UI
@@ -371,7 +821,6 @@ void RPChandler_SetPondMapResetTime(struct jsonrpc_request *r)
     Serial.println("[RPC][SetPondMapReset]: saving to NVS done");
 
     jsonrpc_return_success(r, "{\"MorningTime\":\"%d\",\"Evening Time\":\"%d\",\"statusCode\":200,\"statusMsg\":\"Success.\"}", g_config.morningPondMapResetTime, g_config.eveningPondMapResetTime);
-    setSharedFlag(g_appState.sendFrame, true);
 }
 /**********************************************************
 * RPC Function to operate Slot
@@ -406,13 +855,11 @@ void RPChandler_setLocalTimeOffset(struct jsonrpc_request *r)
         m_oMemory.putInt("LocalMins", g_config.totalMinsOffSet);
 
         jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\", \"localTimeMin\":%d}", g_config.totalMinsOffSet);
-        setSharedFlag(g_appState.sendFrame, true);
     }
     else
     {
         debugPrintln("Invalid version...");
         jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"Invalid Version.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
     }
 }
 
@@ -430,52 +877,45 @@ void RPChandler_updateConfig(struct jsonrpc_request *r)
         g_appState.getConfig = true;
         xSemaphoreGive(xSharedVarMutex);
     }
+    app_events_signal(APP_EV_CONFIG_CHANGED);
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\"}");
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 /**********************************************************
  * RPC Function to get configIDS file from stater
- * r-> pointer holds the config data buffer
- * @param [in] None
- * @param [out] configIDs file from filesystem on succerss
+ * The pond lines come a page at a time, streamed from the file
+ * into the reply; "next" is -1 on the last page
+ * @param [in] Data: {"cursor": 0, "limit": 40}, both optional
+ * @param [out] {"config":[..],"version":N,"tenantId":"..","offset":330,"total":255,"next":40,"statusCode":200}
  ***********************************************************/
 void RPChandler_getConfigIDs(struct jsonrpc_request *r)
 {
     debugPrintln("@@ Inside getConfigIds.....");
-    int FileSize = m_oFileSystem.getFileSize(FILENAME_IDSCONFIG);
-    
-    // Validate file size
-    if (FileSize <= 0 || FileSize > 8192) // Max 8KB for config file
+    if (m_oFileSystem.getFileSize(FILENAME_IDSCONFIG) <= 0)
     {
-        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"Invalid file size.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"file Not available.\"}");
         return;
     }
-    
-    // Allocate buffer dynamically with size validation
-    char *rdata = (char *)malloc(FileSize + 1);
-    if (!rdata)
+
+    double cursor = 0;
+    double limit = CONFIG_PAGE_MAX;
+    mjson_get_number(r->params, r->params_len, "$.cursor", &cursor);
+    mjson_get_number(r->params, r->params_len, "$.limit", &limit);
+    if (cursor < 0 || cursor > UINT16_MAX || limit <= 0)
     {
-        jsonrpc_return_success(r, "{\"statusCode\":500,\"statusMsg\":\"Memory allocation failed.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"invalid cursor or limit.\"}");
         return;
     }
-    
-    int ret = m_oFileSystem.readFile(FILENAME_IDSCONFIG, rdata);
-    if (ret)
-    {
-        rdata[FileSize] = '\0'; // Ensure null termination
-        jsonrpc_return_success(r, "%s", (const char *)rdata);
-        setSharedFlag(g_appState.sendFrame, true);
-    }
-    else
+
+    struct config_page *page = (struct config_page *)malloc(sizeof(struct config_page));
+    if (!page)
     {
-        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"file Not available.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
+        jsonrpc_return_success(r, RPC_OUT_OF_MEMORY);
+        return;
     }
-    
-    free(rdata);
+    config_page_init(page, FILENAME_IDSCONFIG, (uint16_t)cursor, limit > CONFIG_PAGE_MAX ? CONFIG_PAGE_MAX : (uint16_t)limit);
+    jsonrpc_return_success(r, "%M", config_page_print, page);
+    free(page);
 }
 
 /**************************************************************
@@ -486,7 +926,6 @@ void RPChandler_ClearBackupFiles(struct jsonrpc_request *r)
 {
     m_oBackupStore.clearAllFiles(&m_oFileSystem);
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\"}");
-    setSharedFlag(g_appState.sendFrame, true);
 }
 /**************************************************************
  *   RPC Function to get list of files in filesystem with sizes
@@ -502,7 +941,6 @@ void RPChandler_getFileList(struct jsonrpc_request *r)
     if (!root || !root.isDirectory())
     {
         jsonrpc_return_success(r, "{\"statusCode\":500,\"statusMsg\":\"Failed to open filesystem root.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
         return;
     }
 
@@ -522,12 +960,27 @@ void RPChandler_getFileList(struct jsonrpc_request *r)
     serializeJson(doc, response, sizeof(response));
 
     jsonrpc_return_success(r, "%s", response);
-    setSharedFlag(g_appState.sendFrame, true);
+}
+
+/**************************************************************
+ *   Function to turn an RPC filename into a SPIFFS path ("BAK_0.txt" -> "/BAK_0.txt")
+ ***************************************************************/
+static void toSpiffsPath(const char *filename, char *filepath, int sizeofPath)
+{
+    if (filename[0] == '/')
+    {
+        safeStrcpy(filepath, filename, sizeofPath);
+    }
+    else
+    {
+        snprintf(filepath, sizeofPath, "/%s", filename);
+    }
 }
 
 /**************************************************************
  *   RPC Function to get file contents by filename
- *   r-> pointer holds the config data buffer
+ *   Only for small files, the reply has to fit one RPC reply slot;
+ *   larger files are pulled with getFileChunk
  * @param [in] Data: {"filename": "BAK_0.txt"}
  * @param [out] File contents or error message
  ***************************************************************/
@@ -539,75 +992,160 @@ void RPChandler_getFileContent(struct jsonrpc_request *r)
     if (mjson_get_string(r->params, r->params_len, "$.filename", filename, sizeof(filename)) == -1)
     {
         jsonrpc_return_success(r, "{\"statusCode\":400,\"statusMsg\":\"Missing filename parameter.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
         return;
     }
 
-    // Ensure filename starts with '/'
     char filepath[70];
-    if (filename[0] == '/')
-    {
-        safeStrcpy(filepath, filename, sizeof(filepath));
-    }
-    else
-    {
-        snprintf(filepath, sizeof(filepath), "/%s", filename);
-    }
+    toSpiffsPath(filename, filepath, sizeof(filepath));
 
     File file = SPIFFS.open(filepath, "r");
     if (!file)
     {
         jsonrpc_return_success(r, "{\"statusCode\":404,\"statusMsg\":\"File not found.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
         return;
     }
 
     size_t fileSize = file.size();
-    if (fileSize == 0)
+    if (fileSize > RPC_FILE_CONTENT_MAX)
     {
         file.close();
-        jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\",\"content\":\"\"}");
-        setSharedFlag(g_appState.sendFrame, true);
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"File too large, use getFileChunk.\",\"size\":%d}", (int)fileSize);
+        return;
+    }
+
+    char content[RPC_FILE_CONTENT_MAX + 1];
+    size_t bytesRead = file.readBytes(content, fileSize);
+    content[bytesRead] = '\0';
+    file.close();
+
+    jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success\",\"filename\":%Q,\"size\":%d,\"content\":%Q}",
+                           filename, (int)bytesRead, content);
+}
+
+/**************************************************************
+ *   RPC Function to read one chunk of a file, base64 encoded
+ *   Memory use is one chunk whatever the file size; the caller walks
+ *   "offset" until "eof" and checks each chunk against "crc" (CRC-32)
+ * @param [in] Data: {"filename": "BAK_0.txt", "offset": 0, "length": 768}
+ * @param [out] {"statusCode":200,"offset":0,"length":768,"size":4096,"eof":false,"crc":"1c291ca3","data":".."}
+ ***************************************************************/
+void RPChandler_getFileChunk(struct jsonrpc_request *r)
+{
+    char filename[64];
+    double offset = 0;
+    double length = RPC_FILE_CHUNK_MAX;
+    if (mjson_get_string(r->params, r->params_len, "$.filename", filename, sizeof(filename)) == -1)
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":400,\"statusMsg\":\"Missing filename parameter.\"}");
+        return;
+    }
+    mjson_get_number(r->params, r->params_len, "$.offset", &offset);
+    mjson_get_number(r->params, r->params_len, "$.length", &length);
+    if (offset < 0 || length <= 0)
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"invalid offset or length.\"}");
         return;
     }
+    if (length > RPC_FILE_CHUNK_MAX)
+        length = RPC_FILE_CHUNK_MAX;
+
+    char filepath[70];
+    toSpiffsPath(filename, filepath, sizeof(filepath));
 
-    // Allocate buffer for file content
-    char *content = (char *)malloc(fileSize + 1);
-    if (!content)
+    File file = SPIFFS.open(filepath, "r");
+    if (!file)
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":404,\"statusMsg\":\"File not found.\"}");
+        return;
+    }
+
+    size_t fileSize = file.size();
+    if ((size_t)offset > fileSize || !file.seek((size_t)offset))
     {
         file.close();
-        jsonrpc_return_success(r, "{\"statusCode\":500,\"statusMsg\":\"Memory allocation failed.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"offset past end of file.\",\"size\":%d}", (int)fileSize);
         return;
     }
 
-    size_t bytesRead = file.readBytes(content, fileSize);
-    content[bytesRead] = '\0';
+    uint8_t chunk[RPC_FILE_CHUNK_MAX];
+    size_t bytesRead = file.read(chunk, (size_t)length);
     file.close();
 
-    // Create response with content
-    DynamicJsonDocument doc(fileSize + 256);
-    doc["statusCode"] = 200;
-    doc["statusMsg"] = "Success";
-    doc["filename"] = filename;
-    doc["size"] = bytesRead;
-    doc["content"] = content;
+    char crc[9];
+    snprintf(crc, sizeof(crc), "%08lx", (unsigned long)crc32_le(0, chunk, bytesRead));
+    bool eof = ((size_t)offset + bytesRead) >= fileSize;
+
+    // %V streams the base64 straight into the reply, no encode buffer needed
+    jsonrpc_return_success(r, "{\"statusCode\":200,\"offset\":%d,\"length\":%d,\"size\":%d,\"eof\":%s,\"crc\":%Q,\"data\":%V}",
+                           (int)offset, (int)bytesRead, (int)fileSize, eof ? "true" : "false",
+                           crc, (int)bytesRead, (const char *)chunk);
+}
+
+/**************************************************************
+ *   RPC Function to list the files a page at a time
+ *   "cursor" is the number of entries already returned, "next" is -1 on
+ *   the last page
+ * @param [in] Data: {"cursor": 0, "limit": 16}
+ * @param [out] {"statusCode":200,"files":[{"name":"/P1.txt","size":120},..],"next":16}
+ ***************************************************************/
+void RPChandler_listFiles(struct jsonrpc_request *r)
+{
+    double cursor = 0;
+    double limit = RPC_LIST_PAGE_MAX;
+    mjson_get_number(r->params, r->params_len, "$.cursor", &cursor);
+    mjson_get_number(r->params, r->params_len, "$.limit", &limit);
+    if (cursor < 0 || limit <= 0)
+    {
+        jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"invalid cursor or limit.\"}");
+        return;
+    }
+    if (limit > RPC_LIST_PAGE_MAX)
+        limit = RPC_LIST_PAGE_MAX;
 
-    char *response = (char *)malloc(fileSize + 300);
-    if (response)
+    File root = SPIFFS.open("/");
+    if (!root || !root.isDirectory())
     {
-        serializeJson(doc, response, fileSize + 300);
-        jsonrpc_return_success(r, "%s", response);
-        free(response);
+        jsonrpc_return_success(r, "{\"statusCode\":500,\"statusMsg\":\"Failed to open filesystem root.\"}");
+        return;
     }
-    else
+
+    char files[RPC_LIST_BUFFER];
+    int used = 0;
+    int index = 0;
+    int listed = 0;
+    bool more = false;
+    files[0] = '\0';
+
+    File file = root.openNextFile();
+    while (file)
     {
-        jsonrpc_return_success(r, "{\"statusCode\":500,\"statusMsg\":\"Response allocation failed.\"}");
+        if (index >= (int)cursor)
+        {
+            if (listed >= (int)limit)
+            {
+                more = true;
+                break;
+            }
+            int n = snprintf(files + used, sizeof(files) - used, "%s{\"name\":\"%s\",\"size\":%d}",
+                             listed ? "," : "", file.name(), (int)file.size());
+            if (n < 0 || used + n >= (int)sizeof(files))
+            {
+                // entry did not fit, it starts the next page
+                files[used] = '\0';
+                more = true;
+                break;
+            }
+            used += n;
+            listed++;
+        }
+        index++;
+        file = root.openNextFile();
     }
 
-    free(content);
-    setSharedFlag(g_appState.sendFrame, true);
+    jsonrpc_return_success(r, "{\"statusCode\":200,\"files\":[%s],\"next\":%d}",
+                           files, more ? (int)cursor + listed : -1);
 }
+
 /**************************************************************
  *   RPC Function to delete a file from filesystem
  *   r-> pointer holds the config data buffer
@@ -622,7 +1160,6 @@ void RPChandler_deleteFile(struct jsonrpc_request *r)
     if (mjson_get_string(r->params, r->params_len, "$.filename", filename, sizeof(filename)) == -1)
     {
         jsonrpc_return_success(r, "{\"statusCode\":400,\"statusMsg\":\"Missing filename parameter.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
         return;
     }
 
@@ -641,12 +1178,11 @@ void RPChandler_deleteFile(struct jsonrpc_request *r)
     if (!SPIFFS.exists(filepath))
     {
         jsonrpc_return_success(r, "{\"statusCode\":404,\"statusMsg\":\"File not found.\"}");
-        setSharedFlag(g_appState.sendFrame, true);
         return;
     }
 
     // Delete the file
-    if (SPIFFS.remove(filepath))
+    if (m_oFileSystem.removeFile(filepath))
     {
         debugPrintf("File deleted: %s\n", filepath);
         jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"File deleted successfully.\"}");
@@ -657,7 +1193,6 @@ void RPChandler_deleteFile(struct jsonrpc_request *r)
         jsonrpc_return_success(r, "{\"statusCode\":500,\"statusMsg\":\"Failed to delete file.\"}");
     }
 
-    setSharedFlag(g_appState.sendFrame, true);
 }
 /**********************************************************
  * RPC Function to update firmware using elagent ota
@@ -668,21 +1203,32 @@ void RPChandler_deleteFile(struct jsonrpc_request *r)
 void RPChandler_firmwareUpdate(struct jsonrpc_request *r)
 {
     debugPrintln("@@ Inside firmwareUpdate.....");
-    char buff[200];
-    snprintf(buff, r->params_len + 1, "%S", (wchar_t *)r->params);
-    debugPrintln(buff);
+    debugPrintf("%.*s\n", r->params_len, r->params);
     static double preVersn = 0;
     static double Versn = 0;
     mjson_get_number(r->params, r->params_len, "$.version", &Versn);
     if (Versn != preVersn)
     {
+        const char *url;
+        int urlLen = 0;
+        if (mjson_find(r->params, r->params_len, "$.firmwareUrl", &url, &urlLen) == MJSON_TOK_STRING &&
+            urlLen - 2 >= OTA_ENGINE_URL_MAX)
+        {
+            // Never cut the URL: the download and its resume checkpoint would both point elsewhere
+            jsonrpc_return_success(r, "{\"statusCode\":250,\"statusMsg\":\"URL longer than %d bytes\"}", OTA_ENGINE_URL_MAX - 1);
+            return;
+        }
         preVersn = Versn;
-        char Id[250] = "";
+        char Id[OTA_ENGINE_URL_MAX] = "";
         if (mjson_get_string(r->params, r->params_len, "$.firmwareUrl", Id, sizeof(Id)) != -1)
         {
-            g_appState.doFota = true;
             g_http_dev.curr_progress = 0;
             safeStrcpy(g_http_dev.uri_firmware_fota, Id, sizeof(g_http_dev.uri_firmware_fota));
+            /*Optional image hash, checked before the new image is made bootable*/
+            if (mjson_get_string(r->params, r->params_len, "$.sha256", g_http_dev.fw_sha256, sizeof(g_http_dev.fw_sha256)) < 0)
+                g_http_dev.fw_sha256[0] = '\0';
+            g_appState.doFota = true;
+            app_events_signal(APP_EV_OTA_REQUEST);
             jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Firmware URL update success\"}");
         }
         else
@@ -694,7 +1240,6 @@ void RPChandler_firmwareUpdate(struct jsonrpc_request *r)
     {
         jsonrpc_return_success(r, "{\"statusCode\":300,\"statusMsg\":\"Invalid Version number\"}");
     }
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 /**************************************************************
@@ -711,8 +1256,8 @@ void RPChandler_refreshFrame(struct jsonrpc_request *r)
         sendFrameType = CALL_FRAME;
         xSemaphoreGive(xSharedVarMutex);
     }
+    app_events_signal(APP_EV_FRAME_REQUEST);
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Live frame sent success\"}");
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 void RPChandler_sysReboot(struct jsonrpc_request *r)
@@ -724,7 +1269,6 @@ void RPChandler_sysReboot(struct jsonrpc_request *r)
         xSemaphoreGive(xSharedVarMutex);
     }
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Live frame sent success\"}");
-    setSharedFlag(g_appState.sendFrame, true);
 }
 /**********************************************************
  * RPC Function to set Wifi Credentials
@@ -772,13 +1316,11 @@ void RPChandler_setWifiCredentials(struct jsonrpc_request *r)
             rebootAfterSetDataCmd = 100;
         }
         jsonrpc_return_success(r, "{\"wifiSsid\":\"%s\",\"wifiPass\":\"%s\",\"statusCode\":200,\"statusMsg\":\"Success.\"}", m_cWifiSsid, m_cWifiPass);
-        setSharedFlag(g_appState.sendFrame, true);
     }
     else
     {
         debugPrintln("Invalid version...");
         jsonrpc_return_success(r, "{\"wifiSsid\":\"%s\",\"wifiPass\":\"%s\",\"statusCode\":300,\"statusMsg\":\"Invalid Version.\"}", m_cWifiSsid, m_cWifiPass);
-        setSharedFlag(g_appState.sendFrame, true);
     }
 }
 
@@ -814,13 +1356,11 @@ void RPChandler_setServerCredntials(struct jsonrpc_request *r)
             rebootAfterSetDataCmd = 100;
         }
         jsonrpc_return_success(r, "{\"IP\":\"%s\",\"port\":\"%d\",\"statusCode\":200,\"statusMsg\":\"Success.\"}", g_http_dev.server_ip, g_http_dev.http_port);
-        setSharedFlag(g_appState.sendFrame, true);
     }
     else
     {
         debugPrintln("Invalid version...");
         jsonrpc_return_success(r, "{\"IP\":\"%s\",\"port\":\"%d\",\"statusCode\":300,\"statusMsg\":\"Invalid Version.\"}", g_http_dev.server_ip, g_http_dev.http_port);
-        setSharedFlag(g_appState.sendFrame, true);
     }
 }
 /**************************************************************
@@ -836,7 +1376,6 @@ void RPChandler_ClearNonBackupFiles(struct jsonrpc_request *r)
         xSemaphoreGive(xSharedVarMutex);
     }
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"success.\"}");
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 /**********************************************************
@@ -872,73 +1411,69 @@ void RPChandler_SimulatedPosts(struct jsonrpc_request *r)
     }
     Is_Simulated_Lat_Longs = true;
     jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\"}");
-    setSharedFlag(g_appState.sendFrame, true);
 }
 
 /****************************************************************************************
- * RPC Handler Lookup Table (Phase 4 Optimization)
- * Cleaner, more maintainable approach using function pointers
+ * RPC Handler Lookup Table
+ * Kept sorted by method name (strcmp order, upper case first) so dispatch can
+ * binary search it; the static_assert below rejects an out of order entry.
  ***************************************************************************************/
-struct RPCHandlerEntry {
-    const char* method;
-    void (*handler)(struct jsonrpc_request *r);
-};
-
-// Centralized RPC handler table - easy to maintain and review
-static const RPCHandlerEntry rpcHandlerTable[] = {
-    // System & Configuration
+static constexpr struct rpc_route rpcHandlerTable[] = {
     {"ActivateSafeMode", RPChandler_runSafeMode},
-    {"wifiConfig", RPChandler_setWifiCredentials},
-    {"serverConfig", RPChandler_setServerCredntials},
-    {"setLocalTimeOffset", RPChandler_setLocalTimeOffset},
-    {"syncRTC", RPChandler_syncRTC},
-    {"whoAreYou", RPChandler_whoAreYou},
-    {"getConfig", RPChandler_getConfigIDs},
-    {"setOperationMode", RPChandler_setOperationMode},
-    {"setDataFrequency", RPChandler_setInterval},
-    
-    // Sensor Operations
-    {"setCalValues", RPChandler_setCalValues},
-    {"getCalValues", RPChandler_getCalValues},
-    {"setSalinity", RPChandler_setSalinity},
-    {"getSalinity", RPChandler_getSalinity},
-    {"setPressure", RPChandler_setPressure},
-    {"getPressure", RPChandler_getPressure},
-    
-    // Data & Frame Operations
-    {"getLiveFrame", RPChandler_refreshFrame},
     {"ClearBackupFiles", RPChandler_ClearBackupFiles},
     {"ClearNonBackupFiles", RPChandler_ClearNonBackupFiles},
-    
-    // Pond Management
+    {"FOTA", RPChandler_firmwareUpdate},
     {"ResetPondStatus", RPChandler_ResetPondStatus},
     {"SetPondMapResetTime", RPChandler_SetPondMapResetTime},
     {"SimulatePosts", RPChandler_SimulatedPosts},
-    
-    // File Operations
-    {"getFileList", RPChandler_getFileList},
-    {"getFileContent", RPChandler_getFileContent},
+    {"calibrate", RPChandler_calibrate},
     {"deleteFile", RPChandler_deleteFile},
-    
-    // System Control
-    {"FOTA", RPChandler_firmwareUpdate},
+    {"getCalStatus", RPChandler_getCalStatus},
+    {"getCalValues", RPChandler_getCalValues},
+    {"getConfig", RPChandler_getConfigIDs},
+    {"getFileChunk", RPChandler_getFileChunk},
+    {"getFileContent", RPChandler_getFileContent},
+    {"getFileList", RPChandler_getFileList},
+    {"getLiveFrame", RPChandler_refreshFrame},
+    {"getMetrics", RPChandler_getMetrics},
+    {"getPower", RPChandler_getPower},
+    {"getPressure", RPChandler_getPressure},
+    {"getSalinity", RPChandler_getSalinity},
+    {"getWifiStats", RPChandler_getWifiStats},
+    {"listFiles", RPChandler_listFiles},
+    {"serverConfig", RPChandler_setServerCredntials},
+    {"setAuxProbe", RPChandler_setAuxProbe},
+    {"setCalValues", RPChandler_setCalValues},
+    {"setDataFrequency", RPChandler_setInterval},
+    {"setFieldTrace", RPChandler_setFieldTrace},
+    {"setFrameTransport", RPChandler_setFrameTransport},
+    {"setGpsProtocol", RPChandler_setGpsProtocol},
+    {"setLocalTimeOffset", RPChandler_setLocalTimeOffset},
+    {"setOperationMode", RPChandler_setOperationMode},
+    {"setPingMetrics", RPChandler_setPingMetrics},
+    {"setPressure", RPChandler_setPressure},
+    {"setSalinity", RPChandler_setSalinity},
+    {"setTraceConfig", RPChandler_setTraceConfig},
+    {"setWifiNetworks", RPChandler_setWifiNetworks},
+    {"syncRTC", RPChandler_syncRTC},
     {"sysReboot", RPChandler_sysReboot},
-    
-    // Sentinel (marks end of table)
-    {nullptr, nullptr}
+    {"updateConfig", RPChandler_updateConfig},
+    {"whoAreYou", RPChandler_whoAreYou},
+    {"wifiConfig", RPChandler_setWifiCredentials},
 };
 
+#define RPC_HANDLER_COUNT (sizeof(rpcHandlerTable) / sizeof(rpcHandlerTable[0]))
+
+static_assert(rpc_routes_sorted(rpcHandlerTable, RPC_HANDLER_COUNT), "rpcHandlerTable must stay sorted by method name");
+
 /****************************************************************************************
- * Function to initialize all RPC handlers using the lookup table
- * @param [in] None
+ * Function to dispatch one JSON-RPC request object straight from the receive buffer
+ * Only pointers into the frame are taken, nothing is copied or allocated; replies
+ * follow mjson's jsonrpc_process() format
+ * @param [in] frame request object, frame_len its length, fn/fndata reply printer
  * @param [out] None
  ***************************************************************************************/
-void initializeAllRPCHandlers(void)
+void dispatchRPC(const char *frame, int frame_len, mjson_print_fn_t fn, void *fndata)
 {
-    // Register all handlers from the table
-    for (int i = 0; rpcHandlerTable[i].method != nullptr; i++) {
-        jsonrpc_export(rpcHandlerTable[i].method, rpcHandlerTable[i].handler);
-    }
-    
-    debugPrintln("RPC Handlers initialized successfully");
+    rpc_dispatch(rpcHandlerTable, RPC_HANDLER_COUNT, frame, frame_len, fn, fndata);
 }
@@ -5,6 +5,7 @@
 #include <mjson.h>
 #include "CApplication.h"  // For struct definitions
 #include "http_ops.h"      // For http_device structure
+#include "wifi_manager.h"  // For wifi_manager structure
 
 // Forward declarations for external objects and variables
 extern class cBsp m_oBsp;
@@ -13,6 +14,13 @@ extern class FILESYSTEM m_oFileSystem;
 extern class CBackupStorage m_oBackupStore;
 extern struct http_device g_http_dev; // HTTP device with ops structure (C-style)
 extern struct do_sensor_device g_do_sensor; // DO sensor with ops structure (C-style)
+extern struct sample_trace g_sampleTrace; // Countdown DO/temp trace
+extern struct cal_engine g_calEngine; // Air-saturation calibration engine
+extern struct wifi_manager g_wifiMgr; // Station reconnects and known networks
+extern struct power_manager g_power; // Duty cycling state and energy estimate
+extern struct sensor_bus g_sensor_bus; // RS-485 bus shared by all Modbus probes
+extern struct rpc_reply_queue g_rpcReplies; // Framed replies waiting for the Socket.IO link
+extern struct frame_uplink g_frameUplink; // Data frames handed to the Socket.IO link
 extern class CGps m_oGps;
 extern class CDisplay m_oDisp;
 extern class Preferences m_oMemory;
@@ -26,8 +34,9 @@ extern AppState g_appState;
 extern AppTimers g_timers;
 extern AppConfig g_config;
 extern DeviceConfig g_deviceConfig;
-extern SensorData g_sensorData;
+extern CSnapshot<SensorData> g_sensorData;
 extern CurrentPondInfo g_currentPond;
+extern CSnapshot<CurrentPondInfo> g_pondSnapshot;
 extern SmartConfigData g_smartConfig;
 
 // Legacy variables (kept for backward compatibility during migration)
@@ -50,7 +59,6 @@ extern double SimulatedLat;
 extern double SimulatedLongs;
 extern char m_cWifiSsid[20];
 extern char m_cWifiPass[20];
-extern char sendResult[4000];
 
 // External display variables
 extern char CurrntPondName[20];
@@ -75,6 +83,18 @@ void RPChandler_setCalValues(struct jsonrpc_request *r);
 void RPChandler_setSalinity(struct jsonrpc_request *r);
 void RPChandler_setOperationMode(struct jsonrpc_request *r);
 void RPChandler_setInterval(struct jsonrpc_request *r);
+void RPChandler_setFrameTransport(struct jsonrpc_request *r);
+void RPChandler_setAuxProbe(struct jsonrpc_request *r);
+void RPChandler_setTraceConfig(struct jsonrpc_request *r);
+void RPChandler_setWifiNetworks(struct jsonrpc_request *r);
+void RPChandler_getWifiStats(struct jsonrpc_request *r);
+void RPChandler_getMetrics(struct jsonrpc_request *r);
+void RPChandler_getPower(struct jsonrpc_request *r);
+void RPChandler_setPingMetrics(struct jsonrpc_request *r);
+void RPChandler_setGpsProtocol(struct jsonrpc_request *r);
+void RPChandler_setFieldTrace(struct jsonrpc_request *r);
+void RPChandler_calibrate(struct jsonrpc_request *r);
+void RPChandler_getCalStatus(struct jsonrpc_request *r);
 void RPChandler_getSalinity(struct jsonrpc_request *r);
 void RPChandler_getPressure(struct jsonrpc_request *r);
 void RPChandler_setPressure(struct jsonrpc_request *r);
@@ -90,6 +110,8 @@ void RPChandler_getConfigIDs(struct jsonrpc_request *r);
 void RPChandler_ClearBackupFiles(struct jsonrpc_request *r);
 void RPChandler_getFileList(struct jsonrpc_request *r);
 void RPChandler_getFileContent(struct jsonrpc_request *r);
+void RPChandler_getFileChunk(struct jsonrpc_request *r);
+void RPChandler_listFiles(struct jsonrpc_request *r);
 void RPChandler_deleteFile(struct jsonrpc_request *r);
 void RPChandler_firmwareUpdate(struct jsonrpc_request *r);
 void RPChandler_refreshFrame(struct jsonrpc_request *r);
@@ -99,7 +121,7 @@ void RPChandler_setServerCredntials(struct jsonrpc_request *r);
 void RPChandler_ClearNonBackupFiles(struct jsonrpc_request *r);
 void RPChandler_SimulatedPosts(struct jsonrpc_request *r);
 
-// RPC initialization function
-void initializeAllRPCHandlers(void);
+// RPC dispatch, looks the method up in the sorted handler table
+void dispatchRPC(const char *frame, int frame_len, mjson_print_fn_t fn, void *fndata);
 
 #endif // RPC_HANDLERS_H
@@ -0,0 +1,39 @@
+/**
+ * @file app_events.cpp
+ * @brief Wake-up events shared by the FreeRTOS tasks Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "app_events.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/task.h>
+
+static EventGroupHandle_t s_events;
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void app_events_init(void)
+{
+    if (!s_events) s_events = xEventGroupCreate();
+}
+
+void app_events_signal(uint32_t bits)
+{
+    if (s_events) xEventGroupSetBits(s_events, (EventBits_t)bits);
+}
+
+uint32_t app_events_wait(uint32_t bits, uint32_t timeout_ms)
+{
+    if (!s_events)
+    {
+        vTaskDelay(pdMS_TO_TICKS(timeout_ms));
+        return 0;
+    }
+    EventBits_t set = xEventGroupWaitBits(s_events, (EventBits_t)bits, pdTRUE, pdFALSE,
+                                          pdMS_TO_TICKS(timeout_ms));
+    return (uint32_t)(set & bits);
+}
@@ -0,0 +1,80 @@
+/**
+ * @file app_events.h
+ * @brief Wake-up events shared by the FreeRTOS tasks
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * One event group carries the requests that used to be found by polling a
+ * flag on every tick. Whoever sets the flag also signals the bit, and the
+ * task owning the work blocks on it instead of a fixed vTaskDelay():
+ *
+ * | Bit                    | Set by                           | Waited on by |
+ * |------------------------|----------------------------------|--------------|
+ * | APP_EV_FRAME_REQUEST   | Button V frame, refreshFrame RPC | Frame task   |
+ * | APP_EV_CONFIG_CHANGED  | Socket connect, updateConfig RPC | Frame task   |
+ * | APP_EV_LINK_TX         | Frame event posted to the uplink | App task     |
+ * | APP_EV_UPLINK_DONE     | Uplink event acked or failed     | Frame task   |
+ * | APP_EV_OTA_REQUEST     | firmwareUpdate RPC               | OTA task     |
+ * | APP_EV_SENSOR_BUS      | Poll rate, calibration or probe  | Modbus task  |
+ * |                        | request (sensor_bus_post)        |              |
+ *
+ * Each bit has a single waiter, which clears it on wake-up. A bit signalled
+ * twice before the waiter runs wakes it once; the flags still say what to do.
+ *
+ * Every wait is bounded (at most APP_EVENTS_IDLE_MS) so a dormant task still
+ * feeds the task watchdog (WDT_TIMEOUT, 60 s).
+ *
+ * @par Usage Pattern:
+ * @code
+ * app_events_init();                                   // before the tasks start
+ *
+ * sendFrameType = CALL_FRAME;                          // any task
+ * app_events_signal(APP_EV_FRAME_REQUEST);
+ *
+ * app_events_wait(APP_EV_FRAME_REQUEST, 1000);         // Frame task
+ * @endcode
+ */
+
+#ifndef APP_EVENTS_H
+#define APP_EVENTS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define APP_EV_FRAME_REQUEST (1UL << 0)
+#define APP_EV_CONFIG_CHANGED (1UL << 1)
+#define APP_EV_LINK_TX (1UL << 2)
+#define APP_EV_UPLINK_DONE (1UL << 3)
+#define APP_EV_OTA_REQUEST (1UL << 4)
+#define APP_EV_SENSOR_BUS (1UL << 5)
+
+#define APP_EVENTS_IDLE_MS 30000        /**< Longest sleep, half the watchdog timeout */
+
+/**
+ * @brief Create the event group
+ */
+void app_events_init(void);
+
+/**
+ * @brief Set event bits, from any task
+ * @param bits APP_EV_* mask
+ */
+void app_events_signal(uint32_t bits);
+
+/**
+ * @brief Block until any of the bits is set or the timeout expires
+ * @param bits APP_EV_* mask to wait on, cleared on return
+ * @param timeout_ms Longest wait
+ * @return Bits that were set, 0 on timeout
+ */
+uint32_t app_events_wait(uint32_t bits, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_EVENTS_H */
@@ -390,51 +390,69 @@ void CDisplay::ConfigModeScreenHandler()
 
   if (inCalibration)
   {
-    int elapsed = (millis() - calibrationStartMillis) / 1000;
-    if (elapsed > calibrationDuration)
+    const cal_progress_t &cal = DisplayCalibrationData;
+    if (cal.state == CAL_STATE_DONE || cal.state == CAL_STATE_FAILED)
     {
-      StopReadingSensor = true;
       ClearDisplay();
-      tft.setFreeFont(&calibri_regular12pt7b);
-      tft.drawString(" Hi, Please Wait", 10, 50);
-      tft.drawString(" Setting Cal Values", 10, 100);
-      tft.drawString(" To the sensor", 10, 150);
+      if (cal.state == CAL_STATE_DONE)
+      {
+        tft.setFreeFont(&calibri_regular14pt7b);
+        tft.setTextColor(TFT_DARKGREEN);
+        tft.drawString(" Sensor Calibration", 10, 50);
+        tft.drawString(" Successful", 10, 100);
+        tft.drawString(" I am ready", 10, 150);
+      }
+      else
+      {
+        tft.setTextColor(TFT_RED);
+        tft.setFreeFont(&calibri_regular14pt7b);
+        tft.drawString(" Sensor Calibration", 10, 50);
+        tft.drawString(" Failed", 10, 100);
+        tft.drawString(" Please Re-Calibrate", 10, 150);
+      }
+      m_bAckCalibration = true;
+      calibrationWaitDrawn = false;
+      inCalibration = false;
+      showResult = true;
+      resultTimer = millis();
+      return;
+    }
 
-      if (m_bCalibrationResponse != 2)
+    if (cal.state == CAL_STATE_WRITING || cal.state == CAL_STATE_VERIFYING)
+    {
+      if (!calibrationWaitDrawn)
       {
-        switch (m_bCalibrationResponse)
-        {
-        case 1:
-          ClearDisplay();
-          tft.setFreeFont(&calibri_regular14pt7b);
-          tft.setTextColor(TFT_DARKGREEN);
-          tft.drawString(" Sensor Calibration", 10, 50);
-          tft.drawString(" Successful", 10, 100);
-          tft.drawString(" I am ready", 10, 150);
-          break;
-        case 0:
-          ClearDisplay();
-          tft.setTextColor(TFT_RED);
-          tft.setFreeFont(&calibri_regular14pt7b);
-          tft.drawString(" Sensor Calibration", 10, 50);
-          tft.drawString(" Failed", 10, 100);
-          tft.drawString(" Please Re-Calibrate", 10, 150);
-          break;
-        default:
-          break;
-        }
-        StopReadingSensor = false;
-        inCalibration = false;
-        showResult = true;
-        resultTimer = millis();
+        ClearDisplay();
+        tft.setFreeFont(&calibri_regular12pt7b);
+        tft.drawString(" Hi, Please Wait", 10, 50);
+        tft.drawString(" Setting Cal Values", 10, 100);
+        tft.drawString(" To the sensor", 10, 150);
+        calibrationWaitDrawn = true;
       }
       return;
     }
-    else
+
+    if (cal.state == CAL_STATE_IDLE && !m_bStartCalibration)
     {
-      drawCalibrationStatus(elapsed);
+      /* Aborted */
+      inCalibration = false;
+      ClearDisplay();
+      drawConfigMenuTemplate();
+      drawMenuText(configMenuIndex);
       return;
     }
+
+    /* Collecting: a press finishes once the reading is stable, a 2 s hold aborts */
+    if (event == JUST_PRESSED && cal.converged)
+    {
+      m_bFinishCalibration = true;
+    }
+    else if (event == SHORT_PRESS_DETECTED)
+    {
+      m_bAbortCalibration = true;
+    }
+    drawCalibrationStatus(cal);
+    return;
   }
 
   if (showResult)
@@ -495,14 +513,14 @@ void CDisplay::ConfigModeScreenHandler()
   }
 }
 
-void CDisplay::drawCalibrationStatus(int elapsedSec)
+void CDisplay::drawCalibrationStatus(const cal_progress_t &cal)
 {
   // ClearDisplay();
   tft.setTextDatum(TL_DATUM);
   tft.setTextColor(fgColor(), bgColor());
 
   tft.setFreeFont(&POPPINS_SEMIBOLD_09pt7b);
-  String header = "Calibrating(" + String(elapsedSec) + "/" + String(calibrationDuration) + "s)";
+  String header = "Calibrating(" + String(cal.elapsed_s) + "/" + String(cal.max_s) + "s)";
   tft.fillRect(tft.textWidth("Calibrating(") + 2, 5, 120, 30, bgColor());
   tft.drawString(header, 2, 10);
 
@@ -522,8 +540,9 @@ void CDisplay::drawCalibrationStatus(int elapsedSec)
   tft.setFreeFont(&calibri_regular10pt7b);
   tft.setTextDatum(TL_DATUM);
   int textAreaX = 15, textAreaW = SCREEN_WIDTH - 20;
-  tft.fillCircle(7, 190, 3, TFT_RED);
-  drawWrappedText(textAreaX, 185, textAreaW, "Please keep the device powered on.");
+  tft.fillRect(textAreaX, 185, textAreaW, 50, bgColor());
+  tft.fillCircle(7, 190, 3, cal.converged ? TFT_DARKGREEN : TFT_RED);
+  drawWrappedText(textAreaX, 185, textAreaW, cal.converged ? "Reading stable, press to finish." : "Please keep the device powered on.");
   tft.fillCircle(7, 245, 3, TFT_RED);
   drawWrappedText(textAreaX, 240, textAreaW, "Do not move the sensor, during calibration.");
 }
@@ -545,11 +564,16 @@ void CDisplay::executeConfirmedAction(uint8_t index)
     tft.drawString("WiFi Reset Done", SCREEN_WIDTH / 2, 100);
     break;
   case 2:
-    calibrationStartMillis = millis();
+  {
+    m_bStartCalibration = true;
     inCalibration = true;
+    calibrationWaitDrawn = false;
     ClearDisplay();
-    drawCalibrationStatus(0);
+    cal_progress_t starting = {};
+    starting.max_s = CAL_MAX_DURATION_S;
+    drawCalibrationStatus(starting);
     return;
+  }
   case 3:
     tft.drawString("Returning back to", SCREEN_WIDTH / 2, 100);
     tft.drawString(" Config Menu", SCREEN_WIDTH / 2, 160);
@@ -8,6 +8,7 @@
 #include "CPondConfig.h"
 #include "company_logo_220x220.h"
 #include "CBackupStorage.h"
+#include "calibration_engine.h"
 
 /*POPPINS FAMILY*/
 #include "POPPINS_SEMIBOLD_09pt7b.h"
@@ -146,10 +147,14 @@ public:
   bool m_bSmartConfigMode = false;
   bool m_bResetServerFlag = false;
   bool m_bResetWifiFlag = false;
-  bool StopReadingSensor = false;
+  /* Calibration requests consumed by the App task, progress filled in by it */
+  bool m_bStartCalibration = false;
+  bool m_bFinishCalibration = false;
+  bool m_bAbortCalibration = false;
+  bool m_bAckCalibration = false;
+  cal_progress_t DisplayCalibrationData = {};
   bool m_bSelectedReturnHome = false;
   bool m_bRefreshRightPanel = false;
-  uint8_t m_bCalibrationResponse = 2;
 
   leftPanel_t DisplayLeftPanelData;
   Header_t DisplayHeaderData;
@@ -222,9 +227,8 @@ private:
   bool showResult = false;
   unsigned long resultTimer = 0;
   const uint8_t CONFIG_MENU_COUNT = 6;
-  const int calibrationDuration = 180; // 180 seconds
-  unsigned long calibrationStartMillis = 0;
   bool inCalibration = false;
+  bool calibrationWaitDrawn = false;
 
   /*Default Pages*/
   void NextAqua(int x, int y, int b, int color);
@@ -236,7 +240,7 @@ private:
   void drawConfirmDialog(uint8_t index);
   void drawYesNoOptions();
   void executeConfirmedAction(uint8_t index);
-  void drawCalibrationStatus(int elapsedSec);
+  void drawCalibrationStatus(const cal_progress_t &cal);
 
   /**/
   uint16_t bgColor();
@@ -0,0 +1,365 @@
+/**
+ * @file calibration_engine.cpp
+ * @brief DO Sensor Air-Saturation Calibration Engine Implementation
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * cal_engine_step() is the only function that talks to the sensor and it
+ * runs in the Modbus task, so calibration writes never race the bus poller.
+ * Modbus transactions are done outside the lock; the lock only covers the
+ * short bookkeeping around them.
+ */
+
+#include "calibration_engine.h"
+#include <Arduino.h>
+#include <math.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+/* ========================================================================
+ * HELPER FUNCTIONS (call with eng->lock held)
+ * ======================================================================== */
+
+/**
+ * @brief Clear the collection window for a fresh run
+ */
+static void reset_run(struct cal_engine *eng, uint32_t now_ms, uint32_t sample_ms)
+{
+    memset(eng->window, 0, sizeof(eng->window));
+    eng->window_idx = 0;
+    eng->window_count = 0;
+    eng->samples = 0;
+    eng->temp_sum = 0.0f;
+    eng->mean_pct = 0.0f;
+    eng->spread_pct = 0.0f;
+    eng->converged = 0;
+    eng->attempts = 0;
+    eng->k = 0.0f;
+    eng->b = 0.0f;
+    eng->error = CAL_ERR_NONE;
+    eng->start_ms = now_ms;
+    eng->end_ms = now_ms;
+    /* Only readings taken after the start count */
+    eng->last_sample_ms = sample_ms;
+}
+
+/**
+ * @brief Add one DO % reading and refresh mean, spread and convergence
+ */
+static void add_sample(struct cal_engine *eng, float pct, float temp)
+{
+    eng->window[eng->window_idx] = pct;
+    eng->window_idx = (eng->window_idx + 1) % CAL_WINDOW_SAMPLES;
+    if (eng->window_count < CAL_WINDOW_SAMPLES) eng->window_count++;
+    eng->samples++;
+    eng->temp_sum += temp;
+
+    float sum = 0.0f, lo = eng->window[0], hi = eng->window[0];
+    for (uint8_t i = 0; i < eng->window_count; i++)
+    {
+        float v = eng->window[i];
+        sum += v;
+        if (v < lo) lo = v;
+        if (v > hi) hi = v;
+    }
+    eng->mean_pct = sum / eng->window_count;
+    eng->spread_pct = hi - lo;
+    eng->converged = (eng->window_count == CAL_WINDOW_SAMPLES &&
+                      eng->spread_pct <= CAL_CONVERGED_SPREAD_PCT);
+}
+
+/**
+ * @brief Enter FAILED, returns 1 for the step() result
+ */
+static uint8_t fail(struct cal_engine *eng, cal_error_t error, uint32_t now_ms)
+{
+    eng->state = CAL_STATE_FAILED;
+    eng->error = error;
+    eng->end_ms = now_ms;
+    debugPrintf("[Calibration] failed, error %d\n", error);
+    return 1;
+}
+
+/**
+ * @brief Relative comparison for the K/B read-back
+ */
+static bool matches(float read_back, float written)
+{
+    float scale = fabsf(written) > 1.0f ? fabsf(written) : 1.0f;
+    return fabsf(read_back - written) <= CAL_VERIFY_TOLERANCE * scale;
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void cal_engine_init(struct cal_engine *eng, struct do_sensor_device *sensor)
+{
+    if (!eng) return;
+
+    memset(eng, 0, sizeof(struct cal_engine));
+    eng->sensor = sensor;
+    eng->state = CAL_STATE_IDLE;
+    eng->lock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+uint8_t cal_engine_start(struct cal_engine *eng)
+{
+    if (!eng) return FAIL;
+
+    uint8_t ret = FAIL;
+    portENTER_CRITICAL(&eng->lock);
+    if (eng->state != CAL_STATE_WRITING && eng->state != CAL_STATE_VERIFYING)
+    {
+        /* Switch state right away so readers never see a stale result */
+        reset_run(eng, millis(), eng->last_sample_ms);
+        eng->state = CAL_STATE_COLLECTING;
+        eng->req_start = 1;
+        eng->req_finish = 0;
+        eng->req_abort = 0;
+        ret = SUCCESS;
+    }
+    portEXIT_CRITICAL(&eng->lock);
+    return ret;
+}
+
+uint8_t cal_engine_write(struct cal_engine *eng, float k, float b)
+{
+    if (!eng || !(k > 0.0f)) return FAIL;
+
+    uint8_t ret = FAIL;
+    portENTER_CRITICAL(&eng->lock);
+    if (eng->state != CAL_STATE_COLLECTING && eng->state != CAL_STATE_WRITING &&
+        eng->state != CAL_STATE_VERIFYING && !eng->req_start)
+    {
+        reset_run(eng, millis(), eng->last_sample_ms);
+        eng->k = k;
+        eng->b = b;
+        eng->req_finish = 0;
+        eng->req_abort = 0;
+        eng->state = CAL_STATE_WRITING;
+        ret = SUCCESS;
+    }
+    portEXIT_CRITICAL(&eng->lock);
+    return ret;
+}
+
+uint8_t cal_engine_finish(struct cal_engine *eng)
+{
+    if (!eng) return FAIL;
+
+    uint8_t ret;
+    portENTER_CRITICAL(&eng->lock);
+    ret = (eng->state == CAL_STATE_COLLECTING && eng->converged);
+    if (ret) eng->req_finish = 1;
+    portEXIT_CRITICAL(&eng->lock);
+    return ret;
+}
+
+void cal_engine_abort(struct cal_engine *eng)
+{
+    if (!eng) return;
+
+    portENTER_CRITICAL(&eng->lock);
+    eng->req_abort = 1;
+    portEXIT_CRITICAL(&eng->lock);
+}
+
+void cal_engine_ack(struct cal_engine *eng)
+{
+    if (!eng) return;
+
+    portENTER_CRITICAL(&eng->lock);
+    if (eng->state == CAL_STATE_DONE || eng->state == CAL_STATE_FAILED)
+        eng->state = CAL_STATE_IDLE;
+    portEXIT_CRITICAL(&eng->lock);
+}
+
+uint8_t cal_engine_step(struct cal_engine *eng, uint32_t now_ms, uint32_t sample_ms)
+{
+    if (!eng || !eng->sensor) return 0;
+
+    struct do_sensor_device *sensor = eng->sensor;
+    uint8_t finished = 0;
+    cal_state_t state;
+
+    portENTER_CRITICAL(&eng->lock);
+    if (eng->req_abort)
+    {
+        eng->req_abort = 0;
+        eng->req_finish = 0;
+        eng->state = CAL_STATE_IDLE;
+        eng->error = CAL_ERR_ABORTED;
+    }
+    if (eng->req_start)
+    {
+        /* Start was posted from another task, re-anchor on the Modbus clock */
+        eng->req_start = 0;
+        reset_run(eng, now_ms, sample_ms);
+    }
+    state = eng->state;
+    portEXIT_CRITICAL(&eng->lock);
+
+    switch (state)
+    {
+    case CAL_STATE_COLLECTING:
+    {
+        bool fresh = (sample_ms != eng->last_sample_ms) && do_sensor_is_connected(sensor);
+        portENTER_CRITICAL(&eng->lock);
+        if (fresh)
+        {
+            eng->last_sample_ms = sample_ms;
+            add_sample(eng, sensor->do_percent, sensor->temp);
+        }
+
+        bool go = false;
+        if (eng->req_finish)
+        {
+            eng->req_finish = 0;
+            go = eng->converged;
+        }
+        if (!go && (now_ms - eng->start_ms) >= (uint32_t)CAL_MAX_DURATION_S * 1000)
+        {
+            if (eng->samples >= CAL_MIN_SAMPLES)
+                go = true;
+            else
+                finished = fail(eng, CAL_ERR_NO_SAMPLES, now_ms);
+        }
+        if (go)
+        {
+            if (eng->mean_pct < CAL_MIN_VALID_PCT || eng->mean_pct > CAL_MAX_VALID_PCT)
+            {
+                finished = fail(eng, CAL_ERR_OUT_OF_RANGE, now_ms);
+            }
+            else
+            {
+                /* Single-point air calibration: scale the reading to 100 % */
+                eng->k = 100.0f / eng->mean_pct;
+                eng->b = 0.0f;
+                eng->attempts = 0;
+                eng->state = CAL_STATE_WRITING;
+            }
+        }
+        portEXIT_CRITICAL(&eng->lock);
+        break;
+    }
+
+    case CAL_STATE_WRITING:
+    {
+        sensor->cal_k = eng->k;
+        sensor->cal_b = eng->b;
+        uint8_t ok = do_sensor_set_calibration(sensor);
+        debugPrintf("[Calibration] write K %.5f B %.5f -> %d\n", eng->k, eng->b, ok);
+
+        portENTER_CRITICAL(&eng->lock);
+        eng->attempts++;
+        if (ok)
+            eng->state = CAL_STATE_VERIFYING;
+        else if (eng->attempts >= CAL_WRITE_ATTEMPTS)
+            finished = fail(eng, CAL_ERR_WRITE, now_ms);
+        portEXIT_CRITICAL(&eng->lock);
+        break;
+    }
+
+    case CAL_STATE_VERIFYING:
+    {
+        uint8_t ok = do_sensor_get_calibration(sensor) &&
+                     matches(sensor->cal_k, eng->k) && matches(sensor->cal_b, eng->b);
+        debugPrintf("[Calibration] read back K %.5f B %.5f -> %d\n", sensor->cal_k, sensor->cal_b, ok);
+
+        portENTER_CRITICAL(&eng->lock);
+        if (ok)
+        {
+            eng->state = CAL_STATE_DONE;
+            eng->end_ms = now_ms;
+            finished = 1;
+        }
+        else if (eng->attempts < CAL_WRITE_ATTEMPTS)
+        {
+            eng->state = CAL_STATE_WRITING;
+        }
+        else
+        {
+            finished = fail(eng, CAL_ERR_VERIFY, now_ms);
+        }
+        portEXIT_CRITICAL(&eng->lock);
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    return finished;
+}
+
+uint8_t cal_engine_is_busy(struct cal_engine *eng)
+{
+    if (!eng) return 0;
+    cal_state_t state = eng->state;
+    return (state == CAL_STATE_COLLECTING || state == CAL_STATE_WRITING || state == CAL_STATE_VERIFYING);
+}
+
+void cal_engine_get_progress(struct cal_engine *eng, cal_progress_t *out, uint32_t now_ms)
+{
+    if (!eng || !out) return;
+
+    portENTER_CRITICAL(&eng->lock);
+    out->state = eng->state;
+    out->error = eng->error;
+    out->converged = eng->converged;
+    uint32_t end = (eng->state == CAL_STATE_DONE || eng->state == CAL_STATE_FAILED) ? eng->end_ms : now_ms;
+    out->elapsed_s = (eng->state == CAL_STATE_IDLE) ? 0 : (uint16_t)((end - eng->start_ms) / 1000);
+    out->max_s = CAL_MAX_DURATION_S;
+    out->samples = eng->samples;
+    out->mean_pct = eng->mean_pct;
+    out->spread_pct = eng->spread_pct;
+    out->k = eng->k;
+    out->b = eng->b;
+    portEXIT_CRITICAL(&eng->lock);
+}
+
+void cal_engine_get_record(struct cal_engine *eng, cal_record_t *out)
+{
+    if (!eng || !out) return;
+
+    memset(out, 0, sizeof(cal_record_t));
+    portENTER_CRITICAL(&eng->lock);
+    out->k = eng->k;
+    out->b = eng->b;
+    out->mean_pct = eng->mean_pct;
+    out->temp = eng->samples ? eng->temp_sum / eng->samples : 0.0f;
+    out->duration_s = (uint16_t)((eng->end_ms - eng->start_ms) / 1000);
+    out->samples = eng->samples;
+    out->ok = (eng->state == CAL_STATE_DONE);
+    out->error = eng->error;
+    portEXIT_CRITICAL(&eng->lock);
+}
+
+const char *cal_engine_state_name(uint8_t state)
+{
+    switch (state)
+    {
+    case CAL_STATE_IDLE:       return "idle";
+    case CAL_STATE_COLLECTING: return "collecting";
+    case CAL_STATE_WRITING:    return "writing";
+    case CAL_STATE_VERIFYING:  return "verifying";
+    case CAL_STATE_DONE:       return "done";
+    case CAL_STATE_FAILED:     return "failed";
+    default:                   return "unknown";
+    }
+}
@@ -0,0 +1,246 @@
+/**
+ * @file calibration_engine.h
+ * @brief DO Sensor Air-Saturation Calibration Engine
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Drives a single-point (100 % air saturation) calibration as a state
+ * machine stepped from the Modbus task, which already owns the RS-485 bus:
+ *
+ * @code
+ * IDLE -> COLLECTING -> WRITING -> VERIFYING -> DONE
+ *             |            |           |
+ *             +------------+-----------+------> FAILED
+ * @endcode
+ *
+ * - COLLECTING keeps a window of DO % readings and flags convergence when
+ *   the window is full and its spread is small. The operator may finish
+ *   from then on; otherwise the window mean is used at the time limit.
+ * - WRITING computes K = 100 / mean, B = 0 and writes them.
+ * - VERIFYING reads K/B back and compares them with what was written.
+ *
+ * A manual K/B (setCalValues RPC) enters at WRITING with no collection, so
+ * the probe's calibration registers are only ever written from the Modbus
+ * task, and never while a calibration is running.
+ *
+ * Other tasks only post requests (start/finish/abort/write) and read
+ * progress, both through a short critical section.
+ *
+ * @par Usage Pattern:
+ * @code
+ * cal_engine_init(&g_calEngine, &g_do_sensor);
+ * cal_engine_start(&g_calEngine);                       // display / RPC
+ * if (cal_engine_step(&g_calEngine, millis(), last_read_ms)) // Modbus task
+ *     cal_engine_get_record(&g_calEngine, &record);     // persist result
+ * cal_engine_get_progress(&g_calEngine, &progress);     // display / RPC
+ * @endcode
+ */
+
+#ifndef CALIBRATION_ENGINE_H
+#define CALIBRATION_ENGINE_H
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include "do_sensor_ops.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAL_WINDOW_SAMPLES 20           /**< Readings in the convergence window */
+#define CAL_CONVERGED_SPREAD_PCT 1.0f   /**< Max-min DO % across the window */
+#define CAL_MIN_SAMPLES 5               /**< Fewest readings accepted at the time limit */
+#define CAL_MAX_DURATION_S 180          /**< Collection time limit */
+#define CAL_MIN_VALID_PCT 50.0f         /**< Plausible air-saturation readings */
+#define CAL_MAX_VALID_PCT 150.0f
+#define CAL_WRITE_ATTEMPTS 2            /**< Write + verify attempts before FAILED */
+#define CAL_VERIFY_TOLERANCE 0.0005f    /**< Relative K/B read-back tolerance */
+
+/**
+ * @brief Engine states
+ */
+typedef enum {
+    CAL_STATE_IDLE = 0,
+    CAL_STATE_COLLECTING,
+    CAL_STATE_WRITING,
+    CAL_STATE_VERIFYING,
+    CAL_STATE_DONE,
+    CAL_STATE_FAILED
+} cal_state_t;
+
+/**
+ * @brief Why a calibration ended in FAILED
+ */
+typedef enum {
+    CAL_ERR_NONE = 0,
+    CAL_ERR_NO_SAMPLES,                 /**< Time limit with too few valid readings */
+    CAL_ERR_OUT_OF_RANGE,               /**< Mean outside CAL_MIN/MAX_VALID_PCT */
+    CAL_ERR_WRITE,                      /**< Modbus write failed */
+    CAL_ERR_VERIFY,                     /**< Read-back did not match */
+    CAL_ERR_ABORTED                     /**< Operator aborted */
+} cal_error_t;
+
+/**
+ * @brief Progress view for the display and RPC
+ */
+typedef struct {
+    uint8_t state;                      /**< cal_state_t */
+    uint8_t error;                      /**< cal_error_t */
+    uint8_t converged;                  /**< 1 once the window is stable */
+    uint16_t elapsed_s;                 /**< Seconds since start */
+    uint16_t max_s;                     /**< Collection time limit */
+    uint16_t samples;                   /**< Valid readings taken */
+    float mean_pct;                     /**< Window mean DO % */
+    float spread_pct;                   /**< Window max-min DO % */
+    float k;                            /**< K written (WRITING onwards) */
+    float b;                            /**< B written (WRITING onwards) */
+} cal_progress_t;
+
+/**
+ * @brief History record of a finished calibration (samples 0 for a manual K/B)
+ */
+typedef struct {
+    uint32_t epoch;                     /**< Filled in by the caller */
+    float k;
+    float b;
+    float mean_pct;                     /**< Air-saturation reading that was corrected */
+    float temp;                         /**< Mean temperature during collection */
+    uint16_t duration_s;
+    uint16_t samples;
+    uint8_t ok;                         /**< 1 on DONE, 0 on FAILED */
+    uint8_t error;                      /**< cal_error_t */
+} cal_record_t;
+
+#define CAL_HISTORY_MAX 8               /**< Records kept in the persisted history */
+
+/**
+ * @brief Persisted calibration history (ring of the last CAL_HISTORY_MAX runs)
+ */
+typedef struct {
+    uint8_t count;                      /**< Valid records */
+    uint8_t next;                       /**< Slot the next record goes to */
+    cal_record_t records[CAL_HISTORY_MAX];
+} cal_history_t;
+
+/**
+ * @struct cal_engine
+ * @brief Calibration Engine Structure
+ */
+struct cal_engine {
+    struct do_sensor_device *sensor;    /**< Probe being calibrated */
+
+    cal_state_t state;
+    cal_error_t error;
+    uint8_t converged;
+    uint8_t attempts;                   /**< Write + verify attempts so far */
+
+    /* Requests posted by other tasks, consumed by cal_engine_step() */
+    uint8_t req_start;
+    uint8_t req_finish;
+    uint8_t req_abort;
+
+    /* Collection window */
+    float window[CAL_WINDOW_SAMPLES];   /**< Last DO % readings */
+    uint8_t window_idx;
+    uint8_t window_count;
+    uint16_t samples;
+    float temp_sum;
+    float mean_pct;
+    float spread_pct;
+    uint32_t start_ms;
+    uint32_t end_ms;
+    uint32_t last_sample_ms;            /**< Timestamp of the last reading taken */
+
+    float k;
+    float b;
+
+    portMUX_TYPE lock;                  /**< Guards everything above across tasks */
+};
+
+/**
+ * @brief Initialize the engine for a probe
+ * @param eng Pointer to engine structure
+ * @param sensor Probe to calibrate
+ */
+void cal_engine_init(struct cal_engine *eng, struct do_sensor_device *sensor);
+
+/**
+ * @brief Request a new calibration (ignored while writing or verifying)
+ * @param eng Pointer to engine structure
+ * @return 1 if accepted, 0 if busy writing
+ */
+uint8_t cal_engine_start(struct cal_engine *eng);
+
+/**
+ * @brief Request a write of a manual K/B, verified like a calibrated one
+ * @param eng Pointer to engine structure
+ * @param k Calibration K, must be positive
+ * @param b Calibration B
+ * @return 1 if accepted, 0 if K is not positive or a calibration is running
+ *
+ * @details
+ * The busy check and the switch to WRITING are one critical section, so a
+ * calibration started from another task cannot slip in between.
+ */
+uint8_t cal_engine_write(struct cal_engine *eng, float k, float b);
+
+/**
+ * @brief Request an early finish, honoured only once converged
+ * @param eng Pointer to engine structure
+ * @return 1 if the reading has converged, 0 otherwise
+ */
+uint8_t cal_engine_finish(struct cal_engine *eng);
+
+/**
+ * @brief Request an abort, takes effect at the next step
+ * @param eng Pointer to engine structure
+ */
+void cal_engine_abort(struct cal_engine *eng);
+
+/**
+ * @brief Return a finished engine to IDLE after the result was shown
+ * @param eng Pointer to engine structure
+ */
+void cal_engine_ack(struct cal_engine *eng);
+
+/**
+ * @brief Advance the state machine, Modbus task only
+ * @param eng Pointer to engine structure
+ * @param now_ms Current millis()
+ * @param sample_ms millis() of the probe's last successful read
+ * @return 1 when the engine just reached DONE or FAILED, 0 otherwise
+ */
+uint8_t cal_engine_step(struct cal_engine *eng, uint32_t now_ms, uint32_t sample_ms);
+
+/**
+ * @brief 1 while the engine needs sensor reads (COLLECTING..VERIFYING)
+ * @param eng Pointer to engine structure
+ */
+uint8_t cal_engine_is_busy(struct cal_engine *eng);
+
+/**
+ * @brief Copy a consistent progress view
+ * @param eng Pointer to engine structure
+ * @param out Progress output
+ * @param now_ms Current millis() for the elapsed time
+ */
+void cal_engine_get_progress(struct cal_engine *eng, cal_progress_t *out, uint32_t now_ms);
+
+/**
+ * @brief Build the history record of the last finished calibration
+ * @param eng Pointer to engine structure
+ * @param out Record output (epoch left at 0)
+ */
+void cal_engine_get_record(struct cal_engine *eng, cal_record_t *out);
+
+/**
+ * @brief Printable state name for logs and RPC replies
+ */
+const char *cal_engine_state_name(uint8_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CALIBRATION_ENGINE_H */
@@ -0,0 +1,130 @@
+/**
+ * @file config_page.cpp
+ * @brief getConfig reply paging Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "config_page.h"
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <stdio.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define CONFIG_PAGE_READ_BLOCK 256
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+/**
+ * @brief Tokenizer callback: keep the header fields, print lines in the window
+ */
+static uint8_t on_event(struct json_stream *js, uint8_t ev, const char *value, size_t len)
+{
+    struct config_page *page = (struct config_page *)js->ctx;
+    uint8_t depth = json_stream_depth(js);
+    const char *key = json_stream_key(js, 0);
+
+    if (depth == 1)
+    {
+        if (ev == JSON_EV_NUMBER && !strcmp(key, "version"))
+            snprintf(page->version, sizeof(page->version), "%s", value);
+        else if (ev == JSON_EV_STRING && !strcmp(key, "tenantId"))
+            snprintf(page->tenant, sizeof(page->tenant), "%s", value);
+        else if (ev == JSON_EV_NUMBER && !strcmp(key, "offset"))
+            snprintf(page->offset, sizeof(page->offset), "%s", value);
+    }
+    else if (depth == 2 && ev == JSON_EV_STRING && !strcmp(key, "config"))
+    {
+        uint32_t line = page->total++;
+        if (line >= page->cursor && page->emitted < page->limit)
+        {
+            page->printed += mjson_printf(page->fn, page->fndata, "%s%.*Q",
+                                          page->emitted ? "," : "", (int)len, value);
+            page->emitted++;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Stream the file through the tokenizer
+ * @return SUCCESS (1) if the whole file parsed
+ */
+static uint8_t parse_file(struct config_page *page)
+{
+    File file = SPIFFS.open(page->path, FILE_READ);
+    if (!file)
+    {
+        debugPrintf("[ConfigPage] %s not found\n", page->path);
+        return 0;
+    }
+
+    json_stream_init(&page->js, on_event, page);
+    char block[CONFIG_PAGE_READ_BLOCK];
+    uint8_t ok = 1;
+    int n;
+    while (ok && (n = file.read((uint8_t *)block, sizeof(block))) > 0)
+    {
+        ok = json_stream_feed(&page->js, block, (size_t)n);
+    }
+    file.close();
+
+    if (!ok || !json_stream_finish(&page->js))
+    {
+        debugPrintf("[ConfigPage] parse failed (%u at byte %lu)\n", page->js.error, (unsigned long)page->js.pos);
+        return 0;
+    }
+    return 1;
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void config_page_init(struct config_page *page, const char *path, uint16_t cursor, uint16_t limit)
+{
+    if (!page) return;
+    memset(page, 0, sizeof(struct config_page));
+    snprintf(page->path, sizeof(page->path), "%s", path ? path : "");
+    page->cursor = cursor;
+    page->limit = limit > CONFIG_PAGE_MAX ? CONFIG_PAGE_MAX : limit;
+}
+
+int config_page_print(mjson_print_fn_t fn, void *fndata, va_list *ap)
+{
+    struct config_page *page = va_arg(*ap, struct config_page *);
+    page->fn = fn;
+    page->fndata = fndata;
+    page->printed = mjson_printf(fn, fndata, "{%Q:[", "config");
+    page->ok = parse_file(page);
+
+    int next = -1;
+    if (page->ok && page->cursor + page->emitted < page->total)
+    {
+        next = page->cursor + page->emitted;
+    }
+    page->printed += mjson_printf(fn, fndata, "]");
+    if (page->version[0])
+        page->printed += mjson_printf(fn, fndata, ",%Q:%s", "version", page->version);
+    if (page->tenant[0])
+        page->printed += mjson_printf(fn, fndata, ",%Q:%Q", "tenantId", page->tenant);
+    if (page->offset[0])
+        page->printed += mjson_printf(fn, fndata, ",%Q:%s", "offset", page->offset);
+    page->printed += mjson_printf(fn, fndata, ",%Q:%d,%Q:%d,%Q:%d}",
+                                  "total", (int)page->total, "next", next,
+                                  "statusCode", page->ok ? 200 : 300);
+    return page->printed;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file config_page.h
+ * @brief getConfig reply: idsConfig.txt printed a page of ponds at a time
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * A full config (255 pond lines of ~100 bytes) is bigger than any reply
+ * buffer, so getConfig returns the header fields with a window of the
+ * "config" array. The file is streamed through json_stream and the page is
+ * printed straight into the reply, nothing of the file is held in RAM:
+ * @code
+ * {"config":["<line>",..],"version":N,"tenantId":"..","offset":330,
+ *  "total":255,"next":40,"statusCode":200}
+ * @endcode
+ * "next" is the cursor of the following page, -1 on the last one, the same
+ * convention as listFiles. A config that fits one page comes back whole.
+ *
+ * @par Usage Pattern:
+ * @code
+ * struct config_page *page = (struct config_page *)malloc(sizeof(*page));
+ * config_page_init(page, FILENAME_IDSCONFIG, cursor, limit);
+ * jsonrpc_return_success(r, "%M", config_page_print, page);
+ * free(page);
+ * @endcode
+ */
+
+#ifndef CONFIG_PAGE_H
+#define CONFIG_PAGE_H
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <mjson.h>
+#include "json_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONFIG_PAGE_MAX 40              /**< Pond lines per page */
+#define CONFIG_PAGE_PATH_MAX 32
+#define CONFIG_PAGE_FIELD_MAX 48        /**< Header values, longer ones are cut */
+
+/**
+ * @brief Largest page printed, for sizing the reply buffer
+ *
+ * Lines reach the printer cut to JSON_STREAM_TOKEN_MAX; quoting and the
+ * separator add 3 bytes each, the header fields and counters stay under 256.
+ */
+#define CONFIG_PAGE_REPLY_MAX (CONFIG_PAGE_MAX * (JSON_STREAM_TOKEN_MAX + 3) + 256)
+
+/**
+ * @struct config_page
+ * @brief One page request and its parse state
+ */
+struct config_page {
+    struct json_stream js;
+    mjson_print_fn_t fn;
+    void *fndata;
+    int printed;                        /**< Bytes printed so far */
+
+    char path[CONFIG_PAGE_PATH_MAX];
+    uint16_t cursor;                    /**< First line wanted */
+    uint16_t limit;                     /**< Lines wanted */
+    uint32_t total;                     /**< Lines in the file */
+    uint16_t emitted;                   /**< Lines printed */
+    uint8_t ok;                         /**< File read and parsed */
+
+    char version[CONFIG_PAGE_FIELD_MAX];  /**< Number text as written */
+    char tenant[CONFIG_PAGE_FIELD_MAX];
+    char offset[CONFIG_PAGE_FIELD_MAX];   /**< Number text as written */
+};
+
+/**
+ * @brief Prepare a page request
+ * @param page Pointer to page structure
+ * @param path Config file
+ * @param cursor First line wanted
+ * @param limit Lines wanted, capped to CONFIG_PAGE_MAX
+ */
+void config_page_init(struct config_page *page, const char *path, uint16_t cursor, uint16_t limit);
+
+/**
+ * @brief mjson %M printer writing the page object
+ *
+ * Takes a struct config_page * from the argument list. The object is always
+ * well formed; "statusCode" is 300 when the file was missing or unparsable.
+ *
+ * @return Bytes printed
+ */
+int config_page_print(mjson_print_fn_t fn, void *fndata, va_list *ap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_PAGE_H */
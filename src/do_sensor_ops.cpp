@@ -10,6 +10,7 @@
  */
 
 #include "do_sensor_ops.h"
+#include "field_trace.h"
 #include <Arduino.h>
 #include <ModbusMaster.h>
 #include <string.h>
@@ -31,16 +32,13 @@
 #define MAX_CONSECUTIVE_FAILURES 10
 
 /* Modbus register configurations */
-static do_sensor_register_t reg_serial_num = {0x0900, 0x07, {0}};
-static do_sensor_register_t reg_start_msrmnt = {0x2500, 0x01, {0}};
-static do_sensor_register_t reg_stop_msrmnt = {0x2E00, 0x01, {0}};
-static do_sensor_register_t reg_temp_do_vals = {0x2600, 0x06, {0}};
-static do_sensor_register_t reg_cal_data = {0x1100, 0x04, {0}};
-static do_sensor_register_t reg_salinity = {0x1500, 0x02, {0}};
-static do_sensor_register_t reg_pressure = {0x2400, 0x02, {0}};
-
-/* Global Modbus node - stored in device->priv */
-static ModbusMaster *g_modbus_node = NULL;
+static do_sensor_register_t reg_serial_num = {0x0900, 0x07};
+static do_sensor_register_t reg_start_msrmnt = {0x2500, 0x01};
+static do_sensor_register_t reg_stop_msrmnt = {0x2E00, 0x01};
+static do_sensor_register_t reg_temp_do_vals = {0x2600, 0x06};
+static do_sensor_register_t reg_cal_data = {0x1100, 0x04};
+static do_sensor_register_t reg_salinity = {0x1500, 0x02};
+static do_sensor_register_t reg_pressure = {0x2400, 0x02};
 
 /* ========================================================================
  * HELPER FUNCTIONS
@@ -64,10 +62,20 @@ static void float_to_hex_le(float value, uint16_t *val1, uint16_t *val2)
 }
 
 /**
- * @brief Get data from sensor via Modbus RTU
+ * @brief Hand every ADU on the bus to the field trace recorder
+ */
+static void trace_adu(bool response, const uint8_t *adu, uint8_t len)
+{
+    field_trace_record(response ? FIELD_TRACE_MODBUS_RX : FIELD_TRACE_MODBUS_TX, adu, len);
+}
+
+/**
+ * @brief Read holding registers via Modbus RTU
+ * @param payload Set to a view of the register bytes inside the node's
+ *                response ADU (wire order), valid until the next transaction
  */
 static int get_data_from_sensor(ModbusMaster *node, uint16_t start_addr, 
-                                uint16_t num_regs, uint16_t *response_buf)
+                                uint16_t num_regs, const uint8_t **payload)
 {
     if (!node) return FAIL;
     
@@ -75,15 +83,19 @@ static int get_data_from_sensor(ModbusMaster *node, uint16_t start_addr,
     
     if (result == node->ku8MBSuccess)
     {
-        for (size_t i = 0; i < num_regs; i++)
+        uint8_t len = 0;
+        const uint8_t *bytes = node->getResponseBytes(&len);
+        if (!bytes || len < num_regs * 2)
         {
-            response_buf[i] = node->getResponseBuffer(i);
+            debugPrintln("[DoSensor] Short holding register response");
+            return FAIL;
         }
+        if (payload) *payload = bytes;
         
         #ifdef SERIAL_DEBUG
-        for (size_t i = 0; i < num_regs; i++)
+        for (uint8_t i = 0; i < len; i++)
         {
-            debugPrint(response_buf[i], HEX);
+            debugPrint(bytes[i], HEX);
             debugPrint(" ");
         }
         debugPrintln();
@@ -99,99 +111,45 @@ static int get_data_from_sensor(ModbusMaster *node, uint16_t start_addr,
 }
 
 /**
- * @brief Extract temperature and DO values from response buffer
+ * @brief Decode one sensor float from two registers
+ * 
+ * The probe sends IEEE-754 floats least significant byte first across its
+ * two registers, so the wire bytes are the float in little-endian order.
  */
-static void extract_temp_and_do_values(uint16_t response_buf[], float *temp, 
-                                      float *do_percent, float *do_mgl)
+static float decode_float(const uint8_t *p)
 {
-    /* Temperature: Combine two 16-bit values into 32-bit */
-    uint32_t temp_hex = ((uint32_t)response_buf[0] << 16) | response_buf[1];
-    uint32_t do_hex = ((uint32_t)response_buf[2] << 16) | response_buf[3];
-    uint32_t domg_hex = ((uint32_t)response_buf[4] << 16) | response_buf[5];
-    
-    /* Extract and recombine bytes */
-    uint8_t byte1_temp = (temp_hex >> 24) & 0xFF;
-    uint8_t byte2_temp = (temp_hex >> 16) & 0xFF;
-    uint8_t byte3_temp = (temp_hex >> 8) & 0xFF;
-    uint8_t byte4_temp = temp_hex & 0xFF;
-    uint32_t combined_temp = ((uint32_t)byte4_temp << 24) | ((uint32_t)byte3_temp << 16) | 
-                            ((uint32_t)byte2_temp << 8) | byte1_temp;
-    
-    uint8_t byte1_do = (do_hex >> 24) & 0xFF;
-    uint8_t byte2_do = (do_hex >> 16) & 0xFF;
-    uint8_t byte3_do = (do_hex >> 8) & 0xFF;
-    uint8_t byte4_do = do_hex & 0xFF;
-    uint32_t combined_do = ((uint32_t)byte4_do << 24) | ((uint32_t)byte3_do << 16) | 
-                          ((uint32_t)byte2_do << 8) | byte1_do;
-    
-    uint8_t byte1_domg = (domg_hex >> 24) & 0xFF;
-    uint8_t byte2_domg = (domg_hex >> 16) & 0xFF;
-    uint8_t byte3_domg = (domg_hex >> 8) & 0xFF;
-    uint8_t byte4_domg = domg_hex & 0xFF;
-    uint32_t combined_domg = ((uint32_t)byte4_domg << 24) | ((uint32_t)byte3_domg << 16) | 
-                            ((uint32_t)byte2_domg << 8) | byte1_domg;
-    
-    /* Reinterpret as float */
     float_converter_t converter;
-    
-    converter.uint_value = combined_temp;
-    *temp = converter.float_value;
-    
-    converter.uint_value = combined_do;
-    *do_percent = converter.float_value * 100;
-    
-    converter.uint_value = combined_domg;
-    *do_mgl = converter.float_value;
+    converter.uint_value = ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) |
+                           ((uint32_t)p[1] << 8) | p[0];
+    return converter.float_value;
 }
 
 /**
- * @brief Extract calibration values from response buffer
+ * @brief Extract temperature and DO values from the response payload
  */
-static void extract_cal_values(uint16_t response_buf[], float *k, float *b)
-{
-    uint32_t k_val = ((uint32_t)response_buf[0] << 16) | response_buf[1];
-    uint32_t b_val = ((uint32_t)response_buf[2] << 16) | response_buf[3];
-    
-    /* Extract and recombine bytes */
-    uint8_t byte1_k = (k_val >> 24) & 0xFF;
-    uint8_t byte2_k = (k_val >> 16) & 0xFF;
-    uint8_t byte3_k = (k_val >> 8) & 0xFF;
-    uint8_t byte4_k = k_val & 0xFF;
-    uint32_t combined_k = ((uint32_t)byte4_k << 24) | ((uint32_t)byte3_k << 16) | 
-                         ((uint32_t)byte2_k << 8) | byte1_k;
-    
-    uint8_t byte1_b = (b_val >> 24) & 0xFF;
-    uint8_t byte2_b = (b_val >> 16) & 0xFF;
-    uint8_t byte3_b = (b_val >> 8) & 0xFF;
-    uint8_t byte4_b = b_val & 0xFF;
-    uint32_t combined_b = ((uint32_t)byte4_b << 24) | ((uint32_t)byte3_b << 16) | 
-                         ((uint32_t)byte2_b << 8) | byte1_b;
-    
-    float_converter_t converter;
-    converter.uint_value = combined_k;
-    *k = converter.float_value;
-    
-    converter.uint_value = combined_b;
-    *b = converter.float_value;
+static void extract_temp_and_do_values(const uint8_t *payload, float *temp, 
+                                      float *do_percent, float *do_mgl)
+{
+    *temp = decode_float(payload);
+    *do_percent = decode_float(payload + 4) * 100;
+    *do_mgl = decode_float(payload + 8);
 }
 
 /**
- * @brief Extract single float value from response buffer
+ * @brief Extract calibration values from the response payload
  */
-static void extract_value(uint16_t response_buf[], float *val)
+static void extract_cal_values(const uint8_t *payload, float *k, float *b)
 {
-    uint32_t value = ((uint32_t)response_buf[0] << 16) | response_buf[1];
-    
-    uint8_t byte1 = (value >> 24) & 0xFF;
-    uint8_t byte2 = (value >> 16) & 0xFF;
-    uint8_t byte3 = (value >> 8) & 0xFF;
-    uint8_t byte4 = value & 0xFF;
-    uint32_t combined = ((uint32_t)byte4 << 24) | ((uint32_t)byte3 << 16) | 
-                       ((uint32_t)byte2 << 8) | byte1;
-    
-    float_converter_t converter;
-    converter.uint_value = combined;
-    *val = converter.float_value;
+    *k = decode_float(payload);
+    *b = decode_float(payload + 4);
+}
+
+/**
+ * @brief Extract single float value from the response payload
+ */
+static void extract_value(const uint8_t *payload, float *val)
+{
+    *val = decode_float(payload);
 }
 
 /* ========================================================================
@@ -212,23 +170,26 @@ static uint8_t modbus_do_sensor_init(struct do_sensor_device *sensor, Stream *se
         if (!sensor->priv) return FAIL;
     }
     
+    /* Each device keeps its own node so several slaves can share one UART */
     ModbusMaster *node = (ModbusMaster *)sensor->priv;
-    g_modbus_node = node;
+    const uint8_t *payload = NULL;
+    sensor->slave_id = slave_id;
     
     /* Initialize Modbus */
     node->begin(slave_id, *serial);
+    node->trace(trace_adu);
     
     /* Start measurement */
     get_data_from_sensor(node, reg_start_msrmnt.start_address, 
-                        reg_start_msrmnt.num_registers, reg_start_msrmnt.response_buffer);
+                        reg_start_msrmnt.num_registers, NULL);
     
     /* Get salinity */
     if (sensor->salinity == 0.0f)
     {
         if (get_data_from_sensor(node, reg_salinity.start_address, 
-                                reg_salinity.num_registers, reg_salinity.response_buffer) == SUCCESS)
+                                reg_salinity.num_registers, &payload) == SUCCESS)
         {
-            extract_value(reg_salinity.response_buffer, &sensor->salinity);
+            extract_value(payload, &sensor->salinity);
         }
     }
     
@@ -249,16 +210,17 @@ static uint8_t modbus_do_sensor_read_values(struct do_sensor_device *sensor)
     if (!sensor || !sensor->priv) return FAIL;
     
     ModbusMaster *node = (ModbusMaster *)sensor->priv;
+    const uint8_t *payload = NULL;
     
     int result = get_data_from_sensor(node, reg_temp_do_vals.start_address, 
-                                     reg_temp_do_vals.num_registers, reg_temp_do_vals.response_buffer);
+                                     reg_temp_do_vals.num_registers, &payload);
     
     if (result == SUCCESS)
     {
         float temp_reading, do_reading, do_mgl_reading;
         
         /* Extract values */
-        extract_temp_and_do_values(reg_temp_do_vals.response_buffer, &temp_reading, 
+        extract_temp_and_do_values(payload, &temp_reading, 
                                   &do_reading, &do_mgl_reading);
         
         /* Validate extracted values */
@@ -292,9 +254,9 @@ static uint8_t modbus_do_sensor_read_values(struct do_sensor_device *sensor)
             if (sensor->salinity == 0.0f)
             {
                 if (get_data_from_sensor(node, reg_salinity.start_address, 
-                                        reg_salinity.num_registers, reg_salinity.response_buffer) == SUCCESS)
+                                        reg_salinity.num_registers, &payload) == SUCCESS)
                 {
-                    extract_value(reg_salinity.response_buffer, &sensor->salinity);
+                    extract_value(payload, &sensor->salinity);
                 }
             }
             
@@ -338,7 +300,7 @@ static uint8_t modbus_do_sensor_start_measurement(struct do_sensor_device *senso
     
     ModbusMaster *node = (ModbusMaster *)sensor->priv;
     int result = get_data_from_sensor(node, reg_start_msrmnt.start_address, 
-                                     reg_start_msrmnt.num_registers, reg_start_msrmnt.response_buffer);
+                                     reg_start_msrmnt.num_registers, NULL);
     
     if (result == SUCCESS)
     {
@@ -357,7 +319,7 @@ static uint8_t modbus_do_sensor_stop_measurement(struct do_sensor_device *sensor
     
     ModbusMaster *node = (ModbusMaster *)sensor->priv;
     int result = get_data_from_sensor(node, reg_stop_msrmnt.start_address, 
-                                     reg_stop_msrmnt.num_registers, reg_stop_msrmnt.response_buffer);
+                                     reg_stop_msrmnt.num_registers, NULL);
     
     if (result == SUCCESS)
     {
@@ -374,17 +336,17 @@ static uint8_t modbus_do_sensor_set_calibration(struct do_sensor_device *sensor)
 {
     if (!sensor || !sensor->priv) return FAIL;
     
+    /* A zero or negative slope would blank every reading */
+    if (!(sensor->cal_k > 0.0f) || isinf(sensor->cal_k)) return FAIL;
+    
     ModbusMaster *node = (ModbusMaster *)sensor->priv;
     node->clearTransmitBuffer();
     
-    float k = 100.0 / sensor->do_percent;
-    debugPrintln(sensor->do_percent);
-    debugPrintln(k);
-    
-    uint16_t val1, val2;
-    float_to_hex_le(k, &val1, &val2);
+    debugPrintf("[DoSensor] Writing K: %.5f, B: %.5f\n", sensor->cal_k, sensor->cal_b);
     
-    uint16_t values[4] = {val1, val2, 0, 0};
+    uint16_t values[4];
+    float_to_hex_le(sensor->cal_k, &values[0], &values[1]);
+    float_to_hex_le(sensor->cal_b, &values[2], &values[3]);
     
     for (uint8_t i = 0; i < 4; i++)
     {
@@ -393,7 +355,7 @@ static uint8_t modbus_do_sensor_set_calibration(struct do_sensor_device *sensor)
         node->setTransmitBuffer(i, values[i]);
     }
     
-    uint8_t result = node->writeMultipleRegisters(0x1100, 0x04);
+    uint8_t result = node->writeMultipleRegisters(reg_cal_data.start_address, reg_cal_data.num_registers);
     
     if (result == node->ku8MBSuccess)
     {
@@ -415,11 +377,12 @@ static uint8_t modbus_do_sensor_get_calibration(struct do_sensor_device *sensor)
     if (!sensor || !sensor->priv) return FAIL;
     
     ModbusMaster *node = (ModbusMaster *)sensor->priv;
-    int result = get_data_from_sensor(node, 0x1100, 0x04, reg_cal_data.response_buffer);
+    const uint8_t *payload = NULL;
+    int result = get_data_from_sensor(node, reg_cal_data.start_address, reg_cal_data.num_registers, &payload);
     
     if (result == SUCCESS)
     {
-        extract_cal_values(reg_cal_data.response_buffer, &sensor->cal_k, &sensor->cal_b);
+        extract_cal_values(payload, &sensor->cal_k, &sensor->cal_b);
         debugPrintf("[DoSensor] K: %.2f, B: %.2f\n", sensor->cal_k, sensor->cal_b);
         return SUCCESS;
     }
@@ -470,12 +433,13 @@ static uint8_t modbus_do_sensor_get_salinity(struct do_sensor_device *sensor)
     if (!sensor || !sensor->priv) return FAIL;
     
     ModbusMaster *node = (ModbusMaster *)sensor->priv;
+    const uint8_t *payload = NULL;
     int result = get_data_from_sensor(node, reg_salinity.start_address, 
-                                     reg_salinity.num_registers, reg_salinity.response_buffer);
+                                     reg_salinity.num_registers, &payload);
     
     if (result == SUCCESS)
     {
-        extract_value(reg_salinity.response_buffer, &sensor->salinity);
+        extract_value(payload, &sensor->salinity);
         debugPrintf("[DoSensor] Salinity: %.2f\n", sensor->salinity);
         return SUCCESS;
     }
@@ -526,12 +490,13 @@ static uint8_t modbus_do_sensor_get_pressure(struct do_sensor_device *sensor)
     if (!sensor || !sensor->priv) return FAIL;
     
     ModbusMaster *node = (ModbusMaster *)sensor->priv;
+    const uint8_t *payload = NULL;
     int result = get_data_from_sensor(node, reg_pressure.start_address, 
-                                     reg_pressure.num_registers, reg_pressure.response_buffer);
+                                     reg_pressure.num_registers, &payload);
     
     if (result == SUCCESS)
     {
-        extract_value(reg_pressure.response_buffer, &sensor->pressure);
+        extract_value(payload, &sensor->pressure);
         debugPrintf("[DoSensor] Pressure: %.2f\n", sensor->pressure);
         return SUCCESS;
     }
@@ -547,7 +512,7 @@ static uint8_t modbus_do_sensor_get_serial_number(struct do_sensor_device *senso
     
     ModbusMaster *node = (ModbusMaster *)sensor->priv;
     int result = get_data_from_sensor(node, reg_serial_num.start_address, 
-                                     reg_serial_num.num_registers, reg_serial_num.response_buffer);
+                                     reg_serial_num.num_registers, NULL);
     
     if (result == SUCCESS)
     {
@@ -52,7 +52,6 @@ struct do_sensor_device;
 typedef struct {
     uint16_t start_address;      /**< Modbus register start address */
     uint16_t num_registers;      /**< Number of registers to read/write */
-    uint16_t response_buffer[10]; /**< Buffer for Modbus response */
 } do_sensor_register_t;
 
 /**
@@ -96,9 +95,9 @@ struct do_sensor_ops {
      *  @return 1 on success, 0 on failure */
     uint8_t (*stop_measurement)(struct do_sensor_device *sensor);
     
-    /** @brief Set calibration values
+    /** @brief Write sensor->cal_k and sensor->cal_b to the sensor
      *  @param sensor Device structure
-     *  @return 1 on success, 0 on failure */
+     *  @return 1 on success, 0 on failure or if cal_k is not positive */
     uint8_t (*set_calibration)(struct do_sensor_device *sensor);
     
     /** @brief Get calibration values
@@ -165,6 +164,7 @@ struct do_sensor_device {
     float cal_k;                        /**< Calibration K value */
     float cal_b;                        /**< Calibration B value */
     char serial_number[15];             /**< Sensor serial number */
+    uint8_t slave_id;                   /**< Modbus slave ID on the RS-485 bus */
     
     /* State flags */
     uint8_t is_initialized;             /**< 1 if sensor is initialized */
@@ -225,9 +225,9 @@ uint8_t do_sensor_start_measurement(struct do_sensor_device *sensor);
 uint8_t do_sensor_stop_measurement(struct do_sensor_device *sensor);
 
 /**
- * @brief Set calibration values
+ * @brief Write the calibration in sensor->cal_k / sensor->cal_b
  * @param sensor Pointer to sensor device structure
- * @return 1 on success, 0 on failure
+ * @return 1 on success, 0 on failure or if cal_k is not positive
  */
 uint8_t do_sensor_set_calibration(struct do_sensor_device *sensor);
 
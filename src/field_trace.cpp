@@ -0,0 +1,323 @@
+/**
+ * @file field_trace.cpp
+ * @brief Field trace recorder Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "field_trace.h"
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <stdio.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+#define RECORD_OVERHEAD 8               /* Type, dt (5 bytes max), len (2 bytes max) */
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t *s_buf[2];
+static uint16_t s_used[2];
+static int64_t s_base[2];
+static uint16_t s_dropped[2];
+static uint8_t s_fill;                  /* Buffer producers append to */
+static volatile uint8_t s_ready;        /* The other buffer waits for the App task */
+static volatile uint8_t s_enabled;
+static int64_t s_last_us;
+static uint16_t s_lost;                 /* Dropped since the last swap */
+
+static uint32_t s_seq;
+static uint8_t s_segment;
+static uint32_t s_segment_bytes;
+static struct field_trace_stats s_stats;
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+static IRAM_ATTR uint8_t *put_varint(uint8_t *p, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+/**
+ * @brief Hand the buffer being filled to the App task, called with the lock held
+ */
+static IRAM_ATTR void swap_buffers(void)
+{
+    s_ready = 1;
+    s_fill ^= 1;
+    s_used[s_fill] = 0;
+    s_base[s_fill] = s_last_us;
+    s_dropped[s_fill] = s_lost;
+    s_lost = 0;
+}
+
+static void segment_path(char *path, size_t len, uint8_t segment)
+{
+    snprintf(path, len, FIELD_TRACE_PATH_FMT, (unsigned)segment);
+}
+
+/**
+ * @brief Highest block seq in a segment, walking the headers up to a torn block
+ */
+static uint8_t segment_last_seq(uint8_t segment, uint32_t *seq)
+{
+    char path[20];
+    segment_path(path, sizeof(path), segment);
+    File file = SPIFFS.open(path, FILE_READ);
+    if (!file || file.isDirectory()) return FAIL;
+
+    size_t size = file.size();
+    size_t pos = 0;
+    uint8_t found = FAIL;
+    struct field_trace_block hdr;
+    while (pos + sizeof(hdr) <= size && file.seek(pos) &&
+           (size_t)file.read((uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == FIELD_TRACE_MAGIC)
+    {
+        if (!found || (int32_t)(hdr.seq - *seq) > 0) *seq = hdr.seq;
+        found = SUCCESS;
+        pos += sizeof(hdr) + hdr.len;
+    }
+    file.close();
+    return found;
+}
+
+/**
+ * @brief Append one block to the current segment, moving on when it is full
+ */
+static uint8_t write_block(const uint8_t *data, uint16_t len, int64_t base_us, uint16_t dropped)
+{
+    struct field_trace_block hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = FIELD_TRACE_MAGIC;
+    hdr.seq = s_seq;
+    hdr.base_us = base_us;
+    hdr.len = len;
+    hdr.dropped = dropped;
+
+    const char *mode = FILE_APPEND;
+    if (s_segment_bytes + sizeof(hdr) + len > FIELD_TRACE_SEGMENT_SIZE)
+    {
+        s_segment = (s_segment + 1) % FIELD_TRACE_SEGMENTS;
+        s_segment_bytes = 0;
+    }
+    if (s_segment_bytes == 0) mode = FILE_WRITE;
+
+    char path[20];
+    segment_path(path, sizeof(path), s_segment);
+    File file = SPIFFS.open(path, mode);
+    if (!file) return FAIL;
+    uint8_t ok = file.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+                 file.write(data, len) == len;
+    file.close();
+
+    /* Whatever made it to flash counts, the next start skips a torn block */
+    s_segment_bytes += sizeof(hdr) + len;
+    s_seq++;
+    return ok ? SUCCESS : FAIL;
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void field_trace_init(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_enabled = 0;
+    s_ready = 0;
+    s_fill = 0;
+    s_used[0] = s_used[1] = 0;
+    s_lost = 0;
+    portEXIT_CRITICAL(&s_lock);
+    memset(&s_stats, 0, sizeof(s_stats));
+}
+
+uint8_t field_trace_start(void)
+{
+    if (s_enabled) return SUCCESS;
+
+    uint8_t *a = (uint8_t *)malloc(FIELD_TRACE_BUF_SIZE);
+    uint8_t *b = (uint8_t *)malloc(FIELD_TRACE_BUF_SIZE);
+    if (!a || !b)
+    {
+        free(a);
+        free(b);
+        return FAIL;
+    }
+
+    /* Carry on in a fresh segment after the newest block, a reset may have torn the last one */
+    uint32_t newest = 0;
+    uint8_t found = 0;
+    s_segment = FIELD_TRACE_SEGMENTS - 1;
+    for (uint8_t i = 0; i < FIELD_TRACE_SEGMENTS; i++)
+    {
+        uint32_t seq = 0;
+        if (segment_last_seq(i, &seq) && (!found || (int32_t)(seq - newest) > 0))
+        {
+            newest = seq;
+            s_segment = i;
+            found = 1;
+        }
+    }
+    s_seq = found ? newest + 1 : 0;
+    s_segment_bytes = FIELD_TRACE_SEGMENT_SIZE;
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    portENTER_CRITICAL(&s_lock);
+    s_buf[0] = a;
+    s_buf[1] = b;
+    s_fill = 0;
+    s_used[0] = s_used[1] = 0;
+    s_ready = 0;
+    s_lost = 0;
+    s_last_us = esp_timer_get_time();
+    s_base[0] = s_last_us;
+    s_dropped[0] = 0;
+    s_enabled = 1;
+    portEXIT_CRITICAL(&s_lock);
+    debugPrintf("[FieldTrace] start at segment %u, seq %u\n", (unsigned)((s_segment + 1) % FIELD_TRACE_SEGMENTS), (unsigned)s_seq);
+    return SUCCESS;
+}
+
+void field_trace_stop(void)
+{
+    if (!s_enabled) return;
+
+    portENTER_CRITICAL(&s_lock);
+    s_enabled = 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    /* The waiting buffer first, then the one that was being filled */
+    field_trace_flush(0);
+    field_trace_flush(1);
+
+    portENTER_CRITICAL(&s_lock);
+    uint8_t *a = s_buf[0];
+    uint8_t *b = s_buf[1];
+    s_buf[0] = s_buf[1] = NULL;
+    portEXIT_CRITICAL(&s_lock);
+    free(a);
+    free(b);
+    debugPrintf("[FieldTrace] stop, %u records, %u dropped\n", (unsigned)s_stats.records, (unsigned)s_stats.dropped);
+}
+
+uint8_t field_trace_enabled(void)
+{
+    return s_enabled;
+}
+
+void IRAM_ATTR field_trace_record(uint8_t type, const void *data, size_t len)
+{
+    if (!s_enabled) return;
+    if (len > FIELD_TRACE_MAX_PAYLOAD) len = FIELD_TRACE_MAX_PAYLOAD;
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+    if (!s_enabled)
+    {
+        portEXIT_CRITICAL_SAFE(&s_lock);
+        return;
+    }
+    if (s_used[s_fill] + RECORD_OVERHEAD + len > FIELD_TRACE_BUF_SIZE)
+    {
+        if (s_ready)
+        {
+            s_lost++;
+            s_stats.dropped++;
+            portEXIT_CRITICAL_SAFE(&s_lock);
+            return;
+        }
+        swap_buffers();
+    }
+
+    int64_t dt = now - s_last_us;
+    if (dt < 0) dt = 0;
+    if (dt > UINT32_MAX) dt = UINT32_MAX;
+    uint8_t *p = s_buf[s_fill] + s_used[s_fill];
+    *p++ = type;
+    p = put_varint(p, (uint32_t)dt);
+    p = put_varint(p, (uint32_t)len);
+    if (len) memcpy(p, data, len);
+    p += len;
+    s_used[s_fill] = (uint16_t)(p - s_buf[s_fill]);
+    if (now > s_last_us) s_last_us = now;
+    s_stats.records++;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+uint8_t field_trace_flush(uint8_t force)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&s_lock);
+    if (!s_buf[0])
+    {
+        portEXIT_CRITICAL(&s_lock);
+        return SUCCESS;
+    }
+    if (!s_ready && s_used[s_fill] && (force || now - s_base[s_fill] >= (int64_t)FIELD_TRACE_FLUSH_MS * 1000))
+        swap_buffers();
+    uint8_t ready = s_ready;
+    uint8_t idx = s_fill ^ 1;
+    portEXIT_CRITICAL(&s_lock);
+    if (!ready) return SUCCESS;
+
+    /* Producers only touch the other buffer until s_ready drops */
+    uint8_t ok = write_block(s_buf[idx], s_used[idx], s_base[idx], s_dropped[idx]);
+    if (ok)
+        s_stats.blocks++;
+    else
+        s_stats.errors++;
+
+    portENTER_CRITICAL(&s_lock);
+    s_ready = 0;
+    portEXIT_CRITICAL(&s_lock);
+    return ok;
+}
+
+uint8_t field_trace_erase(void)
+{
+    /* The buffers stay until field_trace_stop() has written them */
+    if (s_enabled || s_buf[0]) return FAIL;
+
+    char path[20];
+    for (uint8_t i = 0; i < FIELD_TRACE_SEGMENTS; i++)
+    {
+        segment_path(path, sizeof(path), i);
+        SPIFFS.remove(path);
+    }
+    return SUCCESS;
+}
+
+void field_trace_get_stats(struct field_trace_stats *out)
+{
+    if (!out) return;
+
+    portENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    out->enabled = s_enabled;
+    out->segment = s_segment;
+    portEXIT_CRITICAL(&s_lock);
+}
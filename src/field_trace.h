@@ -0,0 +1,170 @@
+/**
+ * @file field_trace.h
+ * @brief Field trace recorder: raw inputs and link results in a bounded SPIFFS ring
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * A wrong pond, a slow capture or a lost frame in the field cannot be
+ * reproduced in the office. When enabled (setFieldTrace RPC) the device
+ * records what went into the pipelines, with microsecond timestamps:
+ * raw GPS receiver bytes, Modbus request and response ADUs, button edges,
+ * uplink results and the pond each lookup settled on.
+ *
+ * Producers append records to one of two RAM buffers under a spinlock; no
+ * flash access happens on their path. The App task writes a buffer once it
+ * is full or FIELD_TRACE_FLUSH_MS old, so a reset loses a few seconds at
+ * most. When both buffers are busy a record is dropped and counted.
+ *
+ * @par On flash:
+ * @code
+ * "/trace_0.bin" .. "/trace_3.bin"      ring, oldest segment overwritten
+ * segment:  block ...
+ * block:    field_trace_block | record ...  (len bytes)
+ * record:   type | varint dt_us | varint len | payload
+ * @endcode
+ * dt_us is the time since the previous record of the block, the first one
+ * is relative to base_us (esp_timer). Blocks carry an increasing seq, so
+ * the ring is read back in order whichever segment is current. The small
+ * varint deltas and the repetitive NMEA/ADU payloads deflate well before
+ * the files go out through getFileChunk.
+ *
+ * The ring holds FIELD_TRACE_SEGMENTS x FIELD_TRACE_SEGMENT_SIZE bytes:
+ * about a minute of NMEA at 9600 baud, several minutes with UBX NAV-PVT.
+ * Stop the recording soon after the problem, then fetch the segments.
+ *
+ * Recording costs a timer read, a copy of the payload and a spinlock per
+ * record; the flash writes are one append per 4 KB. field_trace_record()
+ * is in IRAM and safe to call from an ISR. Start, stop, flush and erase
+ * touch flash and belong to one task (the App task).
+ *
+ * @par Usage Pattern:
+ * @code
+ * field_trace_init();
+ * if (enabledInNvs) field_trace_start();
+ *
+ * field_trace_record(FIELD_TRACE_GPS, bytes, n);   // any task or ISR
+ * field_trace_flush(0);                            // App task, every tick
+ *
+ * field_trace_stop();                              // flushes the rest
+ * @endcode
+ */
+
+#ifndef FIELD_TRACE_H
+#define FIELD_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FIELD_TRACE_PATH_FMT "/trace_%u.bin"
+#define FIELD_TRACE_SEGMENTS 4
+#define FIELD_TRACE_SEGMENT_SIZE 12288  /**< Ring of 48 KB in total */
+#define FIELD_TRACE_BUF_SIZE 4096       /**< Each of the two RAM buffers, allocated while recording */
+#define FIELD_TRACE_FLUSH_MS 5000       /**< Longest a record waits in RAM */
+#define FIELD_TRACE_MAX_PAYLOAD 255     /**< Longer payloads are cut */
+#define FIELD_TRACE_MAGIC 0x31544657u   /**< "WFT1" */
+
+/**
+ * @brief Record types
+ */
+enum field_trace_type {
+    FIELD_TRACE_GPS = 1,                /**< Receiver bytes as read, NMEA or UBX */
+    FIELD_TRACE_MODBUS_TX,              /**< Request ADU with CRC */
+    FIELD_TRACE_MODBUS_RX,              /**< Response ADU as received, empty on a timeout */
+    FIELD_TRACE_BUTTON,                 /**< 1 pressed, 0 released */
+    FIELD_TRACE_UPLINK,                 /**< struct field_trace_uplink */
+    FIELD_TRACE_POND                    /**< Confidence byte, then the pond name (empty outside) */
+};
+
+/**
+ * @brief Block header, one per RAM buffer written
+ */
+struct field_trace_block {
+    uint32_t magic;
+    uint32_t seq;                       /**< Increasing across the ring and reboots */
+    int64_t base_us;                    /**< Time the first record's dt is relative to */
+    uint16_t len;                       /**< Record bytes following the header */
+    uint16_t dropped;                   /**< Records lost just before this block */
+    uint32_t reserved;
+};
+
+/**
+ * @brief Payload of FIELD_TRACE_UPLINK
+ */
+struct field_trace_uplink {
+    uint8_t transport;                  /**< FRAME_TRANSPORT_* */
+    uint8_t ok;                         /**< Acked by the server */
+    uint16_t frames;                    /**< 1 live, up to FRAME_UPLINK_BATCH_MAX from backup */
+    uint32_t duration_ms;
+};
+
+/**
+ * @brief Recorder figures for the RPC reply
+ */
+struct field_trace_stats {
+    uint8_t enabled;
+    uint8_t segment;                    /**< Segment being written */
+    uint32_t records;                   /**< Since start */
+    uint32_t dropped;                   /**< Since start, both buffers were busy */
+    uint32_t blocks;                    /**< Written since start */
+    uint32_t errors;                    /**< Blocks the flash write lost */
+};
+
+/**
+ * @brief Clear the state; nothing is recorded until field_trace_start()
+ */
+void field_trace_init(void);
+
+/**
+ * @brief Allocate the buffers and continue the ring after its newest block
+ * @return SUCCESS (1), FAIL (0) if out of memory
+ */
+uint8_t field_trace_start(void);
+
+/**
+ * @brief Stop recording, write what is buffered and free the buffers
+ */
+void field_trace_stop(void);
+
+/**
+ * @brief Whether a recording runs
+ * @return 1 if records are kept
+ */
+uint8_t field_trace_enabled(void);
+
+/**
+ * @brief Append one record; returns at once when not recording
+ * @param type FIELD_TRACE_*
+ * @param data Payload
+ * @param len Payload bytes, cut at FIELD_TRACE_MAX_PAYLOAD
+ */
+void field_trace_record(uint8_t type, const void *data, size_t len);
+
+/**
+ * @brief Write a full buffer, or one older than FIELD_TRACE_FLUSH_MS
+ * @param force Write the buffer being filled too
+ * @return SUCCESS (1), FAIL (0) on a flash error
+ */
+uint8_t field_trace_flush(uint8_t force);
+
+/**
+ * @brief Delete the ring; only once field_trace_stop() has returned
+ * @return SUCCESS (1), FAIL (0) if a recording runs
+ */
+uint8_t field_trace_erase(void);
+
+/**
+ * @brief Read the recorder figures
+ * @param out Output
+ */
+void field_trace_get_stats(struct field_trace_stats *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FIELD_TRACE_H */
@@ -0,0 +1,227 @@
+/**
+ * @file frame_uplink.cpp
+ * @brief Data frame upload over the open Socket.IO link Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "frame_uplink.h"
+#include "app_events.h"
+#include <Arduino.h>
+#include <mjson.h>
+#include <stdio.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+/**
+ * @brief Bytes needed to close the event: "]" for a single frame, "]]" for a batch
+ */
+static size_t closing_len(const struct frame_uplink *u)
+{
+    return u->batch ? 2 : 1;
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void frame_uplink_init(struct frame_uplink *u)
+{
+    if (!u) return;
+
+    memset(u, 0, sizeof(struct frame_uplink));
+    u->lock = portMUX_INITIALIZER_UNLOCKED;
+    u->next_id = 1;
+}
+
+void frame_uplink_set_link(struct frame_uplink *u, uint8_t up)
+{
+    if (!u) return;
+
+    portENTER_CRITICAL(&u->lock);
+    u->link_up = up;
+    bool dropped = !up && (u->state == FRAME_UPLINK_PENDING || u->state == FRAME_UPLINK_AWAIT_ACK);
+    if (dropped) u->state = FRAME_UPLINK_FAILED;
+    portEXIT_CRITICAL(&u->lock);
+    if (dropped) app_events_signal(APP_EV_UPLINK_DONE);
+}
+
+uint8_t frame_uplink_link_up(struct frame_uplink *u)
+{
+    return u ? u->link_up : 0;
+}
+
+uint8_t frame_uplink_open(struct frame_uplink *u, const char *event, uint8_t batch)
+{
+    if (!u || !event) return FAIL;
+
+    portENTER_CRITICAL(&u->lock);
+    bool free_box = (u->state == FRAME_UPLINK_IDLE);
+    if (free_box)
+    {
+        u->state = FRAME_UPLINK_FILLING;
+        u->ack_id = u->next_id++;
+        if (u->next_id == 0) u->next_id = 1;
+    }
+    portEXIT_CRITICAL(&u->lock);
+    if (!free_box) return FAIL;
+
+    u->batch = batch;
+    u->frames = 0;
+    int n = snprintf(u->buf, sizeof(u->buf), "%lu[\"%s\",%s",
+                     (unsigned long)u->ack_id, event, batch ? "[" : "");
+    u->len = (size_t)n;
+    return SUCCESS;
+}
+
+uint8_t frame_uplink_append(struct frame_uplink *u, const char *frame, size_t len)
+{
+    if (!u || !frame || u->state != FRAME_UPLINK_FILLING) return FAIL;
+    if (!u->batch && u->frames) return FAIL;
+
+    size_t sep = u->frames ? 1 : 0;
+    if (u->len + sep + len + closing_len(u) > sizeof(u->buf))
+    {
+        return FAIL;
+    }
+    if (sep) u->buf[u->len++] = ',';
+    memcpy(u->buf + u->len, frame, len);
+    u->len += len;
+    u->frames++;
+    return SUCCESS;
+}
+
+uint8_t frame_uplink_frames(struct frame_uplink *u)
+{
+    return u ? u->frames : 0;
+}
+
+void frame_uplink_discard(struct frame_uplink *u)
+{
+    if (!u || u->state != FRAME_UPLINK_FILLING) return;
+
+    portENTER_CRITICAL(&u->lock);
+    u->state = FRAME_UPLINK_IDLE;
+    portEXIT_CRITICAL(&u->lock);
+}
+
+uint8_t frame_uplink_transmit(struct frame_uplink *u, uint32_t timeout_ms)
+{
+    if (!u || u->state != FRAME_UPLINK_FILLING) return FAIL;
+    if (!u->frames)
+    {
+        frame_uplink_discard(u);
+        return FAIL;
+    }
+
+    /* append() kept room for the closing brackets */
+    if (u->batch) u->buf[u->len++] = ']';
+    u->buf[u->len++] = ']';
+
+    portENTER_CRITICAL(&u->lock);
+    u->state = u->link_up ? FRAME_UPLINK_PENDING : FRAME_UPLINK_FAILED;
+    portEXIT_CRITICAL(&u->lock);
+    app_events_signal(APP_EV_LINK_TX);
+
+    /* Sleep until the App task resolves the event; a stale wake-up from an
+     * earlier event only costs one more look at the state */
+    uint32_t start = millis();
+    uint8_t state;
+    for (;;)
+    {
+        state = u->state;
+        if (state == FRAME_UPLINK_ACKED || state == FRAME_UPLINK_FAILED) break;
+        uint32_t waited = millis() - start;
+        if (waited >= timeout_ms) break;
+        app_events_wait(APP_EV_UPLINK_DONE, timeout_ms - waited);
+    }
+
+    portENTER_CRITICAL(&u->lock);
+    state = u->state;
+    /* A send still in progress owns the buffer; service() frees it after */
+    u->state = (state == FRAME_UPLINK_SENDING) ? FRAME_UPLINK_CANCELLED : FRAME_UPLINK_IDLE;
+    portEXIT_CRITICAL(&u->lock);
+
+    if (state == FRAME_UPLINK_ACKED)
+    {
+        u->acked++;
+        return SUCCESS;
+    }
+    if (state == FRAME_UPLINK_FAILED)
+    {
+        u->failed++;
+    }
+    else
+    {
+        u->timeouts++;
+    }
+    debugPrintf("[Uplink] event %lu not acked (state %u)\n", (unsigned long)u->ack_id, state);
+    return FAIL;
+}
+
+void frame_uplink_service(struct frame_uplink *u, frame_uplink_send_fn send)
+{
+    if (!u || !send || u->state != FRAME_UPLINK_PENDING) return;
+
+    portENTER_CRITICAL(&u->lock);
+    bool take = (u->state == FRAME_UPLINK_PENDING);
+    if (take) u->state = FRAME_UPLINK_SENDING;
+    portEXIT_CRITICAL(&u->lock);
+    if (!take) return;
+
+    uint8_t sent = send(u->buf, u->len);
+    debugPrintf("[Uplink] event %lu sent %u, %u bytes\n", (unsigned long)u->ack_id, sent, (unsigned)u->len);
+
+    portENTER_CRITICAL(&u->lock);
+    if (u->state == FRAME_UPLINK_CANCELLED)
+        u->state = FRAME_UPLINK_IDLE;
+    else if (u->state == FRAME_UPLINK_SENDING)
+        u->state = sent ? FRAME_UPLINK_AWAIT_ACK : FRAME_UPLINK_FAILED;
+    bool done = (u->state == FRAME_UPLINK_FAILED);
+    portEXIT_CRITICAL(&u->lock);
+    if (done) app_events_signal(APP_EV_UPLINK_DONE);
+}
+
+void frame_uplink_on_ack(struct frame_uplink *u, const char *payload, size_t len)
+{
+    if (!u || !payload) return;
+
+    uint32_t id = 0;
+    size_t i = 0;
+    while (i < len && payload[i] >= '0' && payload[i] <= '9')
+    {
+        id = id * 10 + (uint32_t)(payload[i] - '0');
+        i++;
+    }
+    if (i == 0) return;
+
+    /* Ack arguments: [{"statusCode":200,...}] or [] */
+    double status = 200;
+    mjson_get_number(payload + i, (int)(len - i), "$[0].statusCode", &status);
+
+    portENTER_CRITICAL(&u->lock);
+    bool done = (u->state == FRAME_UPLINK_AWAIT_ACK && id == u->ack_id);
+    if (done)
+    {
+        u->state = ((int)status == 200) ? FRAME_UPLINK_ACKED : FRAME_UPLINK_FAILED;
+    }
+    portEXIT_CRITICAL(&u->lock);
+    if (done) app_events_signal(APP_EV_UPLINK_DONE);
+}
@@ -0,0 +1,182 @@
+/**
+ * @file frame_uplink.h
+ * @brief Data frame upload over the open Socket.IO link, with acks
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Frames and backup batches are sent as Socket.IO events carrying an ack id
+ * (42<id>["doReading",{...}] / 42<id>["doReadings",[{...},...]]); the server
+ * answers 43<id>[{...}]. No TCP or HTTP handshake per frame.
+ *
+ * The Socket.IO client belongs to the App task, uploads come from the Frame
+ * task. The uplink is a one-event mailbox between the two:
+ *
+ * - Frame task: frame_uplink_open() / _append() / _transmit(); transmit
+ *   wakes the App task (APP_EV_LINK_TX) and sleeps until the ack, a NACK, a
+ *   link drop or the timeout.
+ * - App task: frame_uplink_service() sends a pending event,
+ *   frame_uplink_on_ack() / frame_uplink_set_link() resolve it and wake the
+ *   Frame task (APP_EV_UPLINK_DONE).
+ *
+ * The caller picks the transport per frame: the socket when the mode allows
+ * it and frame_uplink_link_up() is true, HTTP otherwise. A live frame the
+ * socket does not confirm (mailbox busy, send error, NACK, no ack) is posted
+ * over HTTP before it goes to backup. After a lost ack the server may see
+ * it twice, as it already could from the backup upload.
+ *
+ * @par Usage Pattern:
+ * @code
+ * // Frame task
+ * if (frame_uplink_open(&g_frameUplink, FRAME_UPLINK_EVENT_SINGLE, 0) &&
+ *     frame_uplink_append(&g_frameUplink, frame, len))
+ *     ok = frame_uplink_transmit(&g_frameUplink, FRAME_UPLINK_ACK_TIMEOUT_MS);
+ *
+ * // App task, on APP_EV_LINK_TX and every tick
+ * frame_uplink_service(&g_frameUplink, send_fn);
+ * @endcode
+ */
+
+#ifndef FRAME_UPLINK_H
+#define FRAME_UPLINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRAME_TRANSPORT_HTTP 0          /**< Every frame as an HTTP POST, the default */
+#define FRAME_TRANSPORT_SOCKET 1        /**< Socket.IO when connected, HTTP otherwise */
+
+#define FRAME_UPLINK_EVENT_SINGLE "doReading"
+#define FRAME_UPLINK_EVENT_BATCH "doReadings"
+
+#define FRAME_UPLINK_BUF_SIZE 4608      /**< Envelope + one frame or a backup batch */
+#define FRAME_UPLINK_BATCH_MAX 4        /**< Backup frames per event */
+#define FRAME_UPLINK_ACK_TIMEOUT_MS 3000
+
+/**
+ * @brief Mailbox state
+ */
+typedef enum {
+    FRAME_UPLINK_IDLE = 0,
+    FRAME_UPLINK_FILLING,               /**< Frame task writing the event */
+    FRAME_UPLINK_PENDING,               /**< Waiting for the App task to send */
+    FRAME_UPLINK_SENDING,               /**< App task inside the send call */
+    FRAME_UPLINK_AWAIT_ACK,
+    FRAME_UPLINK_ACKED,
+    FRAME_UPLINK_FAILED,                /**< NACK, send error or link drop */
+    FRAME_UPLINK_CANCELLED              /**< Waiter gave up while sending */
+} frame_uplink_state_t;
+
+/**
+ * @struct frame_uplink
+ * @brief One in-flight event plus link state and counters
+ */
+struct frame_uplink {
+    portMUX_TYPE lock;                  /**< Guards state, ids and link flag */
+    volatile uint8_t state;             /**< frame_uplink_state_t */
+    volatile uint8_t link_up;           /**< Socket.IO namespace joined */
+    uint8_t batch;                      /**< Event carries an array */
+    uint8_t frames;                     /**< Frames appended so far */
+    uint32_t next_id;
+    uint32_t ack_id;                    /**< Id of the event in flight */
+
+    uint32_t acked;                     /**< Events confirmed by the server */
+    uint32_t failed;                    /**< NACKs, send errors, link drops */
+    uint32_t timeouts;                  /**< No ack within the wait */
+
+    size_t len;
+    char buf[FRAME_UPLINK_BUF_SIZE];
+};
+
+/**
+ * @brief Send callback, returns 1 once the link took the bytes
+ */
+typedef uint8_t (*frame_uplink_send_fn)(const char *data, size_t len);
+
+/**
+ * @brief Initialize an idle uplink with the link down
+ * @param u Pointer to uplink structure
+ */
+void frame_uplink_init(struct frame_uplink *u);
+
+/**
+ * @brief Record link state; a drop fails the event in flight
+ * @param u Pointer to uplink structure
+ * @param up 1 when connected, 0 when disconnected
+ */
+void frame_uplink_set_link(struct frame_uplink *u, uint8_t up);
+
+/**
+ * @brief Whether frames can go over the socket right now
+ * @param u Pointer to uplink structure
+ * @return 1 if connected, 0 otherwise
+ */
+uint8_t frame_uplink_link_up(struct frame_uplink *u);
+
+/**
+ * @brief Start a new event in the mailbox
+ * @param u Pointer to uplink structure
+ * @param event Event name
+ * @param batch 1 to send the frames as an array, 0 for a single frame
+ * @return SUCCESS (1) if the mailbox was free, FAIL (0) otherwise
+ */
+uint8_t frame_uplink_open(struct frame_uplink *u, const char *event, uint8_t batch);
+
+/**
+ * @brief Append one serialized frame to the open event
+ * @param u Pointer to uplink structure
+ * @param frame JSON object
+ * @param len Length of frame
+ * @return SUCCESS (1) if it fit, FAIL (0) otherwise (event left unchanged)
+ */
+uint8_t frame_uplink_append(struct frame_uplink *u, const char *frame, size_t len);
+
+/**
+ * @brief Number of frames in the open event
+ * @param u Pointer to uplink structure
+ * @return Frame count
+ */
+uint8_t frame_uplink_frames(struct frame_uplink *u);
+
+/**
+ * @brief Drop the open event without sending it
+ * @param u Pointer to uplink structure
+ */
+void frame_uplink_discard(struct frame_uplink *u);
+
+/**
+ * @brief Hand the event to the App task and wait for the server
+ * @param u Pointer to uplink structure
+ * @param timeout_ms Longest wait for the ack
+ * @return SUCCESS (1) when acked, FAIL (0) otherwise
+ */
+uint8_t frame_uplink_transmit(struct frame_uplink *u, uint32_t timeout_ms);
+
+/**
+ * @brief Send a pending event, App task only
+ * @param u Pointer to uplink structure
+ * @param send Link send callback
+ */
+void frame_uplink_service(struct frame_uplink *u, frame_uplink_send_fn send);
+
+/**
+ * @brief Resolve the event in flight from a Socket.IO ack, App task only
+ *
+ * Any ack whose payload carries a statusCode other than 200 is a NACK.
+ *
+ * @param u Pointer to uplink structure
+ * @param payload Ack payload, "<id>[...]"
+ * @param len Length of payload
+ */
+void frame_uplink_on_ack(struct frame_uplink *u, const char *payload, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_UPLINK_H */
@@ -87,6 +87,21 @@ static position_t closest_point_on_segment(position_t A, position_t B, position_
     return closest;
 }
 
+/**
+ * @brief Fold one polygon edge into a scan: ray crossing and edge distance
+ */
+static void scan_edge(struct geofence_scan *scan, position_t A, position_t B)
+{
+    position_t P = scan->point;
+    if (((A.lng > P.lng) != (B.lng > P.lng)) &&
+        (P.lat < (B.lat - A.lat) * (P.lng - A.lng) / (B.lng - A.lng) + A.lat))
+        scan->inside = !scan->inside;
+
+    double d = haversine(P, closest_point_on_segment(A, B, P));
+    if (d < scan->min_dist)
+        scan->min_dist = d;
+}
+
 /* ========================================================================
  * STANDARD GEOFENCE OPERATIONS IMPLEMENTATION
  * ======================================================================== */
@@ -295,6 +310,41 @@ double geofence_distance_to_segment(struct geofence_device *geofence, position_t
     return geofence->ops->distance_to_segment(geofence, point, p1, p2, closest_point);
 }
 
+void geofence_scan_begin(struct geofence_scan *scan, position_t point)
+{
+    if (!scan) return;
+
+    memset(scan, 0, sizeof(struct geofence_scan));
+    scan->point = point;
+    scan->min_dist = 1e12;
+}
+
+void geofence_scan_add(struct geofence_scan *scan, position_t vertex)
+{
+    if (!scan) return;
+
+    if (scan->count)
+        scan_edge(scan, scan->prev, vertex);
+    else
+        scan->first = vertex;
+    scan->prev = vertex;
+    scan->count++;
+}
+
+double geofence_scan_end(struct geofence_scan *scan)
+{
+    if (!scan || scan->count < 3) return -1.0;
+
+    scan_edge(scan, scan->prev, scan->first);
+    return scan->inside ? 0 : scan->min_dist;
+}
+
+double geofence_scan_edge_distance(const struct geofence_scan *scan)
+{
+    if (!scan) return 0;
+    return scan->inside ? -scan->min_dist : scan->min_dist;
+}
+
 void geofence_cleanup(struct geofence_device *geofence)
 {
     if (!geofence) return;
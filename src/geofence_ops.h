@@ -136,6 +136,23 @@ struct geofence_device {
     uint8_t is_initialized;             /**< 1 if device is initialized */
 };
 
+/**
+ * @struct geofence_scan
+ * @brief Boundary test fed one vertex at a time
+ *
+ * @details
+ * Same result as geofence_distance_to_boundary() without holding the polygon
+ * in memory, for boundaries streamed from flash.
+ */
+struct geofence_scan {
+    position_t point;                   /**< Position being tested */
+    position_t first;                   /**< First vertex, closes the polygon */
+    position_t prev;
+    int count;                          /**< Vertices seen */
+    int inside;                         /**< Ray crossings parity so far */
+    double min_dist;                    /**< Nearest edge so far, meters */
+};
+
 /* Standard Geofence Operations - exported for registration */
 extern const struct geofence_ops standard_geofence_ops;
 
@@ -204,6 +221,34 @@ double geofence_distance(struct geofence_device *geofence, position_t p1, positi
 double geofence_distance_to_segment(struct geofence_device *geofence, position_t point, 
                                     position_t p1, position_t p2, position_t *closest_point);
 
+/**
+ * @brief Start a vertex-by-vertex boundary test
+ * @param scan Pointer to scan state
+ * @param point Current position
+ */
+void geofence_scan_begin(struct geofence_scan *scan, position_t point);
+
+/**
+ * @brief Add the next boundary vertex
+ * @param scan Pointer to scan state
+ * @param vertex Boundary point, in polygon order
+ */
+void geofence_scan_add(struct geofence_scan *scan, position_t vertex);
+
+/**
+ * @brief Close the polygon and get the result
+ * @param scan Pointer to scan state
+ * @return Distance in meters, 0 if inside, -1 with fewer than 3 vertices
+ */
+double geofence_scan_end(struct geofence_scan *scan);
+
+/**
+ * @brief Signed distance to the nearest edge, after geofence_scan_end()
+ * @param scan Pointer to a closed scan
+ * @return Meters, negative inside (depth from the edge), positive outside
+ */
+double geofence_scan_edge_distance(const struct geofence_scan *scan);
+
 /**
  * @brief Cleanup geofence device (optional)
  * @param geofence Pointer to geofence device structure
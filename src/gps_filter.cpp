@@ -0,0 +1,183 @@
+/**
+ * @file gps_filter.cpp
+ * @brief Constant-velocity Kalman filter for GPS fixes Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "gps_filter.h"
+#include <math.h>
+#include <string.h>
+
+#define SUCCESS 1
+#define FAIL 0
+
+#define M_PER_DEG_LAT 111320.0
+#define DEG_TO_RAD_F 0.017453292519943295
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+static void axis_start(struct gps_filter_axis *a, float x, float var)
+{
+    a->x = x;
+    a->v = 0.0f;
+    a->pxx = var;
+    a->pxv = 0.0f;
+    a->pvv = GPS_FILTER_INIT_SPEED_MPS * GPS_FILTER_INIT_SPEED_MPS;
+}
+
+/**
+ * @brief x += v dt, P = F P F' + Q for white-noise acceleration
+ */
+static void axis_predict(struct gps_filter_axis *a, float dt)
+{
+    float q = GPS_FILTER_ACCEL_MPS2 * GPS_FILTER_ACCEL_MPS2;
+    float dt2 = dt * dt;
+
+    a->x += a->v * dt;
+    a->pxx += dt * (2.0f * a->pxv + dt * a->pvv) + q * dt2 * dt2 * 0.25f;
+    a->pxv += dt * a->pvv + q * dt2 * dt * 0.5f;
+    a->pvv += q * dt2;
+}
+
+/**
+ * @brief Innovation of a measurement in units of its expected spread
+ */
+static float axis_innovation(const struct gps_filter_axis *a, float z, float r)
+{
+    float y = z - a->x;
+    return y * y / (a->pxx + r);
+}
+
+static void axis_update(struct gps_filter_axis *a, float z, float r)
+{
+    float s = a->pxx + r;
+    float kx = a->pxx / s;
+    float kv = a->pxv / s;
+    float y = z - a->x;
+
+    a->x += kx * y;
+    a->v += kv * y;
+    a->pvv -= kv * a->pxv;
+    a->pxv *= 1.0f - kx;
+    a->pxx *= 1.0f - kx;
+}
+
+static void set_origin(struct gps_filter *f, double lat, double lng)
+{
+    f->lat0 = lat;
+    f->lng0 = lng;
+    f->m_per_deg_lng = M_PER_DEG_LAT * cos(lat * DEG_TO_RAD_F);
+}
+
+/**
+ * @brief Convert the state to degrees and the covariance to a radius
+ */
+static void publish(struct gps_filter *f)
+{
+    f->lat = f->lat0 + f->north.x / M_PER_DEG_LAT;
+    f->lng = f->lng0 + f->east.x / f->m_per_deg_lng;
+    f->radius_m = sqrtf(fmaxf(f->east.pxx, f->north.pxx));
+}
+
+/**
+ * @brief Move the origin under the estimate once it wanders off
+ */
+static void reanchor(struct gps_filter *f)
+{
+    if (fabsf(f->east.x) < GPS_FILTER_REANCHOR_M && fabsf(f->north.x) < GPS_FILTER_REANCHOR_M)
+        return;
+
+    publish(f);
+    set_origin(f, f->lat, f->lng);
+    f->east.x = 0.0f;
+    f->north.x = 0.0f;
+}
+
+static void restart(struct gps_filter *f, double lat, double lng, float r, uint32_t now)
+{
+    set_origin(f, lat, lng);
+    axis_start(&f->east, 0.0f, r);
+    axis_start(&f->north, 0.0f, r);
+    f->ready = 1;
+    f->rejects = 0;
+    f->last_ms = now;
+    f->last_fix_ms = now;
+    publish(f);
+}
+
+static void advance(struct gps_filter *f, uint32_t now)
+{
+    float dt = (now - f->last_ms) * 0.001f;
+    f->last_ms = now;
+    if (dt <= 0.0f) return;
+
+    axis_predict(&f->east, dt);
+    axis_predict(&f->north, dt);
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void gps_filter_init(struct gps_filter *f)
+{
+    if (!f) return;
+    memset(f, 0, sizeof(struct gps_filter));
+}
+
+float gps_filter_sigma(float h_acc_m, float hdop)
+{
+    float sigma = h_acc_m;
+    if (sigma <= 0.0f)
+        sigma = ((hdop > 0.0f) ? hdop : GPS_FILTER_UNKNOWN_HDOP) * GPS_FILTER_UERE_M;
+    return (sigma < GPS_FILTER_MIN_SIGMA_M) ? GPS_FILTER_MIN_SIGMA_M : sigma;
+}
+
+uint8_t gps_filter_update(struct gps_filter *f, double lat, double lng, float sigma_m, uint32_t now)
+{
+    if (!f) return FAIL;
+
+    float r = sigma_m * sigma_m;
+    if (!f->ready || now - f->last_fix_ms > GPS_FILTER_MAX_GAP_MS)
+    {
+        restart(f, lat, lng, r, now);
+        return SUCCESS;
+    }
+
+    advance(f, now);
+    float ze = (float)((lng - f->lng0) * f->m_per_deg_lng);
+    float zn = (float)((lat - f->lat0) * M_PER_DEG_LAT);
+
+    float gate = GPS_FILTER_GATE * GPS_FILTER_GATE;
+    if (axis_innovation(&f->east, ze, r) > gate || axis_innovation(&f->north, zn, r) > gate)
+    {
+        f->rejected++;
+        if (++f->rejects >= GPS_FILTER_MAX_REJECTS)
+        {
+            /* Consistently elsewhere: a real jump, not an outlier */
+            restart(f, lat, lng, r, now);
+            return SUCCESS;
+        }
+        publish(f);
+        return FAIL;
+    }
+
+    axis_update(&f->east, ze, r);
+    axis_update(&f->north, zn, r);
+    f->rejects = 0;
+    f->last_fix_ms = now;
+    reanchor(f);
+    publish(f);
+    return SUCCESS;
+}
+
+void gps_filter_predict(struct gps_filter *f, uint32_t now)
+{
+    if (!f || !f->ready) return;
+
+    advance(f, now);
+    publish(f);
+}
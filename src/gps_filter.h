@@ -0,0 +1,132 @@
+/**
+ * @file gps_filter.h
+ * @brief Constant-velocity Kalman filter for GPS fixes in local east/north meters
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Raw fixes scatter by several meters around a standing operator, which is
+ * the width of a pond bund: the geofence flipped between a pond and the one
+ * next to it while nobody moved. The filter smooths each fix into a position
+ * and a 1-sigma uncertainty radius that the pond lookup turns into a
+ * confidence.
+ *
+ * Each axis (east, north) is an independent two-state filter, position and
+ * velocity, in meters around an origin near the operator:
+ * @code
+ * predict:  x += v dt                     P += F P F' + Q(GPS_FILTER_ACCEL_MPS2)
+ * update:   sigma = hAcc (UBX) or HDOP x GPS_FILTER_UERE_M (NMEA)
+ * @endcode
+ * The flat-earth projection is good to a few centimeters within
+ * GPS_FILTER_REANCHOR_M, after which the origin moves to the current
+ * estimate.
+ *
+ * A fix further than GPS_FILTER_GATE sigma from the prediction is dropped
+ * (multipath off the water, a fix with a stale almanac). After
+ * GPS_FILTER_MAX_REJECTS drops in a row the filter restarts at the fix, so a
+ * real jump is followed within a few seconds. It also restarts after
+ * GPS_FILTER_MAX_GAP_MS without a valid fix.
+ *
+ * Owned by the GPS task; no locking.
+ *
+ * @par Usage Pattern:
+ * @code
+ * gps_filter_init(&filter);
+ *
+ * // GPS task, every fix
+ * if (valid)
+ *     gps_filter_update(&filter, lat, lng, gps_filter_sigma(hAccM, hDop), millis());
+ * else
+ *     gps_filter_predict(&filter, millis());
+ * publish(filter.lat, filter.lng, filter.radius_m);
+ * @endcode
+ */
+
+#ifndef GPS_FILTER_H
+#define GPS_FILTER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPS_FILTER_UERE_M 3.0f          /**< NMEA: 1-sigma range error per unit of HDOP */
+#define GPS_FILTER_UNKNOWN_HDOP 5.0f    /**< NMEA sentence without HDOP */
+#define GPS_FILTER_MIN_SIGMA_M 1.0f     /**< Receivers are optimistic below this */
+#define GPS_FILTER_ACCEL_MPS2 0.3f      /**< Walking: 1-sigma change of velocity per second */
+#define GPS_FILTER_INIT_SPEED_MPS 1.5f  /**< 1-sigma velocity at a restart */
+#define GPS_FILTER_GATE 4.0f            /**< Innovation gate, sigma */
+#define GPS_FILTER_MAX_REJECTS 5
+#define GPS_FILTER_MAX_GAP_MS 30000
+#define GPS_FILTER_REANCHOR_M 1000.0f
+
+/**
+ * @brief Position and velocity along one axis, with covariance
+ */
+struct gps_filter_axis {
+    float x;                            /**< Meters from the origin */
+    float v;                            /**< Meters per second */
+    float pxx;
+    float pxv;
+    float pvv;
+};
+
+/**
+ * @struct gps_filter
+ * @brief Filter state and the last estimate
+ */
+struct gps_filter {
+    uint8_t ready;                      /**< Started by a valid fix */
+    uint8_t rejects;                    /**< Consecutive fixes outside the gate */
+    uint32_t last_ms;                   /**< Time of the state */
+    uint32_t last_fix_ms;               /**< Last fix the gate accepted */
+    double lat0;                        /**< Origin */
+    double lng0;
+    double m_per_deg_lng;               /**< At the origin latitude */
+    struct gps_filter_axis east;
+    struct gps_filter_axis north;
+
+    double lat;                         /**< Estimate, degrees */
+    double lng;
+    float radius_m;                     /**< 1-sigma, larger of the two axes; 0 before the first fix */
+    uint32_t rejected;                  /**< Fixes dropped by the gate since boot */
+};
+
+/**
+ * @brief Clear the state; the next valid fix starts the filter
+ * @param f Pointer to filter
+ */
+void gps_filter_init(struct gps_filter *f);
+
+/**
+ * @brief 1-sigma horizontal error of a fix
+ * @param h_acc_m Receiver accuracy estimate (UBX), 0 when not reported
+ * @param hdop HDOP (NMEA), 0 when not reported
+ * @return Meters, at least GPS_FILTER_MIN_SIGMA_M
+ */
+float gps_filter_sigma(float h_acc_m, float hdop);
+
+/**
+ * @brief Fold in a valid fix
+ * @param f Pointer to filter
+ * @param lat Fix latitude, degrees
+ * @param lng Fix longitude, degrees
+ * @param sigma_m 1-sigma error of the fix, see gps_filter_sigma()
+ * @param now millis()
+ * @return 1 if the fix was used, 0 if the gate dropped it
+ */
+uint8_t gps_filter_update(struct gps_filter *f, double lat, double lng, float sigma_m, uint32_t now);
+
+/**
+ * @brief Advance without a fix; the radius grows with the time since the last one
+ * @param f Pointer to filter
+ * @param now millis()
+ */
+void gps_filter_predict(struct gps_filter *f, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GPS_FILTER_H */
@@ -112,10 +112,11 @@
 #include "http_ops.h"
 #include "BSP.h"
 #include <HTTPClient.h>
-#include <Update.h>
 #include <WiFi.h>
 #include <Arduino.h>
 #include "mjson.h"
+#include "ota_engine.h"
+#include "perf_metrics.h"
 
 /* Debug macros - Enable SERIAL_DEBUG for verbose logging */
 // #define SERIAL_DEBUG
@@ -131,6 +132,11 @@
 #define debugPrintlnf(...) /* Disabled */
 #endif
 
+#define OTA_STALL_MS 10000  /* No firmware bytes for this long drops the attempt */
+
+static_assert(sizeof(((struct http_device *)0)->uri_firmware_fota) == OTA_ENGINE_URL_MAX,
+              "the FOTA URL buffer must hold exactly what the OTA engine accepts");
+
 /* ============================================================================
  * Private Data Structure for ESP32 HTTP Client
  * ============================================================================ */
@@ -138,6 +144,7 @@
 struct esp32_http_priv {
     HTTPClient *http_client;
     WiFiClient *ota_client;
+    struct ota_engine *ota;     /**< Interrupted download kept for the next call */
 };
 
 /* ============================================================================
@@ -183,6 +190,52 @@ static void set_payload(struct http_device *http, const char *data)
     }
 }
 
+/**
+ * @brief Stream adapter handing HTTPClient body writes to an http_sink_fn
+ *
+ * HTTPClient::writeToStream() removes chunked transfer encoding and reads
+ * through its own TCP-sized buffer, so the body never exists in one piece.
+ * A sink returning 0 makes the write short and ends the transfer.
+ */
+class SinkStream : public Stream
+{
+public:
+    SinkStream(http_sink_fn sink, void *ctx) : m_sink(sink), m_ctx(ctx) {}
+    size_t write(const uint8_t *data, size_t len) override
+    {
+        return m_sink(m_ctx, data, len) ? len : 0;
+    }
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override {}
+
+private:
+    http_sink_fn m_sink;
+    void *m_ctx;
+};
+
+/**
+ * @brief GET a URL and stream the 200 body into a sink
+ * @return 1 when the whole body reached the sink, 0 otherwise
+ */
+static uint8_t get_to_sink(struct esp32_http_priv *priv, const char *link, http_sink_fn sink, void *ctx)
+{
+    priv->http_client->begin(link);
+    priv->http_client->setTimeout(30000);
+    priv->http_client->addHeader("Content-Type", "application/json");
+
+    int httpCode = priv->http_client->GET();
+    debugPrintln(priv->http_client->errorToString(httpCode));
+    if (httpCode != HTTP_CODE_OK) return 0;
+
+    SinkStream out(sink, ctx);
+    int written = priv->http_client->writeToStream(&out);
+    debugPrintf("[HTTP] streamed %d bytes\n", written);
+    return (written >= 0) ? 1 : 0;
+}
+
 /* ============================================================================
  * ESP32 HTTP Static Implementation Functions
  * ============================================================================ */
@@ -287,8 +340,11 @@ static time_t esp32_upload_ping_frame(struct http_device *http)
         debugPrintln("[HTTP] begin : Ping");
         
         /* Build URL for ping */
-        char link[150];
-        sprintf(link, "http://%s:%d/ping", http->server_ip, http->http_port);
+        char link[150 + sizeof(http->ping_query)];
+        if (http->ping_query[0])
+            sprintf(link, "http://%s:%d/ping?%s", http->server_ip, http->http_port, http->ping_query);
+        else
+            sprintf(link, "http://%s:%d/ping", http->server_ip, http->http_port);
         
         priv->http_client->begin(link);
         priv->http_client->addHeader("Content-Type", "application/json");
@@ -334,16 +390,19 @@ static time_t esp32_upload_ping_frame(struct http_device *http)
  * @brief Download device configuration from server
  * @param http Pointer to HTTP device structure
  * @param device_id Query string with device ID (e.g., "deviceId=AA:BB:CC")
+ * @param sink Receives the response body chunk by chunk
+ * @param ctx Sink context
  * @return 1 on success, 0 on failure
  * 
  * @details
  * - Endpoint: GET /api/do/getconfiguration?deviceId=...
- * - Response stored in payload for parsing by application
+ * - Body is streamed to the sink, never buffered whole, so there is no
+ *   size limit on the configuration
  * - Configuration includes operation mode, intervals, etc.
  */
-static uint8_t esp32_get_config(struct http_device *http, char *device_id)
+static uint8_t esp32_get_config(struct http_device *http, char *device_id, http_sink_fn sink, void *ctx)
 {
-    if (!http || !device_id) return 0;
+    if (!http || !device_id || !sink) return 0;
     
     struct esp32_http_priv *priv = get_priv(http);
     if (!priv || !priv->http_client) return 0;
@@ -361,24 +420,11 @@ static uint8_t esp32_get_config(struct http_device *http, char *device_id)
         
         debugPrintln(link);
         
-        priv->http_client->begin(link);
-        priv->http_client->setTimeout(30000);
-        priv->http_client->addHeader("Content-Type", "application/json");
-        
-        debugPrintln(device_id);
-        
-        int httpCode = priv->http_client->GET();
-        debugPrintln(priv->http_client->errorToString(httpCode));
-        
-        if (httpCode == HTTP_CODE_OK) {
+        ret = get_to_sink(priv, link, sink, ctx);
+        if (ret) {
             Serial.println("@@ Requested getDevice data :-)");
-            String payload = priv->http_client->getString();
-            debugPrintln(payload);
-            set_payload(http, payload.c_str());
-            ret = 1;
         } else {
             Serial.println("@@ failed to send getDevice  :-(");
-            ret = 0;
         }
     } else {
         ret = 0;
@@ -395,16 +441,19 @@ static uint8_t esp32_get_config(struct http_device *http, char *device_id)
  * @brief Download pond boundary coordinates from server
  * @param http Pointer to HTTP device structure
  * @param query Query string with pond ID (e.g., "pondId=123")
+ * @param sink Receives the response body chunk by chunk
+ * @param ctx Sink context
  * @return 1 on success, 0 on failure
  * 
  * @details
  * - Endpoint: GET /api/do/getPondsBoundaries?pondId=...
- * - Response contains GPS coordinates defining pond boundaries
+ * - Response contains GPS coordinates defining pond boundaries, streamed
+ *   to the sink whatever the number of posts
  * - Used for geofencing and pond detection
  */
-static uint8_t esp32_get_pond_boundaries(struct http_device *http, char *query)
+static uint8_t esp32_get_pond_boundaries(struct http_device *http, char *query, http_sink_fn sink, void *ctx)
 {
-    if (!http || !query) return 0;
+    if (!http || !query || !sink) return 0;
     
     struct esp32_http_priv *priv = get_priv(http);
     if (!priv || !priv->http_client) return 0;
@@ -422,24 +471,11 @@ static uint8_t esp32_get_pond_boundaries(struct http_device *http, char *query)
         
         debugPrintln(link);
         
-        priv->http_client->begin(link);
-        priv->http_client->setTimeout(30000);
-        priv->http_client->addHeader("Content-Type", "application/json");
-        
-        debugPrintln(query);
-        
-        int httpCode = priv->http_client->GET();
-        debugPrintln(priv->http_client->errorToString(httpCode));
-        
-        if (httpCode == HTTP_CODE_OK) {
+        ret = get_to_sink(priv, link, sink, ctx);
+        if (ret) {
             debugPrintln("@@ Requested get pond Boundaries :-)");
-            String payload = priv->http_client->getString();
-            debugPrintln(payload);
-            set_payload(http, payload.c_str());
-            ret = 1;
         } else {
             debugPrintln("@@ failed to get pond Boundaries  :-(");
-            ret = 0;
         }
     } else {
         ret = 0;
@@ -452,18 +488,38 @@ static uint8_t esp32_get_pond_boundaries(struct http_device *http, char *query)
     return ret;
 }
 
+/**
+ * @brief Total image size from "Content-Range: bytes 0-65535/1234567"
+ * @return Size in bytes, 0 if the header is missing or malformed
+ */
+static uint32_t content_range_total(const String &range)
+{
+    int slash = range.lastIndexOf('/');
+    if (slash < 0 || range.charAt(slash + 1) == '*') return 0;
+    return (uint32_t)strtoul(range.c_str() + slash + 1, NULL, 10);
+}
+
 /**
  * @brief Perform Over-The-Air (OTA) firmware update
  * @param http Pointer to HTTP device structure
  * @param bsp Pointer to BSP device for watchdog feeding
- * @return Error code: 0=success, 1=HTTP error, 2=no space, 3=update error, 4=not finished, 5=busy
+ * @return Error code: 0=success, 1=HTTP error, 2=no space, 3=update error, 4=not finished, 5=busy,
+ *         6=interrupted (progress kept, call again to resume)
  * 
  * @details
  * - Downloads firmware binary from URL stored in http->uri_firmware_fota
+ * - Fetches OTA_ENGINE_CHUNK bytes per GET with a Range header, starting
+ *   where the previous attempt (or the one before the reboot) stopped
+ * - A server without Range support (200) is accepted from byte 0
+ * - Socket reads go straight into the engine's sector buffer; zlib and
+ *   delta images are decoded on the way (see ota_engine.h)
+ * - An interrupted download keeps its engine until the next call, so an
+ *   encoded stream resumes mid-inflate; plain images also resume after a
+ *   reboot from the NVS checkpoint
+ * - Verifies http->fw_sha256 (when set) before switching the boot partition
  * - Updates curr_progress field during download (0-100%)
  * - Feeds watchdog during long download to prevent reset
  * - Automatically reboots device on successful update
- * - Uses 2KB buffer for streaming download
  * 
  * @warning Device will reboot automatically on success!
  * @note Progress can be monitored via http->curr_progress
@@ -475,106 +531,148 @@ static uint8_t esp32_perform_ota(struct http_device *http, cBsp *bsp)
     struct esp32_http_priv *priv = get_priv(http);
     if (!priv || !priv->http_client || !priv->ota_client) return 5;
     
-    uint8_t ret = 0;
-    
-    if (!http->is_busy) {
-        http->is_busy = 1;
-        
-        debugPrint("[HTTP] IsConnected : ");
-        debugPrintln(priv->http_client->connected());
-        debugPrintln("[HTTP] begin : Frame");
-        debugPrintf("Connecting to firmware URL : %s\n", http->uri_firmware_fota);
-        
-        /* Begin HTTP connection for OTA */
+    if (http->is_busy) {
+        debugPrintln("@@ HTTP Busy");
+        return 5;
+    }
+    http->is_busy = 1;
+
+    /* Sector buffer and hash context, only held while updating */
+    struct ota_engine *ota = priv->ota;
+    priv->ota = NULL;
+    if (ota && strcmp(ota->url, http->uri_firmware_fota) != 0) {
+        ota_engine_end(ota);
+        free(ota);
+        ota = NULL;
+    }
+    if (!ota) {
+        ota = (struct ota_engine *)malloc(sizeof(struct ota_engine));
+        if (!ota || !ota_engine_begin(ota, http->uri_firmware_fota, http->fw_sha256)) {
+            debugPrintln("Cannot start OTA: no partition, memory or bad hash");
+            if (ota) ota_engine_end(ota);
+            free(ota);
+            http->is_busy = 0;
+            return 2;
+        }
+    }
+
+    debugPrintf("Connecting to firmware URL : %s\n", http->uri_firmware_fota);
+    static const char *kHeaders[] = {"Content-Range"};
+    uint8_t ret = 6;
+    bool noRange = false;
+    unsigned long st = millis();
+
+    while (!ota_engine_done(ota)) {
+        bsp->wdtfeed();
+        uint32_t from = ota_engine_offset(ota);
+        char range[40];
+        snprintf(range, sizeof(range), "bytes=%lu-%lu",
+                 (unsigned long)from, (unsigned long)(from + OTA_ENGINE_CHUNK - 1));
+
         priv->http_client->begin(*priv->ota_client, http->uri_firmware_fota);
-        
+        priv->http_client->setTimeout(OTA_STALL_MS);
+        priv->http_client->collectHeaders(kHeaders, 1);
+        priv->http_client->addHeader("Range", range);
         int httpCode = priv->http_client->GET();
-        
-        if (httpCode == HTTP_CODE_OK) {
-            int contentLength = priv->http_client->getSize();
-            debugPrintf("Length: %d\n", contentLength);
-            
-            if (Update.begin(contentLength)) {
-                debugPrintln("Begin OTA. This may take a while...");
-                
-                int written = 0;
-                int totalWritten = 0;
-                uint8_t buff[2048] = {0};
-                
-                WiFiClient *stream = priv->http_client->getStreamPtr();
-                debugPrint("OTA start :");
-                unsigned long st = millis();
-                debugPrintln(st);
-                
-                int prevprogress = 0;
-                
-                /* Read stream and write to Update object */
-                while (priv->http_client->connected() && 
-                       (totalWritten < contentLength || contentLength == -1)) {
-                    
-                    /* Feed watchdog using BSP class method */
-                    if (bsp) {
-                        bsp->wdtfeed();
-                    }
-                    
-                    size_t size = stream->available();
-                    if (size) {
-                        int c = stream->readBytes(buff, 
-                                  ((size > sizeof(buff)) ? sizeof(buff) : size));
-                        written = Update.write(buff, c);
-                        totalWritten += written;
-                        
-                        /* Update progress */
-                        prevprogress = http->curr_progress;
-                        http->curr_progress = (totalWritten * 100) / contentLength;
-                        
-                        if (http->curr_progress != prevprogress) {
-                            debugPrintf("Progress: %d \n", http->curr_progress);
-                        }
-                    }
-                }
-                
-                debugPrint("OTA End :");
-                unsigned long et = millis();
-                debugPrintln(et);
-                debugPrint("Duration:");
-                debugPrintln(et - st);
-                
-                if (totalWritten == contentLength) {
-                    debugPrintln("Written : " + String(totalWritten) + " successfully");
-                } else {
-                    debugPrintln("Written only : " + String(totalWritten) + 
-                               "/" + String(contentLength) + ". Retry?");
-                }
-                
-                if (Update.end()) {
-                    if (Update.isFinished()) {
-                        debugPrintln("OTA update has successfully finished. Rebooting...");
-                        delay(2000);
-                        ESP.restart();
-                    } else {
-                        debugPrintln("OTA update not finished. Something went wrong!");
-                        ret = 4;
-                    }
-                } else {
-                    debugPrintln("Error Occurred. Error #: " + String(Update.getError()));
-                    ret = 3;
+
+        uint32_t total = 0;
+        if (httpCode == HTTP_CODE_PARTIAL_CONTENT) {
+            total = content_range_total(priv->http_client->header("Content-Range"));
+        } else if (httpCode == HTTP_CODE_OK && from == 0) {
+            total = priv->http_client->getSize();
+        } else if (httpCode == HTTP_CODE_OK) {
+            /* Server ignored the Range header, the next attempt starts from 0 */
+            debugPrintln("Server does not support ranges, restarting OTA");
+            noRange = true;
+            priv->http_client->end();
+            break;
+        } else {
+            debugPrintf("Cannot download firmware. HTTP error code: %d\n", httpCode);
+            /* Negative codes are connection errors, worth resuming */
+            ret = (httpCode < 0) ? 6 : 1;
+            priv->http_client->end();
+            break;
+        }
+        if (!ota_engine_set_size(ota, total)) {
+            debugPrintln("Not enough space to begin OTA");
+            ret = 2;
+            priv->http_client->end();
+            break;
+        }
+        if (ota_engine_offset(ota) != from) {
+            /* Size changed under us and the engine restarted; request again */
+            priv->http_client->end();
+            continue;
+        }
+
+        int body = priv->http_client->getSize();
+        uint32_t end = (body > 0) ? from + (uint32_t)body : total;
+        WiFiClient *stream = priv->http_client->getStreamPtr();
+        unsigned long lastData = millis();
+        bool flashOk = true;
+
+        while (ota_engine_offset(ota) < end) {
+            bsp->wdtfeed();
+            size_t room = 0;
+            uint8_t *dst = ota_engine_buffer(ota, &room);
+            size_t want = end - ota_engine_offset(ota);
+            if (want < room) room = want;
+            size_t avail = stream->available();
+            if (avail) {
+                int c = stream->read(dst, (avail < room) ? avail : room);
+                if (c > 0) {
+                    flashOk = ota_engine_commit(ota, c);
+                    if (!flashOk) break;
+                    lastData = millis();
                 }
+            } else if (!stream->connected() || millis() - lastData > OTA_STALL_MS) {
+                break;
             } else {
-                debugPrintln("Not enough space to begin OTA");
-                ret = 2;
+                delay(1);
             }
-        } else {
-            debugPrintf("Cannot download firmware. HTTP error code: %d\n", httpCode);
-            ret = 1;
         }
-        
         priv->http_client->end();
+
+        int progress = (int)(((uint64_t)ota_engine_offset(ota) * 100) / total);
+        if (progress != http->curr_progress) {
+            http->curr_progress = progress;
+            debugPrintf("Progress: %d \n", http->curr_progress);
+        }
+        if (!flashOk) {
+            ret = 3;
+            break;
+        }
+        if (ota_engine_offset(ota) < end) {
+            debugPrintf("Connection dropped at %u, will resume\n", (unsigned)ota_engine_offset(ota));
+            ret = 6;
+            break;
+        }
+    }
+
+    debugPrint("Duration:");
+    debugPrintln(millis() - st);
+
+    if (ota_engine_done(ota)) {
+        if (ota_engine_finish(ota)) {
+            debugPrintln("OTA update has successfully finished. Rebooting...");
+            ota_engine_end(ota);
+            free(ota);
+            delay(2000);
+            ESP.restart();
+        }
+        debugPrintln("OTA image rejected");
+        ret = 3;
+    } else if (ret == 6 && !noRange) {
+        ota_engine_checkpoint(ota);
+        priv->ota = ota;
+        http->is_busy = 0;
+        return ret;
     } else {
-        ret = 5;
-        debugPrintln("@@ HTTP Busy");
+        ota_engine_clear();
     }
-    
+
+    ota_engine_end(ota);
+    free(ota);
     http->is_busy = 0;
     return ret;
 }
@@ -640,6 +738,7 @@ int http_device_init(struct http_device *http, const char *name, const struct ht
     strncpy(http->default_server_ip, "34.93.69.40", sizeof(http->default_server_ip));
     strncpy(http->server_ip, http->default_server_ip, sizeof(http->server_ip));
     http->uri_firmware_fota[0] = '\0';
+    http->fw_sha256[0] = '\0';
     
     /* Allocate and initialize private data */
     struct esp32_http_priv *priv = (struct esp32_http_priv*)malloc(sizeof(struct esp32_http_priv));
@@ -647,6 +746,7 @@ int http_device_init(struct http_device *http, const char *name, const struct ht
     
     priv->http_client = new HTTPClient();
     priv->ota_client = new WiFiClient();
+    priv->ota = NULL;
     
     if (!priv->http_client || !priv->ota_client) {
         if (priv->http_client) delete priv->http_client;
@@ -685,6 +785,10 @@ void http_device_cleanup(struct http_device *http)
         if (priv->ota_client) {
             delete priv->ota_client;
         }
+        if (priv->ota) {
+            ota_engine_end(priv->ota);
+            free(priv->ota);
+        }
         free(priv);
         http->priv = NULL;
     }
@@ -736,7 +840,10 @@ void http_set_server(struct http_device *http, const char *ip, uint16_t http_por
 uint8_t http_upload_data_frame(struct http_device *http, char *data)
 {
     if (!http || !http->ops || !http->ops->upload_data_frame) return 0;
-    return http->ops->upload_data_frame(http, data);
+    PERF_SCOPE(PERF_HTTP);
+    uint8_t ok = http->ops->upload_data_frame(http, data);
+    if (!ok) PERF_COUNT(PERF_CNT_HTTP_FAIL);
+    return ok;
 }
 
 /**
@@ -753,45 +860,56 @@ uint8_t http_upload_data_frame(struct http_device *http, char *data)
 time_t http_upload_ping_frame(struct http_device *http)
 {
     if (!http || !http->ops || !http->ops->upload_ping_frame) return 0;
-    return http->ops->upload_ping_frame(http);
+    PERF_SCOPE(PERF_HTTP);
+    time_t epoch = http->ops->upload_ping_frame(http);
+    if (!epoch) PERF_COUNT(PERF_CNT_HTTP_FAIL);
+    return epoch;
 }
 
 /**
  * @brief Download device configuration (Public API)
  * @param http Pointer to HTTP device structure
  * @param device_id Query string with device ID
+ * @param sink Receives the response body chunk by chunk
+ * @param ctx Sink context
  * @return 1 on success, 0 on failure
  * 
  * @details
  * Wrapper function that calls through operations table.
- * Response is stored in payload - use http_get_payload() to retrieve.
+ * The response is not kept in payload.
  * 
  * @see esp32_get_config() for implementation details
- * @see http_get_payload() to access response
  */
-uint8_t http_get_config(struct http_device *http, char *device_id)
+uint8_t http_get_config(struct http_device *http, char *device_id, http_sink_fn sink, void *ctx)
 {
     if (!http || !http->ops || !http->ops->get_config) return 0;
-    return http->ops->get_config(http, device_id);
+    PERF_SCOPE(PERF_HTTP);
+    uint8_t ok = http->ops->get_config(http, device_id, sink, ctx);
+    if (!ok) PERF_COUNT(PERF_CNT_HTTP_FAIL);
+    return ok;
 }
 
 /**
  * @brief Download pond boundaries (Public API)
  * @param http Pointer to HTTP device structure
  * @param query Query string with pond ID
+ * @param sink Receives the response body chunk by chunk
+ * @param ctx Sink context
  * @return 1 on success, 0 on failure
  * 
  * @details
  * Wrapper function that calls through operations table.
- * Response is stored in payload - use http_get_payload() to retrieve.
+ * The response is not kept in payload.
  * 
  * @see esp32_get_pond_boundaries() for implementation details
- * @see http_get_payload() to access response
  */
-uint8_t http_get_pond_boundaries(struct http_device *http, char *query)
+uint8_t http_get_pond_boundaries(struct http_device *http, char *query, http_sink_fn sink, void *ctx)
 {
     if (!http || !http->ops || !http->ops->get_pond_boundaries) return 0;
-    return http->ops->get_pond_boundaries(http, query);
+    PERF_SCOPE(PERF_HTTP);
+    uint8_t ok = http->ops->get_pond_boundaries(http, query, sink, ctx);
+    if (!ok) PERF_COUNT(PERF_CNT_HTTP_FAIL);
+    return ok;
 }
 
 /**
@@ -35,6 +35,7 @@
 #define HTTP_OPS_H
 
 #include <stdint.h>
+#include <stddef.h>
 #include <time.h>
 
 #ifdef __cplusplus
@@ -45,6 +46,15 @@ extern "C" {
 struct http_device;
 class cBsp;  /**< BSP device for watchdog operations */
 
+/**
+ * @brief Response body sink, called per received chunk
+ * @param ctx Caller context
+ * @param data Body bytes
+ * @param len Length of data
+ * @return 1 to continue, 0 to abort the transfer
+ */
+typedef uint8_t (*http_sink_fn)(void *ctx, const uint8_t *data, size_t len);
+
 /**
  * @struct http_ops
  * @brief HTTP Operations Structure
@@ -67,22 +77,26 @@ struct http_ops {
      *  @return Server epoch time, 0 on failure */
     time_t (*upload_ping_frame)(struct http_device *http);
     
-    /** @brief Download device configuration
+    /** @brief Download device configuration, streaming the body to a sink
      *  @param http Device structure
      *  @param device_id Query string with device ID
-     *  @return 1 on success, 0 on failure */
-    uint8_t (*get_config)(struct http_device *http, char *device_id);
+     *  @param sink Body sink
+     *  @param ctx Sink context
+     *  @return 1 when the whole body was delivered, 0 on failure */
+    uint8_t (*get_config)(struct http_device *http, char *device_id, http_sink_fn sink, void *ctx);
     
-    /** @brief Download pond boundary coordinates
+    /** @brief Download pond boundary coordinates, streaming the body to a sink
      *  @param http Device structure
      *  @param query Query string with pond ID
-     *  @return 1 on success, 0 on failure */
-    uint8_t (*get_pond_boundaries)(struct http_device *http, char *query);
+     *  @param sink Body sink
+     *  @param ctx Sink context
+     *  @return 1 when the whole body was delivered, 0 on failure */
+    uint8_t (*get_pond_boundaries)(struct http_device *http, char *query, http_sink_fn sink, void *ctx);
     
-    /** @brief Perform OTA firmware update
+    /** @brief Perform OTA firmware update, resuming an interrupted one
      *  @param http Device structure
      *  @param bsp BSP device for watchdog
-     *  @return Error code: 0=success, 1-5=errors
+     *  @return Error code: 0=success, 1-5=errors, 6=interrupted (resumable)
      *  @warning Device reboots on success! */
     uint8_t (*perform_ota)(struct http_device *http, cBsp *bsp);
 };
@@ -111,7 +125,9 @@ struct http_device {
     char default_server_ip[25];         /**< Default server IP (34.93.69.40) */
     uint16_t server_port;               /**< WebSocket/Socket.IO port (5000) */
     uint16_t http_port;                 /**< HTTP REST API port (3000) */
-    char uri_firmware_fota[150];        /**< OTA firmware download URL */
+    char uri_firmware_fota[512];        /**< OTA firmware download URL, OTA_ENGINE_URL_MAX */
+    char fw_sha256[65];                 /**< Expected image SHA-256 (hex), empty if not given */
+    char ping_query[96];                /**< Appended to GET /ping when not empty */
     
     /* State */
     uint8_t is_busy;                    /**< 1 if HTTP operation in progress */
@@ -132,8 +148,8 @@ void http_device_cleanup(struct http_device *http);
 void http_set_server(struct http_device *http, const char *ip, uint16_t http_port, uint16_t server_port);
 uint8_t http_upload_data_frame(struct http_device *http, char *data);
 time_t http_upload_ping_frame(struct http_device *http);
-uint8_t http_get_config(struct http_device *http, char *device_id);
-uint8_t http_get_pond_boundaries(struct http_device *http, char *query);
+uint8_t http_get_config(struct http_device *http, char *device_id, http_sink_fn sink, void *ctx);
+uint8_t http_get_pond_boundaries(struct http_device *http, char *query, http_sink_fn sink, void *ctx);
 uint8_t http_perform_ota(struct http_device *http, cBsp *bsp);
 const char* http_get_payload(struct http_device *http);
 
@@ -0,0 +1,390 @@
+/**
+ * @file json_stream.cpp
+ * @brief Incremental JSON tokenizer with fixed memory Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "json_stream.h"
+#include <string.h>
+
+#define SUCCESS 1
+#define FAIL 0
+
+/**
+ * @brief Parser states, one byte of input at a time
+ */
+enum {
+    ST_VALUE = 0,                       /* Expecting a value */
+    ST_VALUE_OR_END,                    /* After '[' */
+    ST_KEY,                             /* After ',' in an object */
+    ST_KEY_OR_END,                      /* After '{' */
+    ST_COLON,
+    ST_AFTER_VALUE,                     /* Expecting ',' or a closing bracket */
+    ST_STRING,
+    ST_KEY_STRING,
+    ST_NUMBER,
+    ST_LITERAL,
+    ST_DONE                             /* Root value complete */
+};
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+static uint8_t is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static uint8_t fail(struct json_stream *js, uint8_t error)
+{
+    js->error = error;
+    return FAIL;
+}
+
+static uint8_t emit(struct json_stream *js, uint8_t ev)
+{
+    const char *value = "";
+    size_t len = 0;
+    if (ev >= JSON_EV_STRING)
+    {
+        js->tok[js->tok_len] = '\0';
+        value = js->tok;
+        len = js->tok_len;
+    }
+    if (!js->on_event(js, ev, value, len)) return fail(js, JSON_STREAM_ABORTED);
+    return SUCCESS;
+}
+
+/**
+ * @brief A value ended: the root is done, or the container expects more
+ */
+static void value_done(struct json_stream *js)
+{
+    js->state = js->depth ? ST_AFTER_VALUE : ST_DONE;
+}
+
+static void tok_add(struct json_stream *js, char c)
+{
+    if (js->tok_len < JSON_STREAM_TOKEN_MAX)
+        js->tok[js->tok_len++] = c;
+    else
+        js->truncated = 1;
+}
+
+/**
+ * @brief Append a \\u code point as UTF-8; surrogate halves become '?'
+ */
+static void tok_add_utf8(struct json_stream *js, uint16_t cp)
+{
+    if (cp < 0x80)
+    {
+        tok_add(js, (char)cp);
+    }
+    else if (cp < 0x800)
+    {
+        tok_add(js, (char)(0xC0 | (cp >> 6)));
+        tok_add(js, (char)(0x80 | (cp & 0x3F)));
+    }
+    else if (cp >= 0xD800 && cp < 0xE000)
+    {
+        tok_add(js, '?');
+    }
+    else
+    {
+        tok_add(js, (char)(0xE0 | (cp >> 12)));
+        tok_add(js, (char)(0x80 | ((cp >> 6) & 0x3F)));
+        tok_add(js, (char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+static uint8_t open_container(struct json_stream *js, char c)
+{
+    js->tok_len = 0;
+    if (!emit(js, (c == '{') ? JSON_EV_OBJECT : JSON_EV_ARRAY)) return FAIL;
+    if (js->depth >= JSON_STREAM_DEPTH) return fail(js, JSON_STREAM_TOO_DEEP);
+
+    js->container[js->depth] = (uint8_t)c;
+    js->index[js->depth] = 0;
+    js->key[js->depth][0] = '\0';
+    js->depth++;
+    js->state = (c == '{') ? ST_KEY_OR_END : ST_VALUE_OR_END;
+    return SUCCESS;
+}
+
+static uint8_t close_container(struct json_stream *js, char c)
+{
+    if (!js->depth || js->container[js->depth - 1] != (uint8_t)((c == '}') ? '{' : '['))
+    {
+        return fail(js, JSON_STREAM_SYNTAX);
+    }
+    js->depth--;
+    if (!emit(js, JSON_EV_END)) return FAIL;
+    value_done(js);
+    return SUCCESS;
+}
+
+/**
+ * @brief Start of a value, first character already known not to be space
+ */
+static uint8_t begin_value(struct json_stream *js, char c)
+{
+    js->tok_len = 0;
+    js->truncated = 0;
+    if (c == '{' || c == '[') return open_container(js, c);
+    if (c == '"')
+    {
+        js->state = ST_STRING;
+        js->esc = 0;
+        return SUCCESS;
+    }
+    if (c == '-' || (c >= '0' && c <= '9'))
+    {
+        tok_add(js, c);
+        js->state = ST_NUMBER;
+        return SUCCESS;
+    }
+    if (c == 't' || c == 'f' || c == 'n')
+    {
+        tok_add(js, c);
+        js->state = ST_LITERAL;
+        return SUCCESS;
+    }
+    return fail(js, JSON_STREAM_SYNTAX);
+}
+
+static uint8_t end_literal(struct json_stream *js)
+{
+    js->tok[js->tok_len] = '\0';
+    if (!strcmp(js->tok, "true") || !strcmp(js->tok, "false"))
+    {
+        if (!emit(js, JSON_EV_BOOL)) return FAIL;
+    }
+    else if (!strcmp(js->tok, "null"))
+    {
+        if (!emit(js, JSON_EV_NULL)) return FAIL;
+    }
+    else
+    {
+        return fail(js, JSON_STREAM_SYNTAX);
+    }
+    value_done(js);
+    return SUCCESS;
+}
+
+/**
+ * @brief One character of a string body; returns 1 on the closing quote
+ */
+static uint8_t string_char(struct json_stream *js, char c, uint8_t *closed)
+{
+    *closed = 0;
+    if (js->esc == 1)
+    {
+        js->esc = 0;
+        switch (c)
+        {
+        case 'b': tok_add(js, '\b'); break;
+        case 'f': tok_add(js, '\f'); break;
+        case 'n': tok_add(js, '\n'); break;
+        case 'r': tok_add(js, '\r'); break;
+        case 't': tok_add(js, '\t'); break;
+        case 'u': js->esc = 2; js->ucode = 0; break;
+        case '"': case '\\': case '/': tok_add(js, c); break;
+        default: return fail(js, JSON_STREAM_SYNTAX);
+        }
+        return SUCCESS;
+    }
+    if (js->esc >= 2)
+    {
+        uint8_t v;
+        if (c >= '0' && c <= '9') v = c - '0';
+        else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+        else return fail(js, JSON_STREAM_SYNTAX);
+        js->ucode = (uint16_t)((js->ucode << 4) | v);
+        if (++js->esc == 6)
+        {
+            js->esc = 0;
+            tok_add_utf8(js, js->ucode);
+        }
+        return SUCCESS;
+    }
+    if (c == '\\')
+    {
+        js->esc = 1;
+    }
+    else if (c == '"')
+    {
+        *closed = 1;
+    }
+    else if ((uint8_t)c < 0x20)
+    {
+        return fail(js, JSON_STREAM_SYNTAX);
+    }
+    else
+    {
+        tok_add(js, c);
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief Advance the state machine by one character
+ */
+static uint8_t step(struct json_stream *js, char c)
+{
+    uint8_t closed;
+    switch (js->state)
+    {
+    case ST_VALUE:
+        if (is_space(c)) return SUCCESS;
+        return begin_value(js, c);
+
+    case ST_VALUE_OR_END:
+        if (is_space(c)) return SUCCESS;
+        if (c == ']') return close_container(js, c);
+        return begin_value(js, c);
+
+    case ST_KEY_OR_END:
+        if (is_space(c)) return SUCCESS;
+        if (c == '}') return close_container(js, c);
+        /* fall through */
+    case ST_KEY:
+        if (is_space(c)) return SUCCESS;
+        if (c != '"') return fail(js, JSON_STREAM_SYNTAX);
+        js->tok_len = 0;
+        js->truncated = 0;
+        js->esc = 0;
+        js->state = ST_KEY_STRING;
+        return SUCCESS;
+
+    case ST_KEY_STRING:
+        if (!string_char(js, c, &closed)) return FAIL;
+        if (closed)
+        {
+            size_t n = js->tok_len;
+            if (n > JSON_STREAM_KEY_MAX - 1) n = JSON_STREAM_KEY_MAX - 1;
+            memcpy(js->key[js->depth - 1], js->tok, n);
+            js->key[js->depth - 1][n] = '\0';
+            js->state = ST_COLON;
+        }
+        return SUCCESS;
+
+    case ST_COLON:
+        if (is_space(c)) return SUCCESS;
+        if (c != ':') return fail(js, JSON_STREAM_SYNTAX);
+        js->state = ST_VALUE;
+        return SUCCESS;
+
+    case ST_STRING:
+        if (!string_char(js, c, &closed)) return FAIL;
+        if (closed)
+        {
+            if (!emit(js, JSON_EV_STRING)) return FAIL;
+            value_done(js);
+        }
+        return SUCCESS;
+
+    case ST_NUMBER:
+        if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-')
+        {
+            tok_add(js, c);
+            return SUCCESS;
+        }
+        if (!emit(js, JSON_EV_NUMBER)) return FAIL;
+        value_done(js);
+        return step(js, c);
+
+    case ST_LITERAL:
+        if (c >= 'a' && c <= 'z')
+        {
+            tok_add(js, c);
+            return SUCCESS;
+        }
+        if (!end_literal(js)) return FAIL;
+        return step(js, c);
+
+    case ST_AFTER_VALUE:
+        if (is_space(c)) return SUCCESS;
+        if (c == '}' || c == ']') return close_container(js, c);
+        if (c != ',') return fail(js, JSON_STREAM_SYNTAX);
+        if (js->container[js->depth - 1] == '{')
+        {
+            js->state = ST_KEY;
+        }
+        else
+        {
+            js->index[js->depth - 1]++;
+            js->state = ST_VALUE;
+        }
+        return SUCCESS;
+
+    case ST_DONE:
+        if (is_space(c)) return SUCCESS;
+        return fail(js, JSON_STREAM_SYNTAX);
+    }
+    return fail(js, JSON_STREAM_SYNTAX);
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void json_stream_init(struct json_stream *js, json_stream_fn fn, void *ctx)
+{
+    if (!js) return;
+
+    memset(js, 0, sizeof(struct json_stream));
+    js->on_event = fn;
+    js->ctx = ctx;
+    js->state = ST_VALUE;
+}
+
+uint8_t json_stream_feed(struct json_stream *js, const char *data, size_t len)
+{
+    if (!js || !js->on_event) return FAIL;
+    if (js->error) return FAIL;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (!step(js, data[i])) return FAIL;
+        js->pos++;
+    }
+    return SUCCESS;
+}
+
+uint8_t json_stream_finish(struct json_stream *js)
+{
+    if (!js || js->error) return FAIL;
+
+    /* A bare number or literal at the root ends with the input */
+    if (js->state == ST_NUMBER && !js->depth)
+    {
+        if (!emit(js, JSON_EV_NUMBER)) return FAIL;
+        js->state = ST_DONE;
+    }
+    else if (js->state == ST_LITERAL && !js->depth)
+    {
+        if (!end_literal(js)) return FAIL;
+    }
+    if (js->state != ST_DONE) return fail(js, JSON_STREAM_INCOMPLETE);
+    return SUCCESS;
+}
+
+uint8_t json_stream_depth(const struct json_stream *js)
+{
+    return js ? js->depth : 0;
+}
+
+const char *json_stream_key(const struct json_stream *js, uint8_t level)
+{
+    if (!js || level >= js->depth || js->container[level] != '{') return "";
+    return js->key[level];
+}
+
+uint32_t json_stream_index(const struct json_stream *js, uint8_t level)
+{
+    if (!js || level >= js->depth || js->container[level] != '[') return 0;
+    return js->index[level];
+}
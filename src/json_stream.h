@@ -0,0 +1,163 @@
+/**
+ * @file json_stream.h
+ * @brief Incremental JSON tokenizer with fixed memory
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Parses a JSON document fed in arbitrary pieces (HTTP body chunks, file
+ * blocks) and reports each value to a callback as it completes, SAX style.
+ * Nothing of the document is kept: memory is the struct itself whatever the
+ * payload size, so configs and boundaries no longer need a size cap.
+ *
+ * Where a value sits is read from the parser inside the callback:
+ * - json_stream_depth(): containers enclosing the value (0 = root value)
+ * - json_stream_key(js, n): member name at level n when that level is an
+ *   object, "" when it is an array
+ * - json_stream_index(js, n): element position at level n in an array
+ *
+ * Container starts are reported before they are entered and ends after they
+ * are left, so both carry the container's own position.
+ *
+ * @par Usage Pattern:
+ * @code
+ * static uint8_t on_event(struct json_stream *js, uint8_t ev, const char *val, size_t len)
+ * {
+ *     // {"config":{"posts":[{"lat":..}]}} -> depth 4, keys config / posts / - / lat
+ *     if (ev == JSON_EV_NUMBER && json_stream_depth(js) == 1 &&
+ *         !strcmp(json_stream_key(js, 0), "version"))
+ *         version = atoll(val);
+ *     return 1;
+ * }
+ *
+ * json_stream_init(&js, on_event, ctx);
+ * while (n = read(buf)) json_stream_feed(&js, buf, n);
+ * ok = json_stream_finish(&js);
+ * @endcode
+ */
+
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_STREAM_DEPTH 8             /**< Deepest nesting accepted */
+#define JSON_STREAM_KEY_MAX 24          /**< Member names are cut to this, with the NUL */
+#define JSON_STREAM_TOKEN_MAX 160       /**< Longest string/number passed whole */
+
+/**
+ * @brief Callback events
+ */
+typedef enum {
+    JSON_EV_OBJECT = 0,                 /**< '{' */
+    JSON_EV_ARRAY,                      /**< '[' */
+    JSON_EV_END,                        /**< '}' or ']' */
+    JSON_EV_STRING,                     /**< Unescaped text */
+    JSON_EV_NUMBER,                     /**< Text as written, for strtod / strtoll */
+    JSON_EV_BOOL,                       /**< "true" or "false" */
+    JSON_EV_NULL
+} json_event_t;
+
+/**
+ * @brief Why parsing stopped
+ */
+typedef enum {
+    JSON_STREAM_OK = 0,
+    JSON_STREAM_SYNTAX,                 /**< Not JSON */
+    JSON_STREAM_TOO_DEEP,               /**< More than JSON_STREAM_DEPTH levels */
+    JSON_STREAM_ABORTED,                /**< Callback returned 0 */
+    JSON_STREAM_INCOMPLETE              /**< Input ended inside the document */
+} json_stream_error_t;
+
+struct json_stream;
+
+/**
+ * @brief Value callback
+ * @param js Parser, for the position of the value
+ * @param ev json_event_t
+ * @param value NUL terminated text for strings, numbers and literals, else ""
+ * @param len Length of value
+ * @return 1 to continue, 0 to stop parsing
+ */
+typedef uint8_t (*json_stream_fn)(struct json_stream *js, uint8_t ev, const char *value, size_t len);
+
+/**
+ * @struct json_stream
+ * @brief Tokenizer state
+ */
+struct json_stream {
+    json_stream_fn on_event;
+    void *ctx;                          /**< For the callback */
+
+    uint8_t state;
+    uint8_t depth;                      /**< Containers open */
+    uint8_t error;                      /**< json_stream_error_t */
+    uint8_t truncated;                  /**< Current value was cut to JSON_STREAM_TOKEN_MAX */
+    uint8_t esc;                        /**< Escape progress inside a string */
+    uint16_t ucode;                     /**< \\u digits so far */
+    uint8_t container[JSON_STREAM_DEPTH];
+    uint32_t index[JSON_STREAM_DEPTH];   /**< Element counts, wide enough for any file SPIFFS holds */
+    char key[JSON_STREAM_DEPTH][JSON_STREAM_KEY_MAX];
+
+    uint16_t tok_len;
+    char tok[JSON_STREAM_TOKEN_MAX + 1];
+    uint32_t pos;                       /**< Bytes consumed, for error reports */
+};
+
+/**
+ * @brief Prepare a parser for a new document
+ * @param js Pointer to parser
+ * @param fn Value callback
+ * @param ctx Caller context, available as js->ctx
+ */
+void json_stream_init(struct json_stream *js, json_stream_fn fn, void *ctx);
+
+/**
+ * @brief Parse the next piece of the document
+ * @param js Pointer to parser
+ * @param data Bytes
+ * @param len Length of data
+ * @return SUCCESS (1), or FAIL (0) once an error is set
+ */
+uint8_t json_stream_feed(struct json_stream *js, const char *data, size_t len);
+
+/**
+ * @brief End of input
+ * @param js Pointer to parser
+ * @return SUCCESS (1) if exactly one complete document was parsed
+ */
+uint8_t json_stream_finish(struct json_stream *js);
+
+/**
+ * @brief Containers enclosing the value being reported
+ * @param js Pointer to parser
+ * @return Depth, 0 for the root value
+ */
+uint8_t json_stream_depth(const struct json_stream *js);
+
+/**
+ * @brief Member name at a level
+ * @param js Pointer to parser
+ * @param level 0 for members of the root object
+ * @return Name, "" for array levels or past the current depth
+ */
+const char *json_stream_key(const struct json_stream *js, uint8_t level);
+
+/**
+ * @brief Element position at a level
+ * @param js Pointer to parser
+ * @param level 0 for elements of the root array
+ * @return Index, 0 for object levels
+ */
+uint32_t json_stream_index(const struct json_stream *js, uint8_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_STREAM_H */
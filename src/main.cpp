@@ -30,7 +30,8 @@ void Task1code(void *pvParameters)
   for (;;)
   {
     App.frameHandlingTask();
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    /* Housekeeping once a second, a requested frame or new config starts at once */
+    app_events_wait(APP_EV_FRAME_REQUEST | APP_EV_CONFIG_CHANGED, FRAME_TASK_PERIOD_MS);
   }
 }
 
@@ -42,7 +43,13 @@ void Task2code(void *pvParameters)
   for (;;)
   {
     App.applicationTask();
-    vTaskDelay(100 / portTICK_PERIOD_MS);
+    /* Between ticks, wake only to put a posted frame event on the link */
+    TickType_t next = xTaskGetTickCount() + pdMS_TO_TICKS(TASK_TICK_MS);
+    for (TickType_t now = xTaskGetTickCount(); (int32_t)(next - now) > 0; now = xTaskGetTickCount())
+    {
+      if (app_events_wait(APP_EV_LINK_TX, (next - now) * portTICK_PERIOD_MS))
+        App.serviceLink();
+    }
   }
 }
 
@@ -64,8 +71,8 @@ void Task3code(void *pvParameters)
 {
   for (;;)
   {
-    App.commandParseTask();
-    vTaskDelay(1000 / portTICK_PERIOD_MS);
+    /* The sensor bus schedules each probe itself, sleep until the next one is due */
+    app_events_wait(APP_EV_SENSOR_BUS, App.commandParseTask());
   }
 }
 
@@ -76,8 +83,8 @@ void Task4code(void *pvParameter)
 {
   for (;;)
   {
-    App.fotaTask();
-    vTaskDelay(100 / portTICK_PERIOD_MS);
+    /* Dormant until firmwareUpdate signals it */
+    app_events_wait(APP_EV_OTA_REQUEST, App.fotaTask());
   }
 }
 /************************************************
@@ -120,7 +127,7 @@ void CreateTasks(int Value)
   xTaskCreatePinnedToCore(
       Task2code,                    /* Task function. */
       "App",                        /* name of task. */
-      20000,                        /* Stack size of task */
+      20000,                        /* Stack size of task, getMetrics stackFree shows the headroom */
       NULL,                         /* parameter of the task */
       3,                            /* priority of the task */
       &applicationTaskHandler,      /* Task handle to keep track of created task */
@@ -172,6 +179,11 @@ void setup()
   if (retValue)
   {
     CreateTasks(retValue);
+    perf_metrics_register_task("Frame", frameHandlingTaskHandler);
+    perf_metrics_register_task("App", applicationTaskHandler);
+    perf_metrics_register_task("Modbus", commandParseTaskHandler);
+    perf_metrics_register_task("OTA", OtaTaskHandler);
+    perf_metrics_register_task("SmartConfig", SmartConfigHandler);
     App.AppWatchdogInit(&frameHandlingTaskHandler, &applicationTaskHandler, &commandParseTaskHandler, &OtaTaskHandler, &SmartConfigHandler);
     debugPrintln("Total 5 Watchdog Init.....");
   }
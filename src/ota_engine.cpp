@@ -0,0 +1,616 @@
+/**
+ * @file ota_engine.cpp
+ * @brief Resumable firmware image writer Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "ota_engine.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <string.h>
+#include "esp32/rom/miniz.h"
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+#define OTA_NVS_NAMESPACE "otaState"
+#define OTA_CHECKPOINT_MAGIC 0x4F544131  /* "OTA1" */
+
+#define OTA_IMAGE_MAGIC 0xE9            /* First byte of an ESP32 app image */
+#define OTA_ZLIB_MAGIC 0x78             /* First byte of a zlib stream */
+#define OTA_DELTA_CTRL_LEN 12
+#define OTA_BASE_READ 256               /* Running image bytes per flash read */
+
+/**
+ * @brief Progress record kept in NVS
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t part_addr;                 /**< Target partition, must not change */
+    uint32_t size;
+    uint32_t offset;                    /**< Sector aligned */
+    uint8_t has_sha;
+    uint8_t sha[32];
+} ota_checkpoint_t;
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+/**
+ * @brief Parse 64 hex digits into 32 bytes
+ */
+static uint8_t parse_sha_hex(const char *hex, uint8_t *out)
+{
+    if (strlen(hex) != 64) return FAIL;
+
+    for (uint8_t i = 0; i < 32; i++)
+    {
+        uint8_t byte = 0;
+        for (uint8_t n = 0; n < 2; n++)
+        {
+            char c = hex[i * 2 + n];
+            byte <<= 4;
+            if (c >= '0' && c <= '9') byte |= c - '0';
+            else if (c >= 'a' && c <= 'f') byte |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') byte |= c - 'A' + 10;
+            else return FAIL;
+        }
+        out[i] = byte;
+    }
+    return SUCCESS;
+}
+
+static uint8_t load_checkpoint(ota_checkpoint_t *ck, char *url, size_t url_len)
+{
+    Preferences prefs;
+    if (!prefs.begin(OTA_NVS_NAMESPACE, true)) return FAIL;
+
+    size_t n = prefs.getBytes("ck", ck, sizeof(ota_checkpoint_t));
+    size_t u = prefs.getString("url", url, url_len);
+    prefs.end();
+    return (n == sizeof(ota_checkpoint_t) && u > 0 && ck->magic == OTA_CHECKPOINT_MAGIC) ? SUCCESS : FAIL;
+}
+
+static void save_checkpoint(struct ota_engine *ota)
+{
+    ota_checkpoint_t ck;
+    memset(&ck, 0, sizeof(ck));
+    ck.magic = OTA_CHECKPOINT_MAGIC;
+    ck.part_addr = ota->part->address;
+    ck.size = ota->size;
+    ck.offset = ota->offset;
+    ck.has_sha = ota->has_sha;
+    memcpy(ck.sha, ota->expect_sha, sizeof(ck.sha));
+
+    Preferences prefs;
+    if (!prefs.begin(OTA_NVS_NAMESPACE, false)) return;
+    prefs.putString("url", ota->url);
+    prefs.putBytes("ck", &ck, sizeof(ck));
+    prefs.end();
+    ota->saved_offset = ota->offset;
+    debugPrintf("[OTA] checkpoint %u/%u\n", (unsigned)ota->offset, (unsigned)ota->size);
+}
+
+/**
+ * @brief Start over from byte 0 with a fresh hash
+ */
+static void restart(struct ota_engine *ota)
+{
+    ota->offset = 0;
+    ota->saved_offset = 0;
+    ota->fill = 0;
+    ota->format = OTA_FORMAT_UNKNOWN;
+    ota->payload = OTA_PAYLOAD_UNKNOWN;
+    ota->stream_done = 0;
+    ota->in_pos = 0;
+    ota->dict_ofs = 0;
+    ota->hdr_len = 0;
+    mbedtls_sha256_free(&ota->sha);
+    mbedtls_sha256_init(&ota->sha);
+    mbedtls_sha256_starts(&ota->sha, 0);
+}
+
+/**
+ * @brief Rebuild the running hash from the sectors already in flash
+ */
+static uint8_t rehash_written(struct ota_engine *ota)
+{
+    for (uint32_t pos = 0; pos < ota->offset; pos += OTA_ENGINE_SECTOR)
+    {
+        if (esp_partition_read(ota->part, pos, ota->sector, OTA_ENGINE_SECTOR) != ESP_OK)
+        {
+            return FAIL;
+        }
+        mbedtls_sha256_update(&ota->sha, ota->sector, OTA_ENGINE_SECTOR);
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief Erase, write and hash the buffered bytes at the current offset
+ */
+static uint8_t flush_sector(struct ota_engine *ota)
+{
+    if (!ota->fill) return SUCCESS;
+
+    if (esp_partition_erase_range(ota->part, ota->offset, OTA_ENGINE_SECTOR) != ESP_OK ||
+        esp_partition_write(ota->part, ota->offset, ota->sector, ota->fill) != ESP_OK)
+    {
+        debugPrintf("[OTA] flash write failed at %u\n", (unsigned)ota->offset);
+        return FAIL;
+    }
+    mbedtls_sha256_update(&ota->sha, ota->sector, ota->fill);
+    ota->offset += ota->fill;
+    ota->fill = 0;
+    return SUCCESS;
+}
+
+/**
+ * @brief Append decoded image bytes, flushing every full sector
+ */
+static uint8_t emit(struct ota_engine *ota, const uint8_t *data, size_t len)
+{
+    if (ota->offset + ota->fill + len > ota->part->size)
+    {
+        debugPrintln("[OTA] image larger than the partition");
+        return FAIL;
+    }
+    while (len)
+    {
+        size_t n = OTA_ENGINE_SECTOR - ota->fill;
+        if (n > len) n = len;
+        memcpy(ota->sector + ota->fill, data, n);
+        ota->fill += n;
+        data += n;
+        len -= n;
+        if (ota->fill == OTA_ENGINE_SECTOR && !flush_sector(ota)) return FAIL;
+    }
+    return SUCCESS;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Check the delta header against the image in the running partition
+ */
+static uint8_t open_delta(struct ota_engine *ota)
+{
+    if (memcmp(ota->hdr, "WMD1", 4) != 0) return FAIL;
+
+    uint32_t old_size = get_le32(ota->hdr + 4);
+    ota->new_size = get_le32(ota->hdr + 8);
+    ota->base = esp_ota_get_running_partition();
+    if (!ota->base || old_size > ota->base->size || ota->new_size > ota->part->size) return FAIL;
+
+    uint8_t chunk[OTA_BASE_READ];
+    uint8_t digest[32];
+    mbedtls_sha256_context base_sha;
+    mbedtls_sha256_init(&base_sha);
+    mbedtls_sha256_starts(&base_sha, 0);
+    for (uint32_t pos = 0; pos < old_size; pos += sizeof(chunk))
+    {
+        uint32_t n = (old_size - pos < sizeof(chunk)) ? old_size - pos : sizeof(chunk);
+        if (esp_partition_read(ota->base, pos, chunk, n) != ESP_OK)
+        {
+            mbedtls_sha256_free(&base_sha);
+            return FAIL;
+        }
+        mbedtls_sha256_update(&base_sha, chunk, n);
+    }
+    mbedtls_sha256_finish(&base_sha, digest);
+    mbedtls_sha256_free(&base_sha);
+    if (memcmp(digest, ota->hdr + 12, 32) != 0)
+    {
+        debugPrintln("[OTA] delta built for another firmware, refused");
+        return FAIL;
+    }
+    ota->old_pos = 0;
+    debugPrintf("[OTA] delta %u -> %u bytes\n", (unsigned)old_size, (unsigned)ota->new_size);
+    return SUCCESS;
+}
+
+/**
+ * @brief Output old[pos + i] + diff[i] for a run of diff bytes
+ */
+static uint8_t apply_add(struct ota_engine *ota, const uint8_t *diff, size_t len)
+{
+    uint8_t chunk[OTA_BASE_READ];
+    while (len)
+    {
+        size_t n = (len < sizeof(chunk)) ? len : sizeof(chunk);
+        if (ota->old_pos + n > ota->base->size ||
+            esp_partition_read(ota->base, ota->old_pos, chunk, n) != ESP_OK)
+        {
+            return FAIL;
+        }
+        for (size_t i = 0; i < n; i++)
+        {
+            chunk[i] += diff[i];
+        }
+        if (!emit(ota, chunk, n)) return FAIL;
+        ota->old_pos += n;
+        diff += n;
+        len -= n;
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief Step past finished add/extra runs, which may be empty
+ */
+static void settle_delta(struct ota_engine *ota)
+{
+    if (ota->payload == OTA_DELTA_ADD && !ota->add_left)
+    {
+        ota->payload = OTA_DELTA_EXTRA;
+    }
+    if (ota->payload == OTA_DELTA_EXTRA && !ota->extra_left)
+    {
+        ota->old_pos += ota->seek;
+        ota->payload = (ota->offset + ota->fill == ota->new_size) ? OTA_DELTA_DONE : OTA_DELTA_CTRL;
+    }
+}
+
+/**
+ * @brief Route inflated bytes: straight out for an image, through the patcher for a delta
+ */
+static uint8_t decode_payload(struct ota_engine *ota, const uint8_t *data, size_t len)
+{
+    while (len)
+    {
+        size_t n;
+        switch (ota->payload)
+        {
+        case OTA_PAYLOAD_UNKNOWN:
+            if (data[0] == OTA_IMAGE_MAGIC)
+                ota->payload = OTA_PAYLOAD_IMAGE;
+            else if (data[0] == 'W')
+                ota->payload = OTA_DELTA_HEADER;
+            else
+                return FAIL;
+            break;
+
+        case OTA_PAYLOAD_IMAGE:
+            return emit(ota, data, len);
+
+        case OTA_DELTA_HEADER:
+        case OTA_DELTA_CTRL:
+        {
+            uint8_t need = (ota->payload == OTA_DELTA_HEADER) ? OTA_DELTA_HEADER_LEN : OTA_DELTA_CTRL_LEN;
+            n = need - ota->hdr_len;
+            if (n > len) n = len;
+            memcpy(ota->hdr + ota->hdr_len, data, n);
+            ota->hdr_len += n;
+            data += n;
+            len -= n;
+            if (ota->hdr_len < need) break;
+            ota->hdr_len = 0;
+            if (ota->payload == OTA_DELTA_HEADER)
+            {
+                if (!open_delta(ota)) return FAIL;
+                ota->payload = OTA_DELTA_CTRL;
+            }
+            else
+            {
+                ota->add_left = get_le32(ota->hdr);
+                ota->extra_left = get_le32(ota->hdr + 4);
+                ota->seek = (int32_t)get_le32(ota->hdr + 8);
+                ota->payload = OTA_DELTA_ADD;
+                settle_delta(ota);
+            }
+            break;
+        }
+
+        case OTA_DELTA_ADD:
+            n = (ota->add_left < len) ? ota->add_left : len;
+            if (!apply_add(ota, data, n)) return FAIL;
+            ota->add_left -= n;
+            data += n;
+            len -= n;
+            settle_delta(ota);
+            break;
+
+        case OTA_DELTA_EXTRA:
+            n = (ota->extra_left < len) ? ota->extra_left : len;
+            if (!emit(ota, data, n)) return FAIL;
+            ota->extra_left -= n;
+            data += n;
+            len -= n;
+            settle_delta(ota);
+            break;
+
+        default:
+            /* Bytes after the last record */
+            return FAIL;
+        }
+    }
+    return SUCCESS;
+}
+
+/**
+ * @brief Run encoded input through the inflater and on to the payload decoder
+ */
+static uint8_t inflate_input(struct ota_engine *ota, const uint8_t *in, size_t len)
+{
+    tinfl_decompressor *inf = (tinfl_decompressor *)ota->inflater;
+    while (!ota->stream_done)
+    {
+        size_t in_bytes = len;
+        size_t out_bytes = TINFL_LZ_DICT_SIZE - ota->dict_ofs;
+        tinfl_status st = tinfl_decompress(inf, in, &in_bytes, ota->dict, ota->dict + ota->dict_ofs, &out_bytes,
+                                           TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        in += in_bytes;
+        len -= in_bytes;
+        if (out_bytes && !decode_payload(ota, ota->dict + ota->dict_ofs, out_bytes)) return FAIL;
+        ota->dict_ofs = (ota->dict_ofs + out_bytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+        if (st < TINFL_STATUS_DONE)
+        {
+            debugPrintf("[OTA] corrupt zlib stream (%d)\n", st);
+            return FAIL;
+        }
+        if (st == TINFL_STATUS_DONE)
+        {
+            ota->stream_done = 1;
+        }
+        else if (st == TINFL_STATUS_NEEDS_MORE_INPUT && !len)
+        {
+            break;
+        }
+        else if (!in_bytes && !out_bytes)
+        {
+            return FAIL;
+        }
+    }
+    /* Bytes after the end of the stream mean a corrupt download */
+    return len ? FAIL : SUCCESS;
+}
+
+/**
+ * @brief Pick the pipeline from the first byte of the download
+ */
+static uint8_t detect_format(struct ota_engine *ota)
+{
+    if (ota->sector[0] == OTA_IMAGE_MAGIC)
+    {
+        ota->format = OTA_FORMAT_RAW;
+        return SUCCESS;
+    }
+    if (ota->sector[0] != OTA_ZLIB_MAGIC) return FAIL;
+
+    if (!ota->inflater) ota->inflater = malloc(sizeof(tinfl_decompressor));
+    if (!ota->dict) ota->dict = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+    if (!ota->inflater || !ota->dict)
+    {
+        debugPrintln("[OTA] no memory for the inflater");
+        return FAIL;
+    }
+    tinfl_init((tinfl_decompressor *)ota->inflater);
+    ota->format = OTA_FORMAT_ZLIB;
+    ota->fill = 0;
+    ota->in_pos = 1;
+    ota->in_buf[0] = ota->sector[0];
+    return inflate_input(ota, ota->in_buf, 1);
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+uint8_t ota_engine_begin(struct ota_engine *ota, const char *url, const char *sha256_hex)
+{
+    if (!ota || !url) return FAIL;
+
+    memset(ota, 0, sizeof(struct ota_engine));
+    mbedtls_sha256_init(&ota->sha);
+    size_t url_len = strlen(url);
+    if (url_len >= sizeof(ota->url))
+    {
+        Serial.printf("[OTA] URL of %u bytes is over the %u byte limit, refused\n",
+                      (unsigned)url_len, (unsigned)(sizeof(ota->url) - 1));
+        return FAIL;
+    }
+    memcpy(ota->url, url, url_len + 1);
+
+    ota->part = esp_ota_get_next_update_partition(NULL);
+    if (!ota->part) return FAIL;
+
+    if (sha256_hex && sha256_hex[0])
+    {
+        if (!parse_sha_hex(sha256_hex, ota->expect_sha)) return FAIL;
+        ota->has_sha = 1;
+    }
+
+    restart(ota);
+
+    ota_checkpoint_t ck;
+    char saved_url[OTA_ENGINE_URL_MAX];
+    if (load_checkpoint(&ck, saved_url, sizeof(saved_url)) &&
+        strcmp(saved_url, ota->url) == 0 &&
+        ck.part_addr == ota->part->address &&
+        ck.offset % OTA_ENGINE_SECTOR == 0 && ck.offset <= ck.size &&
+        (!ota->has_sha || (ck.has_sha && memcmp(ck.sha, ota->expect_sha, 32) == 0)))
+    {
+        ota->size = ck.size;
+        ota->offset = ck.offset;
+        ota->saved_offset = ck.offset;
+        if (ck.offset) ota->format = OTA_FORMAT_RAW;
+        if (!ota->has_sha && ck.has_sha)
+        {
+            memcpy(ota->expect_sha, ck.sha, 32);
+            ota->has_sha = 1;
+        }
+        if (rehash_written(ota))
+        {
+            debugPrintf("[OTA] resuming at %u/%u\n", (unsigned)ota->offset, (unsigned)ota->size);
+            return SUCCESS;
+        }
+        ota->size = 0;
+        restart(ota);
+    }
+
+    ota_engine_clear();
+    return SUCCESS;
+}
+
+uint8_t ota_engine_set_size(struct ota_engine *ota, uint32_t size)
+{
+    if (!ota || !ota->part || size == 0 || size > ota->part->size) return FAIL;
+
+    if (ota->size != size)
+    {
+        if (ota->size)
+        {
+            debugPrintln("[OTA] image size changed, starting over");
+        }
+        ota->size = size;
+        restart(ota);
+        save_checkpoint(ota);
+    }
+    return SUCCESS;
+}
+
+uint32_t ota_engine_offset(const struct ota_engine *ota)
+{
+    if (!ota) return 0;
+    return (ota->format == OTA_FORMAT_ZLIB) ? ota->in_pos : ota->offset + ota->fill;
+}
+
+uint8_t *ota_engine_buffer(struct ota_engine *ota, size_t *room)
+{
+    uint32_t pos = ota_engine_offset(ota);
+    size_t left = (ota->size > pos) ? ota->size - pos : 0;
+    size_t free_bytes;
+    uint8_t *dst;
+    if (ota->format == OTA_FORMAT_ZLIB)
+    {
+        free_bytes = sizeof(ota->in_buf);
+        dst = ota->in_buf;
+    }
+    else
+    {
+        /* A single byte first, it tells which buffer the rest goes to */
+        free_bytes = (ota->format == OTA_FORMAT_UNKNOWN) ? 1 : OTA_ENGINE_SECTOR - ota->fill;
+        dst = ota->sector + ota->fill;
+    }
+    *room = (left < free_bytes) ? left : free_bytes;
+    return dst;
+}
+
+uint8_t ota_engine_commit(struct ota_engine *ota, size_t len)
+{
+    if (!ota || !len) return ota ? SUCCESS : FAIL;
+
+    if (ota->format == OTA_FORMAT_ZLIB)
+    {
+        if (len > sizeof(ota->in_buf)) return FAIL;
+        ota->in_pos += len;
+        return inflate_input(ota, ota->in_buf, len);
+    }
+    if (ota->fill + len > OTA_ENGINE_SECTOR) return FAIL;
+
+    ota->fill += len;
+    if (ota->format == OTA_FORMAT_UNKNOWN)
+    {
+        return detect_format(ota);
+    }
+    if (ota->fill == OTA_ENGINE_SECTOR)
+    {
+        if (!flush_sector(ota)) return FAIL;
+        if (ota->offset - ota->saved_offset >= OTA_ENGINE_SAVE_EVERY * OTA_ENGINE_SECTOR)
+        {
+            save_checkpoint(ota);
+        }
+    }
+    return SUCCESS;
+}
+
+uint8_t ota_engine_done(const struct ota_engine *ota)
+{
+    return (ota && ota->size && ota_engine_offset(ota) >= ota->size) ? 1 : 0;
+}
+
+void ota_engine_end(struct ota_engine *ota)
+{
+    if (!ota) return;
+
+    free(ota->inflater);
+    free(ota->dict);
+    ota->inflater = NULL;
+    ota->dict = NULL;
+    mbedtls_sha256_free(&ota->sha);
+}
+
+void ota_engine_checkpoint(struct ota_engine *ota)
+{
+    /* Only whole sectors are on flash; the partial one is fetched again.
+       Inflater state cannot be saved, encoded downloads restart after a reboot */
+    if (ota && ota->part && ota->size && ota->format == OTA_FORMAT_RAW && ota->offset != ota->saved_offset)
+    {
+        save_checkpoint(ota);
+    }
+}
+
+uint8_t ota_engine_finish(struct ota_engine *ota)
+{
+    if (!ota || !ota_engine_done(ota)) return FAIL;
+
+    uint8_t ok = flush_sector(ota);
+    if (ota->format == OTA_FORMAT_ZLIB &&
+        (!ota->stream_done || (ota->payload != OTA_PAYLOAD_IMAGE && ota->payload != OTA_DELTA_DONE)))
+    {
+        debugPrintln("[OTA] encoded download ended early");
+        ok = FAIL;
+    }
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&ota->sha, digest);
+    ota_engine_clear();
+
+    if (!ok) return FAIL;
+    if (ota->has_sha && memcmp(digest, ota->expect_sha, sizeof(digest)) != 0)
+    {
+        debugPrintln("[OTA] SHA-256 mismatch, image rejected");
+        return FAIL;
+    }
+    /* Runs the bootloader's own image check before switching */
+    esp_err_t err = esp_ota_set_boot_partition(ota->part);
+    if (err != ESP_OK)
+    {
+        debugPrintf("[OTA] image invalid, err %d\n", err);
+        return FAIL;
+    }
+    debugPrintln("[OTA] image verified, boot partition switched");
+    return SUCCESS;
+}
+
+void ota_engine_clear(void)
+{
+    Preferences prefs;
+    if (!prefs.begin(OTA_NVS_NAMESPACE, false)) return;
+    prefs.clear();
+    prefs.end();
+}
+
+uint8_t ota_engine_pending(char *url, size_t len)
+{
+    ota_checkpoint_t ck;
+    if (!url || !len) return 0;
+    return load_checkpoint(&ck, url, len) ? 1 : 0;
+}
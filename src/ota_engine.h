@@ -0,0 +1,234 @@
+/**
+ * @file ota_engine.h
+ * @brief Resumable firmware image writer with SHA-256 verification
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Writes a firmware image sector by sector into the next OTA partition and
+ * checkpoints progress in NVS, so a download cut by a WiFi drop or a reboot
+ * continues from the last committed sector instead of byte 0. The transport
+ * (HTTP Range requests in http_ops.cpp) only has to fetch from
+ * ota_engine_offset() onwards.
+ *
+ * - Network reads land directly in the sector buffer (ota_engine_buffer /
+ *   ota_engine_commit), no intermediate copy.
+ * - A full sector is erased and written, then hashed.
+ * - The checkpoint holds the full URL, image size, partition, committed
+ *   offset and the expected hash. A URL that does not fit is refused, so a
+ *   resume can never match a cut-down URL. The running SHA-256 is not stored: the hardware SHA
+ *   context cannot be saved, so on resume it is rebuilt from the flash
+ *   already written.
+ * - ota_engine_finish() compares the hash before the boot partition is
+ *   switched; the bootloader image check runs after it.
+ *
+ * The download may also be encoded, detected from its first byte:
+ * - 0xE9: plain ESP32 image, written as received.
+ * - 0x78: zlib stream, inflated with the ROM miniz into the sector buffer.
+ *   It holds either a full image (0xE9...) or a delta patch ("WMD1"), see
+ *   below. Produced by ota_pack.py from the build output.
+ *
+ * Delta patch, little endian, bsdiff-style records against the image in the
+ * running partition:
+ * @code
+ * "WMD1" | u32 old_size | u32 new_size | sha256(old image)[32]
+ * { u32 add_len | u32 extra_len | i32 seek | add_len diff bytes | extra_len bytes }...
+ * @endcode
+ * Each record outputs old[pos + i] + diff[i] for add_len bytes, then the
+ * extra bytes verbatim, then moves pos by add_len + seek. A patch for a
+ * different base image is refused before anything is written.
+ *
+ * The expected hash is always that of the final image. The inflater state
+ * lives in RAM only, so an encoded download resumes after a dropped
+ * connection but restarts after a reboot; only plain images are
+ * checkpointed.
+ *
+ * @par Usage Pattern:
+ * @code
+ * ota_engine_begin(ota, url, sha256_hex);
+ * // GET Range: bytes=<ota_engine_offset()>-..., learn the total size
+ * ota_engine_set_size(ota, total);
+ * while (reading) {
+ *     size_t room;
+ *     uint8_t *dst = ota_engine_buffer(ota, &room);
+ *     ota_engine_commit(ota, stream->readBytes(dst, room));
+ * }
+ * if (ota_engine_done(ota)) ota_engine_finish(ota);   // reboot to apply
+ * else ota_engine_checkpoint(ota);                    // resume later
+ * @endcode
+ */
+
+#ifndef OTA_ENGINE_H
+#define OTA_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_partition.h>
+#include "mbedtls/sha256.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_ENGINE_SECTOR 4096          /**< Flash erase unit, bytes */
+#define OTA_ENGINE_CHUNK (64 * 1024)    /**< Bytes per Range request */
+#define OTA_ENGINE_SAVE_EVERY 16        /**< Sectors between NVS checkpoints */
+#define OTA_ENGINE_URL_MAX 512          /**< Longest URL with its NUL; longer ones are refused, never cut */
+#define OTA_ENGINE_IN_BUF 1460          /**< Encoded bytes per read, one TCP segment */
+#define OTA_DELTA_HEADER_LEN 44
+
+/**
+ * @brief Encoding of the downloaded bytes
+ */
+typedef enum {
+    OTA_FORMAT_UNKNOWN = 0,             /**< Nothing received yet */
+    OTA_FORMAT_RAW,
+    OTA_FORMAT_ZLIB
+} ota_format_t;
+
+/**
+ * @brief What the inflated stream carries, and where a delta patch stands
+ */
+typedef enum {
+    OTA_PAYLOAD_UNKNOWN = 0,
+    OTA_PAYLOAD_IMAGE,
+    OTA_DELTA_HEADER,
+    OTA_DELTA_CTRL,
+    OTA_DELTA_ADD,
+    OTA_DELTA_EXTRA,
+    OTA_DELTA_DONE
+} ota_payload_t;
+
+/**
+ * @struct ota_engine
+ * @brief One image download in progress
+ */
+struct ota_engine {
+    const esp_partition_t *part;        /**< Target OTA partition */
+    uint32_t size;                      /**< Download size, 0 until known */
+    uint32_t offset;                    /**< Image bytes written to flash */
+    uint32_t saved_offset;              /**< Offset in the NVS checkpoint */
+    uint16_t fill;                      /**< Bytes waiting in sector[] */
+    uint8_t has_sha;                    /**< expect_sha is valid */
+    uint8_t expect_sha[32];
+    mbedtls_sha256_context sha;         /**< Hash of bytes written so far */
+    char url[OTA_ENGINE_URL_MAX];
+    uint8_t sector[OTA_ENGINE_SECTOR];
+
+    /* Encoded downloads */
+    uint8_t format;                     /**< ota_format_t */
+    uint8_t payload;                    /**< ota_payload_t */
+    uint8_t stream_done;                /**< Inflater reached the end of the zlib stream */
+    uint32_t in_pos;                    /**< Encoded bytes consumed */
+    void *inflater;                     /**< tinfl_decompressor, heap, zlib only */
+    uint8_t *dict;                      /**< 32 KB inflate window, heap, zlib only */
+    uint16_t dict_ofs;
+    uint8_t in_buf[OTA_ENGINE_IN_BUF];
+
+    /* Delta patch state */
+    const esp_partition_t *base;        /**< Running partition the patch applies to */
+    uint8_t hdr[OTA_DELTA_HEADER_LEN];  /**< Header or record being collected */
+    uint8_t hdr_len;
+    uint32_t new_size;
+    uint32_t old_pos;
+    uint32_t add_left;
+    uint32_t extra_left;
+    int32_t seek;
+};
+
+/**
+ * @brief Start or resume a download
+ *
+ * Resumes when the NVS checkpoint is for the same URL and hash (or no hash
+ * is given), otherwise starts from 0 and drops the old checkpoint.
+ *
+ * @param ota Pointer to engine structure
+ * @param url Firmware URL, shorter than OTA_ENGINE_URL_MAX
+ * @param sha256_hex Expected image hash, 64 hex digits, or NULL/"" for none
+ * @return SUCCESS (1) or FAIL (0) (URL too long, no OTA partition, bad hash string)
+ */
+uint8_t ota_engine_begin(struct ota_engine *ota, const char *url, const char *sha256_hex);
+
+/**
+ * @brief Record the download size reported by the server
+ *
+ * A size different from the checkpoint restarts the download from 0.
+ *
+ * @param ota Pointer to engine structure
+ * @param size Total download size in bytes
+ * @return SUCCESS (1), or FAIL (0) if it cannot fit the partition
+ */
+uint8_t ota_engine_set_size(struct ota_engine *ota, uint32_t size);
+
+/**
+ * @brief Next byte of the download to request
+ * @param ota Pointer to engine structure
+ * @return Offset into the downloaded file (image or encoded)
+ */
+uint32_t ota_engine_offset(const struct ota_engine *ota);
+
+/**
+ * @brief Where the next network read goes: the sector buffer, or the
+ *        encoded input buffer once the download is known to be zlib
+ * @param ota Pointer to engine structure
+ * @param room Bytes that can be written at the returned pointer
+ * @return Write pointer
+ */
+uint8_t *ota_engine_buffer(struct ota_engine *ota, size_t *room);
+
+/**
+ * @brief Account bytes read into ota_engine_buffer(), decoding and flushing full sectors
+ * @param ota Pointer to engine structure
+ * @param len Bytes read
+ * @return SUCCESS (1), or FAIL (0) on a flash error, corrupt stream or wrong delta base
+ */
+uint8_t ota_engine_commit(struct ota_engine *ota, size_t len);
+
+/**
+ * @brief Whether every byte of the download has been received
+ * @param ota Pointer to engine structure
+ * @return 1 if complete
+ */
+uint8_t ota_engine_done(const struct ota_engine *ota);
+
+/**
+ * @brief Release the inflate buffers; call before freeing the engine
+ * @param ota Pointer to engine structure
+ */
+void ota_engine_end(struct ota_engine *ota);
+
+/**
+ * @brief Save the committed offset so a reboot can resume (plain images only)
+ * @param ota Pointer to engine structure
+ */
+void ota_engine_checkpoint(struct ota_engine *ota);
+
+/**
+ * @brief Flush, verify the hash and make the image the boot partition
+ *
+ * The checkpoint is dropped whatever the result; a bad image has to be
+ * downloaded again.
+ *
+ * @param ota Pointer to engine structure
+ * @return SUCCESS (1) if the device can reboot into the new image
+ */
+uint8_t ota_engine_finish(struct ota_engine *ota);
+
+/**
+ * @brief Forget any checkpoint in NVS
+ */
+void ota_engine_clear(void);
+
+/**
+ * @brief URL of an unfinished download, for resuming after a reboot
+ * @param url Buffer for the URL
+ * @param len Size of url
+ * @return 1 if a checkpoint exists
+ */
+uint8_t ota_engine_pending(char *url, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OTA_ENGINE_H */
@@ -0,0 +1,192 @@
+/**
+ * @file perf_metrics.cpp
+ * @brief Latency histograms, event counters and task watermarks Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "perf_metrics.h"
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SUCCESS 1
+#define FAIL 0
+
+#define PERF_FIRST_BUCKET_BITS 6        /* Bucket 0 ends at 2^6 us */
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static struct perf_hist s_probes[PERF_PROBE_COUNT];
+static uint32_t s_counters[PERF_COUNTER_COUNT];
+
+static struct {
+    const char *name;
+    TaskHandle_t handle;
+} s_tasks[PERF_MAX_TASKS];
+static uint8_t s_taskCount;
+
+static const char *const kProbeNames[PERF_PROBE_COUNT] = {
+    "pondLookup", "frameBuild", "http", "modbus", "display", "fsIo"
+};
+
+static const char *const kCounterNames[PERF_COUNTER_COUNT] = {
+    "httpFail", "frameToBackup", "fsError"
+};
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+/**
+ * @brief Bucket of a duration: two bits of magnitude per bucket
+ */
+static uint8_t bucket_of(uint32_t us)
+{
+    uint8_t bits = (uint8_t)(32 - __builtin_clz(us | 1));
+    if (bits <= PERF_FIRST_BUCKET_BITS) return 0;
+    uint8_t b = (uint8_t)((bits - PERF_FIRST_BUCKET_BITS + 1) / 2);
+    return (b < PERF_HIST_BUCKETS) ? b : PERF_HIST_BUCKETS - 1;
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void perf_metrics_init(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(s_probes, 0, sizeof(s_probes));
+    memset(s_counters, 0, sizeof(s_counters));
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void perf_metrics_register_task(const char *name, TaskHandle_t task)
+{
+    if (!task || s_taskCount >= PERF_MAX_TASKS) return;
+    s_tasks[s_taskCount].name = name;
+    s_tasks[s_taskCount].handle = task;
+    s_taskCount++;
+}
+
+uint32_t perf_metrics_now(void)
+{
+    return (uint32_t)esp_timer_get_time();
+}
+
+void perf_metrics_record(uint8_t probe, uint32_t start_us)
+{
+    if (probe >= PERF_PROBE_COUNT) return;
+
+    uint32_t us = perf_metrics_now() - start_us;
+    uint8_t b = bucket_of(us);
+    struct perf_hist *h = &s_probes[probe];
+
+    portENTER_CRITICAL(&s_lock);
+    h->count++;
+    h->total_us += us;
+    if (us > h->max_us) h->max_us = us;
+    h->buckets[b]++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void perf_metrics_count(uint8_t counter)
+{
+    if (counter >= PERF_COUNTER_COUNT) return;
+
+    portENTER_CRITICAL(&s_lock);
+    s_counters[counter]++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void perf_metrics_get(uint8_t probe, struct perf_hist *out)
+{
+    if (!out) return;
+    if (probe >= PERF_PROBE_COUNT)
+    {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    *out = s_probes[probe];
+    portEXIT_CRITICAL(&s_lock);
+}
+
+uint32_t perf_metrics_counter(uint8_t counter)
+{
+    return (counter < PERF_COUNTER_COUNT) ? s_counters[counter] : 0;
+}
+
+uint32_t perf_metrics_bucket_limit(uint8_t bucket)
+{
+    if (bucket >= PERF_HIST_BUCKETS - 1) return UINT32_MAX;
+    return 1UL << (PERF_FIRST_BUCKET_BITS + 2 * bucket);
+}
+
+uint32_t perf_metrics_percentile(const struct perf_hist *h, uint8_t pct)
+{
+    if (!h || !h->count) return 0;
+
+    uint32_t rank = (uint32_t)(((uint64_t)h->count * pct + 99) / 100);
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < PERF_HIST_BUCKETS; b++)
+    {
+        seen += h->buckets[b];
+        if (seen >= rank)
+        {
+            /* The open-ended bucket reports the largest sample instead */
+            uint32_t limit = perf_metrics_bucket_limit(b);
+            return (limit < h->max_us) ? limit : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+uint8_t perf_metrics_task(uint8_t i, const char **name, uint32_t *stack_free)
+{
+    if (i >= s_taskCount) return FAIL;
+    if (name) *name = s_tasks[i].name;
+    if (stack_free) *stack_free = uxTaskGetStackHighWaterMark(s_tasks[i].handle);
+    return SUCCESS;
+}
+
+const char *perf_metrics_probe_name(uint8_t probe)
+{
+    return (probe < PERF_PROBE_COUNT) ? kProbeNames[probe] : "unknown";
+}
+
+const char *perf_metrics_counter_name(uint8_t counter)
+{
+    return (counter < PERF_COUNTER_COUNT) ? kCounterNames[counter] : "unknown";
+}
+
+size_t perf_metrics_ping_query(char *buf, size_t len)
+{
+    if (!buf || !len) return 0;
+
+    uint32_t minStack = UINT32_MAX;
+    for (uint8_t i = 0; i < s_taskCount; i++)
+    {
+        uint32_t free_ = uxTaskGetStackHighWaterMark(s_tasks[i].handle);
+        if (free_ < minStack) minStack = free_;
+    }
+    if (minStack == UINT32_MAX) minStack = 0;
+
+    int n = snprintf(buf, len, "up=%lu&heap=%lu&stack=%lu&p90=",
+                     (unsigned long)(esp_timer_get_time() / 1000000),
+                     (unsigned long)esp_get_minimum_free_heap_size(), (unsigned long)minStack);
+    for (uint8_t p = 0; p < PERF_PROBE_COUNT && n > 0 && (size_t)n < len; p++)
+    {
+        struct perf_hist h;
+        perf_metrics_get(p, &h);
+        n += snprintf(buf + n, len - n, p ? ",%lu" : "%lu",
+                      (unsigned long)((perf_metrics_percentile(&h, 90) + 999) / 1000));
+    }
+    if (n <= 0 || (size_t)n >= len)
+    {
+        buf[0] = '\0';
+        return 0;
+    }
+    return (size_t)n;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file perf_metrics.h
+ * @brief Latency histograms, event counters and task watermarks
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Hot paths are timed with esp_timer (microseconds) into one fixed
+ * histogram per probe. Buckets grow by 4x from 64 us, so twelve of them
+ * cover a display redraw and a 30 s HTTP timeout alike:
+ * @code
+ * bucket  0: < 64 us      bucket  6: < 262 ms
+ * bucket  1: < 256 us     bucket  7: < 1 s
+ * bucket  2: < 1 ms       bucket  8: < 4 s
+ * bucket  3: < 4 ms       bucket  9: < 16 s
+ * bucket  4: < 16 ms      bucket 10: < 67 s
+ * bucket  5: < 65 ms      bucket 11: longer
+ * @endcode
+ * A sample costs two timer reads, a count-leading-zeros and a few adds
+ * under a spinlock. test_perf_metrics measures it against a frame build,
+ * the shortest timed path; the others wait on a bus, a radio or flash.
+ *
+ * Stack watermarks of registered tasks and heap figures are read when the
+ * metrics are reported, not sampled.
+ *
+ * Build with -DPERF_METRICS=0 to compile the probes out; the report then
+ * only carries heap and stack figures.
+ *
+ * @par Usage Pattern:
+ * @code
+ * perf_metrics_init();
+ * perf_metrics_register_task("App", appTaskHandle);
+ *
+ * void redraw() { PERF_SCOPE(PERF_DISPLAY); ... }         // C++ scope
+ *
+ * uint32_t t0 = PERF_NOW();                                // explicit span
+ * build();
+ * PERF_RECORD(PERF_FRAME_BUILD, t0);
+ *
+ * if (!ok) PERF_COUNT(PERF_CNT_HTTP_FAIL);
+ * @endcode
+ */
+
+#ifndef PERF_METRICS_H
+#define PERF_METRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#ifndef PERF_METRICS
+#define PERF_METRICS 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PERF_HIST_BUCKETS 12
+#define PERF_MAX_TASKS 6
+
+/**
+ * @brief Timed paths
+ */
+typedef enum {
+    PERF_POND_LOOKUP = 0,               /**< Geofence search for the current pond */
+    PERF_FRAME_BUILD,                   /**< Data frame serialization */
+    PERF_HTTP,                          /**< One REST request, connect to last byte */
+    PERF_MODBUS,                        /**< One probe read transaction */
+    PERF_DISPLAY,                       /**< Screen update */
+    PERF_FS_IO,                         /**< Backup file read or write */
+    PERF_PROBE_COUNT
+} perf_probe_t;
+
+/**
+ * @brief Events without a duration
+ */
+typedef enum {
+    PERF_CNT_HTTP_FAIL = 0,             /**< REST request without a 200 */
+    PERF_CNT_FRAME_BACKUP,              /**< Frame stored instead of uploaded */
+    PERF_CNT_FS_ERROR,                  /**< Backup write that failed */
+    PERF_COUNTER_COUNT
+} perf_counter_t;
+
+/**
+ * @brief One probe's histogram
+ */
+struct perf_hist {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[PERF_HIST_BUCKETS];
+};
+
+/**
+ * @brief Clear all probes and counters
+ */
+void perf_metrics_init(void);
+
+/**
+ * @brief Watch a task's stack watermark
+ * @param name Task name for the report (kept by pointer)
+ * @param task Task handle
+ */
+void perf_metrics_register_task(const char *name, TaskHandle_t task);
+
+/**
+ * @brief Current esp_timer time, the start of a span
+ * @return Microseconds since boot, truncated to 32 bits
+ */
+uint32_t perf_metrics_now(void);
+
+/**
+ * @brief Add one span ending now
+ * @param probe perf_probe_t
+ * @param start_us perf_metrics_now() at the start
+ */
+void perf_metrics_record(uint8_t probe, uint32_t start_us);
+
+/**
+ * @brief Increment a counter
+ * @param counter perf_counter_t
+ */
+void perf_metrics_count(uint8_t counter);
+
+/**
+ * @brief Consistent copy of a probe
+ * @param probe perf_probe_t
+ * @param out Destination
+ */
+void perf_metrics_get(uint8_t probe, struct perf_hist *out);
+
+/**
+ * @brief Read a counter
+ * @param counter perf_counter_t
+ * @return Value since boot
+ */
+uint32_t perf_metrics_counter(uint8_t counter);
+
+/**
+ * @brief Upper bound of the bucket holding a percentile
+ * @param h Probe copy
+ * @param pct 1-100
+ * @return Microseconds, 0 when the probe has no samples
+ */
+uint32_t perf_metrics_percentile(const struct perf_hist *h, uint8_t pct);
+
+/**
+ * @brief Upper bound of a bucket
+ * @param bucket 0 to PERF_HIST_BUCKETS - 1
+ * @return Microseconds, UINT32_MAX for the last bucket
+ */
+uint32_t perf_metrics_bucket_limit(uint8_t bucket);
+
+/**
+ * @brief Registered task by position
+ * @param i 0 to perf_metrics_task_count() - 1
+ * @param name Task name
+ * @param stack_free Lowest free stack seen by FreeRTOS, bytes
+ * @return SUCCESS (1), or FAIL (0) past the last task
+ */
+uint8_t perf_metrics_task(uint8_t i, const char **name, uint32_t *stack_free);
+
+/**
+ * @brief Name of a probe for reports
+ * @param probe perf_probe_t
+ * @return Constant string
+ */
+const char *perf_metrics_probe_name(uint8_t probe);
+
+/**
+ * @brief Name of a counter for reports
+ * @param counter perf_counter_t
+ * @return Constant string
+ */
+const char *perf_metrics_counter_name(uint8_t counter);
+
+/**
+ * @brief Compact summary for the ping query string
+ * @param buf Output, e.g. "up=3600&heap=41200&stack=812&p90=12,3,410,38,21,6"
+ *            (uptime s, minimum free heap, smallest stack watermark, p90 ms per probe)
+ * @param len Size of buf
+ * @return Length written, 0 if it did not fit
+ */
+size_t perf_metrics_ping_query(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+
+/**
+ * @brief Records the enclosing scope into a probe
+ */
+class CPerfScope
+{
+public:
+    explicit CPerfScope(uint8_t probe) : m_u8Probe(probe), m_u32Start(perf_metrics_now()) {}
+    ~CPerfScope() { perf_metrics_record(m_u8Probe, m_u32Start); }
+
+private:
+    uint8_t m_u8Probe;
+    uint32_t m_u32Start;
+};
+#endif
+
+#if PERF_METRICS
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_SCOPE(probe) CPerfScope PERF_CONCAT(perfScope_, __LINE__)(probe)
+#define PERF_NOW() perf_metrics_now()
+#define PERF_RECORD(probe, start) perf_metrics_record((probe), (start))
+#define PERF_COUNT(counter) perf_metrics_count(counter)
+#else
+#define PERF_SCOPE(probe)
+#define PERF_NOW() 0
+#define PERF_RECORD(probe, start) ((void)(start))
+#define PERF_COUNT(counter)
+#endif
+
+#endif /* PERF_METRICS_H */
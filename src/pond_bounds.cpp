@@ -0,0 +1,244 @@
+/**
+ * @file pond_bounds.cpp
+ * @brief Pond boundary store Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "pond_bounds.h"
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+static uint8_t flush_block(struct pond_bounds_ingest *in)
+{
+    size_t bytes = in->fill * sizeof(position_t);
+    if (bytes && in->file.write((const uint8_t *)in->block, bytes) != bytes)
+    {
+        in->write_error = 1;
+        return FAIL;
+    }
+    in->hdr.count += in->fill;
+    in->fill = 0;
+    return SUCCESS;
+}
+
+/**
+ * @brief Pick locationVersion and config.posts[].lat/lng out of the response
+ */
+static uint8_t on_event(struct json_stream *js, uint8_t ev, const char *value, size_t len)
+{
+    (void)len;
+    struct pond_bounds_ingest *in = (struct pond_bounds_ingest *)js->ctx;
+    uint8_t depth = json_stream_depth(js);
+
+    if (depth == 1 && ev == JSON_EV_NUMBER && !strcmp(json_stream_key(js, 0), "locationVersion"))
+    {
+        in->hdr.location_version = (int32_t)strtol(value, NULL, 10);
+        in->has_version = 1;
+        return 1;
+    }
+
+    bool inPosts = depth >= 3 && !strcmp(json_stream_key(js, 0), "config") &&
+                   !strcmp(json_stream_key(js, 1), "posts");
+    if (!inPosts) return 1;
+
+    if (depth == 3 && ev == JSON_EV_OBJECT)
+    {
+        in->have = 0;
+    }
+    else if (depth == 4 && (ev == JSON_EV_NUMBER || ev == JSON_EV_STRING))
+    {
+        const char *key = json_stream_key(js, 3);
+        if (!strcmp(key, "lat"))
+        {
+            in->pt.lat = strtod(value, NULL);
+            in->have |= 1;
+        }
+        else if (!strcmp(key, "lng"))
+        {
+            in->pt.lng = strtod(value, NULL);
+            in->have |= 2;
+        }
+    }
+    else if (depth == 3 && ev == JSON_EV_END && in->have == 3)
+    {
+        in->block[in->fill++] = in->pt;
+        if (in->fill == POND_BOUNDS_BLOCK && !flush_block(in)) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Feed every point of a pond file into a scan and close it
+ */
+static uint8_t scan_pond(const char *pond_name, position_t point, struct geofence_scan *scan)
+{
+    char path[POND_BOUNDS_PATH_MAX];
+    pond_bounds_path(pond_name, path, sizeof(path));
+    File file = SPIFFS.open(path, FILE_READ);
+    if (!file || file.isDirectory()) return FAIL;
+
+    struct pond_bounds_hdr hdr;
+    if ((size_t)file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr) || hdr.magic != POND_BOUNDS_MAGIC)
+    {
+        file.close();
+        return FAIL;
+    }
+
+    position_t block[POND_BOUNDS_BLOCK];
+    geofence_scan_begin(scan, point);
+    uint32_t left = hdr.count;
+    while (left)
+    {
+        uint32_t n = (left < POND_BOUNDS_BLOCK) ? left : POND_BOUNDS_BLOCK;
+        if ((size_t)file.read((uint8_t *)block, n * sizeof(position_t)) != n * sizeof(position_t))
+        {
+            file.close();
+            return FAIL;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            geofence_scan_add(scan, block[i]);
+        }
+        left -= n;
+    }
+    file.close();
+    return (geofence_scan_end(scan) >= 0) ? SUCCESS : FAIL;
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void pond_bounds_path(const char *pond_name, char *path, size_t len)
+{
+    snprintf(path, len, "/%s.pb", pond_name);
+}
+
+uint8_t pond_bounds_ingest_begin(struct pond_bounds_ingest *in, const char *pond_name)
+{
+    if (!in || !pond_name) return FAIL;
+
+    json_stream_init(&in->js, on_event, in);
+    memset(&in->hdr, 0, sizeof(in->hdr));
+    in->hdr.magic = POND_BOUNDS_MAGIC;
+    in->have = 0;
+    in->has_version = 0;
+    in->write_error = 0;
+    in->fill = 0;
+    pond_bounds_path(pond_name, in->path, sizeof(in->path));
+    snprintf(in->tmp, sizeof(in->tmp), "/%s.tmp", pond_name);
+
+    in->file = SPIFFS.open(in->tmp, FILE_WRITE);
+    if (!in->file) return FAIL;
+
+    /* Placeholder, rewritten with the count at the end */
+    if (in->file.write((const uint8_t *)&in->hdr, sizeof(in->hdr)) != sizeof(in->hdr))
+    {
+        in->file.close();
+        SPIFFS.remove(in->tmp);
+        return FAIL;
+    }
+    return SUCCESS;
+}
+
+uint8_t pond_bounds_ingest_feed(void *ctx, const uint8_t *data, size_t len)
+{
+    struct pond_bounds_ingest *in = (struct pond_bounds_ingest *)ctx;
+    if (!in || !in->file) return 0;
+    return json_stream_feed(&in->js, (const char *)data, len);
+}
+
+uint8_t pond_bounds_ingest_end(struct pond_bounds_ingest *in, uint8_t complete)
+{
+    if (!in) return FAIL;
+    if (!in->file) return FAIL;
+
+    uint8_t ok = complete && json_stream_finish(&in->js) && flush_block(in);
+    if (ok && (!in->has_version || in->hdr.count < POND_BOUNDS_MIN_POINTS))
+    {
+        debugPrintf("[Bounds] %s: no version or only %u posts\n", in->path, (unsigned)in->hdr.count);
+        ok = 0;
+    }
+    if (ok)
+    {
+        ok = in->file.seek(0) &&
+             in->file.write((const uint8_t *)&in->hdr, sizeof(in->hdr)) == sizeof(in->hdr);
+    }
+    in->file.close();
+
+    if (!ok)
+    {
+        debugPrintf("[Bounds] %s rejected (json error %u at %lu)\n", in->tmp,
+                    in->js.error, (unsigned long)in->js.pos);
+        SPIFFS.remove(in->tmp);
+        return FAIL;
+    }
+    SPIFFS.remove(in->path);
+    if (!SPIFFS.rename(in->tmp, in->path))
+    {
+        SPIFFS.remove(in->tmp);
+        return FAIL;
+    }
+    debugPrintf("[Bounds] %s: %u posts, version %ld\n", in->path, (unsigned)in->hdr.count,
+                (long)in->hdr.location_version);
+    return SUCCESS;
+}
+
+uint8_t pond_bounds_read(const char *pond_name, struct pond_bounds_hdr *hdr)
+{
+    if (!pond_name || !hdr) return FAIL;
+
+    char path[POND_BOUNDS_PATH_MAX];
+    pond_bounds_path(pond_name, path, sizeof(path));
+    File file = SPIFFS.open(path, FILE_READ);
+    if (!file || file.isDirectory()) return FAIL;
+
+    size_t size = file.size();
+    uint8_t ok = (size_t)file.read((uint8_t *)hdr, sizeof(*hdr)) == sizeof(*hdr) &&
+                 hdr->magic == POND_BOUNDS_MAGIC &&
+                 hdr->count >= POND_BOUNDS_MIN_POINTS &&
+                 size == sizeof(*hdr) + (size_t)hdr->count * sizeof(position_t);
+    file.close();
+    return ok ? SUCCESS : FAIL;
+}
+
+double pond_bounds_distance(const char *pond_name, position_t point)
+{
+    if (!pond_name) return -1.0;
+
+    struct geofence_scan scan;
+    if (!scan_pond(pond_name, point, &scan)) return -1.0;
+    return scan.inside ? 0 : scan.min_dist;
+}
+
+uint8_t pond_bounds_edge_distance(const char *pond_name, position_t point, double *meters)
+{
+    if (!pond_name || !meters) return FAIL;
+
+    struct geofence_scan scan;
+    if (!scan_pond(pond_name, point, &scan)) return FAIL;
+    *meters = geofence_scan_edge_distance(&scan);
+    return SUCCESS;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file pond_bounds.h
+ * @brief Pond boundary store: streamed ingest into compact on-flash point files
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The getPondsBoundaries response
+ * ({"locationVersion":N,"config":{"posts":[{"lat":..,"lng":..},...]}}) is
+ * parsed while it downloads and only the points are kept, as a binary file
+ * per pond:
+ * @code
+ * "/<pond>.pb":  pond_bounds_hdr | position_t[count]
+ * @endcode
+ * The download goes to "/<pond>.tmp" and replaces the old file only once the
+ * whole document parsed, so an interrupted fetch keeps the previous boundary.
+ *
+ * The header is the in-RAM index entry (version and point count, read once
+ * when the pond config loads). The geofence test reads the points back in
+ * blocks of POND_BOUNDS_BLOCK, so neither ingest nor lookup depends on the
+ * number of posts.
+ *
+ * @par Usage Pattern:
+ * @code
+ * struct pond_bounds_ingest *in = new pond_bounds_ingest;
+ * pond_bounds_ingest_begin(in, "P1");
+ * ok = http_get_pond_boundaries(&g_http_dev, query, pond_bounds_ingest_feed, in);
+ * ok = pond_bounds_ingest_end(in, ok);
+ *
+ * double meters = pond_bounds_distance("P1", position);    // 0 inside, -1 no data
+ * pond_bounds_edge_distance("P1", position, &meters);      // negative inside
+ * @endcode
+ */
+
+#ifndef POND_BOUNDS_H
+#define POND_BOUNDS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <FS.h>
+#include "json_stream.h"
+#include "geofence_ops.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POND_BOUNDS_MAGIC 0x31425057u   /**< "WPB1" */
+#define POND_BOUNDS_BLOCK 32            /**< Points per flash read/write */
+#define POND_BOUNDS_PATH_MAX 64
+#define POND_BOUNDS_MIN_POINTS 3
+
+/**
+ * @brief File header and index entry
+ */
+struct pond_bounds_hdr {
+    uint32_t magic;
+    int32_t location_version;           /**< Matches the pond line in the config */
+    uint32_t count;                     /**< Points following the header */
+    uint32_t reserved;
+};
+
+/**
+ * @struct pond_bounds_ingest
+ * @brief One boundary download in progress
+ */
+struct pond_bounds_ingest {
+    struct json_stream js;
+    fs::File file;
+    struct pond_bounds_hdr hdr;
+    char path[POND_BOUNDS_PATH_MAX];    /**< Final file */
+    char tmp[POND_BOUNDS_PATH_MAX];     /**< File being written */
+    position_t pt;                      /**< Post being parsed */
+    uint8_t have;                       /**< lat (1) / lng (2) seen for pt */
+    uint8_t has_version;
+    uint8_t write_error;
+    uint8_t fill;                       /**< Points waiting in block[] */
+    position_t block[POND_BOUNDS_BLOCK];
+};
+
+/**
+ * @brief Path of a pond's boundary file
+ * @param pond_name Pond name from the config
+ * @param path Output buffer
+ * @param len Size of path
+ */
+void pond_bounds_path(const char *pond_name, char *path, size_t len);
+
+/**
+ * @brief Start receiving a pond's boundary
+ * @param in Pointer to ingest state
+ * @param pond_name Pond name from the config
+ * @return SUCCESS (1), or FAIL (0) if the file cannot be created
+ */
+uint8_t pond_bounds_ingest_begin(struct pond_bounds_ingest *in, const char *pond_name);
+
+/**
+ * @brief Body chunk sink, signature of http_sink_fn
+ * @param ctx struct pond_bounds_ingest
+ * @param data Response bytes
+ * @param len Length of data
+ * @return 1 to continue, 0 on bad JSON or a flash error
+ */
+uint8_t pond_bounds_ingest_feed(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Finish a download, installing the file if it is complete
+ * @param in Pointer to ingest state
+ * @param complete Transport result, 0 discards the download
+ * @return SUCCESS (1) if the new boundary is in place
+ */
+uint8_t pond_bounds_ingest_end(struct pond_bounds_ingest *in, uint8_t complete);
+
+/**
+ * @brief Read a pond's index entry
+ * @param pond_name Pond name from the config
+ * @param hdr Output header
+ * @return SUCCESS (1) if the file exists and holds a usable polygon
+ */
+uint8_t pond_bounds_read(const char *pond_name, struct pond_bounds_hdr *hdr);
+
+/**
+ * @brief Distance from a position to a pond, streaming its points from flash
+ * @param pond_name Pond name from the config
+ * @param point Current position
+ * @return Meters, 0 if inside, -1 if the boundary is missing or unreadable
+ */
+double pond_bounds_distance(const char *pond_name, position_t point);
+
+/**
+ * @brief Signed distance from a position to a pond's edge
+ * @param pond_name Pond name from the config
+ * @param point Current position
+ * @param meters Output: negative inside (depth from the edge), positive outside
+ * @return SUCCESS (1), FAIL (0) if the boundary is missing or unreadable
+ */
+uint8_t pond_bounds_edge_distance(const char *pond_name, position_t point, double *meters);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POND_BOUNDS_H */
@@ -0,0 +1,211 @@
+/**
+ * @file pond_status_store.cpp
+ * @brief Pond map status on flash Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "pond_status_store.h"
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+#define POND_STATUS_LOG_BLOCK 32        /**< Deltas per flash read */
+#define DELTA_CHECK_SEED 0x5A           /**< An erased or zeroed record fails the check */
+#define DELTA_ACTIVE_BIT 0x08
+#define DELTA_STATUS_MASK 0x07
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+static uint8_t delta_check(const struct pond_status_delta *d)
+{
+    return (uint8_t)(d->generation ^ d->index ^ d->value ^ DELTA_CHECK_SEED);
+}
+
+/**
+ * @brief Read a checkpoint file into entries
+ */
+static uint8_t read_table(const char *path, struct pond_status_hdr *hdr, struct pond_status_entry *entries, uint32_t cap)
+{
+    File file = SPIFFS.open(path, FILE_READ);
+    if (!file || file.isDirectory()) return FAIL;
+
+    size_t size = file.size();
+    uint8_t ok = (size_t)file.read((uint8_t *)hdr, sizeof(*hdr)) == sizeof(*hdr) &&
+                 hdr->magic == POND_STATUS_MAGIC &&
+                 hdr->count <= cap &&
+                 size == sizeof(*hdr) + (size_t)hdr->count * sizeof(struct pond_status_entry);
+    if (ok && hdr->count)
+        ok = (size_t)file.read((uint8_t *)entries, hdr->count * sizeof(struct pond_status_entry)) ==
+             hdr->count * sizeof(struct pond_status_entry);
+    file.close();
+    return ok ? SUCCESS : FAIL;
+}
+
+/**
+ * @brief Apply the deltas of the current generation, stop at the first torn one
+ */
+static void replay_log(struct pond_status_store *st, struct pond_status_entry *entries)
+{
+    File file = SPIFFS.open(POND_STATUS_LOG_PATH, FILE_READ);
+    if (!file || file.isDirectory()) return;
+
+    size_t size = file.size();
+    uint8_t torn = (size % sizeof(struct pond_status_delta)) ? 1 : 0;
+
+    struct pond_status_delta block[POND_STATUS_LOG_BLOCK];
+    uint32_t left = size / sizeof(struct pond_status_delta);
+    uint8_t bad = 0;
+    while (left && !bad)
+    {
+        uint32_t n = (left < POND_STATUS_LOG_BLOCK) ? left : POND_STATUS_LOG_BLOCK;
+        if ((size_t)file.read((uint8_t *)block, n * sizeof(block[0])) != n * sizeof(block[0]))
+        {
+            bad = 1;
+            break;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            const struct pond_status_delta *d = &block[i];
+            if (d->check != delta_check(d))
+            {
+                bad = 1;
+                break;
+            }
+            st->log_records++;
+            /* Left over from an interrupted checkpoint: already in the table */
+            if (d->generation != (uint8_t)st->generation || d->index >= st->count)
+                continue;
+            entries[d->index].is_active = (d->value & DELTA_ACTIVE_BIT) ? 1 : 0;
+            entries[d->index].status = d->value & DELTA_STATUS_MASK;
+        }
+        left -= n;
+    }
+    file.close();
+    if (torn || bad) st->dirty = 1;
+    debugPrintf("[PondStatus] %u deltas replayed%s\n", (unsigned)st->log_records, st->dirty ? ", log torn" : "");
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void pond_status_store_init(struct pond_status_store *st)
+{
+    if (!st) return;
+    memset(st, 0, sizeof(struct pond_status_store));
+}
+
+uint8_t pond_status_store_load(struct pond_status_store *st, struct pond_status_entry *entries, uint32_t cap, uint32_t *count)
+{
+    if (!st || !entries || !count) return FAIL;
+
+    pond_status_store_init(st);
+    *count = 0;
+
+    struct pond_status_hdr hdr;
+    if (!read_table(POND_STATUS_PATH, &hdr, entries, cap))
+    {
+        /* Interrupted between removing the old checkpoint and the rename */
+        if (!read_table(POND_STATUS_TMP_PATH, &hdr, entries, cap))
+        {
+            SPIFFS.remove(POND_STATUS_LOG_PATH);
+            return FAIL;
+        }
+        st->dirty = 1;
+    }
+
+    st->generation = hdr.generation;
+    st->count = hdr.count;
+    replay_log(st, entries);
+    *count = hdr.count;
+    return SUCCESS;
+}
+
+uint8_t pond_status_store_checkpoint(struct pond_status_store *st, const struct pond_status_entry *entries, uint32_t count)
+{
+    if (!st || (count && !entries) || count > POND_STATUS_MAX_ENTRIES) return FAIL;
+
+    struct pond_status_hdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = POND_STATUS_MAGIC;
+    hdr.generation = st->generation + 1;
+    hdr.count = count;
+
+    File file = SPIFFS.open(POND_STATUS_TMP_PATH, FILE_WRITE);
+    if (!file) return FAIL;
+    size_t body = (size_t)count * sizeof(struct pond_status_entry);
+    uint8_t ok = file.write((const uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+                 (!body || file.write((const uint8_t *)entries, body) == body);
+    file.close();
+    if (!ok)
+    {
+        SPIFFS.remove(POND_STATUS_TMP_PATH);
+        return FAIL;
+    }
+
+    /* SPIFFS rename does not replace an existing file */
+    SPIFFS.remove(POND_STATUS_PATH);
+    if (!SPIFFS.rename(POND_STATUS_TMP_PATH, POND_STATUS_PATH)) return FAIL;
+    /* A log that survives a reset here carries the old generation and is skipped */
+    SPIFFS.remove(POND_STATUS_LOG_PATH);
+
+    st->generation = hdr.generation;
+    st->count = count;
+    st->log_records = 0;
+    st->dirty = 0;
+    debugPrintf("[PondStatus] checkpoint %u, %u ponds\n", (unsigned)st->generation, (unsigned)count);
+    return SUCCESS;
+}
+
+uint8_t pond_status_store_update(struct pond_status_store *st, uint32_t index, uint8_t is_active, uint8_t status)
+{
+    if (!st || st->dirty || index >= st->count || status > DELTA_STATUS_MASK) return FAIL;
+
+    struct pond_status_delta d;
+    d.generation = (uint8_t)st->generation;
+    d.index = (uint8_t)index;
+    d.value = (uint8_t)((is_active ? DELTA_ACTIVE_BIT : 0) | status);
+    d.check = delta_check(&d);
+
+    File file = SPIFFS.open(POND_STATUS_LOG_PATH, FILE_APPEND);
+    if (!file) return FAIL;
+    size_t written = file.write((const uint8_t *)&d, sizeof(d));
+    file.close();
+    if (written != sizeof(d))
+    {
+        st->dirty = 1;
+        return FAIL;
+    }
+    st->log_records++;
+    return SUCCESS;
+}
+
+uint8_t pond_status_store_needs_checkpoint(const struct pond_status_store *st)
+{
+    return (st && (st->dirty || st->log_records >= POND_STATUS_LOG_MAX)) ? 1 : 0;
+}
+
+void pond_status_store_remove(struct pond_status_store *st)
+{
+    SPIFFS.remove(POND_STATUS_PATH);
+    SPIFFS.remove(POND_STATUS_TMP_PATH);
+    SPIFFS.remove(POND_STATUS_LOG_PATH);
+    pond_status_store_init(st);
+}
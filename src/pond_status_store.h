@@ -0,0 +1,151 @@
+/**
+ * @file pond_status_store.h
+ * @brief Pond map status on flash: binary table plus an append-only delta log
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Every frame sent, stored or rejected changes one pond's colour on the map.
+ * The status used to be saved as a JSON object of every pond, serialized and
+ * rewritten in full (several KB) on each change. It now lives in two files:
+ * @code
+ * "/pondStat.bin":  pond_status_hdr | pond_status_entry[count]     (checkpoint)
+ * "/pondStat.log":  pond_status_delta ...                          (4 bytes per change)
+ * @endcode
+ * A change appends one delta that names the entry by its index in the
+ * checkpoint. After POND_STATUS_LOG_MAX deltas, or when the set of ponds
+ * changes, the caller writes a new checkpoint, which starts an empty log.
+ *
+ * Crash safety:
+ * - The checkpoint is written to "/pondStat.tmp" and renamed into place;
+ *   load falls back to the tmp file if the rename did not happen.
+ * - Deltas carry the low byte of the checkpoint generation, so a log left
+ *   behind by an interrupted checkpoint is ignored.
+ * - A torn delta fails its check byte. Load stops there and asks for a
+ *   checkpoint, so later appends stay aligned.
+ *
+ * Called from the task that owns CPondConfig; no locking.
+ *
+ * @par Usage Pattern:
+ * @code
+ * pond_status_store_init(&store);
+ * if (!pond_status_store_load(&store, entries, POND_STATUS_MAX_ENTRIES, &count))
+ *     pond_status_store_checkpoint(&store, defaults, n);
+ *
+ * if (!pond_status_store_update(&store, index, isActive, status) || pond_status_store_needs_checkpoint(&store))
+ *     pond_status_store_checkpoint(&store, entries, count);
+ * @endcode
+ */
+
+#ifndef POND_STATUS_STORE_H
+#define POND_STATUS_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POND_STATUS_PATH "/pondStat.bin"
+#define POND_STATUS_TMP_PATH "/pondStat.tmp"
+#define POND_STATUS_LOG_PATH "/pondStat.log"
+#define POND_STATUS_MAGIC 0x31535057u   /**< "WPS1" */
+#define POND_STATUS_NAME_LEN 10         /**< CPond::m_cPondname */
+#define POND_STATUS_MAX_ENTRIES 256     /**< Deltas address entries with one byte */
+#define POND_STATUS_LOG_MAX 256         /**< Deltas (1 KB) before the next checkpoint */
+
+/**
+ * @brief Checkpoint file header
+ */
+struct pond_status_hdr {
+    uint32_t magic;
+    uint32_t generation;                /**< Incremented by every checkpoint */
+    uint32_t count;                     /**< Entries following the header */
+    uint32_t reserved;
+};
+
+/**
+ * @brief One pond in the checkpoint
+ */
+struct pond_status_entry {
+    char name[POND_STATUS_NAME_LEN];    /**< NUL padded, not always terminated */
+    uint8_t is_active;
+    uint8_t status;                     /**< PONDMAP_VALUE_* */
+};
+
+/**
+ * @brief One change in the log
+ */
+struct pond_status_delta {
+    uint8_t generation;                 /**< Low byte of the checkpoint generation */
+    uint8_t index;                      /**< Entry in the checkpoint */
+    uint8_t value;                      /**< status in bits 0-2, is_active in bit 3 */
+    uint8_t check;
+};
+
+/**
+ * @struct pond_status_store
+ * @brief What is on flash
+ */
+struct pond_status_store {
+    uint32_t generation;
+    uint32_t count;                     /**< Entries in the checkpoint */
+    uint32_t log_records;               /**< Deltas appended since the checkpoint */
+    uint8_t dirty;                      /**< Log unreadable past some point: checkpoint before appending */
+};
+
+/**
+ * @brief Start empty; nothing is read from flash
+ * @param st Pointer to store
+ */
+void pond_status_store_init(struct pond_status_store *st);
+
+/**
+ * @brief Read the checkpoint and apply the log
+ * @param st Pointer to store
+ * @param entries Output table
+ * @param cap Entries that fit in the table
+ * @param count Output: entries read
+ * @return SUCCESS (1), FAIL (0) if there is no usable checkpoint
+ */
+uint8_t pond_status_store_load(struct pond_status_store *st, struct pond_status_entry *entries, uint32_t cap, uint32_t *count);
+
+/**
+ * @brief Write a new checkpoint and start an empty log
+ * @param st Pointer to store
+ * @param entries Full table, index order is what deltas refer to
+ * @param count Entries, at most POND_STATUS_MAX_ENTRIES
+ * @return SUCCESS (1), FAIL (0) on a flash error
+ */
+uint8_t pond_status_store_checkpoint(struct pond_status_store *st, const struct pond_status_entry *entries, uint32_t count);
+
+/**
+ * @brief Append one change
+ * @param st Pointer to store
+ * @param index Entry in the checkpoint
+ * @param is_active Pond active flag
+ * @param status PONDMAP_VALUE_*, 0-7
+ * @return SUCCESS (1), FAIL (0) if the index is not in the checkpoint, the
+ *         store is dirty, or the write failed; write a checkpoint instead
+ */
+uint8_t pond_status_store_update(struct pond_status_store *st, uint32_t index, uint8_t is_active, uint8_t status);
+
+/**
+ * @brief Whether the log is long enough, or damaged, to need a checkpoint
+ * @param st Pointer to store
+ * @return 1 if the caller should checkpoint
+ */
+uint8_t pond_status_store_needs_checkpoint(const struct pond_status_store *st);
+
+/**
+ * @brief Delete the checkpoint and the log
+ * @param st Pointer to store
+ */
+void pond_status_store_remove(struct pond_status_store *st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POND_STATUS_STORE_H */
@@ -0,0 +1,198 @@
+/**
+ * @file power_manager.cpp
+ * @brief Duty cycling between operator actions Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "power_manager.h"
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <esp_wifi.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+static const char *const kStateNames[PWR_STATE_COUNT] = {"active", "walking", "idle"};
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+static bool before(uint32_t now, uint32_t t)
+{
+    return (int32_t)(now - t) < 0;
+}
+
+/**
+ * @brief Hold or release the NO_LIGHT_SLEEP lock
+ */
+static void set_awake(struct power_manager *pm, uint8_t awake)
+{
+    if (pm->awake == awake) return;
+    pm->awake = awake;
+    if (!pm->lock) return;
+
+    if (awake)
+        esp_pm_lock_acquire((esp_pm_lock_handle_t)pm->lock);
+    else
+        esp_pm_lock_release((esp_pm_lock_handle_t)pm->lock);
+}
+
+/**
+ * @brief Charge the time since the last update to the current state
+ */
+static void account(struct power_manager *pm, uint32_t now)
+{
+    uint32_t dt = now - pm->last_account;
+    pm->last_account = now;
+    pm->stats.ms[pm->state] += dt;
+    uint8_t asleep = pm->light_sleep && !pm->awake;
+    pm->stats.charge_mams += (uint64_t)dt * power_manager_current_ma(pm->state, asleep);
+}
+
+static void enter(struct power_manager *pm, uint8_t state, uint32_t now)
+{
+    debugPrintf("[Power] %s -> %s\n", kStateNames[pm->state], kStateNames[state]);
+    pm->state = state;
+    pm->stats.transitions++;
+    /* Redraw at once so the screen shows the new state */
+    pm->last_display = now - PWR_DISPLAY_IDLE_MS;
+
+    /* Max modem sleep skips more beacons; fine while nobody waits on the link */
+    esp_wifi_set_ps(state == PWR_IDLE ? WIFI_PS_MAX_MODEM : WIFI_PS_MIN_MODEM);
+    if (state == PWR_IDLE)
+    {
+        pm->gps_window_end = now;
+        pm->next_gps_window = now + PWR_GPS_CHECK_MS;
+    }
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void power_manager_init(struct power_manager *pm, uint32_t now)
+{
+    if (!pm) return;
+
+    memset(pm, 0, sizeof(struct power_manager));
+    pm->state = PWR_ACTIVE;
+    pm->last_activity = now;
+    pm->last_moving = now;
+    pm->last_account = now;
+
+    esp_pm_config_esp32_t cfg;
+    cfg.max_freq_mhz = PWR_CPU_MAX_MHZ;
+    cfg.min_freq_mhz = PWR_CPU_MIN_MHZ;
+    cfg.light_sleep_enable = true;
+    if (esp_pm_configure(&cfg) == ESP_OK)
+    {
+        pm->light_sleep = 1;
+    }
+    else
+    {
+        /* No tickless idle in this build: frequency scaling only */
+        cfg.light_sleep_enable = false;
+        esp_pm_configure(&cfg);
+    }
+
+    esp_pm_lock_handle_t lock = NULL;
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "pwrAwake", &lock) == ESP_OK)
+        pm->lock = lock;
+    set_awake(pm, 1);
+    debugPrintf("[Power] light sleep %s\n", pm->light_sleep ? "on" : "unsupported");
+}
+
+void power_manager_activity(struct power_manager *pm, uint32_t now)
+{
+    if (!pm) return;
+
+    pm->last_activity = now;
+    if (pm->state != PWR_ACTIVE)
+    {
+        account(pm, now);
+        set_awake(pm, 1);
+        enter(pm, PWR_ACTIVE, now);
+    }
+}
+
+uint8_t power_manager_update(struct power_manager *pm, const struct power_inputs *in, uint32_t now)
+{
+    if (!pm || !in) return PWR_ACTIVE;
+
+    account(pm, now);
+    pm->in_pond = in->in_pond;
+
+    /* While idle the CPU may have slept through GPS sentences; trust fixes in the window only */
+    bool gps_fresh = (pm->state != PWR_IDLE) || before(now, pm->gps_window_end);
+    if (gps_fresh && in->gps_valid && in->speed_mps >= PWR_WALK_SPEED_MPS)
+        pm->last_moving = now;
+
+    uint8_t state;
+    if (in->busy || before(now, pm->last_activity + PWR_ACTIVE_HOLD_MS))
+        state = PWR_ACTIVE;
+    else if (in->in_pond || before(now, pm->last_moving + PWR_IDLE_AFTER_MS))
+        state = PWR_WALKING;
+    else
+        state = PWR_IDLE;
+
+    if (state != pm->state)
+        enter(pm, state, now);
+
+    if (state == PWR_IDLE && !before(now, pm->next_gps_window))
+    {
+        pm->gps_window_end = now + PWR_GPS_WINDOW_MS;
+        pm->next_gps_window = now + PWR_GPS_CHECK_MS;
+    }
+    set_awake(pm, state != PWR_IDLE || before(now, pm->gps_window_end));
+    return state;
+}
+
+uint8_t power_manager_display_due(struct power_manager *pm, uint32_t now)
+{
+    if (!pm) return SUCCESS;
+
+    uint32_t period = PWR_DISPLAY_ACTIVE_MS;
+    if (pm->state == PWR_WALKING) period = PWR_DISPLAY_WALKING_MS;
+    else if (pm->state == PWR_IDLE) period = PWR_DISPLAY_IDLE_MS;
+
+    if (now - pm->last_display < period) return FAIL;
+    pm->last_display = now;
+    return SUCCESS;
+}
+
+uint8_t power_manager_sensor_paused(struct power_manager *pm)
+{
+    return (pm && pm->state != PWR_ACTIVE && !pm->in_pond) ? 1 : 0;
+}
+
+uint32_t power_manager_current_ma(uint8_t state, uint8_t asleep)
+{
+    switch (state)
+    {
+    case PWR_ACTIVE:
+        return PWR_MA_ACTIVE;
+    case PWR_WALKING:
+        return PWR_MA_WALKING;
+    default:
+        return asleep ? PWR_MA_IDLE_SLEEP : PWR_MA_IDLE_AWAKE;
+    }
+}
+
+const char *power_manager_state_name(uint8_t state)
+{
+    return (state < PWR_STATE_COUNT) ? kStateNames[state] : "unknown";
+}
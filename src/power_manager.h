@@ -0,0 +1,188 @@
+/**
+ * @file power_manager.h
+ * @brief Duty cycling between operator actions: active, walking, idle
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Most of a shift the handheld hangs from a shoulder between ponds, yet the
+ * display, GPS and probe ran at full rate. The manager picks one of three
+ * states every App tick and scales the power users to it:
+ *
+ * | State   | Entered when                        | Display | Probe  | CPU / WiFi                |
+ * |---------|-------------------------------------|---------|--------|---------------------------|
+ * | ACTIVE  | Button in the last 60 s, or busy    | 100 ms  | 1 s    | Awake, modem sleep        |
+ * | WALKING | Moving, or standing in a pond       | 500 ms  | 1 s *  | Awake, modem sleep        |
+ * | IDLE    | Still for 5 min outside any pond    | 2 s     | 60 s   | Light sleep, max modem    |
+ *
+ * (*) Outside a pond the probe drops to PWR_SENSOR_PAUSED_MS in WALKING too.
+ * "Busy" is anything an operator is waiting on: the countdown, a menu, a
+ * calibration, a frame in flight, FOTA, or charging.
+ *
+ * Light sleep is automatic (esp_pm, tickless idle): the CPU sleeps whenever
+ * every task is blocked. It stops the UARTs, so a NO_LIGHT_SLEEP lock is held
+ * in ACTIVE and WALKING, and in IDLE for a PWR_GPS_WINDOW_MS window every
+ * PWR_GPS_CHECK_MS so the GPS can report movement or pond entry. The App
+ * task arms the button as a GPIO wake-up source while idle. When the
+ * framework was built without tickless idle, esp_pm rejects light sleep; the
+ * manager then keeps frequency scaling only, and the states still slow the
+ * display and probe.
+ *
+ * The CPU scales between 80 and 240 MHz; APB stays at 80 MHz, so UART, SPI
+ * and I2C clocks are unaffected.
+ *
+ * Energy is estimated from the time spent in each state and the PWR_MA_*
+ * budget below (estimates at the battery; calibrate them with a meter on the
+ * current board). power_sim.py replays shift profiles against the same
+ * constants.
+ *
+ * All calls come from the App task; no locking.
+ *
+ * @par Usage Pattern:
+ * @code
+ * power_manager_init(&g_power, millis());
+ *
+ * // App task, every tick
+ * if (buttonTouched) power_manager_activity(&g_power, millis());
+ * uint8_t state = power_manager_update(&g_power, &inputs, millis());
+ * if (power_manager_display_due(&g_power, millis())) RunDisplay();
+ * @endcode
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PWR_ACTIVE_HOLD_MS 60000        /**< Button input keeps the device active */
+#define PWR_IDLE_AFTER_MS 300000        /**< No movement for this long outside a pond: idle */
+#define PWR_WALK_SPEED_MPS 0.7f         /**< GPS ground speed that counts as moving */
+
+#define PWR_DISPLAY_ACTIVE_MS 100
+#define PWR_DISPLAY_WALKING_MS 500
+#define PWR_DISPLAY_IDLE_MS 2000
+
+#define PWR_SENSOR_PAUSED_MS 60000      /**< Probe poll period outside ponds when not active */
+#define PWR_GPS_CHECK_MS 20000          /**< Idle: keep the CPU awake for the GPS this often */
+#define PWR_GPS_WINDOW_MS 4000          /**< ... for this long */
+
+#define PWR_CPU_MAX_MHZ 240
+#define PWR_CPU_MIN_MHZ 80
+
+/* Energy budget, mA at the battery */
+#define PWR_MA_ACTIVE 185               /**< Display at 10 Hz, probe, GPS, WiFi */
+#define PWR_MA_WALKING 140
+#define PWR_MA_IDLE_AWAKE 95            /**< Idle with the CPU held awake */
+#define PWR_MA_IDLE_SLEEP 40            /**< Idle in auto light sleep, GPS and display on */
+#define PWR_BATTERY_MAH 2600
+
+/**
+ * @brief Power state
+ */
+typedef enum {
+    PWR_ACTIVE = 0,
+    PWR_WALKING,
+    PWR_IDLE,
+    PWR_STATE_COUNT
+} pwr_state_t;
+
+/**
+ * @brief What the App task knows this tick
+ */
+struct power_inputs {
+    uint8_t busy;                       /**< Operator waiting on the device */
+    uint8_t in_pond;                    /**< Geofence found a current pond */
+    uint8_t gps_valid;
+    float speed_mps;                    /**< Ground speed of the last fix */
+};
+
+/**
+ * @brief Time and energy since boot
+ */
+struct power_stats {
+    uint64_t ms[PWR_STATE_COUNT];       /**< Time in each state */
+    uint32_t transitions;
+    uint64_t charge_mams;               /**< Modelled draw, mA x ms */
+};
+
+/**
+ * @struct power_manager
+ * @brief State, timers and the light-sleep lock
+ */
+struct power_manager {
+    uint8_t state;                      /**< pwr_state_t */
+    uint8_t in_pond;
+    uint8_t light_sleep;                /**< Auto light sleep accepted by esp_pm */
+    uint8_t awake;                      /**< NO_LIGHT_SLEEP lock held */
+    uint32_t last_activity;
+    uint32_t last_moving;
+    uint32_t last_account;
+    uint32_t last_display;
+    uint32_t gps_window_end;            /**< Idle: CPU held awake until then */
+    uint32_t next_gps_window;
+    void *lock;                         /**< esp_pm_lock_handle_t */
+    struct power_stats stats;
+};
+
+/**
+ * @brief Configure frequency scaling and light sleep, start ACTIVE
+ * @param pm Pointer to manager
+ * @param now millis()
+ */
+void power_manager_init(struct power_manager *pm, uint32_t now);
+
+/**
+ * @brief Operator input: go ACTIVE now and redraw on the next tick
+ * @param pm Pointer to manager
+ * @param now millis()
+ */
+void power_manager_activity(struct power_manager *pm, uint32_t now);
+
+/**
+ * @brief Pick the state for this tick, apply CPU and WiFi settings on a change
+ * @param pm Pointer to manager
+ * @param in Inputs for this tick
+ * @param now millis()
+ * @return pwr_state_t
+ */
+uint8_t power_manager_update(struct power_manager *pm, const struct power_inputs *in, uint32_t now);
+
+/**
+ * @brief Whether the display should be redrawn on this tick
+ * @param pm Pointer to manager
+ * @param now millis()
+ * @return 1 when the state's refresh period has elapsed
+ */
+uint8_t power_manager_display_due(struct power_manager *pm, uint32_t now);
+
+/**
+ * @brief Whether the probe should poll at PWR_SENSOR_PAUSED_MS
+ * @param pm Pointer to manager
+ * @return 1 outside ponds when not ACTIVE
+ */
+uint8_t power_manager_sensor_paused(struct power_manager *pm);
+
+/**
+ * @brief Modelled battery current
+ * @param state pwr_state_t
+ * @param asleep CPU free to light-sleep
+ * @return mA
+ */
+uint32_t power_manager_current_ma(uint8_t state, uint8_t asleep);
+
+/**
+ * @brief Name of a state for logs and RPC replies
+ * @param state pwr_state_t
+ * @return Constant string
+ */
+const char *power_manager_state_name(uint8_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POWER_MANAGER_H */
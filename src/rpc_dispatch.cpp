@@ -0,0 +1,69 @@
+/**
+ * @file rpc_dispatch.cpp
+ * @brief JSON-RPC dispatch through a sorted route table
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "rpc_dispatch.h"
+#include <string.h>
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+const char *rpc_event_object(const char *payload, size_t length, int *obj_len)
+{
+    const char *obj = NULL;
+    if (!payload || !obj_len) return NULL;
+    if (mjson_find(payload, (int)length, "$[1]", &obj, obj_len) != MJSON_TOK_OBJECT) return NULL;
+    return obj;
+}
+
+const struct rpc_route *rpc_route_find(const struct rpc_route *routes, size_t count,
+                                       const char *method, int len)
+{
+    size_t lo = 0, hi = count;
+    if (!routes || !method || len < 0) return NULL;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        int cmp = strncmp(routes[mid].method, method, len);
+        if (cmp == 0 && routes[mid].method[len] != '\0')
+            cmp = 1; /* Table name is longer, so it sorts after */
+        if (cmp == 0)
+            return &routes[mid];
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+void rpc_dispatch(const struct rpc_route *routes, size_t count,
+                  const char *frame, int frame_len, mjson_print_fn_t fn, void *fndata)
+{
+    struct jsonrpc_request r;
+    memset(&r, 0, sizeof(r));
+    r.frame = frame;
+    r.frame_len = frame_len;
+    r.fn = fn;
+    r.fndata = fndata;
+
+    if (mjson_find(frame, frame_len, "$.method", &r.method, &r.method_len) != MJSON_TOK_STRING)
+    {
+        mjson_printf(fn, fndata, "{\"error\":{\"code\":-32700,\"message\":%.*Q}}\n", frame_len, frame);
+        return;
+    }
+    /* id and params are optional */
+    mjson_find(frame, frame_len, "$.id", &r.id, &r.id_len);
+    mjson_find(frame, frame_len, "$.params", &r.params, &r.params_len);
+
+    /* Method token still has its quotes */
+    const struct rpc_route *route = rpc_route_find(routes, count, r.method + 1, r.method_len - 2);
+    if (route)
+        route->handler(&r);
+    else
+        jsonrpc_return_error(&r, JSONRPC_ERROR_NOT_FOUND, "method not found", NULL);
+}
@@ -0,0 +1,98 @@
+/**
+ * @file rpc_dispatch.h
+ * @brief JSON-RPC dispatch from the receive buffer through a sorted route table
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * A Socket.IO event arrives as ["<event>", {rpc object}]. The object is
+ * located in place with one mjson scan, method/id/params are taken as
+ * pointers into it, and the handler is found by binary search. Nothing is
+ * copied or allocated per event. Replies follow mjson's jsonrpc_process()
+ * format.
+ *
+ * The table is the caller's, sorted by method name in strcmp order; check it
+ * at compile time with rpc_routes_sorted().
+ *
+ * @par Usage Pattern:
+ * @code
+ * static constexpr struct rpc_route routes[] = {{"getConfig", getConfig}, {"whoAreYou", whoAreYou}};
+ * static_assert(rpc_routes_sorted(routes, 2), "routes must stay sorted");
+ *
+ * int len;
+ * const char *req = rpc_event_object(payload, length, &len);
+ * if (req) rpc_dispatch(routes, 2, req, len, printer, printer_data);
+ * @endcode
+ */
+
+#ifndef RPC_DISPATCH_H
+#define RPC_DISPATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mjson.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief One method and its handler
+ */
+struct rpc_route {
+    const char *method;
+    void (*handler)(struct jsonrpc_request *r);
+};
+
+/**
+ * @brief Locate the RPC object of a Socket.IO event
+ * @param payload Event text, ["<event>", {...}]
+ * @param length Bytes in payload
+ * @param obj_len Set to the object length
+ * @return Pointer into payload, NULL if element [1] is not an object
+ */
+const char *rpc_event_object(const char *payload, size_t length, int *obj_len);
+
+/**
+ * @brief Find the route for a method name
+ * @param routes Table sorted by method
+ * @param count Entries in routes
+ * @param method Name, not NUL terminated
+ * @param len Length of the name
+ * @return Route, or NULL when the method is unknown
+ */
+const struct rpc_route *rpc_route_find(const struct rpc_route *routes, size_t count,
+                                       const char *method, int len);
+
+/**
+ * @brief Run one JSON-RPC request object through the table
+ * @param routes Table sorted by method
+ * @param count Entries in routes
+ * @param frame Request object
+ * @param frame_len Length of the object
+ * @param fn Reply printer
+ * @param fndata Printer data
+ */
+void rpc_dispatch(const struct rpc_route *routes, size_t count,
+                  const char *frame, int frame_len, mjson_print_fn_t fn, void *fndata);
+
+#ifdef __cplusplus
+}
+
+static constexpr bool rpc_method_less(const char *a, const char *b)
+{
+    return (*a == *b) ? (*a != '\0' && rpc_method_less(a + 1, b + 1))
+                      : ((unsigned char)*a < (unsigned char)*b);
+}
+
+/**
+ * @brief Compile-time check that a route table is sorted and has no duplicates
+ */
+static constexpr bool rpc_routes_sorted(const struct rpc_route *routes, size_t count, size_t i = 0)
+{
+    return (i + 1 >= count) ||
+           (rpc_method_less(routes[i].method, routes[i + 1].method) && rpc_routes_sorted(routes, count, i + 1));
+}
+#endif
+
+#endif /* RPC_DISPATCH_H */
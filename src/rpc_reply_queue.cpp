@@ -0,0 +1,204 @@
+/**
+ * @file rpc_reply_queue.cpp
+ * @brief Queue of framed JSON-RPC replies Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "rpc_reply_queue.h"
+#include <Arduino.h>
+#include <mjson.h>
+#include <stdio.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define RPC_REPLY_HEAD "[\"rpcr\","
+#define RPC_REPLY_HEAD_LEN (sizeof(RPC_REPLY_HEAD) - 1)
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+/**
+ * @brief Point a slot back at its own buffer, freeing the large one
+ */
+static void use_small(rpc_reply_slot_t *slot)
+{
+    if (slot->queue && slot->queue->large_owner == slot)
+    {
+        slot->queue->large_owner = NULL;
+    }
+    slot->buf = slot->small;
+    slot->size = sizeof(slot->small);
+}
+
+/**
+ * @brief Return a slot to the pool
+ */
+static void release(rpc_reply_slot_t *slot)
+{
+    use_small(slot);
+    slot->in_use = 0;
+    slot->len = 0;
+    slot->overflow = 0;
+}
+
+/**
+ * @brief Move a slot's reply into the queue's large buffer
+ * @return 1 if the slot now has room for need bytes
+ */
+static uint8_t grow(rpc_reply_slot_t *s, size_t need)
+{
+    struct rpc_reply_queue *q = s->queue;
+    if (!q || q->large_owner || s->buf != s->small || need > sizeof(q->large))
+    {
+        return 0;
+    }
+    memcpy(q->large, s->small, s->len);
+    q->large_owner = s;
+    q->large_used++;
+    s->buf = q->large;
+    s->size = sizeof(q->large);
+    debugPrintf("[RpcReply] reply moved to the large buffer at %u bytes\n", (unsigned)need);
+    return 1;
+}
+
+/**
+ * @brief Rewrite an overflowed slot as a JSON-RPC error for the same id
+ */
+static void write_oversized_error(rpc_reply_slot_t *slot, const char *request, int request_len)
+{
+    const char *id = NULL;
+    int id_len = 0;
+    if (!request || mjson_find(request, request_len, "$.id", &id, &id_len) == MJSON_TOK_INVALID || id_len > 64)
+    {
+        id = "null";
+        id_len = 4;
+    }
+    /* The error always fits in the slot's own buffer */
+    use_small(slot);
+    int n = snprintf(slot->buf, slot->size,
+                     RPC_REPLY_HEAD "{\"id\":%.*s,\"error\":{\"code\":-32000,\"message\":\"response too large\"}}",
+                     id_len, id);
+    slot->len = (uint16_t)n;
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void rpc_reply_queue_init(struct rpc_reply_queue *q)
+{
+    if (!q) return;
+    memset(q, 0, sizeof(struct rpc_reply_queue));
+    for (uint8_t i = 0; i < RPC_REPLY_SLOTS; i++)
+    {
+        q->slots[i].queue = q;
+        release(&q->slots[i]);
+    }
+}
+
+void rpc_reply_queue_reset(struct rpc_reply_queue *q)
+{
+    if (!q) return;
+
+    for (uint8_t i = 0; i < RPC_REPLY_SLOTS; i++)
+    {
+        release(&q->slots[i]);
+    }
+    q->head = 0;
+    q->count = 0;
+}
+
+rpc_reply_slot_t *rpc_reply_begin(struct rpc_reply_queue *q)
+{
+    if (!q) return NULL;
+
+    for (uint8_t i = 0; i < RPC_REPLY_SLOTS; i++)
+    {
+        rpc_reply_slot_t *slot = &q->slots[i];
+        if (!slot->in_use)
+        {
+            slot->in_use = 1;
+            slot->overflow = 0;
+            memcpy(slot->buf, RPC_REPLY_HEAD, RPC_REPLY_HEAD_LEN);
+            slot->len = RPC_REPLY_HEAD_LEN;
+            return slot;
+        }
+    }
+
+    q->dropped++;
+    debugPrintf("[RpcReply] pool exhausted, %lu dropped\n", (unsigned long)q->dropped);
+    return NULL;
+}
+
+int rpc_reply_write(const char *frame, int frame_len, void *slot)
+{
+    rpc_reply_slot_t *s = (rpc_reply_slot_t *)slot;
+    if (!s || s->overflow || frame_len <= 0) return frame_len;
+
+    /* Keep one byte for the closing bracket */
+    size_t need = s->len + (size_t)frame_len + 1;
+    if (need > s->size && !grow(s, need))
+    {
+        s->overflow = 1;
+        return frame_len;
+    }
+    memcpy(s->buf + s->len, frame, frame_len);
+    s->len += frame_len;
+    return frame_len;
+}
+
+void rpc_reply_commit(struct rpc_reply_queue *q, rpc_reply_slot_t *slot,
+                      const char *request, int request_len)
+{
+    if (!q || !slot) return;
+
+    if (slot->overflow)
+    {
+        q->oversized++;
+        debugPrintf("[RpcReply] reply too large, %lu so far\n", (unsigned long)q->oversized);
+        write_oversized_error(slot, request, request_len);
+    }
+    else if (slot->len == RPC_REPLY_HEAD_LEN)
+    {
+        /* Notification, nothing to send */
+        release(slot);
+        return;
+    }
+    slot->buf[slot->len++] = ']';
+
+    q->ready[(q->head + q->count) % RPC_REPLY_SLOTS] = (uint8_t)(slot - q->slots);
+    q->count++;
+}
+
+uint8_t rpc_reply_flush(struct rpc_reply_queue *q, rpc_reply_send_fn send)
+{
+    if (!q || !send) return 0;
+
+    uint8_t n = 0;
+    while (q->count)
+    {
+        rpc_reply_slot_t *slot = &q->slots[q->ready[q->head]];
+        if (!send(slot->buf, slot->len))
+        {
+            break;
+        }
+        release(slot);
+        q->head = (q->head + 1) % RPC_REPLY_SLOTS;
+        q->count--;
+        q->sent++;
+        n++;
+    }
+    return n;
+}
@@ -0,0 +1,143 @@
+/**
+ * @file rpc_reply_queue.h
+ * @brief Queue of framed JSON-RPC replies for the Socket.IO link
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Every RPC gets its own slot from a fixed pool. The slot is pre-framed with
+ * the ["rpcr", envelope, mjson prints the reply straight into it, and the
+ * closing bracket is added on commit, so a slot is sent as is with no copy.
+ * Replies are flushed in arrival order as soon as the handler returns.
+ *
+ * - Two RPCs in one tick give two events, never one concatenated buffer.
+ * - A reply that outgrows its slot moves to the one large buffer, sized for
+ *   the biggest result a handler returns (getConfig's idsConfig.txt).
+ * - A reply larger than that, or a second large reply while the first is
+ *   still waiting for the link, is replaced by a JSON-RPC error and counted.
+ * - With the pool exhausted the RPC still runs; its reply is dropped and
+ *   counted.
+ *
+ * All calls are made from the App task (Socket.IO loop), so no lock is taken.
+ *
+ * @par Usage Pattern:
+ * @code
+ * rpc_reply_slot_t *slot = rpc_reply_begin(&g_rpcReplies);
+ * dispatchRPC(req, req_len, rpc_reply_write, slot);
+ * rpc_reply_commit(&g_rpcReplies, slot, req, req_len);
+ * rpc_reply_flush(&g_rpcReplies, send_fn);
+ * @endcode
+ */
+
+#ifndef RPC_REPLY_QUEUE_H
+#define RPC_REPLY_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RPC_REPLY_SLOTS 3               /**< Replies that can wait for the link */
+#define RPC_REPLY_SLOT_SIZE 1536        /**< Envelope + reply, bytes */
+#define RPC_REPLY_MAX_RESULT 8192       /**< Largest result a handler may return */
+#define RPC_REPLY_LARGE_SIZE (RPC_REPLY_MAX_RESULT + 256) /**< Plus envelope, id and result wrapper */
+
+struct rpc_reply_queue;
+
+/**
+ * @brief One framed reply
+ */
+typedef struct {
+    char *buf;                          /**< small, or the queue's large buffer */
+    uint16_t size;                      /**< Capacity of buf */
+    uint16_t len;                       /**< Bytes used in buf */
+    uint8_t in_use;                     /**< Taken from the pool */
+    uint8_t overflow;                   /**< Reply did not fit */
+    struct rpc_reply_queue *queue;      /**< Owner, for the large buffer */
+    char small[RPC_REPLY_SLOT_SIZE];
+} rpc_reply_slot_t;
+
+/**
+ * @struct rpc_reply_queue
+ * @brief Slot pool plus FIFO of replies ready to send
+ */
+struct rpc_reply_queue {
+    rpc_reply_slot_t slots[RPC_REPLY_SLOTS];
+    uint8_t ready[RPC_REPLY_SLOTS];     /**< Slot indexes in send order */
+    uint8_t head;
+    uint8_t count;
+    rpc_reply_slot_t *large_owner;      /**< Slot holding the large buffer */
+    char large[RPC_REPLY_LARGE_SIZE];
+
+    uint32_t sent;                      /**< Replies handed to the link */
+    uint32_t dropped;                   /**< Replies lost to a full pool */
+    uint32_t oversized;                 /**< Replies replaced by an error */
+    uint32_t large_used;                /**< Replies that needed the large buffer */
+};
+
+/**
+ * @brief Send callback, returns 1 once the link took the bytes
+ */
+typedef uint8_t (*rpc_reply_send_fn)(const char *data, size_t len);
+
+/**
+ * @brief Initialize an empty queue
+ * @param q Pointer to queue structure
+ */
+void rpc_reply_queue_init(struct rpc_reply_queue *q);
+
+/**
+ * @brief Drop every pending reply, e.g. when the link went down
+ * @param q Pointer to queue structure
+ */
+void rpc_reply_queue_reset(struct rpc_reply_queue *q);
+
+/**
+ * @brief Take a slot and write the envelope head
+ * @param q Pointer to queue structure
+ * @return Slot, or NULL when the pool is exhausted (counted as dropped)
+ */
+rpc_reply_slot_t *rpc_reply_begin(struct rpc_reply_queue *q);
+
+/**
+ * @brief mjson print callback appending to a slot
+ *
+ * The first write that does not fit copies the slot into the large buffer
+ * if it is free; after that the slot is marked overflowed.
+ *
+ * @param frame Bytes to append
+ * @param frame_len Number of bytes
+ * @param slot rpc_reply_slot_t from rpc_reply_begin(), may be NULL
+ * @return frame_len, so mjson treats the write as complete
+ */
+int rpc_reply_write(const char *frame, int frame_len, void *slot);
+
+/**
+ * @brief Close the envelope and queue the slot for sending
+ *
+ * An empty slot (notification, no reply) goes straight back to the pool.
+ * An overflowed slot is rewritten as an error carrying the request's id.
+ *
+ * @param q Pointer to queue structure
+ * @param slot Slot from rpc_reply_begin(), may be NULL
+ * @param request Request object the reply is for
+ * @param request_len Length of the request object
+ */
+void rpc_reply_commit(struct rpc_reply_queue *q, rpc_reply_slot_t *slot,
+                      const char *request, int request_len);
+
+/**
+ * @brief Send ready replies in order until the queue is empty or a send fails
+ * @param q Pointer to queue structure
+ * @param send Link send callback
+ * @return Number of replies sent
+ */
+uint8_t rpc_reply_flush(struct rpc_reply_queue *q, rpc_reply_send_fn send);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RPC_REPLY_QUEUE_H */
@@ -0,0 +1,215 @@
+/**
+ * @file sample_trace.cpp
+ * @brief Countdown Sample Trace Implementation
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The Modbus task is the only writer (sample_trace_record), the App and
+ * Frame tasks start, stop, encode and clear. Every ring access happens in
+ * a short critical section on the trace's own spinlock, so the hot path
+ * never blocks on the shared-variable mutex and never allocates.
+ */
+
+#include "sample_trace.h"
+#include <Arduino.h>
+#include <string.h>
+#include "mbedtls/base64.h"
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+/* Worst case bytes for one record: 5 (offset) + 3 x 3 (int16 deltas) */
+#define TRACE_MAX_RECORD_BYTES 14
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+/**
+ * @brief Quantize a float to int16 with saturation
+ */
+static int16_t quantize(float value, float scale)
+{
+    float q = value * scale;
+    if (isnan(q)) return 0;
+    if (q > 32767.0f) return 32767;
+    if (q < -32768.0f) return -32768;
+    return (int16_t)lroundf(q);
+}
+
+/**
+ * @brief Write a zigzag varint, returns bytes written
+ */
+static size_t put_zigzag(uint8_t *out, int32_t value)
+{
+    uint32_t v = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void sample_trace_init(struct sample_trace *trace, uint16_t rate_ms, uint16_t length)
+{
+    if (!trace) return;
+
+    memset(trace, 0, sizeof(struct sample_trace));
+    trace->lock = portMUX_INITIALIZER_UNLOCKED;
+    if (!sample_trace_configure(trace, rate_ms, length))
+    {
+        sample_trace_configure(trace, SAMPLE_TRACE_DEFAULT_RATE_MS, SAMPLE_TRACE_DEFAULT_LENGTH);
+    }
+}
+
+uint8_t sample_trace_configure(struct sample_trace *trace, uint16_t rate_ms, uint16_t length)
+{
+    if (!trace) return FAIL;
+    if (rate_ms < SAMPLE_TRACE_MIN_RATE_MS || rate_ms > SAMPLE_TRACE_MAX_RATE_MS) return FAIL;
+    if (length > SAMPLE_TRACE_MAX_SAMPLES) return FAIL;
+
+    uint8_t ret = FAIL;
+    portENTER_CRITICAL(&trace->lock);
+    if (!trace->active)
+    {
+        trace->rate_ms = rate_ms;
+        trace->length = length;
+        trace->head = 0;
+        trace->count = 0;
+        ret = SUCCESS;
+    }
+    portEXIT_CRITICAL(&trace->lock);
+    return ret;
+}
+
+void sample_trace_start(struct sample_trace *trace, uint32_t now_ms)
+{
+    if (!trace || !trace->length) return;
+
+    portENTER_CRITICAL(&trace->lock);
+    trace->head = 0;
+    trace->count = 0;
+    trace->start_ms = now_ms;
+    trace->last_ms = now_ms - trace->rate_ms;
+    trace->active = 1;
+    portEXIT_CRITICAL(&trace->lock);
+}
+
+void sample_trace_stop(struct sample_trace *trace)
+{
+    if (!trace) return;
+
+    portENTER_CRITICAL(&trace->lock);
+    trace->active = 0;
+    portEXIT_CRITICAL(&trace->lock);
+    debugPrintf("[Trace] stopped with %d samples\n", trace->count);
+}
+
+void sample_trace_clear(struct sample_trace *trace)
+{
+    if (!trace) return;
+
+    portENTER_CRITICAL(&trace->lock);
+    trace->head = 0;
+    trace->count = 0;
+    portEXIT_CRITICAL(&trace->lock);
+}
+
+uint8_t sample_trace_record(struct sample_trace *trace, uint32_t now_ms,
+                            float do_mgl, float do_pct, float temp)
+{
+    /* Unlocked early-out keeps the idle path to a single load */
+    if (!trace || !trace->active) return FAIL;
+
+    trace_sample_t s;
+    s.do_mgl_x100 = quantize(do_mgl, 100.0f);
+    s.do_pct_x10 = quantize(do_pct, 10.0f);
+    s.temp_x100 = quantize(temp, 100.0f);
+
+    uint8_t ret = FAIL;
+    portENTER_CRITICAL(&trace->lock);
+    /* Signed, so a reading from before the start (a stale timestamp) is
+       dropped instead of wrapping to a huge offset */
+    int32_t offset = (int32_t)(now_ms - trace->start_ms);
+    if (trace->active && offset >= 0 && (int32_t)(now_ms - trace->last_ms) >= (int32_t)trace->rate_ms)
+    {
+        s.offset_ms = (uint32_t)offset;
+        trace->samples[trace->head] = s;
+        trace->head = (trace->head + 1) % trace->length;
+        if (trace->count < trace->length) trace->count++;
+        trace->last_ms = now_ms;
+        ret = SUCCESS;
+    }
+    portEXIT_CRITICAL(&trace->lock);
+    return ret;
+}
+
+size_t sample_trace_encode(struct sample_trace *trace, uint8_t *out, size_t cap)
+{
+    if (!trace || !out || cap < 2 + TRACE_MAX_RECORD_BYTES) return 0;
+
+    size_t len = 2;
+    uint8_t n = 0;
+    portENTER_CRITICAL(&trace->lock);
+    if (!trace->active && trace->count)
+    {
+        /* Oldest sample sits at head once the ring has wrapped */
+        uint16_t idx = (trace->count < trace->length) ? 0 : trace->head;
+        trace_sample_t prev = {0, 0, 0, 0};
+        for (uint16_t i = 0; i < trace->count && n < 255; i++)
+        {
+            if (len + TRACE_MAX_RECORD_BYTES > cap) break;
+            const trace_sample_t *s = &trace->samples[idx];
+            len += put_zigzag(out + len, (int32_t)(s->offset_ms - prev.offset_ms));
+            len += put_zigzag(out + len, s->do_mgl_x100 - prev.do_mgl_x100);
+            len += put_zigzag(out + len, s->do_pct_x10 - prev.do_pct_x10);
+            len += put_zigzag(out + len, s->temp_x100 - prev.temp_x100);
+            prev = *s;
+            n++;
+            idx = (idx + 1) % trace->length;
+        }
+    }
+    portEXIT_CRITICAL(&trace->lock);
+
+    if (!n) return 0;
+    out[0] = SAMPLE_TRACE_VERSION;
+    out[1] = n;
+    return len;
+}
+
+size_t sample_trace_encode_base64(struct sample_trace *trace, char *out, size_t cap)
+{
+    if (!out || !cap) return 0;
+    out[0] = '\0';
+
+    uint8_t blob[SAMPLE_TRACE_MAX_BLOB];
+    size_t blob_len = sample_trace_encode(trace, blob, sizeof(blob));
+    if (!blob_len) return 0;
+
+    size_t olen = 0;
+    if (mbedtls_base64_encode((unsigned char *)out, cap, &olen, blob, blob_len) != 0)
+    {
+        out[0] = '\0';
+        return 0;
+    }
+    return olen;
+}
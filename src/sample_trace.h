@@ -0,0 +1,151 @@
+/**
+ * @file sample_trace.h
+ * @brief Countdown Sample Trace - fixed-capacity DO/temperature ring buffer
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Records the settling curve of the primary probe while the capture
+ * countdown runs, so a frame carries more than the single triplet taken
+ * at the end. Storage is a static ring of quantized samples: nothing is
+ * allocated after boot, and when the configured length is reached the
+ * oldest samples are overwritten (the tail of the curve matters most).
+ *
+ * @par Blob format (version 1):
+ * @code
+ * byte 0      : format version (1)
+ * byte 1      : sample count N
+ * N records   : 4 zigzag varints per sample, each a delta from the
+ *               previous sample (the first is relative to zero):
+ *               offset ms, DO mg/L x100, DO % x10, temp degC x100
+ * @endcode
+ * The blob is base64 encoded before it goes into the frame as "trace".
+ *
+ * @par Usage Pattern:
+ * @code
+ * sample_trace_init(&g_sampleTrace, 500, 40);
+ * sample_trace_start(&g_sampleTrace, millis());          // countdown start
+ * sample_trace_record(&g_sampleTrace, t, mgl, pct, temp); // Modbus task
+ * sample_trace_stop(&g_sampleTrace);                     // countdown end
+ * sample_trace_encode_base64(&g_sampleTrace, out, sizeof(out));
+ * sample_trace_clear(&g_sampleTrace);
+ * @endcode
+ */
+
+#ifndef SAMPLE_TRACE_H
+#define SAMPLE_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SAMPLE_TRACE_MAX_SAMPLES 120        /**< Ring capacity (upper bound for length) */
+#define SAMPLE_TRACE_MIN_RATE_MS 100        /**< Fastest capture rate (Modbus task period) */
+#define SAMPLE_TRACE_MAX_RATE_MS 5000       /**< Slowest capture rate */
+#define SAMPLE_TRACE_DEFAULT_RATE_MS 500
+#define SAMPLE_TRACE_DEFAULT_LENGTH 40
+#define SAMPLE_TRACE_MAX_BLOB 384           /**< Binary blob cap, samples past it are dropped */
+#define SAMPLE_TRACE_MAX_B64 (((SAMPLE_TRACE_MAX_BLOB + 2) / 3) * 4 + 1)
+#define SAMPLE_TRACE_VERSION 1
+
+/**
+ * @brief One quantized sample
+ */
+typedef struct {
+    uint32_t offset_ms;                 /**< ms since capture start */
+    int16_t do_mgl_x100;                /**< DO mg/L x100 */
+    int16_t do_pct_x10;                 /**< DO % x10 */
+    int16_t temp_x100;                  /**< Temperature degC x100 */
+} trace_sample_t;
+
+/**
+ * @struct sample_trace
+ * @brief Sample Trace Structure
+ */
+struct sample_trace {
+    trace_sample_t samples[SAMPLE_TRACE_MAX_SAMPLES]; /**< Ring storage */
+    uint16_t length;                    /**< Configured ring length (<= MAX_SAMPLES) */
+    uint16_t rate_ms;                   /**< Minimum spacing between samples */
+    uint16_t head;                      /**< Next write index */
+    uint16_t count;                     /**< Valid samples in the ring */
+    uint32_t start_ms;                  /**< millis() at capture start */
+    uint32_t last_ms;                   /**< millis() of the last recorded sample */
+    volatile uint8_t active;            /**< 1 while the countdown is running */
+    portMUX_TYPE lock;                  /**< Guards ring between Modbus and App tasks */
+};
+
+/**
+ * @brief Initialize the trace with a rate and length
+ * @param trace Pointer to trace structure
+ * @param rate_ms Minimum spacing between samples
+ * @param length Samples kept (0 disables capture)
+ */
+void sample_trace_init(struct sample_trace *trace, uint16_t rate_ms, uint16_t length);
+
+/**
+ * @brief Change rate and length, rejected while a capture is running
+ * @param trace Pointer to trace structure
+ * @param rate_ms SAMPLE_TRACE_MIN_RATE_MS..SAMPLE_TRACE_MAX_RATE_MS
+ * @param length 0..SAMPLE_TRACE_MAX_SAMPLES (0 disables capture)
+ * @return 1 on success, 0 on invalid values or active capture
+ */
+uint8_t sample_trace_configure(struct sample_trace *trace, uint16_t rate_ms, uint16_t length);
+
+/**
+ * @brief Drop any previous samples and start recording
+ * @param trace Pointer to trace structure
+ * @param now_ms Current millis()
+ */
+void sample_trace_start(struct sample_trace *trace, uint32_t now_ms);
+
+/**
+ * @brief Stop recording, samples are kept until sample_trace_clear()
+ * @param trace Pointer to trace structure
+ */
+void sample_trace_stop(struct sample_trace *trace);
+
+/**
+ * @brief Drop all samples
+ * @param trace Pointer to trace structure
+ */
+void sample_trace_clear(struct sample_trace *trace);
+
+/**
+ * @brief Record a reading if capture is active and rate_ms has elapsed
+ * @param trace Pointer to trace structure
+ * @param now_ms millis() at which the reading was taken
+ * @param do_mgl DO mg/L
+ * @param do_pct DO %
+ * @param temp Temperature degC
+ * @return 1 if recorded, 0 if skipped or taken before the capture started
+ */
+uint8_t sample_trace_record(struct sample_trace *trace, uint32_t now_ms,
+                            float do_mgl, float do_pct, float temp);
+
+/**
+ * @brief Delta-encode the stopped trace into a binary blob
+ * @param trace Pointer to trace structure
+ * @param out Output buffer
+ * @param cap Output capacity
+ * @return Blob length, 0 if empty or still recording
+ */
+size_t sample_trace_encode(struct sample_trace *trace, uint8_t *out, size_t cap);
+
+/**
+ * @brief Encode the stopped trace as a NUL-terminated base64 string
+ * @param trace Pointer to trace structure
+ * @param out Output buffer (SAMPLE_TRACE_MAX_B64 is always enough)
+ * @param cap Output capacity
+ * @return String length, 0 if empty or still recording
+ */
+size_t sample_trace_encode_base64(struct sample_trace *trace, char *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_TRACE_H */
@@ -0,0 +1,366 @@
+/**
+ * @file sensor_bus_ops.cpp
+ * @brief Multi-drop RS-485 Sensor Bus Manager Implementation
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * ModbusMaster transactions are blocking, so the bus never runs two at once.
+ * Fairness comes from the round-robin cursor and from backing off slaves
+ * that stop answering: a dead probe costs one timeout per back-off period
+ * instead of one per second.
+ *
+ * Requests from other tasks sit in a small table under the bus lock. The
+ * Modbus task runs them outside the lock, since a transaction blocks for
+ * up to the Modbus timeout, and marks each one done for its poster.
+ */
+
+#include "sensor_bus_ops.h"
+#include "perf_metrics.h"
+#include <Arduino.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+/**
+ * @brief Wrap-safe check whether a deadline has passed
+ */
+static bool is_due(uint32_t now, uint32_t due)
+{
+    return (int32_t)(now - due) >= 0;
+}
+
+/**
+ * @brief Run one read transaction for a slot and update its schedule
+ */
+static uint8_t service_slot(sensor_bus_slot_t *slot, uint32_t now)
+{
+    uint32_t t0 = PERF_NOW();
+    uint8_t ok = do_sensor_read_values(slot->sensor);
+    PERF_RECORD(PERF_MODBUS, t0);
+    slot->polls++;
+
+    if (ok)
+    {
+        slot->backoff_ms = slot->interval_ms;
+        slot->last_ok_ms = now;
+    }
+    else
+    {
+        slot->failures++;
+        /* Back off only once the driver has declared the probe disconnected,
+           short glitches keep the nominal cadence */
+        if (!do_sensor_is_connected(slot->sensor))
+        {
+            slot->backoff_ms = (slot->backoff_ms * 2 > SENSOR_BUS_MAX_BACKOFF_MS) ?
+                               SENSOR_BUS_MAX_BACKOFF_MS : slot->backoff_ms * 2;
+        }
+        debugPrintf("[SensorBus] slave 0x%02X failed (%lu/%lu), next in %lu ms\n",
+                    slot->slave_id, slot->failures, slot->polls, slot->backoff_ms);
+    }
+
+    slot->next_due_ms = now + slot->backoff_ms;
+    return ok;
+}
+
+/**
+ * @brief Oldest queued request, marked running (takes the bus lock)
+ */
+static sensor_bus_req_t *take_request(struct sensor_bus *bus)
+{
+    sensor_bus_req_t *oldest = NULL;
+    portENTER_CRITICAL(&bus->lock);
+    for (uint8_t i = 0; i < SENSOR_BUS_MAX_REQUESTS; i++)
+    {
+        sensor_bus_req_t *req = &bus->requests[i];
+        if (!req->ticket || req->state != SENSOR_BUS_RES_PENDING || req->running)
+            continue;
+        if (!oldest || (int32_t)(req->ticket - oldest->ticket) < 0)
+            oldest = req;
+    }
+    if (oldest) oldest->running = 1;
+    portEXIT_CRITICAL(&bus->lock);
+    return oldest;
+}
+
+/**
+ * @brief Run one request on the UART, Modbus task only
+ * @return 1 on success, 0 on failure
+ */
+static uint8_t run_request(struct sensor_bus *bus, uint8_t slave_id, uint8_t op,
+                           float *value, float *value_b)
+{
+    struct do_sensor_device *sensor = sensor_bus_find(bus, slave_id);
+    if (!sensor) return FAIL;
+
+    uint8_t ok = FAIL;
+    switch (op)
+    {
+    case SENSOR_BUS_OP_SET_SALINITY:
+        ok = do_sensor_set_salinity(sensor, *value);
+        break;
+    case SENSOR_BUS_OP_GET_SALINITY:
+        ok = do_sensor_get_salinity(sensor);
+        *value = sensor->salinity;
+        break;
+    case SENSOR_BUS_OP_SET_PRESSURE:
+        ok = do_sensor_set_pressure(sensor, *value);
+        break;
+    case SENSOR_BUS_OP_GET_PRESSURE:
+        ok = do_sensor_get_pressure(sensor);
+        *value = sensor->pressure;
+        break;
+    case SENSOR_BUS_OP_GET_CALIBRATION:
+        ok = do_sensor_get_calibration(sensor);
+        *value = sensor->cal_k;
+        *value_b = sensor->cal_b;
+        break;
+    default:
+        break;
+    }
+    debugPrintf("[SensorBus] request op %d on slave 0x%02X -> %d\n", op, slave_id, ok);
+    return ok;
+}
+
+/**
+ * @brief Run every queued request, oldest first
+ */
+static uint8_t service_requests(struct sensor_bus *bus)
+{
+    uint8_t served = 0;
+    sensor_bus_req_t *req;
+    while ((req = take_request(bus)) != NULL)
+    {
+        /* Only the Modbus task writes a running entry, the copy keeps the lock short */
+        float value = req->value;
+        float value_b = 0.0f;
+        uint8_t ok = run_request(bus, req->slave_id, req->op, &value, &value_b);
+        served++;
+
+        portENTER_CRITICAL(&bus->lock);
+        req->running = 0;
+        if (req->released)
+        {
+            memset(req, 0, sizeof(sensor_bus_req_t));
+        }
+        else
+        {
+            req->value = value;
+            req->value_b = value_b;
+            req->state = ok ? SENSOR_BUS_RES_OK : SENSOR_BUS_RES_FAILED;
+        }
+        portEXIT_CRITICAL(&bus->lock);
+    }
+    return served;
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+uint8_t sensor_bus_init(struct sensor_bus *bus, const char *name, Stream *serial)
+{
+    if (!bus || !serial) return FAIL;
+
+    memset(bus, 0, sizeof(struct sensor_bus));
+    bus->name = name;
+    bus->serial = serial;
+    bus->next_ticket = 1;
+    bus->lock = portMUX_INITIALIZER_UNLOCKED;
+    return SUCCESS;
+}
+
+uint8_t sensor_bus_attach(struct sensor_bus *bus, struct do_sensor_device *sensor,
+                          uint8_t slave_id, uint32_t interval_ms)
+{
+    if (!bus || !sensor) return FAIL;
+    if (bus->num_slots >= SENSOR_BUS_MAX_DEVICES) return FAIL;
+    if (sensor_bus_find(bus, slave_id)) return FAIL;
+
+    /* A probe whose setup failed never gets a slot, so it is never polled */
+    uint8_t ret = do_sensor_setup(sensor, bus->serial, slave_id);
+    debugPrintf("[SensorBus] %s: attach %s as slave 0x%02X (%d)\n",
+                bus->name, sensor->name, slave_id, ret);
+    if (!ret) return FAIL;
+
+    sensor_bus_slot_t *slot = &bus->slots[bus->num_slots];
+    memset(slot, 0, sizeof(sensor_bus_slot_t));
+    slot->sensor = sensor;
+    slot->slave_id = slave_id;
+    slot->interval_ms = interval_ms ? interval_ms : SENSOR_BUS_DEFAULT_INTERVAL_MS;
+    slot->backoff_ms = slot->interval_ms;
+    /* Stagger first polls so the probes do not all come due on the same tick */
+    slot->next_due_ms = millis() + (uint32_t)bus->num_slots * (slot->interval_ms / SENSOR_BUS_MAX_DEVICES);
+    bus->num_slots++;
+    return SUCCESS;
+}
+
+uint8_t sensor_bus_service(struct sensor_bus *bus)
+{
+    if (!bus || !bus->num_slots) return 0;
+
+    /* Operator requests go ahead of the periodic reads */
+    uint8_t served = service_requests(bus);
+    uint8_t start = bus->next_slot;
+    for (uint8_t n = 0; n < bus->num_slots; n++)
+    {
+        uint8_t idx = (start + n) % bus->num_slots;
+        sensor_bus_slot_t *slot = &bus->slots[idx];
+        /* Re-read the clock per slot, each transaction can take up to the Modbus timeout */
+        uint32_t now = millis();
+        if (!is_due(now, slot->next_due_ms))
+            continue;
+
+        service_slot(slot, now);
+        served++;
+        bus->next_slot = (idx + 1) % bus->num_slots;
+    }
+    return served;
+}
+
+uint32_t sensor_bus_post(struct sensor_bus *bus, uint8_t slave_id, uint8_t op, float value)
+{
+    if (!bus || !sensor_bus_find(bus, slave_id)) return 0;
+
+    uint32_t ticket = 0;
+    portENTER_CRITICAL(&bus->lock);
+    for (uint8_t i = 0; i < SENSOR_BUS_MAX_REQUESTS; i++)
+    {
+        sensor_bus_req_t *req = &bus->requests[i];
+        if (req->ticket)
+            continue;
+
+        ticket = bus->next_ticket++;
+        if (!bus->next_ticket) bus->next_ticket = 1;
+        memset(req, 0, sizeof(sensor_bus_req_t));
+        req->ticket = ticket;
+        req->slave_id = slave_id;
+        req->op = op;
+        req->state = SENSOR_BUS_RES_PENDING;
+        req->value = value;
+        break;
+    }
+    portEXIT_CRITICAL(&bus->lock);
+    return ticket;
+}
+
+uint8_t sensor_bus_result(struct sensor_bus *bus, uint32_t ticket, float *value, float *value_b)
+{
+    if (!bus || !ticket) return SENSOR_BUS_RES_NONE;
+
+    uint8_t state = SENSOR_BUS_RES_NONE;
+    portENTER_CRITICAL(&bus->lock);
+    for (uint8_t i = 0; i < SENSOR_BUS_MAX_REQUESTS; i++)
+    {
+        sensor_bus_req_t *req = &bus->requests[i];
+        if (req->ticket != ticket || req->released)
+            continue;
+
+        state = req->state;
+        if (state != SENSOR_BUS_RES_PENDING)
+        {
+            if (value) *value = req->value;
+            if (value_b) *value_b = req->value_b;
+            memset(req, 0, sizeof(sensor_bus_req_t));
+        }
+        break;
+    }
+    portEXIT_CRITICAL(&bus->lock);
+    return state;
+}
+
+void sensor_bus_release(struct sensor_bus *bus, uint32_t ticket)
+{
+    if (!bus || !ticket) return;
+
+    portENTER_CRITICAL(&bus->lock);
+    for (uint8_t i = 0; i < SENSOR_BUS_MAX_REQUESTS; i++)
+    {
+        sensor_bus_req_t *req = &bus->requests[i];
+        if (req->ticket != ticket)
+            continue;
+
+        /* A queued or running request still runs, the Modbus task frees it afterwards */
+        if (req->state == SENSOR_BUS_RES_PENDING)
+            req->released = 1;
+        else
+            memset(req, 0, sizeof(sensor_bus_req_t));
+        break;
+    }
+    portEXIT_CRITICAL(&bus->lock);
+}
+
+struct do_sensor_device *sensor_bus_find(struct sensor_bus *bus, uint8_t slave_id)
+{
+    sensor_bus_slot_t *slot = sensor_bus_find_slot(bus, slave_id);
+    return slot ? slot->sensor : NULL;
+}
+
+sensor_bus_slot_t *sensor_bus_find_slot(struct sensor_bus *bus, uint8_t slave_id)
+{
+    if (!bus) return NULL;
+
+    for (uint8_t i = 0; i < bus->num_slots; i++)
+    {
+        if (bus->slots[i].slave_id == slave_id)
+            return &bus->slots[i];
+    }
+    return NULL;
+}
+
+uint8_t sensor_bus_set_interval(struct sensor_bus *bus, uint8_t slave_id, uint32_t interval_ms)
+{
+    sensor_bus_slot_t *slot = sensor_bus_find_slot(bus, slave_id);
+    if (!slot) return FAIL;
+
+    slot->interval_ms = interval_ms ? interval_ms : SENSOR_BUS_DEFAULT_INTERVAL_MS;
+    if (do_sensor_is_connected(slot->sensor))
+    {
+        slot->backoff_ms = slot->interval_ms;
+        /* Pull the next poll in when the new period is shorter */
+        uint32_t now = millis();
+        if ((int32_t)(slot->next_due_ms - (now + slot->interval_ms)) > 0)
+            slot->next_due_ms = now + slot->interval_ms;
+    }
+    return SUCCESS;
+}
+
+uint32_t sensor_bus_idle_ms(struct sensor_bus *bus, uint32_t now)
+{
+    if (!bus) return UINT32_MAX;
+
+    uint8_t queued = 0;
+    portENTER_CRITICAL(&bus->lock);
+    for (uint8_t i = 0; i < SENSOR_BUS_MAX_REQUESTS; i++)
+    {
+        if (bus->requests[i].state == SENSOR_BUS_RES_PENDING && !bus->requests[i].running)
+            queued = 1;
+    }
+    portEXIT_CRITICAL(&bus->lock);
+    if (queued && bus->num_slots) return 0;
+
+    uint32_t idle = UINT32_MAX;
+    for (uint8_t i = 0; i < bus->num_slots; i++)
+    {
+        uint32_t due = bus->slots[i].next_due_ms;
+        if (is_due(now, due)) return 0;
+        if (due - now < idle) idle = due - now;
+    }
+    return idle;
+}
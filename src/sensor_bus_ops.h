@@ -0,0 +1,246 @@
+/**
+ * @file sensor_bus_ops.h
+ * @brief Multi-drop RS-485 Sensor Bus Manager
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The sensor bus owns one UART and schedules Modbus RTU transactions for
+ * several `do_sensor_device` instances that share the same RS-485 pair and
+ * differ only by slave ID. It follows the same C-style device structure as
+ * the other *_ops modules:
+ * - One transaction in flight at a time (the bus is half duplex)
+ * - Round-robin service order, so no probe can starve the others
+ * - Per-slot poll interval with exponential back-off for silent slaves,
+ *   so a missing probe does not eat the bus with 2 s Modbus timeouts
+ * - Other tasks never touch the UART: they post a request (set salinity,
+ *   read pressure, ...) and collect its result by ticket once the Modbus
+ *   task has run it, ahead of the next poll
+ *
+ * @par Usage Pattern:
+ * @code
+ * // 1. Declare bus and sensors
+ * struct sensor_bus g_sensor_bus;
+ * struct do_sensor_device g_do_sensor;
+ *
+ * // 2. Initialize bus on the RS-485 UART
+ * sensor_bus_init(&g_sensor_bus, "RS485", &Serial1);
+ *
+ * // 3. Attach every probe with its slave ID
+ * do_sensor_init(&g_do_sensor, "FLDBH-505A", &modbus_do_sensor_ops);
+ * sensor_bus_attach(&g_sensor_bus, &g_do_sensor, 0x01, 1000);
+ *
+ * // 4. Service the bus from the Modbus task
+ * sensor_bus_service(&g_sensor_bus);
+ *
+ * // 5. Any other task: queue a request, wake the Modbus task, collect the result
+ * uint32_t ticket = sensor_bus_post(&g_sensor_bus, 0x01, SENSOR_BUS_OP_GET_SALINITY, 0);
+ * app_events_signal(APP_EV_SENSOR_BUS);
+ * while (sensor_bus_result(&g_sensor_bus, ticket, &salinity, NULL) == SENSOR_BUS_RES_PENDING)
+ *     vTaskDelay(pdMS_TO_TICKS(20));
+ * @endcode
+ *
+ * @see sensor_bus_ops.cpp for implementation details
+ */
+
+#ifndef SENSOR_BUS_OPS_H
+#define SENSOR_BUS_OPS_H
+
+#include <stdint.h>
+#include <Stream.h>
+#include <freertos/FreeRTOS.h>
+#include "do_sensor_ops.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SENSOR_BUS_MAX_DEVICES 4            /**< Probes sharing one RS-485 pair */
+#define SENSOR_BUS_DEFAULT_INTERVAL_MS 1000 /**< Default poll period per probe */
+#define SENSOR_BUS_MAX_BACKOFF_MS 30000     /**< Poll period cap for a silent probe */
+#define SENSOR_BUS_MAX_REQUESTS 4           /**< Requests queued or waiting for collection */
+
+/**
+ * @brief Probe operations other tasks can queue
+ */
+typedef enum {
+    SENSOR_BUS_OP_SET_SALINITY = 1,     /**< Write value as the salinity */
+    SENSOR_BUS_OP_GET_SALINITY,         /**< Result: salinity */
+    SENSOR_BUS_OP_SET_PRESSURE,         /**< Write value as the pressure */
+    SENSOR_BUS_OP_GET_PRESSURE,         /**< Result: pressure */
+    SENSOR_BUS_OP_GET_CALIBRATION       /**< Result: K, and B in the second value */
+} sensor_bus_op_t;
+
+/**
+ * @brief State of a request as seen by the task that posted it
+ */
+typedef enum {
+    SENSOR_BUS_RES_NONE = 0,            /**< Unknown ticket, or result already collected */
+    SENSOR_BUS_RES_PENDING,             /**< Queued or running */
+    SENSOR_BUS_RES_OK,                  /**< Done, values valid */
+    SENSOR_BUS_RES_FAILED               /**< Done, the transaction failed */
+} sensor_bus_res_t;
+
+/**
+ * @brief One queued request
+ */
+typedef struct {
+    uint32_t ticket;                    /**< 0 while the entry is free */
+    uint8_t slave_id;                   /**< Probe addressed */
+    uint8_t op;                         /**< sensor_bus_op_t */
+    uint8_t state;                      /**< sensor_bus_res_t */
+    uint8_t running;                    /**< Taken by the Modbus task */
+    uint8_t released;                   /**< Poster gave up, free once done */
+    float value;                        /**< Argument of a set, first result of a get */
+    float value_b;                      /**< Second result (B of GET_CALIBRATION) */
+} sensor_bus_req_t;
+
+/**
+ * @brief One probe attached to the bus
+ */
+typedef struct {
+    struct do_sensor_device *sensor;    /**< Probe driven through its ops table */
+    uint8_t slave_id;                   /**< Modbus slave ID on the bus */
+    uint32_t interval_ms;               /**< Nominal poll period */
+    uint32_t backoff_ms;                /**< Current poll period (grows while silent) */
+    uint32_t next_due_ms;               /**< millis() at which the next poll is due */
+    uint32_t last_ok_ms;                /**< millis() of the last successful read */
+    uint32_t polls;                     /**< Transactions issued */
+    uint32_t failures;                  /**< Transactions that failed */
+} sensor_bus_slot_t;
+
+/**
+ * @struct sensor_bus
+ * @brief Sensor Bus Structure
+ *
+ * @par Lifecycle:
+ * 1. Declare: `struct sensor_bus g_sensor_bus;`
+ * 2. Initialize: `sensor_bus_init(&g_sensor_bus, "RS485", &Serial1)`
+ * 3. Attach: `sensor_bus_attach(&g_sensor_bus, &g_do_sensor, 0x01, 1000)`
+ * 4. Use: `sensor_bus_service(&g_sensor_bus)`
+ */
+struct sensor_bus {
+    const char *name;                   /**< Bus name for logging */
+    Stream *serial;                     /**< UART owned by the bus */
+
+    sensor_bus_slot_t slots[SENSOR_BUS_MAX_DEVICES]; /**< Attached probes */
+    uint8_t num_slots;                  /**< Number of attached probes */
+    uint8_t next_slot;                  /**< Round-robin cursor */
+
+    sensor_bus_req_t requests[SENSOR_BUS_MAX_REQUESTS]; /**< Posted by other tasks */
+    uint32_t next_ticket;               /**< Ticket of the next request */
+    portMUX_TYPE lock;                  /**< Guards requests and next_ticket across tasks */
+};
+
+/**
+ * @brief Initialize the bus on a UART
+ * @param bus Pointer to bus structure
+ * @param name Bus name for logging
+ * @param serial UART connected to the RS-485 transceiver
+ * @return 1 on success, 0 on failure
+ */
+uint8_t sensor_bus_init(struct sensor_bus *bus, const char *name, Stream *serial);
+
+/**
+ * @brief Attach a probe and run its setup on the shared UART
+ * @param bus Pointer to bus structure
+ * @param sensor Probe initialized with do_sensor_init()
+ * @param slave_id Modbus slave ID of the probe
+ * @param interval_ms Poll period (0 selects SENSOR_BUS_DEFAULT_INTERVAL_MS)
+ * @return 1 on success, 0 if the bus is full, the slave ID is taken or setup failed
+ */
+uint8_t sensor_bus_attach(struct sensor_bus *bus, struct do_sensor_device *sensor,
+                          uint8_t slave_id, uint32_t interval_ms);
+
+/**
+ * @brief Poll every probe that is due, in round-robin order
+ * @param bus Pointer to bus structure
+ * @return Number of transactions issued
+ *
+ * @details
+ * Queued requests run first, oldest first. Each due probe then gets exactly
+ * one read transaction per call. A probe that fails has its poll period
+ * doubled (up to SENSOR_BUS_MAX_BACKOFF_MS), and it returns to its nominal
+ * period on the first successful read.
+ */
+uint8_t sensor_bus_service(struct sensor_bus *bus);
+
+/**
+ * @brief Queue a request for the Modbus task, from any task
+ * @param bus Pointer to bus structure
+ * @param slave_id Modbus slave ID of the probe
+ * @param op sensor_bus_op_t
+ * @param value Argument of a set operation, ignored by a get
+ * @return Ticket for sensor_bus_result(), 0 if the slave is not attached or the queue is full
+ *
+ * @details
+ * Only queues; signal APP_EV_SENSOR_BUS so the Modbus task runs it now
+ * rather than at its next poll.
+ */
+uint32_t sensor_bus_post(struct sensor_bus *bus, uint8_t slave_id, uint8_t op, float value);
+
+/**
+ * @brief Collect the result of a posted request, from any task
+ * @param bus Pointer to bus structure
+ * @param ticket Ticket from sensor_bus_post()
+ * @param value First result, may be NULL
+ * @param value_b Second result, may be NULL
+ * @return sensor_bus_res_t; OK and FAILED free the request, later calls return NONE
+ */
+uint8_t sensor_bus_result(struct sensor_bus *bus, uint32_t ticket, float *value, float *value_b);
+
+/**
+ * @brief Give up on a request's result, from any task
+ * @param bus Pointer to bus structure
+ * @param ticket Ticket from sensor_bus_post()
+ *
+ * @details
+ * A queued or running request still runs; its entry is freed once done.
+ */
+void sensor_bus_release(struct sensor_bus *bus, uint32_t ticket);
+
+/**
+ * @brief Find the probe attached with a given slave ID
+ * @param bus Pointer to bus structure
+ * @param slave_id Modbus slave ID
+ * @return Probe pointer, NULL if not attached
+ */
+struct do_sensor_device *sensor_bus_find(struct sensor_bus *bus, uint8_t slave_id);
+
+/**
+ * @brief Find the slot of a slave ID, for its poll bookkeeping
+ * @param bus Pointer to bus structure
+ * @param slave_id Modbus slave ID
+ * @return Slot pointer, NULL if not attached
+ *
+ * @details
+ * Slot order follows attach order, and a probe whose setup failed has no
+ * slot, so slots[0] is not necessarily the primary probe.
+ */
+sensor_bus_slot_t *sensor_bus_find_slot(struct sensor_bus *bus, uint8_t slave_id);
+
+/**
+ * @brief Change the nominal poll period of an attached probe
+ * @param bus Pointer to bus structure
+ * @param slave_id Modbus slave ID
+ * @param interval_ms New poll period (0 selects SENSOR_BUS_DEFAULT_INTERVAL_MS)
+ * @return 1 on success, 0 if the slave is not attached
+ *
+ * @details
+ * Takes effect from the next poll; a probe in back-off keeps backing off.
+ */
+uint8_t sensor_bus_set_interval(struct sensor_bus *bus, uint8_t slave_id, uint32_t interval_ms);
+
+/**
+ * @brief Time until the next probe comes due
+ * @param bus Pointer to bus structure
+ * @param now millis()
+ * @return Milliseconds, 0 if a probe is due or a request is queued, UINT32_MAX with no probe attached
+ */
+uint32_t sensor_bus_idle_ms(struct sensor_bus *bus, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_BUS_OPS_H */
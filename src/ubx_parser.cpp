@@ -0,0 +1,231 @@
+/**
+ * @file ubx_parser.cpp
+ * @brief u-blox UBX framing, NAV-PVT decoding and receiver configuration Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "ubx_parser.h"
+#include <string.h>
+
+#define SUCCESS 1
+#define FAIL 0
+
+#define UBX_FRAME_OVERHEAD 8            /* Sync, class, id, length, checksum */
+
+#define UBX_PRT_UART1 1
+#define UBX_PRT_MODE_8N1 0x000008D0UL
+#define UBX_PROTO_UBX 0x0001
+#define UBX_PROTO_NMEA 0x0002
+
+/**
+ * @brief Parser states, one per frame field
+ */
+enum {
+    UBX_WAIT_SYNC_1 = 0,
+    UBX_WAIT_SYNC_2,
+    UBX_WAIT_CLASS,
+    UBX_WAIT_ID,
+    UBX_WAIT_LEN_1,
+    UBX_WAIT_LEN_2,
+    UBX_WAIT_PAYLOAD,
+    UBX_WAIT_CK_A,
+    UBX_WAIT_CK_B
+};
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+static inline void checksum_add(struct ubx_parser *p, uint8_t c)
+{
+    p->ck_a += c;
+    p->ck_b += p->ck_a;
+}
+
+static uint16_t get_u2(const uint8_t *b)
+{
+    return (uint16_t)(b[0] | (b[1] << 8));
+}
+
+static uint32_t get_u4(const uint8_t *b)
+{
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static void put_u2(uint8_t *b, uint16_t v)
+{
+    b[0] = (uint8_t)v;
+    b[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u4(uint8_t *b, uint32_t v)
+{
+    put_u2(b, (uint16_t)v);
+    put_u2(b + 2, (uint16_t)(v >> 16));
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void ubx_parser_init(struct ubx_parser *p)
+{
+    if (!p) return;
+    memset(p, 0, sizeof(struct ubx_parser));
+}
+
+uint8_t ubx_parser_feed(struct ubx_parser *p, uint8_t c)
+{
+    if (!p) return FAIL;
+
+    switch (p->state)
+    {
+    case UBX_WAIT_SYNC_1:
+        if (c == UBX_SYNC_1) p->state = UBX_WAIT_SYNC_2;
+        break;
+    case UBX_WAIT_SYNC_2:
+        /* A repeated first sync byte may still start a frame */
+        p->state = (c == UBX_SYNC_2) ? UBX_WAIT_CLASS : (c == UBX_SYNC_1) ? UBX_WAIT_SYNC_2 : UBX_WAIT_SYNC_1;
+        p->ck_a = 0;
+        p->ck_b = 0;
+        break;
+    case UBX_WAIT_CLASS:
+        p->cls = c;
+        checksum_add(p, c);
+        p->state = UBX_WAIT_ID;
+        break;
+    case UBX_WAIT_ID:
+        p->id = c;
+        checksum_add(p, c);
+        p->state = UBX_WAIT_LEN_1;
+        break;
+    case UBX_WAIT_LEN_1:
+        p->len = c;
+        checksum_add(p, c);
+        p->state = UBX_WAIT_LEN_2;
+        break;
+    case UBX_WAIT_LEN_2:
+        p->len |= (uint16_t)c << 8;
+        checksum_add(p, c);
+        p->idx = 0;
+        if (p->len > UBX_MAX_PAYLOAD)
+        {
+            /* Too long to store, or a corrupted length: resync on the next bytes */
+            p->oversized++;
+            p->state = UBX_WAIT_SYNC_1;
+            break;
+        }
+        p->state = p->len ? UBX_WAIT_PAYLOAD : UBX_WAIT_CK_A;
+        break;
+    case UBX_WAIT_PAYLOAD:
+        p->payload[p->idx++] = c;
+        checksum_add(p, c);
+        if (p->idx >= p->len) p->state = UBX_WAIT_CK_A;
+        break;
+    case UBX_WAIT_CK_A:
+        p->state = (c == p->ck_a) ? UBX_WAIT_CK_B : UBX_WAIT_SYNC_1;
+        if (c != p->ck_a) p->errors++;
+        break;
+    case UBX_WAIT_CK_B:
+        p->state = UBX_WAIT_SYNC_1;
+        if (c != p->ck_b)
+        {
+            p->errors++;
+            return FAIL;
+        }
+        p->frames++;
+        return SUCCESS;
+    default:
+        p->state = UBX_WAIT_SYNC_1;
+        break;
+    }
+    return FAIL;
+}
+
+uint8_t ubx_decode_nav_pvt(const struct ubx_parser *p, struct ubx_nav_pvt *out)
+{
+    if (!p || !out) return FAIL;
+    if (p->cls != UBX_CLASS_NAV || p->id != UBX_ID_NAV_PVT || p->len != UBX_NAV_PVT_LEN) return FAIL;
+
+    const uint8_t *b = p->payload;
+    out->itow_ms = get_u4(b + 0);
+    out->year = get_u2(b + 4);
+    out->month = b[6];
+    out->day = b[7];
+    out->hour = b[8];
+    out->min = b[9];
+    out->sec = b[10];
+    out->valid = b[11];
+    out->fix_type = b[20];
+    out->flags = b[21];
+    out->num_sv = b[23];
+    out->lon = (int32_t)get_u4(b + 24);
+    out->lat = (int32_t)get_u4(b + 28);
+    out->h_msl_mm = (int32_t)get_u4(b + 36);
+    out->h_acc_mm = get_u4(b + 40);
+    out->g_speed_mms = (int32_t)get_u4(b + 60);
+    out->pdop = get_u2(b + 76);
+    return SUCCESS;
+}
+
+uint8_t ubx_decode_nav_dop(const struct ubx_parser *p, struct ubx_nav_dop *out)
+{
+    if (!p || !out) return FAIL;
+    if (p->cls != UBX_CLASS_NAV || p->id != UBX_ID_NAV_DOP || p->len != UBX_NAV_DOP_LEN) return FAIL;
+
+    const uint8_t *b = p->payload;
+    out->itow_ms = get_u4(b + 0);
+    out->pdop = get_u2(b + 6);
+    out->vdop = get_u2(b + 10);
+    out->hdop = get_u2(b + 12);
+    return SUCCESS;
+}
+
+size_t ubx_build(uint8_t *buf, size_t cap, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+    if (!buf || cap < (size_t)len + UBX_FRAME_OVERHEAD || (len && !payload)) return 0;
+
+    buf[0] = UBX_SYNC_1;
+    buf[1] = UBX_SYNC_2;
+    buf[2] = cls;
+    buf[3] = id;
+    put_u2(buf + 4, len);
+    if (len) memcpy(buf + 6, payload, len);
+
+    uint8_t ck_a = 0, ck_b = 0;
+    for (size_t i = 2; i < (size_t)len + 6; i++)
+    {
+        ck_a += buf[i];
+        ck_b += ck_a;
+    }
+    buf[len + 6] = ck_a;
+    buf[len + 7] = ck_b;
+    return (size_t)len + UBX_FRAME_OVERHEAD;
+}
+
+size_t ubx_build_cfg_prt(uint8_t *buf, size_t cap, uint32_t baud, uint8_t ubx_out)
+{
+    uint8_t pl[20] = {0};
+    pl[0] = UBX_PRT_UART1;
+    put_u4(pl + 4, UBX_PRT_MODE_8N1);
+    put_u4(pl + 8, baud);
+    put_u2(pl + 12, UBX_PROTO_UBX | UBX_PROTO_NMEA);
+    put_u2(pl + 14, ubx_out ? UBX_PROTO_UBX : UBX_PROTO_NMEA);
+    return ubx_build(buf, cap, UBX_CLASS_CFG, UBX_ID_CFG_PRT, pl, sizeof(pl));
+}
+
+size_t ubx_build_cfg_msg(uint8_t *buf, size_t cap, uint8_t cls, uint8_t id, uint8_t rate)
+{
+    uint8_t pl[3] = {cls, id, rate};
+    return ubx_build(buf, cap, UBX_CLASS_CFG, UBX_ID_CFG_MSG, pl, sizeof(pl));
+}
+
+size_t ubx_build_cfg_rate(uint8_t *buf, size_t cap, uint16_t meas_ms)
+{
+    uint8_t pl[6] = {0};
+    put_u2(pl + 0, meas_ms);
+    put_u2(pl + 2, 1);                  /* One solution per measurement */
+    put_u2(pl + 4, 0);                  /* Aligned to UTC */
+    return ubx_build(buf, cap, UBX_CLASS_CFG, UBX_ID_CFG_RATE, pl, sizeof(pl));
+}
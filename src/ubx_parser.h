@@ -0,0 +1,211 @@
+/**
+ * @file ubx_parser.h
+ * @brief u-blox UBX framing, NAV-PVT decoding and receiver configuration
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * UBX frames are binary and fixed-layout:
+ * @code
+ * 0xB5 0x62 | class | id | length (LE16) | payload | CK_A CK_B
+ * @endcode
+ * The checksum (8-bit Fletcher over class..payload) is accumulated while the
+ * bytes arrive, so a frame is framed, checked and stored in one pass with no
+ * line buffer and no text-to-number conversion. NAV-PVT (92 bytes) carries
+ * position, accuracy, fix type, satellites, ground speed and UTC time of one
+ * epoch together, replacing the GGA/RMC/GSA/GSV/VTG sentences (~450 bytes
+ * per epoch) that NMEA needs for the same data. NAV-PVT has PDOP only, so
+ * NAV-DOP (18 bytes) is enabled alongside it for HDOP.
+ *
+ * A length over UBX_MAX_PAYLOAD is refused as soon as it is read and the
+ * parser hunts for the sync bytes again: a corrupted length field would
+ * otherwise swallow up to 64 KB of the stream, good frames included.
+ *
+ * The configuration builders use the CFG-PRT / CFG-MSG / CFG-RATE messages
+ * (u-blox 6/7/8; still accepted by M9 firmware). Settings live in receiver
+ * RAM and are sent again at every boot.
+ *
+ * @par Usage Pattern:
+ * @code
+ * uint8_t msg[32];
+ * serial->write(msg, ubx_build_cfg_prt(msg, sizeof(msg), 38400, 1));
+ * serial->write(msg, ubx_build_cfg_msg(msg, sizeof(msg), UBX_CLASS_NAV, UBX_ID_NAV_PVT, 1));
+ * serial->write(msg, ubx_build_cfg_rate(msg, sizeof(msg), 200));
+ *
+ * while (serial->available())
+ *     if (ubx_parser_feed(&parser, serial->read()) && ubx_decode_nav_pvt(&parser, &pvt))
+ *         use(pvt);
+ * @endcode
+ */
+
+#ifndef UBX_PARSER_H
+#define UBX_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UBX_SYNC_1 0xB5
+#define UBX_SYNC_2 0x62
+#define UBX_MAX_PAYLOAD 100             /**< NAV-PVT is 92 bytes */
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_ID_NAV_DOP 0x04
+#define UBX_ID_NAV_PVT 0x07
+#define UBX_ID_CFG_PRT 0x00
+#define UBX_ID_CFG_MSG 0x01
+#define UBX_ID_CFG_RATE 0x08
+
+#define UBX_NAV_PVT_LEN 92
+#define UBX_NAV_DOP_LEN 18
+
+#define UBX_PVT_VALID_DATE 0x01         /**< valid: UTC date known */
+#define UBX_PVT_VALID_TIME 0x02         /**< valid: UTC time of day known */
+#define UBX_PVT_GNSS_FIX_OK 0x01        /**< flags: fix within DOP and accuracy masks */
+
+/**
+ * @brief Fix types reported in NAV-PVT
+ */
+typedef enum {
+    UBX_FIX_NONE = 0,
+    UBX_FIX_DEAD_RECKONING,
+    UBX_FIX_2D,
+    UBX_FIX_3D,
+    UBX_FIX_GNSS_DR,
+    UBX_FIX_TIME_ONLY
+} ubx_fix_type_t;
+
+/**
+ * @brief One navigation epoch
+ */
+struct ubx_nav_pvt {
+    uint32_t itow_ms;                   /**< GPS time of week */
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+    uint8_t valid;                      /**< UBX_PVT_VALID_* */
+    uint8_t fix_type;                   /**< ubx_fix_type_t */
+    uint8_t flags;                      /**< UBX_PVT_GNSS_FIX_OK */
+    uint8_t num_sv;
+    int32_t lon;                        /**< Degrees x 1e-7 */
+    int32_t lat;                        /**< Degrees x 1e-7 */
+    int32_t h_msl_mm;
+    uint32_t h_acc_mm;                  /**< Horizontal accuracy estimate */
+    int32_t g_speed_mms;                /**< Ground speed */
+    uint16_t pdop;                      /**< x 0.01 */
+};
+
+/**
+ * @brief Dilution of precision of one epoch
+ */
+struct ubx_nav_dop {
+    uint32_t itow_ms;                   /**< Matches the NAV-PVT of the same epoch */
+    uint16_t pdop;                      /**< x 0.01 */
+    uint16_t hdop;                      /**< x 0.01 */
+    uint16_t vdop;                      /**< x 0.01 */
+};
+
+/**
+ * @struct ubx_parser
+ * @brief Byte-wise frame decoder
+ */
+struct ubx_parser {
+    uint8_t state;
+    uint8_t cls;
+    uint8_t id;
+    uint8_t ck_a;
+    uint8_t ck_b;
+    uint16_t len;                       /**< Payload length of the current frame */
+    uint16_t idx;
+    uint8_t payload[UBX_MAX_PAYLOAD];
+    uint32_t frames;                    /**< Frames with a good checksum */
+    uint32_t errors;                    /**< Frames with a bad checksum */
+    uint32_t oversized;                 /**< Lengths over UBX_MAX_PAYLOAD, refused */
+};
+
+/**
+ * @brief Reset to hunting for the sync bytes
+ * @param p Pointer to parser
+ */
+void ubx_parser_init(struct ubx_parser *p);
+
+/**
+ * @brief Consume one byte
+ * @param p Pointer to parser
+ * @param c Received byte
+ * @return 1 when it completed a frame with a good checksum
+ *         (p->cls, p->id, p->len describe it), 0 otherwise
+ */
+uint8_t ubx_parser_feed(struct ubx_parser *p, uint8_t c);
+
+/**
+ * @brief Decode the completed frame as NAV-PVT
+ * @param p Parser that just returned 1 from ubx_parser_feed()
+ * @param out Decoded epoch
+ * @return 1 if the frame is NAV-PVT, 0 otherwise
+ */
+uint8_t ubx_decode_nav_pvt(const struct ubx_parser *p, struct ubx_nav_pvt *out);
+
+/**
+ * @brief Decode the completed frame as NAV-DOP
+ * @param p Parser that just returned 1 from ubx_parser_feed()
+ * @param out Decoded DOP values
+ * @return 1 if the frame is NAV-DOP, 0 otherwise
+ */
+uint8_t ubx_decode_nav_dop(const struct ubx_parser *p, struct ubx_nav_dop *out);
+
+/**
+ * @brief Frame a UBX message with sync bytes and checksum
+ * @param buf Output
+ * @param cap Size of buf
+ * @param cls Message class
+ * @param id Message id
+ * @param payload Payload, may be NULL when len is 0
+ * @param len Payload length
+ * @return Frame length, 0 if it does not fit
+ */
+size_t ubx_build(uint8_t *buf, size_t cap, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len);
+
+/**
+ * @brief CFG-PRT for UART1: 8N1 at baud, UBX and NMEA in, UBX or NMEA out
+ * @param buf Output, at least 28 bytes
+ * @param cap Size of buf
+ * @param baud Port speed, must match the host UART
+ * @param ubx_out 1 for UBX only output, 0 for NMEA only output
+ * @return Frame length, 0 if it does not fit
+ */
+size_t ubx_build_cfg_prt(uint8_t *buf, size_t cap, uint32_t baud, uint8_t ubx_out);
+
+/**
+ * @brief CFG-MSG: output rate of one message on the current port
+ * @param buf Output, at least 11 bytes
+ * @param cap Size of buf
+ * @param cls Message class
+ * @param id Message id
+ * @param rate Once every rate navigation epochs, 0 disables it
+ * @return Frame length, 0 if it does not fit
+ */
+size_t ubx_build_cfg_msg(uint8_t *buf, size_t cap, uint8_t cls, uint8_t id, uint8_t rate);
+
+/**
+ * @brief CFG-RATE: navigation epoch length, UTC aligned
+ * @param buf Output, at least 14 bytes
+ * @param cap Size of buf
+ * @param meas_ms Epoch length (200 for 5 Hz, 1000 for 1 Hz)
+ * @return Frame length, 0 if it does not fit
+ */
+size_t ubx_build_cfg_rate(uint8_t *buf, size_t cap, uint16_t meas_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UBX_PARSER_H */
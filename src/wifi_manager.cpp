@@ -0,0 +1,462 @@
+/**
+ * @file wifi_manager.cpp
+ * @brief Station connection manager Implementation
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#include "wifi_manager.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <string.h>
+
+// #define SERIAL_DEBUG
+#ifdef SERIAL_DEBUG
+#define debugPrint(...) Serial.print(__VA_ARGS__)
+#define debugPrintln(...) Serial.println(__VA_ARGS__)
+#define debugPrintf(...) Serial.printf(__VA_ARGS__)
+#else
+#define debugPrint(...)
+#define debugPrintln(...)
+#define debugPrintf(...)
+#endif
+
+#define SUCCESS 1
+#define FAIL 0
+
+#define WIFI_NVS_NAMESPACE "wifiMgr"
+
+/**
+ * @brief Last good AP as kept in NVS, matched to nets[] by SSID on load
+ */
+typedef struct {
+    char ssid[WIFI_MGR_SSID_MAX];
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_ap_cache_t;
+
+/* ========================================================================
+ * HELPER FUNCTIONS
+ * ======================================================================== */
+
+static void enter(struct wifi_manager *m, uint8_t state, uint32_t now)
+{
+    m->state = state;
+    m->since = now;
+}
+
+static void copy_str(char *dst, const char *src, size_t len)
+{
+    strncpy(dst, src ? src : "", len - 1);
+    dst[len - 1] = '\0';
+}
+
+static int find_net(const struct wifi_manager *m, const char *ssid)
+{
+    for (uint8_t i = 0; i < m->count; i++)
+    {
+        if (m->nets[i].ssid[0] && !strcmp(m->nets[i].ssid, ssid)) return i;
+    }
+    return -1;
+}
+
+static void load_nvs(struct wifi_manager *m)
+{
+    Preferences prefs;
+    if (!prefs.begin(WIFI_NVS_NAMESPACE, true)) return;
+
+    struct wifi_network extra[WIFI_MGR_MAX_NETWORKS - 1];
+    size_t n = prefs.getBytes("nets", extra, sizeof(extra)) / sizeof(struct wifi_network);
+    wifi_ap_cache_t ap;
+    size_t a = prefs.getBytes("ap", &ap, sizeof(ap));
+    prefs.end();
+
+    for (size_t i = 0; i < n && m->count < WIFI_MGR_MAX_NETWORKS; i++)
+    {
+        extra[i].ssid[WIFI_MGR_SSID_MAX - 1] = '\0';
+        extra[i].pass[WIFI_MGR_PASS_MAX - 1] = '\0';
+        if (extra[i].ssid[0]) m->nets[m->count++] = extra[i];
+    }
+
+    if (a == sizeof(ap))
+    {
+        ap.ssid[WIFI_MGR_SSID_MAX - 1] = '\0';
+        int idx = find_net(m, ap.ssid);
+        if (idx >= 0 && ap.channel)
+        {
+            m->has_cache = 1;
+            m->cache_net = (uint8_t)idx;
+            m->cache_channel = ap.channel;
+            memcpy(m->cache_bssid, ap.bssid, sizeof(m->cache_bssid));
+        }
+    }
+}
+
+/**
+ * @brief Remember the AP we are on; NVS is written only when it changed
+ */
+static void update_cache(struct wifi_manager *m, uint8_t net)
+{
+    const uint8_t *bssid = WiFi.BSSID();
+    uint8_t channel = (uint8_t)WiFi.channel();
+    if (!bssid || !channel) return;
+
+    if (m->has_cache && m->cache_net == net && m->cache_channel == channel &&
+        !memcmp(m->cache_bssid, bssid, sizeof(m->cache_bssid)))
+    {
+        return;
+    }
+    m->has_cache = 1;
+    m->cache_net = net;
+    m->cache_channel = channel;
+    memcpy(m->cache_bssid, bssid, sizeof(m->cache_bssid));
+
+    wifi_ap_cache_t ap;
+    memset(&ap, 0, sizeof(ap));
+    copy_str(ap.ssid, m->nets[net].ssid, sizeof(ap.ssid));
+    memcpy(ap.bssid, bssid, sizeof(ap.bssid));
+    ap.channel = channel;
+
+    Preferences prefs;
+    if (!prefs.begin(WIFI_NVS_NAMESPACE, false)) return;
+    prefs.putBytes("ap", &ap, sizeof(ap));
+    prefs.end();
+}
+
+static void record_online(struct wifi_manager *m, uint32_t now)
+{
+    uint32_t ms = now - m->offline_since;
+    uint8_t bucket = 0;
+    while (bucket < WIFI_MGR_HIST_BUCKETS - 1 && ms >= (1000UL << bucket)) bucket++;
+
+    m->stats.outages++;
+    m->stats.hist[bucket]++;
+    m->stats.last_ms = ms;
+    if (ms > m->stats.max_ms) m->stats.max_ms = ms;
+    if (m->roaming)
+        m->stats.roams++;
+    else if (m->state == WIFI_MGR_DIRECT)
+        m->stats.direct++;
+    else
+        m->stats.scanned++;
+    debugPrintf("[WiFi] online after %lu ms (%s)\n", (unsigned long)ms, wifi_manager_state_name(m->state));
+}
+
+static void on_connected(struct wifi_manager *m, uint32_t now)
+{
+    if (m->outage) record_online(m, now);
+    update_cache(m, m->target);
+
+    m->outage = 0;
+    m->roaming = 0;
+    m->backoff_ms = 0;
+    m->direct_tried = 0;
+    m->last_scan = now;
+    m->last_rssi_poll = now;
+    m->rssi = (int8_t)WiFi.RSSI();
+    enter(m, WIFI_MGR_ONLINE, now);
+}
+
+static void back_off(struct wifi_manager *m, uint32_t now)
+{
+    m->backoff_ms = m->backoff_ms ? m->backoff_ms * 2 : WIFI_MGR_BACKOFF_MIN_MS;
+    if (m->backoff_ms > WIFI_MGR_BACKOFF_MAX_MS) m->backoff_ms = WIFI_MGR_BACKOFF_MAX_MS;
+    m->direct_tried = 0;
+    m->roaming = 0;
+    debugPrintf("[WiFi] retry in %lu ms\n", (unsigned long)m->backoff_ms);
+    enter(m, WIFI_MGR_WAIT, now);
+}
+
+/**
+ * @brief Start an async scan; offline the station is stopped first so the
+ * driver is not busy with a connect
+ */
+static uint8_t start_scan(struct wifi_manager *m, uint8_t state, uint32_t now)
+{
+    if (state == WIFI_MGR_SCAN) WiFi.disconnect();
+    if (WiFi.scanNetworks(true, false, false, WIFI_MGR_SCAN_DWELL_MS) == WIFI_SCAN_FAILED) return FAIL;
+
+    m->stats.scans++;
+    m->last_scan = now;
+    enter(m, state, now);
+    return SUCCESS;
+}
+
+/**
+ * @brief Strongest AP of a known network in the scan results
+ * @return Index into nets[], -1 if none was seen
+ */
+static int pick_best(struct wifi_manager *m, int found, uint8_t *bssid, uint8_t *channel, int32_t *rssi)
+{
+    int best = -1;
+    for (int i = 0; i < found; i++)
+    {
+        int idx = find_net(m, WiFi.SSID(i).c_str());
+        if (idx < 0) continue;
+        int32_t r = WiFi.RSSI(i);
+        if (best >= 0 && r <= *rssi) continue;
+        best = idx;
+        *rssi = r;
+        *channel = (uint8_t)WiFi.channel(i);
+        memcpy(bssid, WiFi.BSSID(i), 6);
+    }
+    return best;
+}
+
+static void join(struct wifi_manager *m, uint8_t net, const uint8_t *bssid, uint8_t channel,
+                 uint8_t state, uint32_t now)
+{
+    debugPrintf("[WiFi] join %s ch %u\n", m->nets[net].ssid, channel);
+    m->target = net;
+    WiFi.begin(m->nets[net].ssid, m->nets[net].pass, channel, bssid);
+    enter(m, state, now);
+}
+
+/**
+ * @brief One cycle: cached AP first, else scan
+ */
+static void attempt(struct wifi_manager *m, uint32_t now)
+{
+    if (m->has_cache && !m->direct_tried)
+    {
+        m->direct_tried = 1;
+        join(m, m->cache_net, m->cache_bssid, m->cache_channel, WIFI_MGR_DIRECT, now);
+        return;
+    }
+    if (!start_scan(m, WIFI_MGR_SCAN, now)) back_off(m, now);
+}
+
+static void link_lost(struct wifi_manager *m, uint32_t now)
+{
+    debugPrintln("[WiFi] link lost");
+    m->outage = 1;
+    m->offline_since = now;
+    m->backoff_ms = 0;
+    m->direct_tried = 0;
+    m->roaming = 0;
+}
+
+/**
+ * @brief Results of an offline scan: join the best known AP or back off
+ */
+static void scan_done(struct wifi_manager *m, int found, uint32_t now)
+{
+    uint8_t bssid[6];
+    uint8_t channel = 0;
+    int32_t rssi = 0;
+    int best = pick_best(m, found, bssid, &channel, &rssi);
+    WiFi.scanDelete();
+
+    if (best >= 0)
+        join(m, (uint8_t)best, bssid, channel, WIFI_MGR_JOIN, now);
+    else
+        back_off(m, now);
+}
+
+/**
+ * @brief Results of a roam scan: move if a known AP is clearly stronger
+ */
+static void roam_scan_done(struct wifi_manager *m, int found, uint32_t now)
+{
+    uint8_t bssid[6];
+    uint8_t channel = 0;
+    int32_t rssi = 0;
+    int best = pick_best(m, found, bssid, &channel, &rssi);
+    WiFi.scanDelete();
+
+    m->rssi = (int8_t)WiFi.RSSI();
+    const uint8_t *current = WiFi.BSSID();
+    if (best >= 0 && rssi >= m->rssi + WIFI_MGR_ROAM_MARGIN && (!current || memcmp(current, bssid, 6)))
+    {
+        debugPrintf("[WiFi] roam %d -> %ld dBm\n", m->rssi, (long)rssi);
+        link_lost(m, now);
+        m->roaming = 1;
+        m->roam_left = 0;
+        memcpy(m->roam_bssid, bssid, sizeof(m->roam_bssid));
+        join(m, (uint8_t)best, bssid, channel, WIFI_MGR_JOIN, now);
+        return;
+    }
+    enter(m, WIFI_MGR_ONLINE, now);
+}
+
+/**
+ * @brief Whether a join has landed
+ *
+ * @details
+ * While a roam is under way WiFi.status() keeps reading WL_CONNECTED for
+ * the old AP until the driver drops it, so a roam only counts as done once
+ * the station is on the target BSSID, or came back up after a disconnect.
+ */
+static uint8_t join_done(struct wifi_manager *m, uint8_t up)
+{
+    if (!m->roaming) return up;
+    if (!up)
+    {
+        m->roam_left = 1;
+        return 0;
+    }
+    if (m->roam_left) return 1;
+    const uint8_t *bssid = WiFi.BSSID();
+    return bssid && !memcmp(bssid, m->roam_bssid, sizeof(m->roam_bssid));
+}
+
+/* ========================================================================
+ * PUBLIC API FUNCTIONS
+ * ======================================================================== */
+
+void wifi_manager_init(struct wifi_manager *m, const char *ssid, const char *pass)
+{
+    if (!m) return;
+
+    memset(m, 0, sizeof(struct wifi_manager));
+    copy_str(m->nets[0].ssid, ssid, sizeof(m->nets[0].ssid));
+    copy_str(m->nets[0].pass, pass, sizeof(m->nets[0].pass));
+    m->count = 1;
+    load_nvs(m);
+
+    /* The manager owns reconnects; keep the driver from retrying on its own
+     * and from writing credentials to flash on every begin */
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false);
+    WiFi.mode(WIFI_STA);
+
+    uint32_t now = millis();
+    link_lost(m, now);
+    attempt(m, now);
+}
+
+void wifi_manager_service(struct wifi_manager *m, uint32_t now)
+{
+    if (!m) return;
+
+    uint8_t up = (WiFi.status() == WL_CONNECTED);
+    int found;
+
+    switch (m->state)
+    {
+    case WIFI_MGR_ONLINE:
+        if (!up)
+        {
+            link_lost(m, now);
+            attempt(m, now);
+            break;
+        }
+        if (now - m->last_rssi_poll < WIFI_MGR_RSSI_POLL_MS) break;
+        m->last_rssi_poll = now;
+        m->rssi = (int8_t)WiFi.RSSI();
+        if (m->rssi < WIFI_MGR_ROAM_RSSI && now - m->last_scan >= WIFI_MGR_ROAM_SCAN_MS)
+        {
+            start_scan(m, WIFI_MGR_ROAM_SCAN, now);
+        }
+        break;
+
+    case WIFI_MGR_ROAM_SCAN:
+        if (!up)
+        {
+            /* Dropped mid-scan: its results serve the reconnect */
+            link_lost(m, now);
+            m->state = WIFI_MGR_SCAN;
+            break;
+        }
+        found = WiFi.scanComplete();
+        if (found == WIFI_SCAN_RUNNING && now - m->since < WIFI_MGR_SCAN_TIMEOUT_MS) break;
+        roam_scan_done(m, found, now);
+        break;
+
+    case WIFI_MGR_SCAN:
+        found = WiFi.scanComplete();
+        if (found == WIFI_SCAN_RUNNING && now - m->since < WIFI_MGR_SCAN_TIMEOUT_MS) break;
+        scan_done(m, found, now);
+        break;
+
+    case WIFI_MGR_DIRECT:
+        if (up)
+        {
+            on_connected(m, now);
+        }
+        else if (now - m->since >= WIFI_MGR_DIRECT_TIMEOUT_MS)
+        {
+            /* Cached AP gone or moved channel: scan right away */
+            m->stats.failures++;
+            if (!start_scan(m, WIFI_MGR_SCAN, now)) back_off(m, now);
+        }
+        break;
+
+    case WIFI_MGR_JOIN:
+        if (join_done(m, up))
+        {
+            on_connected(m, now);
+        }
+        else if (now - m->since >= WIFI_MGR_JOIN_TIMEOUT_MS)
+        {
+            m->stats.failures++;
+            if (m->roaming && up && !m->roam_left)
+            {
+                /* The driver never left the old AP: no outage, stay on it */
+                m->outage = 0;
+                m->roaming = 0;
+                enter(m, WIFI_MGR_ONLINE, now);
+                break;
+            }
+            back_off(m, now);
+        }
+        break;
+
+    case WIFI_MGR_WAIT:
+    default:
+        if (up)
+            on_connected(m, now);
+        else if (now - m->since >= m->backoff_ms)
+            attempt(m, now);
+        break;
+    }
+}
+
+uint8_t wifi_manager_set_networks(struct wifi_manager *m, const struct wifi_network *nets, uint8_t n)
+{
+    if (!m || n > WIFI_MGR_MAX_NETWORKS - 1 || (n && !nets)) return FAIL;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        if (!nets[i].ssid[0]) return FAIL;
+    }
+
+    char cached[WIFI_MGR_SSID_MAX];
+    copy_str(cached, m->has_cache ? m->nets[m->cache_net].ssid : "", sizeof(cached));
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        copy_str(m->nets[1 + i].ssid, nets[i].ssid, WIFI_MGR_SSID_MAX);
+        copy_str(m->nets[1 + i].pass, nets[i].pass, WIFI_MGR_PASS_MAX);
+    }
+    m->count = 1 + n;
+
+    /* Indexes moved; keep the cached AP only if its network is still known */
+    int idx = find_net(m, cached);
+    m->has_cache = (idx >= 0);
+    m->cache_net = (idx >= 0) ? (uint8_t)idx : 0;
+    if (m->target >= m->count) m->target = 0;
+
+    Preferences prefs;
+    if (!prefs.begin(WIFI_NVS_NAMESPACE, false)) return FAIL;
+    if (n)
+        prefs.putBytes("nets", &m->nets[1], n * sizeof(struct wifi_network));
+    else
+        prefs.remove("nets");
+    prefs.end();
+    return SUCCESS;
+}
+
+const char *wifi_manager_state_name(uint8_t state)
+{
+    switch (state)
+    {
+    case WIFI_MGR_WAIT: return "backoff";
+    case WIFI_MGR_DIRECT: return "direct";
+    case WIFI_MGR_SCAN: return "scan";
+    case WIFI_MGR_JOIN: return "join";
+    case WIFI_MGR_ONLINE: return "online";
+    case WIFI_MGR_ROAM_SCAN: return "roamScan";
+    default: return "unknown";
+    }
+}
@@ -0,0 +1,168 @@
+/**
+ * @file wifi_manager.h
+ * @brief Station connection manager: cached BSSID, known networks, roaming
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Replaces the fixed 15 s WiFi.disconnect() / WiFi.begin(ssid, pass) retry.
+ * Handhelds move between pond sections served by different APs (often the
+ * same SSID), and the time back online decides whether frames go live or to
+ * backup, so each outage is handled as:
+ *
+ * 1. Direct connect to the last good BSSID and channel (no scan, ~1 s)
+ * 2. One scan, then join the strongest AP of any known network
+ * 3. Exponential backoff (WIFI_MGR_BACKOFF_MIN_MS doubling up to
+ *    WIFI_MGR_BACKOFF_MAX_MS) before repeating from 1
+ *
+ * While online, RSSI below WIFI_MGR_ROAM_RSSI starts a background scan (at
+ * most every WIFI_MGR_ROAM_SCAN_MS) and the station moves to a known AP that
+ * is WIFI_MGR_ROAM_MARGIN dB stronger.
+ *
+ * Known networks are the device credentials (slot 0, from "wifiSsid" /
+ * "wifiPass") plus up to WIFI_MGR_MAX_NETWORKS - 1 extras kept in NVS. The
+ * last good AP is kept in NVS too, so the first connect after boot is direct.
+ *
+ * Every outage that ends online is timed from the moment the link dropped
+ * and counted in a histogram of power-of-two second buckets.
+ *
+ * All calls come from the App task; no locking.
+ *
+ * @par Usage Pattern:
+ * @code
+ * wifi_manager_init(&g_wifiMgr, m_cWifiSsid, m_cWifiPass);
+ *
+ * // App task, every tick
+ * wifi_manager_service(&g_wifiMgr, millis());
+ * @endcode
+ */
+
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIFI_MGR_MAX_NETWORKS 4         /**< Device credentials + 3 extras */
+#define WIFI_MGR_SSID_MAX 33
+#define WIFI_MGR_PASS_MAX 65
+
+#define WIFI_MGR_DIRECT_TIMEOUT_MS 4000 /**< Cached BSSID connect */
+#define WIFI_MGR_JOIN_TIMEOUT_MS 10000  /**< Connect after a scan */
+#define WIFI_MGR_SCAN_TIMEOUT_MS 8000
+#define WIFI_MGR_SCAN_DWELL_MS 120      /**< Active scan time per channel */
+#define WIFI_MGR_BACKOFF_MIN_MS 1000
+#define WIFI_MGR_BACKOFF_MAX_MS 32000
+
+#define WIFI_MGR_ROAM_RSSI -72          /**< dBm, below this look for a better AP */
+#define WIFI_MGR_ROAM_MARGIN 8          /**< dB a candidate must gain */
+#define WIFI_MGR_ROAM_SCAN_MS 30000     /**< Minimum gap between roam scans */
+#define WIFI_MGR_RSSI_POLL_MS 2000
+
+#define WIFI_MGR_HIST_BUCKETS 8         /**< <1 s, <2 s, <4 s ... <64 s, longer */
+
+/**
+ * @brief Manager state
+ */
+typedef enum {
+    WIFI_MGR_WAIT = 0,                  /**< Backing off before the next attempt */
+    WIFI_MGR_DIRECT,                    /**< Connecting to the cached BSSID */
+    WIFI_MGR_SCAN,                      /**< Offline scan for known networks */
+    WIFI_MGR_JOIN,                      /**< Connecting to the AP the scan picked */
+    WIFI_MGR_ONLINE,
+    WIFI_MGR_ROAM_SCAN                  /**< Online, scanning for a stronger AP */
+} wifi_mgr_state_t;
+
+/**
+ * @brief Known network
+ */
+struct wifi_network {
+    char ssid[WIFI_MGR_SSID_MAX];
+    char pass[WIFI_MGR_PASS_MAX];
+};
+
+/**
+ * @brief Reconnect telemetry since boot
+ */
+struct wifi_manager_stats {
+    uint32_t outages;                   /**< Offline periods that ended online */
+    uint32_t direct;                    /**< ... through the cached BSSID */
+    uint32_t scanned;                   /**< ... through a scan and join */
+    uint32_t roams;                     /**< Moves to a stronger AP while online */
+    uint32_t scans;
+    uint32_t failures;                  /**< Attempts that timed out */
+    uint32_t last_ms;                   /**< Latest time to online */
+    uint32_t max_ms;
+    uint32_t hist[WIFI_MGR_HIST_BUCKETS];
+};
+
+/**
+ * @struct wifi_manager
+ * @brief Known networks, cached AP and connection state
+ */
+struct wifi_manager {
+    struct wifi_network nets[WIFI_MGR_MAX_NETWORKS];
+    uint8_t count;
+
+    uint8_t state;                      /**< wifi_mgr_state_t */
+    uint8_t outage;                     /**< Offline since offline_since */
+    uint8_t direct_tried;               /**< Cached connect done this cycle */
+    uint8_t roaming;                    /**< Current join is a roam */
+    uint8_t roam_left;                  /**< Roam saw the link drop since the join */
+    uint8_t roam_bssid[6];              /**< AP the roam is moving to */
+    uint8_t target;                     /**< Network being joined */
+    uint32_t since;                     /**< State entry, ms */
+    uint32_t offline_since;
+    uint32_t backoff_ms;
+    uint32_t last_scan;
+    uint32_t last_rssi_poll;
+    int8_t rssi;                        /**< Last polled while online */
+
+    uint8_t has_cache;
+    uint8_t cache_net;                  /**< Index into nets[] */
+    uint8_t cache_channel;
+    uint8_t cache_bssid[6];
+
+    struct wifi_manager_stats stats;
+};
+
+/**
+ * @brief Load extras and the cached AP, configure the station and start connecting
+ * @param m Pointer to manager
+ * @param ssid Device network (slot 0)
+ * @param pass Its password
+ */
+void wifi_manager_init(struct wifi_manager *m, const char *ssid, const char *pass);
+
+/**
+ * @brief Advance connection, roaming and timers
+ * @param m Pointer to manager
+ * @param now millis()
+ */
+void wifi_manager_service(struct wifi_manager *m, uint32_t now);
+
+/**
+ * @brief Replace the extra networks and save them to NVS
+ * @param m Pointer to manager
+ * @param nets Networks, NULL with n = 0 clears the extras
+ * @param n Count, at most WIFI_MGR_MAX_NETWORKS - 1
+ * @return SUCCESS (1), or FAIL (0) on a bad count or an empty SSID
+ */
+uint8_t wifi_manager_set_networks(struct wifi_manager *m, const struct wifi_network *nets, uint8_t n);
+
+/**
+ * @brief Name of a state for logs and RPC replies
+ * @param state wifi_mgr_state_t
+ * @return Constant string
+ */
+const char *wifi_manager_state_name(uint8_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WIFI_MANAGER_H */
@@ -0,0 +1,82 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the Arduino core used by the native test build
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Covers what the hardware-independent modules touch: millis()/micros()
+ * on shim_clock.h, delay(), the math helpers, byte macros and Serial
+ * writing to stdout. No GPIO, no peripherals.
+ */
+
+#ifndef SHIM_ARDUINO_H
+#define SHIM_ARDUINO_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shim_clock.h"
+#include "Stream.h"
+#include "freertos/FreeRTOS.h"
+
+#define IRAM_ATTR
+#define PROGMEM
+#define F(s) (s)
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define radians(deg) ((deg) * DEG_TO_RAD)
+#define degrees(rad) ((rad) * RAD_TO_DEG)
+#define sq(x) ((x) * (x))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+inline uint16_t makeWord(uint16_t w) { return w; }
+inline uint16_t makeWord(uint8_t h, uint8_t l) { return (uint16_t)((h << 8) | l); }
+#define word(...) makeWord(__VA_ARGS__)
+
+inline unsigned long millis(void) { return (unsigned long)(shim_clock_us() / 1000); }
+inline unsigned long micros(void) { return (unsigned long)shim_clock_us(); }
+inline void delay(unsigned long ms) { shim_clock_sleep_us((uint64_t)ms * 1000); }
+inline void delayMicroseconds(unsigned int us) { shim_clock_sleep_us(us); }
+inline void yield(void) {}
+
+/**
+ * @brief Serial ports print to stdout and never receive
+ */
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    void end(void) {}
+    size_t write(uint8_t c) override { return (quiet || fputc(c, stdout) != EOF) ? 1 : 0; }
+    using Print::write;
+    bool quiet = false;                 /**< Host only: drop output of chatty code under test */
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    operator bool() const { return true; }
+};
+
+inline HardwareSerial Serial;
+inline HardwareSerial Serial1;
+inline HardwareSerial Serial2;
+
+#endif /* SHIM_ARDUINO_H */
@@ -0,0 +1,232 @@
+/**
+ * @file FS.h
+ * @brief Host file system for the native build: the Arduino fs::FS API on a directory
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Paths are flat like SPIFFS ("/BAK_0.txt") and map to files in a host
+ * directory. Behaviour the firmware relies on is kept: rename() refuses to
+ * replace an existing file, opening "/" lists the files, a file opened
+ * FILE_WRITE is truncated and may be rewritten after seek().
+ * name() follows arduino-esp32 2.x (no leading '/'), path() keeps it.
+ */
+
+#ifndef SHIM_FS_H
+#define SHIM_FS_H
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Stream.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+struct FileImpl {
+    FILE *fp = nullptr;
+    std::string path;                   /* As the firmware named it */
+    std::string host;                   /* Host file or directory */
+    bool dir = false;
+    bool writable = false;
+    std::vector<std::string> entries;   /* Directory listing */
+    size_t next = 0;
+
+    ~FileImpl()
+    {
+        if (fp) fclose(fp);
+    }
+};
+
+class File : public Stream
+{
+public:
+    File() {}
+    explicit File(std::shared_ptr<FileImpl> impl) : m_impl(impl) {}
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        if (!m_impl || !m_impl->fp || !m_impl->writable) return 0;
+        return fwrite(buf, 1, len, m_impl->fp);
+    }
+    using Print::write;
+
+    int available() override
+    {
+        if (!m_impl || !m_impl->fp || m_impl->writable) return 0;
+        long left = (long)size() - (long)position();
+        return left > 0 ? (int)left : 0;
+    }
+    int read() override
+    {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+    int peek() override
+    {
+        if (!m_impl || !m_impl->fp) return -1;
+        int c = fgetc(m_impl->fp);
+        if (c != EOF) ungetc(c, m_impl->fp);
+        return c == EOF ? -1 : c;
+    }
+    void flush() override
+    {
+        if (m_impl && m_impl->fp) fflush(m_impl->fp);
+    }
+    size_t read(uint8_t *buf, size_t len)
+    {
+        if (!m_impl || !m_impl->fp || m_impl->writable) return 0;
+        return fread(buf, 1, len, m_impl->fp);
+    }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet)
+    {
+        if (!m_impl || !m_impl->fp) return false;
+        int whence = (mode == SeekSet) ? SEEK_SET : (mode == SeekCur) ? SEEK_CUR : SEEK_END;
+        return fseek(m_impl->fp, (long)pos, whence) == 0;
+    }
+    size_t position() const
+    {
+        if (!m_impl || !m_impl->fp) return 0;
+        long pos = ftell(m_impl->fp);
+        return pos < 0 ? 0 : (size_t)pos;
+    }
+    size_t size() const
+    {
+        if (!m_impl || !m_impl->fp) return 0;
+        fflush(m_impl->fp);
+        struct stat st;
+        return fstat(fileno(m_impl->fp), &st) == 0 ? (size_t)st.st_size : 0;
+    }
+    void close()
+    {
+        m_impl.reset();
+    }
+    time_t getLastWrite()
+    {
+        struct stat st;
+        return (m_impl && stat(m_impl->host.c_str(), &st) == 0) ? st.st_mtime : 0;
+    }
+    const char *path() const { return m_impl ? m_impl->path.c_str() : nullptr; }
+    const char *name() const
+    {
+        if (!m_impl) return nullptr;
+        size_t slash = m_impl->path.rfind('/');
+        return m_impl->path.c_str() + ((slash == std::string::npos || m_impl->path.size() == 1) ? 0 : slash + 1);
+    }
+    bool isDirectory() const { return m_impl && m_impl->dir; }
+    File openNextFile(const char *mode = FILE_READ);
+    void rewindDirectory()
+    {
+        if (m_impl) m_impl->next = 0;
+    }
+    operator bool() const { return m_impl && (m_impl->dir || m_impl->fp); }
+
+private:
+    std::shared_ptr<FileImpl> m_impl;
+};
+
+class FS
+{
+public:
+    virtual ~FS() {}
+
+    File open(const char *path, const char *mode = FILE_READ, bool create = false)
+    {
+        (void)create;
+        if (!path || path[0] != '/') return File();
+        auto impl = std::make_shared<FileImpl>();
+        impl->path = path;
+        impl->host = host(path);
+        if (std::filesystem::is_directory(impl->host))
+        {
+            impl->dir = true;
+            for (const auto &e : std::filesystem::directory_iterator(impl->host))
+            {
+                if (e.is_regular_file()) impl->entries.push_back(e.path().filename().string());
+            }
+            std::sort(impl->entries.begin(), impl->entries.end());
+            return File(impl);
+        }
+        bool write = mode[0] == 'w' || mode[0] == 'a';
+        impl->fp = fopen(impl->host.c_str(), mode[0] == 'w' ? "wb" : mode[0] == 'a' ? "ab" : "rb");
+        impl->writable = write;
+        if (!impl->fp) return File();
+        return File(impl);
+    }
+    File open(const std::string &path, const char *mode = FILE_READ) { return open(path.c_str(), mode); }
+
+    bool exists(const char *path)
+    {
+        struct stat st;
+        return path && stat(host(path).c_str(), &st) == 0;
+    }
+    bool remove(const char *path)
+    {
+        return path && ::remove(host(path).c_str()) == 0;
+    }
+    /* Like SPIFFS, an existing target is not replaced */
+    bool rename(const char *from, const char *to)
+    {
+        if (!from || !to || exists(to) || !exists(from)) return false;
+        return ::rename(host(from).c_str(), host(to).c_str()) == 0;
+    }
+    bool mkdir(const char *path)
+    {
+        std::error_code ec;
+        return std::filesystem::create_directories(host(path), ec) || std::filesystem::is_directory(host(path));
+    }
+    bool rmdir(const char *path)
+    {
+        std::error_code ec;
+        return std::filesystem::remove(host(path), ec);
+    }
+
+    /** Host directory behind "/" */
+    const std::string &root(void) const { return m_root; }
+
+protected:
+    std::string host(const char *path) const { return m_root + path; }
+    std::string m_root;
+};
+
+inline File File::openNextFile(const char *mode)
+{
+    if (!m_impl || !m_impl->dir || m_impl->next >= m_impl->entries.size()) return File();
+    std::string child = m_impl->path;
+    if (child.empty() || child.back() != '/') child += '/';
+    child += m_impl->entries[m_impl->next++];
+
+    auto impl = std::make_shared<FileImpl>();
+    impl->path = child;
+    impl->host = m_impl->host + (m_impl->host.back() == '/' ? "" : "/") + m_impl->entries[m_impl->next - 1];
+    impl->fp = fopen(impl->host.c_str(), mode[0] == 'w' ? "wb" : mode[0] == 'a' ? "ab" : "rb");
+    impl->writable = mode[0] != 'r';
+    return impl->fp ? File(impl) : File();
+}
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekMode;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekSet;
+
+#endif /* SHIM_FS_H */
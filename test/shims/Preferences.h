@@ -0,0 +1,127 @@
+/**
+ * @file Preferences.h
+ * @brief Host NVS: Preferences on an in-memory map that outlives the object
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Values survive end() and a new Preferences object, like NVS survives a
+ * reboot; shim_nvs_erase() wipes everything between tests.
+ */
+
+#ifndef SHIM_PREFERENCES_H
+#define SHIM_PREFERENCES_H
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t>> shim_nvs_namespace;
+
+inline std::map<std::string, shim_nvs_namespace> &shim_nvs(void)
+{
+    static std::map<std::string, shim_nvs_namespace> nvs;
+    return nvs;
+}
+
+inline void shim_nvs_erase(void)
+{
+    shim_nvs().clear();
+}
+
+class Preferences
+{
+public:
+    bool begin(const char *name, bool readOnly = false, const char *partition = NULL)
+    {
+        (void)partition;
+        if (!name || strlen(name) > 15) return false;
+        m_ns = &shim_nvs()[name];
+        m_readOnly = readOnly;
+        return true;
+    }
+    void end(void) { m_ns = nullptr; }
+    bool clear(void)
+    {
+        if (!m_ns || m_readOnly) return false;
+        m_ns->clear();
+        return true;
+    }
+    bool remove(const char *key) { return m_ns && !m_readOnly && m_ns->erase(key) > 0; }
+    bool isKey(const char *key) { return m_ns && m_ns->count(key); }
+
+    size_t putBytes(const char *key, const void *value, size_t len)
+    {
+        if (!m_ns || m_readOnly || !key || strlen(key) > 15) return 0;
+        const uint8_t *p = (const uint8_t *)value;
+        (*m_ns)[key] = std::vector<uint8_t>(p, p + len);
+        return len;
+    }
+    size_t getBytesLength(const char *key)
+    {
+        const std::vector<uint8_t> *v = find(key);
+        return v ? v->size() : 0;
+    }
+    size_t getBytes(const char *key, void *buf, size_t maxLen)
+    {
+        const std::vector<uint8_t> *v = find(key);
+        if (!v || v->size() > maxLen) return 0;
+        memcpy(buf, v->data(), v->size());
+        return v->size();
+    }
+
+    size_t putString(const char *key, const char *value)
+    {
+        return value ? putBytes(key, value, strlen(value) + 1) : 0;
+    }
+    /* Returns the length including the terminator, 0 if missing or too long */
+    size_t getString(const char *key, char *value, size_t maxLen)
+    {
+        return getBytes(key, value, maxLen);
+    }
+
+    size_t putUChar(const char *key, uint8_t v) { return put(key, v); }
+    uint8_t getUChar(const char *key, uint8_t def = 0) { return get(key, def); }
+    size_t putChar(const char *key, int8_t v) { return put(key, v); }
+    int8_t getChar(const char *key, int8_t def = 0) { return get(key, def); }
+    size_t putUShort(const char *key, uint16_t v) { return put(key, v); }
+    uint16_t getUShort(const char *key, uint16_t def = 0) { return get(key, def); }
+    size_t putShort(const char *key, int16_t v) { return put(key, v); }
+    int16_t getShort(const char *key, int16_t def = 0) { return get(key, def); }
+    size_t putUInt(const char *key, uint32_t v) { return put(key, v); }
+    uint32_t getUInt(const char *key, uint32_t def = 0) { return get(key, def); }
+    size_t putInt(const char *key, int32_t v) { return put(key, v); }
+    int32_t getInt(const char *key, int32_t def = 0) { return get(key, def); }
+    size_t putULong(const char *key, uint32_t v) { return put(key, v); }
+    uint32_t getULong(const char *key, uint32_t def = 0) { return get(key, def); }
+    size_t putLong(const char *key, int32_t v) { return put(key, v); }
+    int32_t getLong(const char *key, int32_t def = 0) { return get(key, def); }
+    size_t putFloat(const char *key, float v) { return put(key, v); }
+    float getFloat(const char *key, float def = 0) { return get(key, def); }
+    size_t putBool(const char *key, bool v) { return put(key, (uint8_t)v); }
+    bool getBool(const char *key, bool def = false) { return get(key, (uint8_t)def) != 0; }
+
+private:
+    const std::vector<uint8_t> *find(const char *key)
+    {
+        if (!m_ns || !key) return nullptr;
+        auto it = m_ns->find(key);
+        return it == m_ns->end() ? nullptr : &it->second;
+    }
+    template <typename T> size_t put(const char *key, T v) { return putBytes(key, &v, sizeof(v)); }
+    template <typename T> T get(const char *key, T def)
+    {
+        const std::vector<uint8_t> *v = find(key);
+        if (!v || v->size() != sizeof(T)) return def;
+        T out;
+        memcpy(&out, v->data(), sizeof(T));
+        return out;
+    }
+
+    shim_nvs_namespace *m_ns = nullptr;
+    bool m_readOnly = false;
+};
+
+#endif /* SHIM_PREFERENCES_H */
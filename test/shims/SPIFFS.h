@@ -0,0 +1,71 @@
+/**
+ * @file SPIFFS.h
+ * @brief Host SPIFFS: fs::FS on a scratch directory
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The directory is $SHIM_FS_ROOT, or watermon_spiffs_<pid> in the system
+ * temp directory. Tests start from an empty file system with
+ * SPIFFS.begin() and SPIFFS.format(). totalBytes() reports the
+ * min_spiffs.csv partition; the host directory does not enforce it.
+ */
+
+#ifndef SHIM_SPIFFS_H
+#define SHIM_SPIFFS_H
+
+#include <stdlib.h>
+#include <unistd.h>
+#include "FS.h"
+
+#define SHIM_SPIFFS_SIZE 0x20000
+
+namespace fs
+{
+
+class SPIFFSFS : public FS
+{
+public:
+    bool begin(bool formatOnFail = false, const char *basePath = "/spiffs", uint8_t maxOpenFiles = 10,
+               const char *partitionLabel = NULL)
+    {
+        (void)formatOnFail;
+        (void)basePath;
+        (void)maxOpenFiles;
+        (void)partitionLabel;
+        if (m_root.empty())
+        {
+            const char *env = getenv("SHIM_FS_ROOT");
+            m_root = env ? env : (std::filesystem::temp_directory_path() /
+                                  ("watermon_spiffs_" + std::to_string(getpid()))).string();
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(m_root, ec);
+        return std::filesystem::is_directory(m_root);
+    }
+    void end(void) {}
+    bool format(void)
+    {
+        if (m_root.empty()) return false;
+        std::error_code ec;
+        std::filesystem::remove_all(m_root, ec);
+        return std::filesystem::create_directories(m_root, ec);
+    }
+    size_t totalBytes(void) { return SHIM_SPIFFS_SIZE; }
+    size_t usedBytes(void)
+    {
+        size_t used = 0;
+        std::error_code ec;
+        for (const auto &e : std::filesystem::directory_iterator(m_root, ec))
+        {
+            if (e.is_regular_file()) used += (size_t)e.file_size();
+        }
+        return used;
+    }
+};
+
+} // namespace fs
+
+inline fs::SPIFFSFS SPIFFS;
+
+#endif /* SHIM_SPIFFS_H */
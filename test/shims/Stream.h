@@ -0,0 +1,93 @@
+/**
+ * @file Stream.h
+ * @brief Host Print/Stream, the subset the firmware modules use
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#ifndef SHIM_STREAM_H
+#define SHIM_STREAM_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buf, size_t len)
+    {
+        size_t n = 0;
+        while (len-- && write(*buf++)) n++;
+        return n;
+    }
+    size_t write(const char *s) { return s ? write((const uint8_t *)s, strlen(s)) : 0; }
+    virtual void flush() {}
+
+    size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)))
+    {
+        char buf[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n < 0) return 0;
+        return write((const uint8_t *)buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+    }
+    size_t print(const char *s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(long v, int base = DEC) { return number((unsigned long)v, base, v < 0 && base == DEC); }
+    size_t print(unsigned long v, int base = DEC) { return number(v, base, false); }
+    size_t print(int v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(unsigned char v, int base = DEC) { return print((unsigned long)v, base); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+    size_t println(void) { return write("\r\n"); }
+    template <typename T> size_t println(T v) { size_t n = print(v); return n + println(); }
+    template <typename T> size_t println(T v, int fmt) { size_t n = print(v, fmt); return n + println(); }
+
+private:
+    size_t number(unsigned long v, int base, bool negative)
+    {
+        if (negative) return printf("-%lu", (unsigned long)(-(long)v));
+        if (base == HEX) return printf("%lX", v);
+        if (base == OCT) return printf("%lo", v);
+        return printf("%lu", v);
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long ms) { m_timeout = ms; }
+    size_t readBytes(uint8_t *buf, size_t len)
+    {
+        size_t n = 0;
+        while (n < len && available())
+        {
+            int c = read();
+            if (c < 0) break;
+            buf[n++] = (uint8_t)c;
+        }
+        return n;
+    }
+    size_t readBytes(char *buf, size_t len) { return readBytes((uint8_t *)buf, len); }
+
+protected:
+    unsigned long m_timeout = 1000;
+};
+
+#endif /* SHIM_STREAM_H */
@@ -0,0 +1,2 @@
+/* Pre-1.0 Arduino core header, pulled in by libraries when ARDUINO is not defined */
+#include "Arduino.h"
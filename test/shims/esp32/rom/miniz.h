@@ -0,0 +1,104 @@
+/**
+ * @file miniz.h
+ * @brief Host tinfl_decompress() on zlib, for the OTA inflater
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Only the streaming mode the firmware uses is covered: zlib header,
+ * input in pieces (TINFL_FLAG_HAS_MORE_INPUT) and a circular 32 KB output
+ * window. zlib keeps its own window, so the caller's buffer is plain output.
+ * The decompressor is malloc'd raw by the caller and never torn down, so
+ * the zlib state lives in a table here keyed by its address: released when
+ * the stream ends or fails, or by the next tinfl_init() at that address.
+ */
+
+#ifndef SHIM_MINIZ_H
+#define SHIM_MINIZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+#define TINFL_FLAG_PARSE_ZLIB_HEADER 1
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+#define TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF 4
+#define TINFL_FLAG_COMPUTE_ADLER32 8
+
+typedef enum {
+    TINFL_STATUS_FAILED_CANNOT_MAKE_PROGRESS = -4,
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+typedef struct {
+    uint8_t opaque[16];
+} tinfl_decompressor;
+
+/** zlib state per decompressor, kept here because callers free() theirs raw */
+inline std::map<tinfl_decompressor *, z_stream> &shim_tinfl_live(void)
+{
+    static std::map<tinfl_decompressor *, z_stream> *live = new std::map<tinfl_decompressor *, z_stream>();
+    return *live;
+}
+
+inline void shim_tinfl_release(tinfl_decompressor *r)
+{
+    auto it = shim_tinfl_live().find(r);
+    if (it == shim_tinfl_live().end()) return;
+    inflateEnd(&it->second);
+    shim_tinfl_live().erase(it);
+}
+
+inline void tinfl_init(tinfl_decompressor *r)
+{
+    shim_tinfl_release(r);
+    memset(r, 0, sizeof(*r));
+    z_stream &z = shim_tinfl_live()[r];
+    memset(&z, 0, sizeof(z));
+    if (inflateInit(&z) != Z_OK) shim_tinfl_live().erase(r);
+}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *pIn_buf_next, size_t *pIn_buf_size,
+                                     uint8_t *pOut_buf_start, uint8_t *pOut_buf_next, size_t *pOut_buf_size,
+                                     uint32_t decomp_flags)
+{
+    (void)pOut_buf_start;
+    auto it = shim_tinfl_live().find(r);
+    if (it == shim_tinfl_live().end() || !(decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER))
+    {
+        *pIn_buf_size = 0;
+        *pOut_buf_size = 0;
+        return TINFL_STATUS_BAD_PARAM;
+    }
+    z_stream &z = it->second;
+    z.next_in = (Bytef *)pIn_buf_next;
+    z.avail_in = (uInt)*pIn_buf_size;
+    z.next_out = pOut_buf_next;
+    z.avail_out = (uInt)*pOut_buf_size;
+    int ret = inflate(&z, Z_NO_FLUSH);
+    *pIn_buf_size -= z.avail_in;
+    *pOut_buf_size -= z.avail_out;
+    uInt out_left = z.avail_out;
+
+    if (ret == Z_STREAM_END)
+    {
+        shim_tinfl_release(r);
+        return TINFL_STATUS_DONE;
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR)
+    {
+        shim_tinfl_release(r);
+        return TINFL_STATUS_FAILED;
+    }
+    return out_left == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+#endif /* SHIM_MINIZ_H */
@@ -0,0 +1,46 @@
+/**
+ * @file esp_ota_ops.h
+ * @brief Host OTA slot selection over esp_partition.h
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * app0 runs, app1 takes the update. esp_ota_set_boot_partition() only
+ * checks the image magic byte, the rest of the bootloader check is the
+ * caller's SHA-256.
+ */
+
+#ifndef SHIM_ESP_OTA_OPS_H
+#define SHIM_ESP_OTA_OPS_H
+
+#include "esp_partition.h"
+
+#define ESP_IMAGE_HEADER_MAGIC 0xE9
+
+/** Slot the next boot would run; -1 until an update was accepted */
+inline int &shim_ota_boot_slot(void)
+{
+    static int slot = -1;
+    return slot;
+}
+
+inline const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return shim_app_partition(0);
+}
+
+inline const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start_from)
+{
+    (void)start_from;
+    return shim_app_partition(1);
+}
+
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t *part)
+{
+    if (!part) return ESP_ERR_INVALID_ARG;
+    if (shim_partition_data(part)[0] != ESP_IMAGE_HEADER_MAGIC) return ESP_ERR_OTA_VALIDATE_FAILED;
+    shim_ota_boot_slot() = part->subtype == ESP_PARTITION_SUBTYPE_APP_OTA_1;
+    return ESP_OK;
+}
+
+#endif /* SHIM_ESP_OTA_OPS_H */
@@ -0,0 +1,85 @@
+/**
+ * @file esp_partition.h
+ * @brief Host flash partitions: the two app slots of min_spiffs.csv in RAM
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Writes behave like NOR flash: they can only clear bits, so a sector that
+ * was not erased first reads back corrupted instead of silently correct.
+ * Erase ranges must be sector aligned, as on the chip.
+ */
+
+#ifndef SHIM_ESP_PARTITION_H
+#define SHIM_ESP_PARTITION_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "esp_err.h"
+
+#define SPI_FLASH_SEC_SIZE 4096
+#define SHIM_APP_PARTITION_SIZE 0x1E0000
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_APP_OTA_0 = 0x10,
+    ESP_PARTITION_SUBTYPE_APP_OTA_1 = 0x11
+} esp_partition_subtype_t;
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+inline const esp_partition_t *shim_app_partition(uint8_t slot)
+{
+    static const esp_partition_t parts[2] = {
+        {ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x10000, SHIM_APP_PARTITION_SIZE, "app0", false},
+        {ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x1F0000, SHIM_APP_PARTITION_SIZE, "app1", false},
+    };
+    return &parts[slot & 1];
+}
+
+/** Backing bytes of a partition, allocated erased on first use */
+inline uint8_t *shim_partition_data(const esp_partition_t *part)
+{
+    static std::vector<uint8_t> flash[2];
+    std::vector<uint8_t> &f = flash[part->subtype == ESP_PARTITION_SUBTYPE_APP_OTA_1];
+    if (f.size() != part->size) f.assign(part->size, 0xFF);
+    return f.data();
+}
+
+inline esp_err_t esp_partition_read(const esp_partition_t *part, size_t src_offset, void *dst, size_t size)
+{
+    if (!part || !dst || src_offset > part->size || size > part->size - src_offset) return ESP_ERR_INVALID_ARG;
+    memcpy(dst, shim_partition_data(part) + src_offset, size);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_write(const esp_partition_t *part, size_t dst_offset, const void *src, size_t size)
+{
+    if (!part || !src || dst_offset > part->size || size > part->size - dst_offset) return ESP_ERR_INVALID_ARG;
+    uint8_t *dst = shim_partition_data(part) + dst_offset;
+    const uint8_t *in = (const uint8_t *)src;
+    for (size_t i = 0; i < size; i++) dst[i] &= in[i];
+    return ESP_OK;
+}
+
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    if (!part || offset > part->size || size > part->size - offset) return ESP_ERR_INVALID_ARG;
+    if (offset % SPI_FLASH_SEC_SIZE || size % SPI_FLASH_SEC_SIZE) return ESP_ERR_INVALID_SIZE;
+    memset(shim_partition_data(part) + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+#endif /* SHIM_ESP_PARTITION_H */
@@ -0,0 +1,26 @@
+/**
+ * @file esp_system.h
+ * @brief Host stand-in for the ESP-IDF heap figures
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The host has no fixed heap to report, both figures read as 0.
+ */
+
+#ifndef SHIM_ESP_SYSTEM_H
+#define SHIM_ESP_SYSTEM_H
+
+#include <stdint.h>
+
+inline uint32_t esp_get_free_heap_size(void)
+{
+    return 0;
+}
+
+inline uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 0;
+}
+
+#endif /* SHIM_ESP_SYSTEM_H */
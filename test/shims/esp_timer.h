@@ -0,0 +1,19 @@
+/**
+ * @file esp_timer.h
+ * @brief Host stand-in for esp_timer_get_time() on shim_clock.h
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#ifndef SHIM_ESP_TIMER_H
+#define SHIM_ESP_TIMER_H
+
+#include <stdint.h>
+#include "shim_clock.h"
+
+inline int64_t esp_timer_get_time(void)
+{
+    return (int64_t)shim_clock_us();
+}
+
+#endif /* SHIM_ESP_TIMER_H */
@@ -0,0 +1,75 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS types and critical sections
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * A task is a host thread. portMUX_TYPE is a recursive spinlock over a
+ * thread id, so modules keep their locking and std::thread stress tests
+ * exercise it for real. The ISR and _SAFE variants are the same lock.
+ */
+
+#ifndef SHIM_FREERTOS_H
+#define SHIM_FREERTOS_H
+
+#include <stdint.h>
+#include <thread>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configTICK_RATE_HZ 1000
+
+typedef struct {
+    uintptr_t owner;                    /* 0 when free */
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+inline uintptr_t shim_thread_id(void)
+{
+    static thread_local char id;
+    return (uintptr_t)&id;
+}
+
+inline void shim_mux_enter(portMUX_TYPE *mux)
+{
+    uintptr_t self = shim_thread_id();
+    if (__atomic_load_n(&mux->owner, __ATOMIC_ACQUIRE) == self)
+    {
+        mux->count++;
+        return;
+    }
+    uintptr_t expected = 0;
+    while (!__atomic_compare_exchange_n(&mux->owner, &expected, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        expected = 0;
+        std::this_thread::yield();
+    }
+    mux->count = 1;
+}
+
+inline void shim_mux_exit(portMUX_TYPE *mux)
+{
+    if (--mux->count == 0)
+        __atomic_store_n(&mux->owner, (uintptr_t)0, __ATOMIC_RELEASE);
+}
+
+#define portENTER_CRITICAL(mux) shim_mux_enter(mux)
+#define portEXIT_CRITICAL(mux) shim_mux_exit(mux)
+#define portENTER_CRITICAL_ISR(mux) shim_mux_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux) shim_mux_exit(mux)
+#define portENTER_CRITICAL_SAFE(mux) shim_mux_enter(mux)
+#define portEXIT_CRITICAL_SAFE(mux) shim_mux_exit(mux)
+
+#endif /* SHIM_FREERTOS_H */
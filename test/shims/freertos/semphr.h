@@ -0,0 +1,43 @@
+/**
+ * @file semphr.h
+ * @brief Host stand-in for FreeRTOS mutexes on std::timed_mutex
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#ifndef SHIM_FREERTOS_SEMPHR_H
+#define SHIM_FREERTOS_SEMPHR_H
+
+#include <chrono>
+#include <mutex>
+#include "freertos/FreeRTOS.h"
+
+typedef std::timed_mutex *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return new std::timed_mutex();
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    delete sem;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        sem->lock();
+        return pdTRUE;
+    }
+    return sem->try_lock_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    sem->unlock();
+    return pdTRUE;
+}
+
+#endif /* SHIM_FREERTOS_SEMPHR_H */
@@ -0,0 +1,57 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for the FreeRTOS task calls: a task is the calling thread
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#ifndef SHIM_FREERTOS_TASK_H
+#define SHIM_FREERTOS_TASK_H
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "shim_clock.h"
+
+struct shim_task {
+    char name[16];
+};
+
+typedef struct shim_task *TaskHandle_t;
+
+/** The calling thread's task record, named "main" until shim_task_set_name() */
+inline TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    static thread_local struct shim_task self = {"main"};
+    return &self;
+}
+
+inline void shim_task_set_name(const char *name)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    strncpy(self->name, name, sizeof(self->name) - 1);
+    self->name[sizeof(self->name) - 1] = '\0';
+}
+
+inline const char *pcTaskGetName(TaskHandle_t task)
+{
+    return (task ? task : xTaskGetCurrentTaskHandle())->name;
+}
+
+inline TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(shim_clock_us() / 1000);
+}
+
+inline void vTaskDelay(TickType_t ticks)
+{
+    shim_clock_sleep_us((uint64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+/* Host threads have no fixed stack to measure */
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    (void)task;
+    return 0;
+}
+
+#endif /* SHIM_FREERTOS_TASK_H */
@@ -0,0 +1,41 @@
+/**
+ * @file base64.h
+ * @brief Host mbedtls_base64_encode()
+ * @author Watermon Team
+ * @date 2025
+ */
+
+#ifndef SHIM_MBEDTLS_BASE64_H
+#define SHIM_MBEDTLS_BASE64_H
+
+#include <stddef.h>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+
+/* Like mbedtls: olen is the size needed (with terminator) when dst is too small */
+inline int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen)
+{
+    static const char map[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t need = ((slen + 2) / 3) * 4 + 1;
+    if (!dst || dlen < need)
+    {
+        *olen = need;
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+    unsigned char *p = dst;
+    for (size_t i = 0; i < slen; i += 3)
+    {
+        unsigned v = (unsigned)src[i] << 16;
+        if (i + 1 < slen) v |= (unsigned)src[i + 1] << 8;
+        if (i + 2 < slen) v |= src[i + 2];
+        *p++ = map[(v >> 18) & 63];
+        *p++ = map[(v >> 12) & 63];
+        *p++ = (i + 1 < slen) ? map[(v >> 6) & 63] : '=';
+        *p++ = (i + 2 < slen) ? map[v & 63] : '=';
+    }
+    *p = 0;
+    *olen = (size_t)(p - dst);
+    return 0;
+}
+
+#endif /* SHIM_MBEDTLS_BASE64_H */
@@ -0,0 +1,76 @@
+/**
+ * @file shim_clock.h
+ * @brief Host clock behind millis(), micros(), esp_timer and vTaskDelay
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Runs on the host monotonic clock by default. A test that needs exact
+ * timestamps freezes it with shim_clock_set_ms() and moves it on with
+ * shim_clock_advance_ms(); delay() and vTaskDelay() then advance it instead
+ * of sleeping, so timeout loops still end.
+ */
+
+#ifndef SHIM_CLOCK_H
+#define SHIM_CLOCK_H
+
+#include <stdint.h>
+#include <chrono>
+#include <thread>
+
+struct shim_clock_state {
+    bool frozen = false;
+    uint64_t frozen_us = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+inline shim_clock_state &shim_clock(void)
+{
+    static shim_clock_state state;
+    return state;
+}
+
+/** Microseconds since the test started, or the frozen time */
+inline uint64_t shim_clock_us(void)
+{
+    shim_clock_state &c = shim_clock();
+    if (c.frozen) return c.frozen_us;
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - c.start).count();
+}
+
+/** Freeze the clock at a time */
+inline void shim_clock_set_ms(uint64_t ms)
+{
+    shim_clock().frozen = true;
+    shim_clock().frozen_us = ms * 1000;
+}
+
+/** Move a frozen clock on */
+inline void shim_clock_advance_us(uint64_t us)
+{
+    shim_clock().frozen_us += us;
+}
+
+inline void shim_clock_advance_ms(uint64_t ms)
+{
+    shim_clock_advance_us(ms * 1000);
+}
+
+/** Back to the host clock */
+inline void shim_clock_run(void)
+{
+    shim_clock().frozen = false;
+    shim_clock().start = std::chrono::steady_clock::now();
+}
+
+/** Sleep, or advance a frozen clock */
+inline void shim_clock_sleep_us(uint64_t us)
+{
+    if (shim_clock().frozen)
+        shim_clock_advance_us(us);
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+#endif /* SHIM_CLOCK_H */
@@ -0,0 +1,91 @@
+/**
+ * @file shim_heap.h
+ * @brief Heap accounting for host tests: live bytes and the peak since a reset
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Replaces malloc/free/calloc/realloc for the test binary and forwards to
+ * glibc, counting usable bytes. Include it from exactly one file, the
+ * test's main. operator new goes through malloc, so C++ allocations count.
+ */
+
+#ifndef SHIM_HEAP_H
+#define SHIM_HEAP_H
+
+#include <malloc.h>
+#include <stddef.h>
+#include <atomic>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *p, size_t size);
+void __libc_free(void *p);
+}
+
+static std::atomic<long> s_shimHeapLive(0);
+static std::atomic<long> s_shimHeapPeak(0);
+static std::atomic<unsigned long> s_shimHeapAllocs(0);
+
+static inline void shim_heap_add(void *p)
+{
+    if (!p) return;
+    long live = s_shimHeapLive += (long)malloc_usable_size(p);
+    long peak = s_shimHeapPeak.load();
+    while (live > peak && !s_shimHeapPeak.compare_exchange_weak(peak, live)) {}
+    s_shimHeapAllocs++;
+}
+
+static inline void shim_heap_sub(void *p)
+{
+    if (p) s_shimHeapLive -= (long)malloc_usable_size(p);
+}
+
+extern "C" {
+void *malloc(size_t size)
+{
+    void *p = __libc_malloc(size);
+    shim_heap_add(p);
+    return p;
+}
+
+void *calloc(size_t n, size_t size)
+{
+    void *p = __libc_calloc(n, size);
+    shim_heap_add(p);
+    return p;
+}
+
+void *realloc(void *p, size_t size)
+{
+    shim_heap_sub(p);
+    void *q = __libc_realloc(p, size);
+    shim_heap_add(q ? q : (size ? p : NULL));
+    return q;
+}
+
+void free(void *p)
+{
+    shim_heap_sub(p);
+    __libc_free(p);
+}
+}
+
+/** Start a measurement: the peak drops to what is live now */
+static inline void shim_heap_reset_peak(void)
+{
+    s_shimHeapPeak = s_shimHeapLive.load();
+    s_shimHeapAllocs = 0;
+}
+
+/** Highest live bytes since the reset, above what was live at the reset */
+static inline long shim_heap_peak_since(long base)
+{
+    return s_shimHeapPeak.load() - base;
+}
+
+static inline long shim_heap_live(void) { return s_shimHeapLive.load(); }
+static inline unsigned long shim_heap_allocs(void) { return s_shimHeapAllocs.load(); }
+
+#endif /* SHIM_HEAP_H */
@@ -0,0 +1,278 @@
+/**
+ * @file test_main.cpp
+ * @brief Calibration engine against a mock probe: convergence, K/B math, write and read-back
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The probe is a do_sensor_ops table over two in-memory registers, the way
+ * geofence_ops and do_sensor_ops are meant to be mocked. The test steps the
+ * engine once per simulated second with a fresh reading, like the Modbus
+ * task does.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <random>
+#include "calibration_engine.h"
+
+#define STEP_MS 1000
+
+static struct {
+    float regK;
+    float regB;
+    uint8_t writeFailures;              /* Writes to fail before one succeeds */
+    uint8_t corruptReadBack;            /* get_calibration reports the wrong K */
+    uint8_t writes;
+} s_probe;
+
+static uint8_t mock_set_calibration(struct do_sensor_device *sensor)
+{
+    s_probe.writes++;
+    if (s_probe.writeFailures)
+    {
+        s_probe.writeFailures--;
+        return 0;
+    }
+    s_probe.regK = sensor->cal_k;
+    s_probe.regB = sensor->cal_b;
+    return 1;
+}
+
+static uint8_t mock_get_calibration(struct do_sensor_device *sensor)
+{
+    sensor->cal_k = s_probe.corruptReadBack ? s_probe.regK * 1.01f : s_probe.regK;
+    sensor->cal_b = s_probe.regB;
+    return 1;
+}
+
+static const struct do_sensor_ops s_mockOps = {
+    NULL, NULL, NULL, NULL, mock_set_calibration, mock_get_calibration, NULL, NULL, NULL, NULL, NULL,
+};
+
+static struct do_sensor_device s_sensor;
+static struct cal_engine s_engine;
+static uint32_t s_nowMs;
+
+/**
+ * @brief One Modbus task pass: a new reading, then a step
+ * @return cal_engine_step() result
+ */
+static uint8_t tick(float pct)
+{
+    s_nowMs += STEP_MS;
+    s_sensor.do_percent = pct;
+    s_sensor.temp = 28.0f;
+    return cal_engine_step(&s_engine, s_nowMs, s_nowMs);
+}
+
+/**
+ * @brief Step without new readings until the engine finishes
+ */
+static uint8_t run_to_end(void)
+{
+    for (int i = 0; i < 10; i++)
+    {
+        s_nowMs += STEP_MS;
+        if (cal_engine_step(&s_engine, s_nowMs, s_nowMs - STEP_MS)) return s_engine.state;
+    }
+    return s_engine.state;
+}
+
+void setUp(void)
+{
+    memset(&s_probe, 0, sizeof(s_probe));
+    s_probe.regK = 1.0f;
+    do_sensor_init(&s_sensor, "DO", &s_mockOps);
+    cal_engine_init(&s_engine, &s_sensor);
+    s_nowMs = 100000;
+    TEST_ASSERT_TRUE(cal_engine_start(&s_engine));
+    cal_engine_step(&s_engine, s_nowMs, s_nowMs);
+}
+
+void tearDown(void) {}
+
+void test_converges_and_finishes_early(void)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> noise(-0.3f, 0.3f);
+    float sum = 0;
+    for (int i = 0; i < CAL_WINDOW_SAMPLES - 1; i++)
+    {
+        tick(92.0f + noise(rng));
+        TEST_ASSERT_FALSE(cal_engine_finish(&s_engine));
+    }
+    tick(92.0f);
+    TEST_ASSERT_TRUE(cal_engine_finish(&s_engine));
+    for (int i = 0; i < CAL_WINDOW_SAMPLES; i++) sum += s_engine.window[i];
+
+    TEST_ASSERT_EQUAL(CAL_STATE_DONE, run_to_end());
+    cal_record_t rec;
+    cal_engine_get_record(&s_engine, &rec);
+    TEST_ASSERT_TRUE(rec.ok);
+    TEST_ASSERT_EQUAL(CAL_WINDOW_SAMPLES, rec.samples);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 100.0f / (sum / CAL_WINDOW_SAMPLES), rec.k);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, rec.b);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, rec.k, s_probe.regK);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 28.0f, rec.temp);
+    TEST_ASSERT_LESS_THAN(CAL_MAX_DURATION_S, rec.duration_s);
+}
+
+void test_window_mean_and_spread(void)
+{
+    for (int i = 0; i < CAL_WINDOW_SAMPLES; i++) tick(i & 1 ? 91.0f : 93.0f);
+    cal_progress_t p;
+    cal_engine_get_progress(&s_engine, &p, s_nowMs);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 92.0f, p.mean_pct);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 2.0f, p.spread_pct);
+    TEST_ASSERT_FALSE(p.converged);
+
+    /* The window slides: 20 more steady readings push the old ones out */
+    for (int i = 0; i < CAL_WINDOW_SAMPLES; i++) tick(95.0f);
+    cal_engine_get_progress(&s_engine, &p, s_nowMs);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4, 95.0f, p.mean_pct);
+    TEST_ASSERT_TRUE(p.converged);
+    TEST_ASSERT_EQUAL(2 * CAL_WINDOW_SAMPLES, p.samples);
+}
+
+void test_time_limit_uses_window_mean(void)
+{
+    uint8_t finished = 0;
+    for (int s = 0; s < CAL_MAX_DURATION_S && !finished; s++) finished = tick(s & 1 ? 88.0f : 92.0f);
+    TEST_ASSERT_EQUAL(CAL_STATE_DONE, run_to_end());
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 100.0f / 90.0f, s_probe.regK);
+}
+
+void test_too_few_samples_fails(void)
+{
+    for (int i = 0; i < CAL_MIN_SAMPLES - 1; i++) tick(92.0f);
+    s_nowMs += (uint32_t)CAL_MAX_DURATION_S * 1000;
+    TEST_ASSERT_TRUE(cal_engine_step(&s_engine, s_nowMs, s_nowMs - CAL_MAX_DURATION_S * 1000));
+    TEST_ASSERT_EQUAL(CAL_STATE_FAILED, s_engine.state);
+    TEST_ASSERT_EQUAL(CAL_ERR_NO_SAMPLES, s_engine.error);
+    TEST_ASSERT_EQUAL(0, s_probe.writes);
+}
+
+void test_out_of_range_reading_fails(void)
+{
+    for (int i = 0; i < CAL_WINDOW_SAMPLES; i++) tick(30.0f);
+    TEST_ASSERT_TRUE(cal_engine_finish(&s_engine));
+    TEST_ASSERT_EQUAL(CAL_STATE_FAILED, run_to_end());
+    TEST_ASSERT_EQUAL(CAL_ERR_OUT_OF_RANGE, s_engine.error);
+    TEST_ASSERT_EQUAL(0, s_probe.writes);
+}
+
+void test_write_retried_once(void)
+{
+    s_probe.writeFailures = 1;
+    for (int i = 0; i < CAL_WINDOW_SAMPLES; i++) tick(100.0f);
+    TEST_ASSERT_TRUE(cal_engine_finish(&s_engine));
+    TEST_ASSERT_EQUAL(CAL_STATE_DONE, run_to_end());
+    TEST_ASSERT_EQUAL(2, s_probe.writes);
+}
+
+void test_write_failure_gives_up(void)
+{
+    s_probe.writeFailures = CAL_WRITE_ATTEMPTS;
+    for (int i = 0; i < CAL_WINDOW_SAMPLES; i++) tick(100.0f);
+    TEST_ASSERT_TRUE(cal_engine_finish(&s_engine));
+    TEST_ASSERT_EQUAL(CAL_STATE_FAILED, run_to_end());
+    TEST_ASSERT_EQUAL(CAL_ERR_WRITE, s_engine.error);
+    TEST_ASSERT_EQUAL(CAL_WRITE_ATTEMPTS, s_probe.writes);
+}
+
+void test_read_back_mismatch_fails(void)
+{
+    s_probe.corruptReadBack = 1;
+    for (int i = 0; i < CAL_WINDOW_SAMPLES; i++) tick(90.0f);
+    TEST_ASSERT_TRUE(cal_engine_finish(&s_engine));
+    TEST_ASSERT_EQUAL(CAL_STATE_FAILED, run_to_end());
+    TEST_ASSERT_EQUAL(CAL_ERR_VERIFY, s_engine.error);
+    TEST_ASSERT_EQUAL(CAL_WRITE_ATTEMPTS, s_probe.writes);
+}
+
+void test_abort_returns_to_idle(void)
+{
+    for (int i = 0; i < 5; i++) tick(92.0f);
+    cal_engine_abort(&s_engine);
+    tick(92.0f);
+    TEST_ASSERT_EQUAL(CAL_STATE_IDLE, s_engine.state);
+    TEST_ASSERT_EQUAL(CAL_ERR_ABORTED, s_engine.error);
+    TEST_ASSERT_FALSE(cal_engine_is_busy(&s_engine));
+}
+
+void test_stale_reading_not_counted(void)
+{
+    tick(92.0f);
+    s_nowMs += STEP_MS;
+    cal_engine_step(&s_engine, s_nowMs, s_nowMs - STEP_MS);
+    TEST_ASSERT_EQUAL(1, s_engine.samples);
+
+    s_sensor.is_disconnected = 1;
+    tick(92.0f);
+    TEST_ASSERT_EQUAL(1, s_engine.samples);
+}
+
+void test_manual_write_refused_while_collecting(void)
+{
+    for (int i = 0; i < 3; i++) tick(92.0f);
+    TEST_ASSERT_FALSE(cal_engine_write(&s_engine, 1.1f, 0.2f));
+    tick(92.0f);
+    TEST_ASSERT_EQUAL(CAL_STATE_COLLECTING, s_engine.state);
+    TEST_ASSERT_EQUAL(0, s_probe.writes);
+}
+
+void test_manual_write_verified(void)
+{
+    cal_engine_abort(&s_engine);
+    tick(92.0f);
+    TEST_ASSERT_FALSE(cal_engine_write(&s_engine, 0.0f, 0.2f));
+
+    /* Busy from the moment it is accepted, a start cannot take over */
+    TEST_ASSERT_TRUE(cal_engine_write(&s_engine, 1.1f, 0.2f));
+    TEST_ASSERT_TRUE(cal_engine_is_busy(&s_engine));
+    TEST_ASSERT_FALSE(cal_engine_start(&s_engine));
+    TEST_ASSERT_FALSE(cal_engine_write(&s_engine, 1.3f, 0.0f));
+
+    TEST_ASSERT_EQUAL(CAL_STATE_DONE, run_to_end());
+    TEST_ASSERT_EQUAL(1, s_probe.writes);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.1f, s_probe.regK);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.2f, s_probe.regB);
+
+    cal_record_t rec;
+    cal_engine_get_record(&s_engine, &rec);
+    TEST_ASSERT_TRUE(rec.ok);
+    TEST_ASSERT_EQUAL(0, rec.samples);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.1f, rec.k);
+}
+
+void test_manual_write_read_back_mismatch_fails(void)
+{
+    cal_engine_abort(&s_engine);
+    tick(92.0f);
+    s_probe.corruptReadBack = 1;
+    TEST_ASSERT_TRUE(cal_engine_write(&s_engine, 1.1f, 0.0f));
+    TEST_ASSERT_EQUAL(CAL_STATE_FAILED, run_to_end());
+    TEST_ASSERT_EQUAL(CAL_ERR_VERIFY, s_engine.error);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_converges_and_finishes_early);
+    RUN_TEST(test_window_mean_and_spread);
+    RUN_TEST(test_time_limit_uses_window_mean);
+    RUN_TEST(test_too_few_samples_fails);
+    RUN_TEST(test_out_of_range_reading_fails);
+    RUN_TEST(test_write_retried_once);
+    RUN_TEST(test_write_failure_gives_up);
+    RUN_TEST(test_read_back_mismatch_fails);
+    RUN_TEST(test_abort_returns_to_idle);
+    RUN_TEST(test_stale_reading_not_counted);
+    RUN_TEST(test_manual_write_refused_while_collecting);
+    RUN_TEST(test_manual_write_verified);
+    RUN_TEST(test_manual_write_read_back_mismatch_fails);
+    return UNITY_END();
+}
@@ -0,0 +1,298 @@
+/**
+ * @file test_main.cpp
+ * @brief Field trace recorder on the host: records written to the ring decode back unchanged
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The decoder here reads the segments the way trace_tool.py does: blocks
+ * sorted by seq, records as type | varint dt | varint len | payload, the
+ * time of each record being the block base plus the deltas. The clock is
+ * frozen so every timestamp is known. Also covered: the ring overwriting
+ * its oldest segment, a restart after a torn block, and records dropped
+ * while both RAM buffers are full.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "field_trace.h"
+
+struct decoded_record {
+    uint8_t type;
+    int64_t us;
+    std::string payload;
+};
+
+struct decoded_trace {
+    std::vector<decoded_record> records;
+    std::vector<uint32_t> seqs;         /* In ring order */
+    uint32_t dropped = 0;
+    size_t bytes = 0;                   /* All segments */
+};
+
+static uint32_t get_varint(const std::string &b, size_t *pos)
+{
+    uint32_t v = 0;
+    for (int shift = 0; *pos < b.size(); shift += 7)
+    {
+        uint8_t c = (uint8_t)b[(*pos)++];
+        v |= (uint32_t)(c & 0x7F) << shift;
+        if (c < 0x80) break;
+    }
+    return v;
+}
+
+static std::string read_all(const char *path)
+{
+    File f = SPIFFS.open(path, FILE_READ);
+    if (!f) return std::string();
+    std::string data(f.size(), '\0');
+    f.read((uint8_t *)&data[0], data.size());
+    f.close();
+    return data;
+}
+
+static decoded_trace decode_ring(void)
+{
+    struct block {
+        field_trace_block hdr;
+        std::string body;
+    };
+    std::vector<block> blocks;
+    decoded_trace out;
+    for (unsigned i = 0; i < FIELD_TRACE_SEGMENTS; i++)
+    {
+        char path[20];
+        snprintf(path, sizeof(path), FIELD_TRACE_PATH_FMT, i);
+        std::string data = read_all(path);
+        out.bytes += data.size();
+        size_t pos = 0;
+        while (pos + sizeof(field_trace_block) <= data.size())
+        {
+            block b;
+            memcpy(&b.hdr, data.data() + pos, sizeof(b.hdr));
+            pos += sizeof(b.hdr);
+            if (b.hdr.magic != FIELD_TRACE_MAGIC || pos + b.hdr.len > data.size()) break;
+            b.body = data.substr(pos, b.hdr.len);
+            pos += b.hdr.len;
+            blocks.push_back(b);
+        }
+    }
+    std::sort(blocks.begin(), blocks.end(), [](const block &a, const block &b) {
+        return (int32_t)(a.hdr.seq - b.hdr.seq) < 0;
+    });
+
+    for (const block &b : blocks)
+    {
+        out.seqs.push_back(b.hdr.seq);
+        out.dropped += b.hdr.dropped;
+        int64_t t = b.hdr.base_us;
+        size_t pos = 0;
+        while (pos < b.body.size())
+        {
+            decoded_record r;
+            r.type = (uint8_t)b.body[pos++];
+            t += get_varint(b.body, &pos);
+            uint32_t len = get_varint(b.body, &pos);
+            TEST_ASSERT_TRUE(pos + len <= b.body.size());
+            r.us = t;
+            r.payload = b.body.substr(pos, len);
+            pos += len;
+            out.records.push_back(r);
+        }
+    }
+    return out;
+}
+
+static std::string payload_for(uint32_t n, size_t len)
+{
+    std::string p(len, '\0');
+    for (size_t i = 0; i < len; i++) p[i] = (char)(n * 31 + i);
+    return p;
+}
+
+void setUp(void)
+{
+    SPIFFS.begin(true);
+    SPIFFS.format();
+    shim_clock_set_ms(1000);
+    field_trace_init();
+}
+
+void tearDown(void)
+{
+    field_trace_stop();
+    shim_clock_run();
+}
+
+void test_records_decode_unchanged(void)
+{
+    /* Gaps that need 1, 2, 3 and 5 varint bytes, payloads up to past the cut */
+    const uint32_t gaps[] = {0, 1, 127, 128, 16384, 250000, 6000000};
+    const size_t lens[] = {0, 1, 64, 200, 255, 300};
+    const uint8_t types[] = {FIELD_TRACE_GPS, FIELD_TRACE_MODBUS_TX, FIELD_TRACE_MODBUS_RX,
+                             FIELD_TRACE_BUTTON, FIELD_TRACE_UPLINK, FIELD_TRACE_POND};
+    TEST_ASSERT_EQUAL(1, field_trace_start());
+
+    /* ~30 KB, inside the ring */
+    std::vector<decoded_record> sent;
+    for (uint32_t n = 0; n < 240; n++)
+    {
+        shim_clock_advance_us(gaps[n % 7]);
+        decoded_record r;
+        r.type = types[n % 6];
+        r.us = esp_timer_get_time();
+        std::string p = payload_for(n, lens[n % 6]);
+        field_trace_record(r.type, p.data(), p.size());
+        r.payload = p.substr(0, FIELD_TRACE_MAX_PAYLOAD);
+        sent.push_back(r);
+        field_trace_flush(0);
+    }
+    field_trace_stop();
+
+    struct field_trace_stats stats;
+    field_trace_get_stats(&stats);
+    TEST_ASSERT_EQUAL(240, stats.records);
+    TEST_ASSERT_EQUAL(0, stats.dropped);
+    TEST_ASSERT_EQUAL(0, stats.errors);
+    TEST_ASSERT_FALSE(stats.enabled);
+
+    decoded_trace trace = decode_ring();
+    TEST_ASSERT_EQUAL(sent.size(), trace.records.size());
+    TEST_ASSERT_EQUAL(stats.blocks, trace.seqs.size());
+    for (size_t i = 0; i < sent.size(); i++)
+    {
+        TEST_ASSERT_EQUAL(sent[i].type, trace.records[i].type);
+        TEST_ASSERT_TRUE(sent[i].us == trace.records[i].us);
+        TEST_ASSERT_TRUE(sent[i].payload == trace.records[i].payload);
+    }
+    for (size_t i = 1; i < trace.seqs.size(); i++) TEST_ASSERT_EQUAL_UINT32(trace.seqs[i - 1] + 1, trace.seqs[i]);
+}
+
+void test_ring_keeps_newest(void)
+{
+    /* Four times the ring of NMEA-sized records: the oldest segments go */
+    TEST_ASSERT_EQUAL(1, field_trace_start());
+    const uint32_t total = 4 * FIELD_TRACE_SEGMENTS * FIELD_TRACE_SEGMENT_SIZE / 70;
+    for (uint32_t n = 0; n < total; n++)
+    {
+        shim_clock_advance_us(1000);
+        std::string p = payload_for(n, 64);
+        memcpy(&p[0], &n, sizeof(n));
+        field_trace_record(FIELD_TRACE_GPS, p.data(), p.size());
+        field_trace_flush(0);
+    }
+    field_trace_stop();
+
+    decoded_trace trace = decode_ring();
+    TEST_ASSERT_TRUE(trace.bytes <= FIELD_TRACE_SEGMENTS * FIELD_TRACE_SEGMENT_SIZE);
+    TEST_ASSERT_GREATER_THAN(total / 8, trace.records.size());
+    TEST_ASSERT_LESS_THAN(total, trace.records.size());
+    for (size_t i = 1; i < trace.seqs.size(); i++) TEST_ASSERT_EQUAL_UINT32(trace.seqs[i - 1] + 1, trace.seqs[i]);
+
+    /* What is left is the end of the recording, in order */
+    uint32_t first;
+    memcpy(&first, trace.records[0].payload.data(), sizeof(first));
+    for (size_t i = 0; i < trace.records.size(); i++)
+    {
+        uint32_t n;
+        memcpy(&n, trace.records[i].payload.data(), sizeof(n));
+        TEST_ASSERT_EQUAL_UINT32(first + i, n);
+    }
+    TEST_ASSERT_EQUAL_UINT32(total - 1, first + trace.records.size() - 1);
+}
+
+void test_restart_after_torn_block(void)
+{
+    TEST_ASSERT_EQUAL(1, field_trace_start());
+    for (uint32_t n = 0; n < 10; n++) field_trace_record(FIELD_TRACE_BUTTON, &n, 1);
+    field_trace_stop();
+    decoded_trace before = decode_ring();
+    TEST_ASSERT_EQUAL(1, before.seqs.size());
+
+    /* Reset in the middle of the next block header */
+    char path[20];
+    struct field_trace_stats stats;
+    field_trace_get_stats(&stats);
+    snprintf(path, sizeof(path), FIELD_TRACE_PATH_FMT, (unsigned)stats.segment);
+    File f = SPIFFS.open(path, FILE_APPEND);
+    uint32_t magic = FIELD_TRACE_MAGIC;
+    f.write((const uint8_t *)&magic, sizeof(magic));
+    f.close();
+
+    TEST_ASSERT_EQUAL(1, field_trace_start());
+    for (uint32_t n = 0; n < 10; n++) field_trace_record(FIELD_TRACE_BUTTON, &n, 1);
+    field_trace_stop();
+
+    decoded_trace after = decode_ring();
+    TEST_ASSERT_EQUAL(2, after.seqs.size());
+    TEST_ASSERT_EQUAL_UINT32(before.seqs[0] + 1, after.seqs[1]);
+    TEST_ASSERT_EQUAL(20, after.records.size());
+}
+
+void test_full_buffers_drop_and_count(void)
+{
+    /* The App task falls behind: once both buffers are full records are lost, and counted */
+    TEST_ASSERT_EQUAL(1, field_trace_start());
+    std::string p = payload_for(1, 200);
+    const uint32_t total = 3 * FIELD_TRACE_BUF_SIZE / 200;
+    for (uint32_t n = 0; n < total; n++) field_trace_record(FIELD_TRACE_MODBUS_RX, p.data(), p.size());
+
+    struct field_trace_stats stats;
+    field_trace_get_stats(&stats);
+    TEST_ASSERT_GREATER_THAN(0, stats.dropped);
+    TEST_ASSERT_EQUAL(total, stats.records + stats.dropped);
+
+    field_trace_flush(0);
+    field_trace_record(FIELD_TRACE_MODBUS_RX, p.data(), p.size());
+    field_trace_stop();
+
+    decoded_trace trace = decode_ring();
+    TEST_ASSERT_EQUAL(stats.records + 1, trace.records.size());
+    TEST_ASSERT_EQUAL(stats.dropped, trace.dropped);
+}
+
+void test_record_cost(void)
+{
+    /* Producer side only: NMEA arrives in 64-byte chunks, ~15 per second at 9600 baud */
+    TEST_ASSERT_EQUAL(1, field_trace_start());
+    std::string p = payload_for(7, 64);
+    const int rounds = 200000;
+    double worst = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int n = 0; n < rounds; n++)
+    {
+        field_trace_record(FIELD_TRACE_GPS, p.data(), p.size());
+        if (n % 32 == 31)
+        {
+            auto f0 = std::chrono::steady_clock::now();
+            field_trace_flush(1);
+            worst = std::max(worst, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - f0).count());
+        }
+    }
+    double total = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+
+    char line[120];
+    snprintf(line, sizeof(line), "field trace: %.3f us per 64 B record including flushes, slowest flush %.0f us",
+             total / rounds, worst);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_records_decode_unchanged);
+    RUN_TEST(test_ring_keeps_newest);
+    RUN_TEST(test_restart_after_torn_block);
+    RUN_TEST(test_full_buffers_drop_and_count);
+    RUN_TEST(test_record_cost);
+    return UNITY_END();
+}
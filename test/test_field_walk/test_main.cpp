@@ -0,0 +1,218 @@
+/**
+ * @file test_main.cpp
+ * @brief Field walk on the host: GPS fixes through the filter, pond lookup and frame writer
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * An operator walks past 40 ponds laid out 8 x 5 with 4 m bunds, stops
+ * inside each one for a reading and moves on. Fixes arrive at 1 Hz with
+ * receiver noise. Every epoch runs the firmware's gps_filter and the
+ * geofence over all ponds, the way the App task does, and each stop ends
+ * with a data frame from CFrameWriter. Reported: correct-pond rate for raw
+ * and filtered fixes, time from arrival to a stable pond, cost per epoch.
+ *
+ * The Frame task's upload and backup path is modelled by field_sim.py.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <random>
+#include <string.h>
+#include "gps_filter.h"
+#include "geofence_ops.h"
+#include "CFrameWriter.h"
+
+#define WALK_ROWS 5
+#define WALK_COLS 8
+#define WALK_PONDS (WALK_ROWS * WALK_COLS)
+#define POND_W_M 40.0
+#define POND_H_M 30.0
+#define BUND_M 4.0
+#define STOP_INSET_M 5.0                /* Operator stands this far inside the bank */
+#define STOP_S 60
+#define WALK_MPS 1.2
+#define NOISE_SIGMA_M 3.0
+#define FIX_HDOP 0.9f
+#define SETTLE_S 10                     /* Epochs after arrival not scored */
+
+#define ORIGIN_LAT 16.5
+#define ORIGIN_LNG 81.5
+#define M_PER_DEG_LAT 111320.0
+
+static struct geofence_device s_geofence;
+static position_t s_ponds[WALK_PONDS][4];
+static double s_mPerDegLng;
+
+static position_t to_position(double east, double north)
+{
+    position_t p;
+    p.lat = ORIGIN_LAT + north / M_PER_DEG_LAT;
+    p.lng = ORIGIN_LNG + east / s_mPerDegLng;
+    return p;
+}
+
+static void pond_corner(int pond, double *east, double *north)
+{
+    *east = (pond % WALK_COLS) * (POND_W_M + BUND_M);
+    *north = (pond / WALK_COLS) * (POND_H_M + BUND_M);
+}
+
+/**
+ * @brief Pond the position is in, -1 on a bund
+ */
+static int locate(position_t p)
+{
+    for (int i = 0; i < WALK_PONDS; i++)
+    {
+        if (geofence_distance_to_boundary(&s_geofence, s_ponds[i], 4, p) == 0.0) return i;
+    }
+    return -1;
+}
+
+struct walk_report {
+    uint32_t scored;
+    uint32_t rawHits;
+    uint32_t filteredHits;
+    uint32_t lockMaxS;                  /* Slowest stop to settle on its pond */
+    uint32_t frames;
+    size_t frameBytesMax;
+    double usPerEpoch;
+};
+
+static void run_walk(struct walk_report *r, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, NOISE_SIGMA_M);
+    struct gps_filter filter;
+    gps_filter_init(&filter);
+    memset(r, 0, sizeof(*r));
+
+    double east = -10.0, north = -10.0;
+    uint32_t nowMs = 0;
+    uint64_t busyUs = 0;
+    uint32_t epochs = 0;
+
+    /* Serpentine so consecutive ponds share a bund */
+    for (int stop = 0; stop < WALK_PONDS; stop++)
+    {
+        int row = stop / WALK_COLS;
+        int col = (row & 1) ? WALK_COLS - 1 - stop % WALK_COLS : stop % WALK_COLS;
+        int pond = row * WALK_COLS + col;
+        double pe, pn;
+        pond_corner(pond, &pe, &pn);
+        double te = pe + STOP_INSET_M, tn = pn + STOP_INSET_M;
+
+        double dist = hypot(te - east, tn - north);
+        uint32_t walkS = (uint32_t)ceil(dist / WALK_MPS);
+        uint32_t lockS = 0;
+        bool locked = false;
+        for (uint32_t s = 1; s <= walkS + STOP_S; s++)
+        {
+            double f = (s >= walkS) ? 1.0 : (double)s / walkS;
+            double ce = east + (te - east) * f, cn = north + (tn - north) * f;
+            position_t fix = to_position(ce + noise(rng), cn + noise(rng));
+            nowMs += 1000;
+
+            uint32_t t0 = micros();
+            gps_filter_update(&filter, fix.lat, fix.lng, gps_filter_sigma(0, FIX_HDOP), nowMs);
+            position_t est = {filter.lat, filter.lng};
+            int filtered = locate(est);
+            busyUs += micros() - t0;
+            epochs++;
+
+            if (s < walkS) continue;
+            if (!locked)
+            {
+                if (filtered == pond)
+                {
+                    locked = true;
+                    lockS = s - walkS;
+                }
+            }
+            if (s >= walkS + SETTLE_S)
+            {
+                r->scored++;
+                r->filteredHits += (filtered == pond);
+                r->rawHits += (locate(fix) == pond);
+            }
+        }
+        TEST_ASSERT_TRUE_MESSAGE(locked, "stop never settled on its pond");
+        if (lockS > r->lockMaxS) r->lockMaxS = lockS;
+
+        char name[16];
+        snprintf(name, sizeof(name), "P%02d", pond + 1);
+        char frame[512];
+        CFrameWriter w(frame, sizeof(frame));
+        w.beginObject();
+        w.addInt(FK_EPOCH, 1760000000L + nowMs / 1000);
+        w.addFloat(FK_LAT, filter.lat, 6);
+        w.addFloat(FK_LNG, filter.lng, 6);
+        w.addFloat(FK_POS_RADIUS, filter.radius_m, 1);
+        w.addString(FK_POND_NAME, name);
+        w.endObject();
+        TEST_ASSERT_TRUE(w.ok());
+        TEST_ASSERT_NOT_NULL(strstr(frame, name));
+        r->frames++;
+        if (w.length() > r->frameBytesMax) r->frameBytesMax = w.length();
+
+        east = te;
+        north = tn;
+    }
+    r->usPerEpoch = (double)busyUs / epochs;
+}
+
+void setUp(void)
+{
+    s_mPerDegLng = M_PER_DEG_LAT * cos(ORIGIN_LAT * DEG_TO_RAD);
+    geofence_init(&s_geofence, "Geofence", &standard_geofence_ops);
+    for (int i = 0; i < WALK_PONDS; i++)
+    {
+        double e, n;
+        pond_corner(i, &e, &n);
+        s_ponds[i][0] = to_position(e, n);
+        s_ponds[i][1] = to_position(e + POND_W_M, n);
+        s_ponds[i][2] = to_position(e + POND_W_M, n + POND_H_M);
+        s_ponds[i][3] = to_position(e, n + POND_H_M);
+    }
+}
+
+void tearDown(void) {}
+
+void test_layout_lookup(void)
+{
+    for (int i = 0; i < WALK_PONDS; i++)
+    {
+        double e, n;
+        pond_corner(i, &e, &n);
+        TEST_ASSERT_EQUAL(i, locate(to_position(e + POND_W_M / 2, n + POND_H_M / 2)));
+    }
+    TEST_ASSERT_EQUAL(-1, locate(to_position(POND_W_M + BUND_M / 2, 5.0)));
+}
+
+void test_walk_40_ponds(void)
+{
+    struct walk_report r;
+    run_walk(&r, 2025);
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "walk: %u ponds, raw %.1f %%, filtered %.1f %%, settle <= %u s, %.1f us/epoch, frame <= %u B",
+             (unsigned)r.frames, 100.0 * r.rawHits / r.scored, 100.0 * r.filteredHits / r.scored,
+             (unsigned)r.lockMaxS, r.usPerEpoch, (unsigned)r.frameBytesMax);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL(WALK_PONDS, r.frames);
+    TEST_ASSERT_GREATER_OR_EQUAL(r.rawHits, r.filteredHits);
+    TEST_ASSERT_GREATER_OR_EQUAL(r.scored * 98 / 100, r.filteredHits);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_layout_lookup);
+    RUN_TEST(test_walk_40_ponds);
+    return UNITY_END();
+}
@@ -0,0 +1,243 @@
+/**
+ * @file test_main.cpp
+ * @brief FILESYSTEM on the host backend: bounded reads, streaming, stat cache, atomic writes
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The SPIFFS shim keeps files in a host directory with SPIFFS rename
+ * semantics. A reset during writeFileAtomic() is reproduced by leaving the
+ * files each step would leave behind; after recoverAtomic() the file must
+ * hold the old or the new frame, whole. The benchmark compares the bulk
+ * read and cached stat against the byte-wise read and open-per-stat they
+ * replaced, on a full backup queue.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <chrono>
+#include <string>
+#include "FILESYSTEM.h"
+
+#define FRAME_BYTES 1200                /* A backup frame */
+#define BENCH_ROUNDS 20
+
+static FILESYSTEM s_fs;
+
+static std::string frame(char fill)
+{
+    return std::string(FRAME_BYTES, fill);
+}
+
+static void put(const char *path, const std::string &data)
+{
+    File f = SPIFFS.open(path, FILE_WRITE);
+    TEST_ASSERT_TRUE((bool)f);
+    f.write((const uint8_t *)data.data(), data.size());
+    f.close();
+}
+
+static std::string get(const char *path)
+{
+    static char buf[FRAME_BYTES * 2];
+    int n = s_fs.readFile(path, buf, sizeof(buf));
+    return n >= 0 ? std::string(buf, n) : std::string("<error>");
+}
+
+static double elapsed_us(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void setUp(void)
+{
+    SPIFFS.begin(true);
+    SPIFFS.format();
+    s_fs = FILESYSTEM();
+    TEST_ASSERT_TRUE(s_fs.begin());
+}
+
+void tearDown(void) {}
+
+void test_read_file_is_bounded(void)
+{
+    put("/a.txt", "0123456789");
+    char buf[11];
+    TEST_ASSERT_EQUAL(10, s_fs.readFile("/a.txt", buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("0123456789", buf);
+
+    /* One byte short for the terminator: refused, buffer left empty */
+    memset(buf, 'x', sizeof(buf));
+    TEST_ASSERT_EQUAL(FILE_TOO_LARGE, s_fs.readFile("/a.txt", buf, 10));
+    TEST_ASSERT_EQUAL_STRING("", buf);
+    TEST_ASSERT_EQUAL(FILE_OPEN_FAILED, s_fs.readFile("/missing.txt", buf, sizeof(buf)));
+}
+
+void test_read_stream_chunks(void)
+{
+    std::string data;
+    for (int i = 0; i < 3 * FS_READ_CHUNK + 17; i++) data += (char)('a' + i % 26);
+    put("/s.txt", data);
+
+    struct sink_ctx {
+        std::string got;
+        int calls;
+        int stop_after;
+    } ctx = {"", 0, 0};
+    auto sink = [](void *c, const uint8_t *d, size_t len) -> uint8_t {
+        sink_ctx *s = (sink_ctx *)c;
+        TEST_ASSERT_TRUE(len <= FS_READ_CHUNK);
+        s->got.append((const char *)d, len);
+        return ++s->calls != s->stop_after;
+    };
+    TEST_ASSERT_EQUAL((int)data.size(), s_fs.readStream("/s.txt", sink, &ctx));
+    TEST_ASSERT_EQUAL(4, ctx.calls);
+    TEST_ASSERT_TRUE(ctx.got == data);
+
+    /* The sink stops the read */
+    ctx = {"", 0, 2};
+    TEST_ASSERT_EQUAL(2 * FS_READ_CHUNK, s_fs.readStream("/s.txt", sink, &ctx));
+    TEST_ASSERT_EQUAL(FILE_OPEN_FAILED, s_fs.readStream("/missing.txt", sink, &ctx));
+}
+
+void test_stat_cache_follows_writes(void)
+{
+    TEST_ASSERT_EQUAL(0, s_fs.getFileSize("/c.txt"));
+    TEST_ASSERT_EQUAL(FILE_WRITE_SUCCESSFUL, s_fs.writeFile("/c.txt", "12345"));
+    TEST_ASSERT_EQUAL(5, s_fs.getFileSize("/c.txt"));
+    TEST_ASSERT_EQUAL(FILE_WRITE_SUCCESSFUL, s_fs.writeFileAtomic("/c.txt", "123"));
+    TEST_ASSERT_EQUAL(3, s_fs.getFileSize("/c.txt"));
+
+    /* Written around the class: stale until invalidated */
+    put("/c.txt", "1234567");
+    TEST_ASSERT_EQUAL(3, s_fs.getFileSize("/c.txt"));
+    s_fs.invalidate("/c.txt");
+    TEST_ASSERT_EQUAL(7, s_fs.getFileSize("/c.txt"));
+
+    TEST_ASSERT_TRUE(s_fs.removeFile("/c.txt"));
+    TEST_ASSERT_EQUAL(0, s_fs.getFileSize("/c.txt"));
+}
+
+void test_atomic_write_replaces_and_cleans_up(void)
+{
+    TEST_ASSERT_EQUAL(FILE_WRITE_SUCCESSFUL, s_fs.writeFileAtomic("/BAK_3.txt", frame('A').c_str()));
+    TEST_ASSERT_EQUAL(FILE_WRITE_SUCCESSFUL, s_fs.writeFileAtomic("/BAK_3.txt", frame('B').c_str()));
+    TEST_ASSERT_TRUE(get("/BAK_3.txt") == frame('B'));
+    TEST_ASSERT_FALSE(SPIFFS.exists("/BAK_3.txt" FS_TMP_SUFFIX));
+    TEST_ASSERT_FALSE(SPIFFS.exists("/BAK_3.txt" FS_NEW_SUFFIX));
+
+    /* No room for the staging names */
+    TEST_ASSERT_EQUAL(FILE_OPEN_FAILED, s_fs.writeFileAtomic("/a_path_just_too_long_for_the_staging.txt", "x"));
+}
+
+void test_recover_after_reset_at_each_step(void)
+{
+    const char *path = "/BAK_7.txt";
+    const std::string oldFrame = frame('O'), newFrame = frame('N');
+
+    /* Reset while the staging file was written: old frame kept */
+    put(path, oldFrame);
+    put("/BAK_7.txt" FS_TMP_SUFFIX, newFrame.substr(0, 300));
+    TEST_ASSERT_FALSE(s_fs.recoverAtomic(path));
+    TEST_ASSERT_TRUE(get(path) == oldFrame);
+
+    /* Reset after the copy was complete, before the old frame was removed */
+    put("/BAK_7.txt" FS_NEW_SUFFIX, newFrame);
+    TEST_ASSERT_TRUE(s_fs.recoverAtomic(path));
+    TEST_ASSERT_TRUE(get(path) == newFrame);
+
+    /* Reset between remove and rename: the file is missing, the copy finishes it */
+    TEST_ASSERT_TRUE(s_fs.removeFile(path));
+    put("/BAK_7.txt" FS_NEW_SUFFIX, oldFrame);
+    TEST_ASSERT_EQUAL(0, s_fs.getFileSize(path));
+    TEST_ASSERT_TRUE(s_fs.recoverAtomic(path));
+    TEST_ASSERT_EQUAL(FRAME_BYTES, s_fs.getFileSize(path));
+    TEST_ASSERT_TRUE(get(path) == oldFrame);
+
+    /* Nothing staged: nothing to do */
+    TEST_ASSERT_FALSE(s_fs.recoverAtomic(path));
+    TEST_ASSERT_TRUE(get(path) == oldFrame);
+    TEST_ASSERT_FALSE(SPIFFS.exists("/BAK_7.txt" FS_TMP_SUFFIX));
+    TEST_ASSERT_FALSE(SPIFFS.exists("/BAK_7.txt" FS_NEW_SUFFIX));
+
+    /* A stale staging file does not break the next write */
+    put("/BAK_7.txt" FS_NEW_SUFFIX, "stale");
+    TEST_ASSERT_EQUAL(FILE_WRITE_SUCCESSFUL, s_fs.writeFileAtomic(path, newFrame.c_str()));
+    TEST_ASSERT_TRUE(get(path) == newFrame);
+}
+
+void test_benchmark_backup_queue(void)
+{
+    char path[24];
+    static char buf[FRAME_BYTES + 1];
+    for (int i = 0; i < MAXFILES; i++)
+    {
+        snprintf(path, sizeof(path), "/BAK_%d.txt", i);
+        TEST_ASSERT_EQUAL(FILE_WRITE_SUCCESSFUL, s_fs.writeFileAtomic(path, frame('a' + i % 26).c_str()));
+    }
+
+    /* Byte-wise read, as readFile did before */
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+        for (int i = 0; i < MAXFILES; i++)
+        {
+            snprintf(path, sizeof(path), "/BAK_%d.txt", i);
+            File f = SPIFFS.open(path);
+            size_t n = 0;
+            while (f.available() && n < FRAME_BYTES) buf[n++] = (char)f.read();
+            buf[n] = '\0';
+            f.close();
+        }
+    double byteUs = elapsed_us(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+        for (int i = 0; i < MAXFILES; i++)
+        {
+            snprintf(path, sizeof(path), "/BAK_%d.txt", i);
+            TEST_ASSERT_EQUAL(FRAME_BYTES, s_fs.readFile(path, buf, sizeof(buf)));
+        }
+    double bulkUs = elapsed_us(t0);
+
+    /* countStoredFiles: one size per queue slot, opened or cached */
+    t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+        for (int i = 0; i < MAXFILES; i++)
+        {
+            snprintf(path, sizeof(path), "/BAK_%d.txt", i);
+            s_fs.invalidate(path);
+            TEST_ASSERT_EQUAL(FRAME_BYTES, s_fs.getFileSize(path));
+        }
+    double openUs = elapsed_us(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++)
+        for (int i = 0; i < MAXFILES; i++)
+        {
+            snprintf(path, sizeof(path), "/BAK_%d.txt", i);
+            TEST_ASSERT_EQUAL(FRAME_BYTES, s_fs.getFileSize(path));
+        }
+    double cachedUs = elapsed_us(t0);
+
+    int reads = BENCH_ROUNDS * MAXFILES;
+    char line[200];
+    snprintf(line, sizeof(line), "read %d B frame: byte-wise %.1f us, bulk %.1f us; size: open %.2f us, cached %.2f us",
+             FRAME_BYTES, byteUs / reads, bulkUs / reads, openUs / reads, cachedUs / reads);
+    TEST_MESSAGE(line);
+    TEST_ASSERT_TRUE(cachedUs < openUs);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_read_file_is_bounded);
+    RUN_TEST(test_read_stream_chunks);
+    RUN_TEST(test_stat_cache_follows_writes);
+    RUN_TEST(test_atomic_write_replaces_and_cleans_up);
+    RUN_TEST(test_recover_after_reset_at_each_step);
+    RUN_TEST(test_benchmark_backup_queue);
+    return UNITY_END();
+}
@@ -0,0 +1,349 @@
+/**
+ * @file test_main.cpp
+ * @brief CFrameWriter against the ArduinoJson frame it replaced: same content, bytes, time, heap
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * One full data frame (four probes, a settling trace) is built the way
+ * updateJsonAndSendFrame does with CFrameWriter, and the way it used to
+ * with a DynamicJsonDocument(1800) and serializeJson. Both outputs are
+ * parsed back and compared key by key, in order. The benchmark reports
+ * frames/s, bytes and heap per frame for each, plus the backup path:
+ * patching isHistory in place against serializing the document again.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "shim_heap.h"
+#include "CFrameWriter.h"
+
+#define BENCH_FRAMES 20000UL
+#define PROBES 4
+#define FRAME_BUFFER 2200               /* updateJsonAndSendFrame's stack buffer */
+/* The old DynamicJsonDocument(1800), sized from the frame since slots are twice as big on 64-bit */
+#define DOC_CAPACITY (JSON_OBJECT_SIZE(40) + JSON_ARRAY_SIZE(PROBES) + PROBES * JSON_OBJECT_SIZE(6))
+
+struct probe_reading {
+    long id;
+    const char *name;
+    double doMgl;
+    double pct;
+    double temp;
+    bool connected;
+};
+
+struct frame_fields {
+    const char *reason;
+    const char *deviceId;
+    const char *routerMac;
+    const char *localIp;
+    const char *ssid;
+    long rssi;
+    long epoch;
+    double lat, lng, hdop, radius;
+    long sats;
+    const char *pond, *pondId, *locationId;
+    double doMgl, temp, pct, salinity;
+    const char *nearest;
+    const char *timeBuffer;
+    const char *trace;
+    struct probe_reading probes[PROBES];
+};
+
+static const struct frame_fields s_fields = {
+    "V", "A4:CF:12:9B:3E:70", "F0:9F:C2:11:22:33", "192.168.1.47", "Farm \"North\"\tAP", -67, 1760000123,
+    16.5123457, 81.5234561, 0.9, 2.4, 11,
+    "Farm-North-Block-017", "6650f0c1a2b3c4d5e6f70011", "6650f0c1a2b3c4d5e6f80011",
+    6.41235, 28.125, 84.73125, 15.0,
+    "Farm-North-Block-016,Farm-North-Block-018,Farm-North-Block-025",
+    "2025-10-18 06:41:07",
+    "AQIDBAUGBwgJCgsMDQ4PEBESExQVFhcYGRobHB0eHyAhIiMkJSYnKCkqKywtLi8wMTIzNDU2Nzg5Ojs8PT4/QEFCQ0RFRkdISUpLTE1OT1BRUlNUVVZXWFlaW1xdXl9gYWJjZGVmZ2hpamtsbW5vcHFyc3R1dnd4eXp7fH1+f4CBgoOEhYaHiImKi4yNjo+QkZKTlJWWl5iZmpucnZ6foKGio6SlpqeoqaqrrK2ur7Cx",
+    {
+        {1, "DO", 6.41235, 84.73125, 28.125, true},
+        {2, "DO-2", 6.39871, 84.11002, 28.0, true},
+        {3, "DO-3", 0.0, 0.0, 0.0, false},
+        {4, "DO-4", 7.00125, 91.5, 27.875, true},
+    },
+};
+
+/**
+ * @brief The frame as updateJsonAndSendFrame writes it
+ * @return Frame length, 0 if it did not fit
+ */
+static size_t build_writer(char *buf, size_t cap, size_t *isHistoryPos)
+{
+    const struct frame_fields &f = s_fields;
+    CFrameWriter w(buf, cap);
+    w.beginObject();
+    w.addString(FK_REASON_FOR_PACKET, f.reason);
+    w.addString(FK_NAME, "DO");
+    w.addString(FK_DEVICE_ID, f.deviceId);
+    w.addString(FK_ROUTER_MAC_ID, f.routerMac);
+    w.addString(FK_LOCAL_IP, f.localIp);
+    w.addInt(FK_FW_VER, 214);
+    w.addInt(FK_IS_REBOOT, -1);
+    w.addInt(FK_FRAMES_IN_BACKUP, 12);
+    w.addString(FK_WIFI_SSID, f.ssid);
+    w.addInt(FK_RSSI, f.rssi);
+    w.addInt(FK_EPOCH, f.epoch);
+    w.addInt(FK_OPERATION_MODE, 1);
+    w.addFloat(FK_LAT, f.lat, 7);
+    w.addFloat(FK_LNG, f.lng, 7);
+    w.addFloat(FK_HDOP, f.hdop, 2);
+    w.addInt(FK_SATELLITES, f.sats);
+    w.addBool(FK_IS_GPS_VALID, true);
+    w.addFloat(FK_POS_RADIUS, f.radius, 1);
+    w.addString(FK_RFID, "NO RFID");
+    w.addString(FK_POND_NAME, f.pond);
+    w.addString(FK_POND_ID, f.pondId);
+    w.addString(FK_LOCATION_ID, f.locationId);
+    w.addInt(FK_POND_CONFIDENCE, 92);
+    w.addInt(FK_LOCAL_OFFSET_MIN, 330);
+    w.addFloat(FK_DO, f.doMgl, 5);
+    w.addFloat(FK_TEMP, f.temp, 3);
+    w.addFloat(FK_SATURATION_PCT, f.pct, 5);
+    w.addFloat(FK_SALINITY, f.salinity, 3);
+    w.addInt(FK_BAT_PERCENT, 78);
+    w.addInt(FK_IS_HISTORY, 0);
+    *isHistoryPos = w.position() - 1;
+    w.addString(FK_NEAREST, f.nearest);
+    w.addString(FK_TIME_BUFFER, f.timeBuffer);
+    w.addInt(FK_UP_TIME, 5821);
+    w.addInt(FK_LAST_PNAME_CHECK_TIME, 1760000101);
+    w.addInt(FK_PNAME_CHECKING_CNTR, 3);
+    w.addString(FK_TRACE, f.trace);
+    w.beginArray(FK_PROBES);
+    for (int i = 0; i < PROBES; i++)
+    {
+        const struct probe_reading &p = f.probes[i];
+        w.beginObject();
+        w.addInt(FK_ID, p.id);
+        w.addString(FK_NAME, p.name);
+        w.addFloat(FK_DO, p.doMgl, 5);
+        w.addFloat(FK_SATURATION_PCT, p.pct, 5);
+        w.addFloat(FK_TEMP, p.temp, 3);
+        w.addBool(FK_CONNECTED, p.connected);
+        w.endObject();
+    }
+    w.endArray();
+    w.endObject();
+    return w.ok() ? w.length() : 0;
+}
+
+/**
+ * @brief The same frame through a DynamicJsonDocument, as before CFrameWriter
+ */
+static void fill_document(JsonDocument &doc)
+{
+    const struct frame_fields &f = s_fields;
+    doc["reasonForPacket"] = f.reason;
+    doc["name"] = "DO";
+    doc["deviceId"] = f.deviceId;
+    doc["routerMacId"] = f.routerMac;
+    doc["localIp"] = f.localIp;
+    doc["fwVer"] = 214;
+    doc["isReboot"] = -1;
+    doc["FramesInBackUp"] = 12;
+    doc["wifiSSId"] = f.ssid;
+    doc["rssi"] = f.rssi;
+    doc["epoch"] = f.epoch;
+    doc["operationMode"] = 1;
+    doc["lat"] = f.lat;
+    doc["lng"] = f.lng;
+    doc["HDop"] = f.hdop;
+    doc["Satellites"] = f.sats;
+    doc["IsGpsValid"] = true;
+    doc["PosRadius"] = f.radius;
+    doc["rfId"] = "NO RFID";
+    doc["PondName"] = f.pond;
+    doc["pondId"] = f.pondId;
+    doc["locationId"] = f.locationId;
+    doc["pondConfidence"] = 92;
+    doc["localOffsetTimeInMin"] = 330;
+    doc["do"] = f.doMgl;
+    doc["temp"] = f.temp;
+    doc["saturationPCT"] = f.pct;
+    doc["salinity"] = f.salinity;
+    doc["BatPercent"] = 78;
+    doc["isHistory"] = 0;
+    doc["Nearest"] = f.nearest;
+    doc["timeBuffer"] = f.timeBuffer;
+    doc["UpTime"] = 5821;
+    doc["LstPNameChkTime"] = 1760000101;
+    doc["PNameCheckingCntr"] = 3;
+    doc["trace"] = f.trace;
+    JsonArray probes = doc.createNestedArray("probes");
+    for (int i = 0; i < PROBES; i++)
+    {
+        const struct probe_reading &p = f.probes[i];
+        JsonObject o = probes.createNestedObject();
+        o["id"] = p.id;
+        o["name"] = p.name;
+        o["do"] = p.doMgl;
+        o["saturationPCT"] = p.pct;
+        o["temp"] = p.temp;
+        o["connected"] = p.connected;
+    }
+}
+
+static size_t build_arduinojson(char *buf, size_t cap)
+{
+    DynamicJsonDocument doc(DOC_CAPACITY);
+    fill_document(doc);
+    if (doc.overflowed()) return 0;
+    return serializeJson(doc, buf, cap);
+}
+
+/**
+ * @brief Same values, same keys in the same order
+ */
+static void assert_same(JsonVariantConst a, JsonVariantConst b, const char *where)
+{
+    if (a.is<JsonObjectConst>())
+    {
+        TEST_ASSERT_TRUE_MESSAGE(b.is<JsonObjectConst>(), where);
+        JsonObjectConst oa = a.as<JsonObjectConst>(), ob = b.as<JsonObjectConst>();
+        TEST_ASSERT_EQUAL_MESSAGE(oa.size(), ob.size(), where);
+        JsonObjectConst::iterator ia = oa.begin(), ib = ob.begin();
+        for (; ia != oa.end(); ++ia, ++ib)
+        {
+            TEST_ASSERT_EQUAL_STRING(ia->key().c_str(), ib->key().c_str());
+            assert_same(ia->value(), ib->value(), ia->key().c_str());
+        }
+    }
+    else if (a.is<JsonArrayConst>())
+    {
+        TEST_ASSERT_TRUE_MESSAGE(b.is<JsonArrayConst>(), where);
+        JsonArrayConst xa = a.as<JsonArrayConst>(), xb = b.as<JsonArrayConst>();
+        TEST_ASSERT_EQUAL_MESSAGE(xa.size(), xb.size(), where);
+        for (size_t i = 0; i < xa.size(); i++) assert_same(xa[i], xb[i], where);
+    }
+    else if (a.is<const char *>())
+    {
+        TEST_ASSERT_TRUE_MESSAGE(b.is<const char *>(), where);
+        TEST_ASSERT_EQUAL_STRING_MESSAGE(a.as<const char *>(), b.as<const char *>(), where);
+    }
+    else if (a.is<bool>())
+    {
+        TEST_ASSERT_TRUE_MESSAGE(b.is<bool>(), where);
+        TEST_ASSERT_EQUAL_MESSAGE(a.as<bool>(), b.as<bool>(), where);
+    }
+    else
+    {
+        /* Writer keeps fixed decimals, ArduinoJson prints up to 9 digits */
+        double x = a.as<double>(), y = b.as<double>();
+        TEST_ASSERT_TRUE_MESSAGE(fabs(x - y) <= 1e-7 * fmax(1.0, fabs(x)), where);
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_same_frame_content(void)
+{
+    char a[FRAME_BUFFER], b[FRAME_BUFFER];
+    size_t pos;
+    size_t na = build_writer(a, sizeof(a), &pos);
+    size_t nb = build_arduinojson(b, sizeof(b));
+    TEST_ASSERT_GREATER_THAN(0, na);
+    TEST_ASSERT_GREATER_THAN(0, nb);
+    TEST_ASSERT_EQUAL(strlen(a), na);
+
+    DynamicJsonDocument da(4096), db(4096);
+    TEST_ASSERT_FALSE(deserializeJson(da, (const char *)a, na));
+    TEST_ASSERT_FALSE(deserializeJson(db, (const char *)b, nb));
+    assert_same(da.as<JsonVariantConst>(), db.as<JsonVariantConst>(), "frame");
+    TEST_ASSERT_EQUAL_STRING(s_fields.ssid, da["wifiSSId"].as<const char *>());
+
+    /* The recorded offset is the isHistory digit */
+    TEST_ASSERT_EQUAL('0', a[pos]);
+    a[pos] = '1';
+    da.clear();
+    TEST_ASSERT_FALSE(deserializeJson(da, (const char *)a, na));
+    TEST_ASSERT_EQUAL(1, da["isHistory"].as<int>());
+}
+
+void test_overflow_flagged_not_truncated_json(void)
+{
+    char small[600];
+    size_t pos;
+    TEST_ASSERT_EQUAL(0, build_writer(small, sizeof(small), &pos));
+    TEST_ASSERT_LESS_THAN(sizeof(small), strlen(small));
+
+    char frame[FRAME_BUFFER];
+    size_t n = build_writer(frame, sizeof(frame), &pos);
+    /* Exactly the frame plus its terminator fits, one byte less does not */
+    char *exact = (char *)malloc(n + 1);
+    TEST_ASSERT_EQUAL(n, build_writer(exact, n + 1, &pos));
+    TEST_ASSERT_EQUAL(0, build_writer(exact, n, &pos));
+    free(exact);
+}
+
+void test_bytes_time_and_heap(void)
+{
+    char frame[FRAME_BUFFER];
+    size_t pos;
+    size_t writerBytes = build_writer(frame, sizeof(frame), &pos);
+    size_t docBytes = build_arduinojson(frame, sizeof(frame));
+
+    long base = shim_heap_live();
+    shim_heap_reset_peak();
+    unsigned long allocs0 = shim_heap_allocs();
+    uint32_t t0 = micros();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) build_writer(frame, sizeof(frame), &pos);
+    uint32_t writerUs = micros() - t0;
+    long writerPeak = shim_heap_peak_since(base);
+    unsigned long writerAllocs = shim_heap_allocs() - allocs0;
+
+    shim_heap_reset_peak();
+    allocs0 = shim_heap_allocs();
+    t0 = micros();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) build_arduinojson(frame, sizeof(frame));
+    uint32_t docUs = micros() - t0;
+    long docPeak = shim_heap_peak_since(base);
+    unsigned long docAllocs = shim_heap_allocs() - allocs0;
+
+    /* Backup path: flip one byte, or serialize the document again */
+    t0 = micros();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) frame[pos] = (char)('0' + (i & 1));
+    uint32_t patchUs = micros() - t0;
+    DynamicJsonDocument doc(DOC_CAPACITY);
+    fill_document(doc);
+    t0 = micros();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++)
+    {
+        doc["isHistory"] = (int)(i & 1);
+        serializeJson(doc, frame, sizeof(frame));
+    }
+    uint32_t reserializeUs = micros() - t0;
+
+    char line[240];
+    snprintf(line, sizeof(line),
+             "frame: writer %u B, %.0f frames/s, heap peak %ld B (%lu allocs); "
+             "ArduinoJson %u B, %.0f frames/s, heap peak %ld B (%lu allocs)",
+             (unsigned)writerBytes, BENCH_FRAMES * 1e6 / (writerUs ? writerUs : 1), writerPeak, writerAllocs,
+             (unsigned)docBytes, BENCH_FRAMES * 1e6 / (docUs ? docUs : 1), docPeak, docAllocs);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line), "frame: backup copy %.3f us patched in place, %.1f us serialized again",
+             patchUs / (double)BENCH_FRAMES, reserializeUs / (double)BENCH_FRAMES);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL(0, writerPeak);
+    TEST_ASSERT_EQUAL(0, writerAllocs);
+    TEST_ASSERT_GREATER_OR_EQUAL(DOC_CAPACITY, docPeak);
+    TEST_ASSERT_GREATER_OR_EQUAL(BENCH_FRAMES, docAllocs);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_same_frame_content);
+    RUN_TEST(test_overflow_flagged_not_truncated_json);
+    RUN_TEST(test_bytes_time_and_heap);
+    return UNITY_END();
+}
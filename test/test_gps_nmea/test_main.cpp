@@ -0,0 +1,224 @@
+/**
+ * @file test_main.cpp
+ * @brief NMEA replay through CGps: one published fix per receiver epoch
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Each epoch the receiver sends RMC, VTG, GGA, GSA and GSV with the same UTC
+ * time. RMC and GGA both complete a position in TinyGPS++, and readers of
+ * m_oFix (and the filter behind it) must see that epoch once, with its own
+ * position, HDOP and validity, also when the fix was just lost. The stream is
+ * handed to gpstask() in uneven slices, as the UART delivers it, so epochs
+ * also straddle task passes.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <math.h>
+#include <random>
+#include <string>
+#include <time.h>
+#include <vector>
+#include "GPS.h"
+
+#define REPLAY_EPOCHS 60
+#define REPLAY_BASE_SEC (9 * 3600 + 26 * 60 + 53) /* 09:26:53 UTC */
+#define REPLAY_DATE "140325"                       /* 14 March 2025 */
+
+/**
+ * @brief UART stand-in: hands out the recorded stream a few bytes per pass
+ */
+class ReplaySerial : public Stream
+{
+public:
+    std::string data;
+    size_t pos = 0;
+    size_t slice = 0;                   /* Bytes left in this pass */
+
+    int available() override { return (int)std::min(slice, data.size() - pos); }
+    int read() override
+    {
+        if (!available()) return -1;
+        slice--;
+        return (uint8_t)data[pos++];
+    }
+    int peek() override { return available() ? (uint8_t)data[pos] : -1; }
+    size_t write(uint8_t) override { return 1; }  /* CFG-PRT from gpsInit */
+    using Print::write;
+};
+
+struct epoch_data {
+    double lat;
+    double lng;
+    int sats;
+    int hdop100;
+    time_t utc;
+};
+
+static ReplaySerial s_serial;
+static std::vector<epoch_data> s_epochs;
+
+static void add_sentence(const char *body)
+{
+    uint8_t cs = 0;
+    for (const char *p = body; *p; p++) cs ^= (uint8_t)*p;
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", cs);
+    s_serial.data += "$";
+    s_serial.data += body;
+    s_serial.data += tail;
+}
+
+/**
+ * @brief Record one epoch; fix 0 writes the sentences of a receiver without a fix
+ */
+static void add_epoch(int i, bool fix, bool ggaFirst)
+{
+    int sec = REPLAY_BASE_SEC + i;
+    char utc[20], lat[16], lng[16], rmc[128], gga[128], body[128];
+    snprintf(utc, sizeof(utc), "%02d%02d%02d.00", sec / 3600, (sec / 60) % 60, sec % 60);
+    double latMin = 32.59 + i * 0.006, lngMin = 34.07 + i * 0.004;
+    snprintf(lat, sizeof(lat), "16%07.4f", latMin);
+    snprintf(lng, sizeof(lng), "081%07.4f", lngMin);
+    int sats = 8 + i % 5, hdop100 = 80 + i % 7 * 10;
+
+    if (fix)
+    {
+        snprintf(rmc, sizeof(rmc), "GPRMC,%s,A,%s,N,%s,E,1.20,87.5,%s,,,A", utc, lat, lng, REPLAY_DATE);
+        snprintf(gga, sizeof(gga), "GPGGA,%s,%s,N,%s,E,1,%02d,%d.%02d,4.2,M,-88.0,M,,", utc, lat, lng, sats,
+                 hdop100 / 100, hdop100 % 100);
+    }
+    else
+    {
+        snprintf(rmc, sizeof(rmc), "GPRMC,%s,V,,,,,,,%s,,,N", utc, REPLAY_DATE);
+        snprintf(gga, sizeof(gga), "GPGGA,%s,,,,,0,00,99.99,,,,,,", utc);
+    }
+    add_sentence(ggaFirst ? gga : rmc);
+    add_sentence(fix ? "GPVTG,87.5,T,,M,1.20,N,2.22,K,A" : "GPVTG,,,,,,,,,N");
+    add_sentence(ggaFirst ? rmc : gga);
+    snprintf(body, sizeof(body), "GPGSA,A,%d,05,12,15,18,24,25,29,,,,,,1.80,%d.%02d,1.51", fix ? 3 : 1,
+             hdop100 / 100, hdop100 % 100);
+    add_sentence(body);
+    add_sentence("GPGSV,3,1,11,05,37,287,38,12,59,065,41,15,21,184,33,18,48,329,40");
+    add_sentence("GPGSV,3,2,11,24,66,023,44,25,10,115,29,29,33,246,36,31,05,150,");
+    add_sentence("GPGSV,3,3,11,02,08,301,,13,04,042,,20,02,196,");
+
+    struct tm t = {};
+    t.tm_year = 125;
+    t.tm_mon = 2;
+    t.tm_mday = 14;
+    t.tm_hour = sec / 3600;
+    t.tm_min = (sec / 60) % 60;
+    t.tm_sec = sec % 60;
+    s_epochs.push_back({16 + latMin / 60, 81 + lngMin / 60, sats, hdop100, timegm(&t)});
+}
+
+/**
+ * @brief Run the recording through gpstask(), keeping every fix it publishes
+ */
+static std::vector<GpsFix> replay(CGps &gps, std::vector<time_t> *epochs = NULL)
+{
+    std::mt19937 rng(44);
+    std::vector<GpsFix> fixes;
+    uint32_t version = gps.m_oFix.version();
+    while (s_serial.pos < s_serial.data.size())
+    {
+        s_serial.slice = 1 + rng() % 120;
+        gps.gpstask();
+        uint32_t now = gps.m_oFix.version();
+        TEST_ASSERT_TRUE(now - version <= 1);
+        if (now != version)
+        {
+            fixes.push_back(gps.m_oFix.read());
+            if (epochs) epochs->push_back(gps.Epoch);
+        }
+        version = now;
+    }
+    return fixes;
+}
+
+void setUp(void)
+{
+    s_serial.data.clear();
+    s_serial.pos = 0;
+    s_epochs.clear();
+}
+
+void tearDown(void) {}
+
+/**
+ * @brief Fixes of epochs 1.. hold that epoch's values; epoch 0 is published
+ *        on its first sentence, before the task knows what the receiver sends
+ */
+static void check_fixes(const std::vector<GpsFix> &fixes, const std::vector<time_t> &utc, int from, int to)
+{
+    for (int i = from; i < to; i++)
+    {
+        TEST_ASSERT_TRUE(fixes[i].isValid);
+        TEST_ASSERT_EQUAL(UBX_FIX_3D, fixes[i].fixType);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-7, s_epochs[i].lat, fixes[i].rawLat);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-7, s_epochs[i].lng, fixes[i].rawLng);
+        TEST_ASSERT_EQUAL(s_epochs[i].sats, fixes[i].satellites);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-9, s_epochs[i].hdop100 * 0.01, fixes[i].hDop);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, 1.20f * 0.514444f, fixes[i].speedMps);
+        TEST_ASSERT_EQUAL((long)s_epochs[i].utc, (long)utc[i]);
+    }
+}
+
+void test_rmc_first_publishes_once_per_epoch(void)
+{
+    static CGps gps;
+    gps.gpsInit(&s_serial, 9600, GPS_PROTOCOL_NMEA);
+    for (int i = 0; i < REPLAY_EPOCHS; i++) add_epoch(i, true, false);
+
+    std::vector<time_t> utc;
+    std::vector<GpsFix> fixes = replay(gps, &utc);
+    TEST_ASSERT_EQUAL(REPLAY_EPOCHS, fixes.size());
+    check_fixes(fixes, utc, 1, REPLAY_EPOCHS);
+}
+
+void test_gga_first_publishes_once_per_epoch(void)
+{
+    static CGps gps;
+    gps.gpsInit(&s_serial, 9600, GPS_PROTOCOL_NMEA);
+    for (int i = 0; i < REPLAY_EPOCHS; i++) add_epoch(i, true, true);
+
+    std::vector<time_t> utc;
+    std::vector<GpsFix> fixes = replay(gps, &utc);
+    TEST_ASSERT_EQUAL(REPLAY_EPOCHS, fixes.size());
+    check_fixes(fixes, utc, 1, REPLAY_EPOCHS);
+}
+
+void test_lost_fix_publishes_once_per_epoch(void)
+{
+    /* Walking out of view and back: no epoch keeps the last good fix's validity */
+    static CGps gps;
+    gps.gpsInit(&s_serial, 9600, GPS_PROTOCOL_NMEA);
+    for (int i = 0; i < REPLAY_EPOCHS / 3; i++) add_epoch(i, true, false);
+    for (int i = REPLAY_EPOCHS / 3; i < 2 * REPLAY_EPOCHS / 3; i++) add_epoch(i, false, false);
+    for (int i = 2 * REPLAY_EPOCHS / 3; i < REPLAY_EPOCHS; i++) add_epoch(i, true, false);
+
+    std::vector<time_t> utc;
+    std::vector<GpsFix> fixes = replay(gps, &utc);
+    TEST_ASSERT_EQUAL(REPLAY_EPOCHS, fixes.size());
+    check_fixes(fixes, utc, 1, REPLAY_EPOCHS / 3);
+    for (int i = REPLAY_EPOCHS / 3; i < 2 * REPLAY_EPOCHS / 3; i++)
+    {
+        TEST_ASSERT_FALSE(fixes[i].isValid);
+        TEST_ASSERT_EQUAL(UBX_FIX_NONE, fixes[i].fixType);
+        TEST_ASSERT_EQUAL(0, fixes[i].satellites);
+    }
+    check_fixes(fixes, utc, 2 * REPLAY_EPOCHS / 3, REPLAY_EPOCHS);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_rmc_first_publishes_once_per_epoch);
+    RUN_TEST(test_gga_first_publishes_once_per_epoch);
+    RUN_TEST(test_lost_fix_publishes_once_per_epoch);
+    return UNITY_END();
+}
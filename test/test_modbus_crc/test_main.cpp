@@ -0,0 +1,199 @@
+/**
+ * @file test_main.cpp
+ * @brief CRC-16/MODBUS table against the bitwise reference, and ModbusMaster against a fake slave
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The benchmark reports bytes/s for the old shift/xor loop and the table.
+ * The fake slave answers Read Holding Registers on the other end of a
+ * Stream, so a whole transaction runs through the in-place response path.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <ModbusMaster.h>
+#include <deque>
+#include <vector>
+
+#define BENCH_BYTES (4UL * 1024 * 1024)
+
+/* The loop util/crc16.h used before the table */
+static uint16_t crc16_bitwise(uint16_t crc, uint8_t a)
+{
+    crc ^= a;
+    for (int i = 0; i < 8; ++i)
+    {
+        if (crc & 1)
+            crc = (crc >> 1) ^ 0xA001;
+        else
+            crc = (crc >> 1);
+    }
+    return crc;
+}
+
+/**
+ * @brief Slave at the far end of the RS-485 line, answers function 0x03
+ */
+class FakeSlave : public Stream
+{
+public:
+    uint8_t id = 1;
+    uint16_t regs[64];
+    bool corruptCrc = false;
+    uint32_t requests = 0;
+
+    size_t write(uint8_t c) override
+    {
+        m_request.push_back(c);
+        return 1;
+    }
+    using Print::write;
+    int available() override { return (int)m_reply.size(); }
+    int read() override
+    {
+        if (m_reply.empty()) return -1;
+        int c = m_reply.front();
+        m_reply.pop_front();
+        return c;
+    }
+    int peek() override { return m_reply.empty() ? -1 : m_reply.front(); }
+
+    /* End of the request on the wire */
+    void flush() override
+    {
+        requests++;
+        std::vector<uint8_t> req;
+        req.swap(m_request);
+        if (req.size() != 8 || req[0] != id || req[1] != 0x03) return;
+        if (crc16_buffer(0xFFFF, req.data(), 8) != 0) return;
+        uint16_t addr = word(req[2], req[3]);
+        uint16_t qty = word(req[4], req[5]);
+
+        uint8_t out[256];
+        uint8_t n = 0;
+        out[n++] = id;
+        out[n++] = 0x03;
+        out[n++] = (uint8_t)(qty * 2);
+        for (uint16_t i = 0; i < qty; i++)
+        {
+            out[n++] = highByte(regs[(addr + i) % 64]);
+            out[n++] = lowByte(regs[(addr + i) % 64]);
+        }
+        uint16_t crc = crc16_buffer(0xFFFF, out, n);
+        if (corruptCrc) crc ^= 1;
+        out[n++] = lowByte(crc);
+        out[n++] = highByte(crc);
+        m_reply.insert(m_reply.end(), out, out + n);
+    }
+
+private:
+    std::vector<uint8_t> m_request;
+    std::deque<uint8_t> m_reply;
+};
+
+static FakeSlave s_slave;
+static ModbusMaster s_master;
+
+void setUp(void)
+{
+    for (int i = 0; i < 64; i++) s_slave.regs[i] = (uint16_t)(0x1000 + i * 0x0101);
+    s_slave.corruptCrc = false;
+    s_master.begin(s_slave.id, s_slave);
+}
+
+void tearDown(void) {}
+
+void test_crc_check_value(void)
+{
+    const char *check = "123456789";
+    TEST_ASSERT_EQUAL_HEX16(0x4B37, crc16_buffer(0xFFFF, (const uint8_t *)check, 9));
+}
+
+void test_table_matches_bitwise(void)
+{
+    for (uint32_t crc = 0; crc <= 0xFFFF; crc += 257)
+    {
+        for (uint16_t b = 0; b < 256; b++)
+        {
+            TEST_ASSERT_EQUAL_HEX16(crc16_bitwise((uint16_t)crc, (uint8_t)b), crc16_update((uint16_t)crc, (uint8_t)b));
+        }
+    }
+}
+
+void test_crc_bytes_per_second(void)
+{
+    std::vector<uint8_t> data(BENCH_BYTES);
+    for (size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)(i * 31 + (i >> 7));
+
+    uint32_t t0 = micros();
+    uint16_t bitwise = 0xFFFF;
+    for (size_t i = 0; i < data.size(); i++) bitwise = crc16_bitwise(bitwise, data[i]);
+    uint32_t bitwiseUs = micros() - t0;
+
+    t0 = micros();
+    uint16_t table = 0xFFFF;
+    for (size_t i = 0; i < data.size(); i += 0x8000) table = crc16_buffer(table, &data[i], 0x8000);
+    uint32_t tableUs = micros() - t0;
+
+    char line[160];
+    snprintf(line, sizeof(line), "crc16: bitwise %.1f MB/s, table %.1f MB/s",
+             (double)data.size() / (bitwiseUs ? bitwiseUs : 1), (double)data.size() / (tableUs ? tableUs : 1));
+    TEST_MESSAGE(line);
+    TEST_ASSERT_EQUAL_HEX16(bitwise, table);
+    TEST_ASSERT_LESS_THAN(bitwiseUs, tableUs);
+}
+
+void test_read_registers_in_place(void)
+{
+    TEST_ASSERT_EQUAL(ModbusMaster::ku8MBSuccess, s_master.readHoldingRegisters(4, 6));
+    for (uint8_t i = 0; i < 6; i++)
+    {
+        TEST_ASSERT_EQUAL_HEX16(s_slave.regs[4 + i], s_master.getResponseBuffer(i));
+    }
+    uint8_t len = 0;
+    const uint8_t *view = s_master.getResponseBytes(&len);
+    TEST_ASSERT_NOT_NULL(view);
+    TEST_ASSERT_EQUAL(12, len);
+    TEST_ASSERT_EQUAL_HEX8(highByte(s_slave.regs[4]), view[0]);
+    TEST_ASSERT_EQUAL_HEX8(lowByte(s_slave.regs[9]), view[11]);
+}
+
+void test_bad_crc_rejected(void)
+{
+    s_slave.corruptCrc = true;
+    TEST_ASSERT_EQUAL(ModbusMaster::ku8MBInvalidCRC, s_master.readHoldingRegisters(0, 2));
+    uint8_t len = 1;
+    s_master.clearResponseBuffer();
+    TEST_ASSERT_NULL(s_master.getResponseBytes(&len));
+    TEST_ASSERT_EQUAL(0, len);
+}
+
+void test_transactions_per_second(void)
+{
+    const uint32_t n = 20000;
+    uint32_t t0 = micros();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        TEST_ASSERT_EQUAL(ModbusMaster::ku8MBSuccess, s_master.readHoldingRegisters(0, 10));
+    }
+    uint32_t us = micros() - t0;
+    char line[120];
+    snprintf(line, sizeof(line), "modbus: %.0f register reads/s through the fake slave (host CPU)",
+             n * 1e6 / (us ? us : 1));
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_check_value);
+    RUN_TEST(test_table_matches_bitwise);
+    RUN_TEST(test_crc_bytes_per_second);
+    RUN_TEST(test_read_registers_in_place);
+    RUN_TEST(test_bad_crc_rejected);
+    RUN_TEST(test_transactions_per_second);
+    return UNITY_END();
+}
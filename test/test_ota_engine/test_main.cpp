@@ -0,0 +1,449 @@
+/**
+ * @file test_main.cpp
+ * @brief OTA engine on the flash and NVS shims: resume after cuts, URL handling, verification
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The download loop is the one in http_ops.cpp: ask for ota_engine_offset(),
+ * fill ota_engine_buffer(), commit. A cut checkpoints and drops the engine
+ * like a WiFi loss or a reboot; a fresh engine must pick up from the last
+ * whole sector and the finished partition must equal the image.
+ *
+ * Encoded downloads are built here with zlib: a full image, and a WMD1
+ * delta against the image the test puts in the running partition (app0).
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "ota_engine.h"
+
+#define IMAGE_SIZE (300 * 1024 + 123)   /* Not a whole number of sectors */
+#define RANDOM_CUTS 24
+
+static std::vector<uint8_t> s_image;
+static char s_imageSha[65];
+static std::mt19937 s_rng;
+
+static std::vector<uint8_t> make_image(size_t size, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> img(size);
+    for (size_t i = 0; i < size; i++) img[i] = (uint8_t)(rng() >> 24);
+    img[0] = 0xE9;
+    return img;
+}
+
+static void sha_hex(const std::vector<uint8_t> &data, char *hex)
+{
+    uint8_t digest[32];
+    mbedtls_sha256(data.data(), data.size(), digest, 0);
+    for (int i = 0; i < 32; i++) snprintf(hex + i * 2, 3, "%02x", digest[i]);
+}
+
+/**
+ * @brief Feed the download from ota_engine_offset() in network-sized reads
+ * @param stop_at Download offset to stop at (a cut), or the full size
+ * @return ota_engine_commit() result
+ */
+static uint8_t feed(struct ota_engine *ota, const std::vector<uint8_t> &file, size_t stop_at)
+{
+    if (!ota_engine_set_size(ota, (uint32_t)file.size())) return 0;
+    std::uniform_int_distribution<size_t> read_len(1, 1460);
+    while (!ota_engine_done(ota))
+    {
+        size_t pos = ota_engine_offset(ota);
+        if (pos >= stop_at) break;
+        size_t room;
+        uint8_t *dst = ota_engine_buffer(ota, &room);
+        size_t n = read_len(s_rng);
+        if (n > room) n = room;
+        if (n > stop_at - pos) n = stop_at - pos;
+        memcpy(dst, file.data() + pos, n);
+        if (!ota_engine_commit(ota, n)) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Connection lost: keep what is on flash, drop the engine
+ */
+static void cut(struct ota_engine *ota)
+{
+    ota_engine_checkpoint(ota);
+    ota_engine_end(ota);
+}
+
+static std::vector<uint8_t> deflate_all(const std::vector<uint8_t> &data)
+{
+    uLongf len = compressBound(data.size());
+    std::vector<uint8_t> out(len);
+    compress2(out.data(), &len, data.data(), data.size(), 9);
+    out.resize(len);
+    return out;
+}
+
+static void put_le32(std::vector<uint8_t> &out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+/**
+ * @brief Append one delta record: add_len bytes against old[old_pos], then extra bytes
+ * @note Advances old_pos and new_pos the way the engine does
+ */
+static void put_record(std::vector<uint8_t> &patch, const std::vector<uint8_t> &old_img,
+                       const std::vector<uint8_t> &new_img, size_t &old_pos, size_t &new_pos,
+                       uint32_t add_len, uint32_t extra_len, int32_t seek)
+{
+    put_le32(patch, add_len);
+    put_le32(patch, extra_len);
+    put_le32(patch, (uint32_t)seek);
+    for (uint32_t i = 0; i < add_len; i++)
+        patch.push_back((uint8_t)(new_img[new_pos + i] - old_img[old_pos + i]));
+    patch.insert(patch.end(), new_img.begin() + new_pos + add_len, new_img.begin() + new_pos + add_len + extra_len);
+    old_pos += add_len + seek;
+    new_pos += add_len + extra_len;
+}
+
+static std::vector<uint8_t> delta_header(const std::vector<uint8_t> &old_img, size_t new_size)
+{
+    std::vector<uint8_t> patch = {'W', 'M', 'D', '1'};
+    put_le32(patch, (uint32_t)old_img.size());
+    put_le32(patch, (uint32_t)new_size);
+    uint8_t digest[32];
+    mbedtls_sha256(old_img.data(), old_img.size(), digest, 0);
+    patch.insert(patch.end(), digest, digest + 32);
+    return patch;
+}
+
+/**
+ * @brief A release-sized change: patched constants, a grown function, a dropped table
+ * @param[out] patch Uncompressed WMD1 patch from old_img to the returned image
+ */
+static std::vector<uint8_t> make_new_image(const std::vector<uint8_t> &old_img, std::vector<uint8_t> &patch)
+{
+    std::vector<uint8_t> fresh = make_image(9000, 2);
+    std::vector<uint8_t> img(old_img.begin(), old_img.begin() + 100000);
+    for (size_t i = 1000; i < 1200; i++) img[i] ^= 0x5A;
+    img.insert(img.end(), fresh.begin() + 1, fresh.begin() + 3001);      /* 3000 new bytes */
+    img.insert(img.end(), old_img.begin() + 100000, old_img.begin() + 200000);
+    img.insert(img.end(), old_img.begin() + 205000, old_img.end());     /* 5000 dropped */
+    img.insert(img.end(), fresh.begin() + 3001, fresh.end());            /* tail grows */
+
+    patch = delta_header(old_img, img.size());
+    size_t o = 0, n = 0;
+    put_record(patch, old_img, img, o, n, 100000, 3000, 0);
+    put_record(patch, old_img, img, o, n, 100000, 0, 5000);
+    put_record(patch, old_img, img, o, n, (uint32_t)(old_img.size() - 205000), (uint32_t)(img.size() - n - (old_img.size() - 205000)), 0);
+    return img;
+}
+
+static void install_running(const std::vector<uint8_t> &img)
+{
+    uint8_t *app0 = shim_partition_data(shim_app_partition(0));
+    memset(app0, 0xFF, SHIM_APP_PARTITION_SIZE);
+    memcpy(app0, img.data(), img.size());
+}
+
+static std::string long_url(size_t len)
+{
+    std::string url = "https://storage.example.com/watermon/firmware/do-handheld-v215.bin?X-Amz-Signature=";
+    while (url.size() < len) url += (char)('a' + url.size() % 26);
+    url.resize(len);
+    return url;
+}
+
+void setUp(void)
+{
+    shim_nvs_erase();
+    shim_ota_boot_slot() = -1;
+    memset(shim_partition_data(shim_app_partition(1)), 0xFF, SHIM_APP_PARTITION_SIZE);
+    s_rng.seed(36);
+    if (s_image.empty())
+    {
+        s_image = make_image(IMAGE_SIZE, 1);
+        sha_hex(s_image, s_imageSha);
+    }
+}
+
+void tearDown(void) {}
+
+void test_plain_download_verifies(void)
+{
+    static struct ota_engine ota;
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.bin", s_imageSha));
+    TEST_ASSERT_EQUAL(0, ota_engine_offset(&ota));
+    TEST_ASSERT_TRUE(feed(&ota, s_image, s_image.size()));
+    TEST_ASSERT_TRUE(ota_engine_finish(&ota));
+    ota_engine_end(&ota);
+    TEST_ASSERT_EQUAL(1, shim_ota_boot_slot());
+    TEST_ASSERT_EQUAL_MEMORY(s_image.data(), shim_partition_data(shim_app_partition(1)), s_image.size());
+
+    char url[OTA_ENGINE_URL_MAX];
+    TEST_ASSERT_FALSE(ota_engine_pending(url, sizeof(url)));
+}
+
+void test_resume_at_random_cuts(void)
+{
+    /* A long signed URL, well past the old 150-byte limit */
+    std::string url = long_url(420);
+    std::vector<size_t> cuts;
+    std::uniform_int_distribution<size_t> at(1, IMAGE_SIZE - 1);
+    for (int i = 0; i < RANDOM_CUTS; i++) cuts.push_back(at(s_rng));
+    std::sort(cuts.begin(), cuts.end());
+
+    static struct ota_engine ota;
+    uint32_t refetched = 0;
+    for (size_t c : cuts)
+    {
+        TEST_ASSERT_TRUE(ota_engine_begin(&ota, url.c_str(), s_imageSha));
+        TEST_ASSERT_EQUAL(0, ota_engine_offset(&ota) % OTA_ENGINE_SECTOR);
+        TEST_ASSERT_TRUE(feed(&ota, s_image, c));
+        /* Only the partial sector at the cut is fetched again */
+        TEST_ASSERT_EQUAL(c - c % OTA_ENGINE_SECTOR, ota.offset);
+        cut(&ota);
+
+        char pending[OTA_ENGINE_URL_MAX];
+        TEST_ASSERT_TRUE(ota_engine_pending(pending, sizeof(pending)));
+        TEST_ASSERT_EQUAL_STRING(url.c_str(), pending);
+        refetched += c % OTA_ENGINE_SECTOR;
+    }
+
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, url.c_str(), s_imageSha));
+    TEST_ASSERT_EQUAL(cuts.back() - cuts.back() % OTA_ENGINE_SECTOR, ota_engine_offset(&ota));
+    TEST_ASSERT_TRUE(feed(&ota, s_image, s_image.size()));
+    TEST_ASSERT_TRUE(ota_engine_finish(&ota));
+    ota_engine_end(&ota);
+    TEST_ASSERT_EQUAL_MEMORY(s_image.data(), shim_partition_data(shim_app_partition(1)), s_image.size());
+
+    char line[120];
+    snprintf(line, sizeof(line), "ota: %d cuts over %u bytes, %u bytes fetched twice",
+             RANDOM_CUTS, (unsigned)IMAGE_SIZE, (unsigned)refetched);
+    TEST_MESSAGE(line);
+}
+
+void test_resume_without_hash_keeps_saved_hash(void)
+{
+    static struct ota_engine ota;
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.bin", s_imageSha));
+    TEST_ASSERT_TRUE(feed(&ota, s_image, 100000));
+    cut(&ota);
+
+    /* After a reboot the URL comes from NVS and the hash from the checkpoint */
+    char url[OTA_ENGINE_URL_MAX];
+    TEST_ASSERT_TRUE(ota_engine_pending(url, sizeof(url)));
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, url, NULL));
+    TEST_ASSERT_EQUAL(100000 - 100000 % OTA_ENGINE_SECTOR, ota_engine_offset(&ota));
+    TEST_ASSERT_TRUE(ota.has_sha);
+    TEST_ASSERT_TRUE(feed(&ota, s_image, s_image.size()));
+    TEST_ASSERT_TRUE(ota_engine_finish(&ota));
+    ota_engine_end(&ota);
+}
+
+void test_other_url_hash_or_size_restarts(void)
+{
+    static struct ota_engine ota;
+    std::string url = long_url(300);
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, url.c_str(), s_imageSha));
+    TEST_ASSERT_TRUE(feed(&ota, s_image, 80000));
+    cut(&ota);
+
+    /* Differs only past byte 150: must not be taken for the same download */
+    std::string other = url;
+    other[250] ^= 1;
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, other.c_str(), s_imageSha));
+    TEST_ASSERT_EQUAL(0, ota_engine_offset(&ota));
+    ota_engine_end(&ota);
+
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, url.c_str(), s_imageSha));
+    TEST_ASSERT_TRUE(feed(&ota, s_image, 80000));
+    cut(&ota);
+    char otherSha[65];
+    memcpy(otherSha, s_imageSha, sizeof(otherSha));
+    otherSha[0] = otherSha[0] == '0' ? '1' : '0';
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, url.c_str(), otherSha));
+    TEST_ASSERT_EQUAL(0, ota_engine_offset(&ota));
+    ota_engine_end(&ota);
+
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, url.c_str(), s_imageSha));
+    TEST_ASSERT_TRUE(feed(&ota, s_image, 80000));
+    cut(&ota);
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, url.c_str(), s_imageSha));
+    TEST_ASSERT_GREATER_THAN(0, ota_engine_offset(&ota));
+    TEST_ASSERT_TRUE(ota_engine_set_size(&ota, IMAGE_SIZE + 1));
+    TEST_ASSERT_EQUAL(0, ota_engine_offset(&ota));
+    ota_engine_end(&ota);
+}
+
+void test_url_over_limit_refused(void)
+{
+    static struct ota_engine ota;
+    std::string fits = long_url(OTA_ENGINE_URL_MAX - 1);
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, fits.c_str(), NULL));
+    TEST_ASSERT_EQUAL_STRING(fits.c_str(), ota.url);
+    ota_engine_end(&ota);
+
+    std::string tooLong = long_url(OTA_ENGINE_URL_MAX);
+    TEST_ASSERT_FALSE(ota_engine_begin(&ota, tooLong.c_str(), NULL));
+}
+
+void test_corrupt_flash_fails_hash(void)
+{
+    static struct ota_engine ota;
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.bin", s_imageSha));
+    TEST_ASSERT_TRUE(feed(&ota, s_image, 150000));
+    cut(&ota);
+
+    /* A bit lost in a sector already written: the rebuilt hash catches it */
+    shim_partition_data(shim_app_partition(1))[5000] ^= 0x10;
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.bin", s_imageSha));
+    TEST_ASSERT_TRUE(feed(&ota, s_image, s_image.size()));
+    TEST_ASSERT_FALSE(ota_engine_finish(&ota));
+    ota_engine_end(&ota);
+    TEST_ASSERT_EQUAL(-1, shim_ota_boot_slot());
+
+    char url[OTA_ENGINE_URL_MAX];
+    TEST_ASSERT_FALSE(ota_engine_pending(url, sizeof(url)));
+}
+
+void test_zlib_image(void)
+{
+    /* Real images compress; a random one must still round trip */
+    std::vector<uint8_t> img = s_image;
+    memset(img.data() + 4096, 0, 60000);
+    char sha[65];
+    sha_hex(img, sha);
+    std::vector<uint8_t> packed = deflate_all(img);
+
+    static struct ota_engine ota;
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.bin.z", sha));
+    TEST_ASSERT_TRUE(feed(&ota, packed, packed.size()));
+    TEST_ASSERT_TRUE(ota_engine_finish(&ota));
+    ota_engine_end(&ota);
+    TEST_ASSERT_EQUAL(1, shim_ota_boot_slot());
+    TEST_ASSERT_EQUAL_MEMORY(img.data(), shim_partition_data(shim_app_partition(1)), img.size());
+}
+
+void test_delta_applies(void)
+{
+    install_running(s_image);
+    std::vector<uint8_t> patch;
+    std::vector<uint8_t> img = make_new_image(s_image, patch);
+    std::vector<uint8_t> packed = deflate_all(patch);
+    char sha[65];
+    sha_hex(img, sha);
+
+    /* A dropped connection keeps the engine and carries on from the offset */
+    static struct ota_engine ota;
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.wmd", sha));
+    TEST_ASSERT_TRUE(feed(&ota, packed, packed.size() / 3));
+    TEST_ASSERT_TRUE(feed(&ota, packed, packed.size()));
+    TEST_ASSERT_TRUE(ota_engine_finish(&ota));
+    ota_engine_end(&ota);
+    TEST_ASSERT_EQUAL(1, shim_ota_boot_slot());
+    TEST_ASSERT_EQUAL_MEMORY(img.data(), shim_partition_data(shim_app_partition(1)), img.size());
+
+    char line[120];
+    snprintf(line, sizeof(line), "ota: delta download %u bytes for a %u byte image (full zlib %u)",
+             (unsigned)packed.size(), (unsigned)img.size(), (unsigned)deflate_all(img).size());
+    TEST_MESSAGE(line);
+}
+
+void test_delta_restarts_after_reboot(void)
+{
+    install_running(s_image);
+    std::vector<uint8_t> patch;
+    std::vector<uint8_t> img = make_new_image(s_image, patch);
+    std::vector<uint8_t> packed = deflate_all(patch);
+    char sha[65];
+    sha_hex(img, sha);
+
+    /* The inflater state is RAM only: after a reboot the download starts over */
+    static struct ota_engine ota;
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.wmd", sha));
+    TEST_ASSERT_TRUE(feed(&ota, packed, packed.size() / 2));
+    cut(&ota);
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.wmd", sha));
+    TEST_ASSERT_EQUAL(0, ota_engine_offset(&ota));
+    TEST_ASSERT_TRUE(feed(&ota, packed, packed.size()));
+    TEST_ASSERT_TRUE(ota_engine_finish(&ota));
+    ota_engine_end(&ota);
+    TEST_ASSERT_EQUAL_MEMORY(img.data(), shim_partition_data(shim_app_partition(1)), img.size());
+}
+
+void test_delta_for_other_base_refused(void)
+{
+    std::vector<uint8_t> patch;
+    std::vector<uint8_t> img = make_new_image(s_image, patch);
+    std::vector<uint8_t> packed = deflate_all(patch);
+    char sha[65];
+    sha_hex(img, sha);
+
+    /* The running firmware is not the one the patch was made from */
+    std::vector<uint8_t> other = s_image;
+    other[77777] ^= 1;
+    install_running(other);
+
+    static struct ota_engine ota;
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.wmd", sha));
+    TEST_ASSERT_FALSE(feed(&ota, packed, packed.size()));
+    ota_engine_end(&ota);
+    TEST_ASSERT_EQUAL(-1, shim_ota_boot_slot());
+    TEST_ASSERT_EQUAL_HEX8(0xFF, shim_partition_data(shim_app_partition(1))[0]);
+}
+
+void test_corrupt_stream_rejected(void)
+{
+    install_running(s_image);
+    std::vector<uint8_t> patch;
+    std::vector<uint8_t> img = make_new_image(s_image, patch);
+    char sha[65];
+    sha_hex(img, sha);
+    std::vector<uint8_t> packed = deflate_all(patch);
+
+    static struct ota_engine ota;
+    for (size_t at : {packed.size() / 4, packed.size() / 2, packed.size() - 3})
+    {
+        std::vector<uint8_t> bad = packed;
+        bad[at] ^= 0x24;
+        TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.wmd", sha));
+        uint8_t ok = feed(&ota, bad, bad.size()) && ota_engine_finish(&ota);
+        ota_engine_end(&ota);
+        TEST_ASSERT_FALSE(ok);
+    }
+
+    /* Cut short: every byte inflates but the stream never ends */
+    std::vector<uint8_t> shortStream(packed.begin(), packed.end() - 6);
+    TEST_ASSERT_TRUE(ota_engine_begin(&ota, "http://fw/a.wmd", sha));
+    uint8_t ok = feed(&ota, shortStream, shortStream.size()) && ota_engine_finish(&ota);
+    ota_engine_end(&ota);
+    TEST_ASSERT_FALSE(ok);
+    TEST_ASSERT_EQUAL(-1, shim_ota_boot_slot());
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_plain_download_verifies);
+    RUN_TEST(test_resume_at_random_cuts);
+    RUN_TEST(test_resume_without_hash_keeps_saved_hash);
+    RUN_TEST(test_other_url_hash_or_size_restarts);
+    RUN_TEST(test_url_over_limit_refused);
+    RUN_TEST(test_corrupt_flash_fails_hash);
+    RUN_TEST(test_zlib_image);
+    RUN_TEST(test_delta_applies);
+    RUN_TEST(test_delta_restarts_after_reboot);
+    RUN_TEST(test_delta_for_other_base_refused);
+    RUN_TEST(test_corrupt_stream_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,254 @@
+/**
+ * @file test_main.cpp
+ * @brief Latency histograms: bucket boundaries, percentiles and the cost of a probe
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The clock is frozen so each recorded span has an exact length, and the
+ * bucket it lands in is read back from the histogram. Every bucket is
+ * checked at its first and last microsecond against
+ * perf_metrics_bucket_limit(). The benchmark times a PERF_NOW /
+ * PERF_RECORD pair and a data frame built with CFrameWriter, the cheapest
+ * of the timed paths, and reports the probe as a share of the frame build.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <chrono>
+#include "perf_metrics.h"
+#include "CFrameWriter.h"
+
+#define BENCH_FRAMES 200000UL
+#define BENCH_ROUNDS 5
+
+/**
+ * @brief Record one span of an exact length and return the bucket it went to
+ */
+static int bucket_for(uint32_t us)
+{
+    struct perf_hist before, after;
+    perf_metrics_get(PERF_MODBUS, &before);
+    uint32_t t0 = perf_metrics_now();
+    shim_clock_advance_us(us);
+    perf_metrics_record(PERF_MODBUS, t0);
+    perf_metrics_get(PERF_MODBUS, &after);
+
+    for (int b = 0; b < PERF_HIST_BUCKETS; b++)
+    {
+        if (after.buckets[b] != before.buckets[b])
+            return b;
+    }
+    return -1;
+}
+
+/**
+ * @brief Record count spans of us microseconds into a probe
+ */
+static void record_many(uint8_t probe, uint32_t us, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t t0 = perf_metrics_now();
+        shim_clock_advance_us(us);
+        perf_metrics_record(probe, t0);
+    }
+}
+
+void setUp(void)
+{
+    shim_clock_set_ms(1000);
+    perf_metrics_init();
+}
+
+void tearDown(void)
+{
+    shim_clock_run();
+}
+
+void test_bucket_limits_grow_by_four(void)
+{
+    TEST_ASSERT_EQUAL(64, perf_metrics_bucket_limit(0));
+    TEST_ASSERT_EQUAL(256, perf_metrics_bucket_limit(1));
+    TEST_ASSERT_EQUAL(1024, perf_metrics_bucket_limit(2));
+    TEST_ASSERT_EQUAL(67108864UL, perf_metrics_bucket_limit(PERF_HIST_BUCKETS - 2));
+    TEST_ASSERT_TRUE(perf_metrics_bucket_limit(PERF_HIST_BUCKETS - 1) == UINT32_MAX);
+}
+
+void test_bucket_boundaries(void)
+{
+    TEST_ASSERT_EQUAL(0, bucket_for(0));
+    TEST_ASSERT_EQUAL(0, bucket_for(1));
+    TEST_ASSERT_EQUAL(0, bucket_for(63));
+    for (uint8_t b = 1; b < PERF_HIST_BUCKETS - 1; b++)
+    {
+        char msg[48];
+        snprintf(msg, sizeof(msg), "bucket %u", b);
+        /* A bucket starts at the previous limit and ends one microsecond short of its own */
+        TEST_ASSERT_EQUAL_MESSAGE(b, bucket_for(perf_metrics_bucket_limit(b - 1)), msg);
+        TEST_ASSERT_EQUAL_MESSAGE(b, bucket_for(perf_metrics_bucket_limit(b) - 1), msg);
+    }
+    TEST_ASSERT_EQUAL(PERF_HIST_BUCKETS - 1, bucket_for(perf_metrics_bucket_limit(PERF_HIST_BUCKETS - 2)));
+    TEST_ASSERT_EQUAL(PERF_HIST_BUCKETS - 1, bucket_for(0x7FFFFFFFUL));
+}
+
+void test_count_total_and_max(void)
+{
+    record_many(PERF_DISPLAY, 100, 3);
+    record_many(PERF_DISPLAY, 5000, 1);
+
+    struct perf_hist h;
+    perf_metrics_get(PERF_DISPLAY, &h);
+    TEST_ASSERT_EQUAL(4, h.count);
+    TEST_ASSERT_EQUAL(5300, (long)h.total_us);
+    TEST_ASSERT_EQUAL(5000, h.max_us);
+    TEST_ASSERT_EQUAL(3, h.buckets[1]);
+    TEST_ASSERT_EQUAL(1, h.buckets[4]);
+
+    /* Other probes are untouched */
+    perf_metrics_get(PERF_HTTP, &h);
+    TEST_ASSERT_EQUAL(0, h.count);
+}
+
+void test_percentiles(void)
+{
+    struct perf_hist h;
+    perf_metrics_get(PERF_HTTP, &h);
+    TEST_ASSERT_EQUAL(0, perf_metrics_percentile(&h, 90));
+
+    /* 90 fast, 9 medium and one slow span: the rank is rounded up */
+    record_many(PERF_HTTP, 10, 90);
+    record_many(PERF_HTTP, 2000, 9);
+    record_many(PERF_HTTP, 5000000, 1);
+    perf_metrics_get(PERF_HTTP, &h);
+
+    TEST_ASSERT_EQUAL(64, perf_metrics_percentile(&h, 1));
+    TEST_ASSERT_EQUAL(64, perf_metrics_percentile(&h, 50));
+    TEST_ASSERT_EQUAL(64, perf_metrics_percentile(&h, 90));
+    TEST_ASSERT_EQUAL(4096, perf_metrics_percentile(&h, 91));
+    TEST_ASSERT_EQUAL(4096, perf_metrics_percentile(&h, 99));
+    /* The slowest span's bucket ends at 16.7 s, the largest sample is reported instead */
+    TEST_ASSERT_EQUAL(5000000, perf_metrics_percentile(&h, 100));
+}
+
+void test_percentile_of_one_sample(void)
+{
+    record_many(PERF_FS_IO, 300, 1);
+
+    struct perf_hist h;
+    perf_metrics_get(PERF_FS_IO, &h);
+    TEST_ASSERT_EQUAL(300, perf_metrics_percentile(&h, 1));
+    TEST_ASSERT_EQUAL(300, perf_metrics_percentile(&h, 100));
+}
+
+void test_out_of_range_probe_ignored(void)
+{
+    perf_metrics_record(PERF_PROBE_COUNT, perf_metrics_now());
+    perf_metrics_count(PERF_COUNTER_COUNT);
+
+    struct perf_hist h;
+    perf_metrics_get(PERF_PROBE_COUNT, &h);
+    TEST_ASSERT_EQUAL(0, h.count);
+    TEST_ASSERT_EQUAL(0, perf_metrics_counter(PERF_COUNTER_COUNT));
+
+    perf_metrics_count(PERF_CNT_HTTP_FAIL);
+    perf_metrics_count(PERF_CNT_HTTP_FAIL);
+    TEST_ASSERT_EQUAL(2, perf_metrics_counter(PERF_CNT_HTTP_FAIL));
+}
+
+/**
+ * @brief The data frame of updateJsonAndSendFrame, fixed values
+ */
+static size_t build_frame(char *buf, size_t len, long epoch)
+{
+    CFrameWriter w(buf, len);
+    w.beginObject();
+    w.addString(FK_REASON_FOR_PACKET, "T");
+    w.addString(FK_NAME, "DO-HANDHELD");
+    w.addString(FK_DEVICE_ID, "A4:CF:12:9B:3E:70");
+    w.addString(FK_ROUTER_MAC_ID, "F0:9F:C2:11:22:33");
+    w.addString(FK_LOCAL_IP, "192.168.1.47");
+    w.addInt(FK_FW_VER, 112);
+    w.addInt(FK_IS_REBOOT, 0);
+    w.addInt(FK_FRAMES_IN_BACKUP, 3);
+    w.addString(FK_WIFI_SSID, "Farm North AP");
+    w.addInt(FK_RSSI, -67);
+    w.addInt(FK_EPOCH, epoch);
+    w.addInt(FK_OPERATION_MODE, 1);
+    w.addFloat(FK_LAT, 16.5123457, 7);
+    w.addFloat(FK_LNG, 81.5234561, 7);
+    w.addFloat(FK_HDOP, 0.9, 2);
+    w.addInt(FK_SATELLITES, 11);
+    w.addBool(FK_IS_GPS_VALID, true);
+    w.addFloat(FK_POS_RADIUS, 2.4, 1);
+    w.addString(FK_RFID, "NO RFID");
+    w.addString(FK_POND_NAME, "Farm-North-Block-017");
+    w.addString(FK_POND_ID, "6650f0c1a2b3c4d5e6f70011");
+    w.addString(FK_LOCATION_ID, "6650f0c1a2b3c4d5e6f80011");
+    w.addInt(FK_POND_CONFIDENCE, 92);
+    w.addInt(FK_LOCAL_OFFSET_MIN, 330);
+    w.addFloat(FK_DO, 6.41235, 5);
+    w.addFloat(FK_TEMP, 28.125, 3);
+    w.addFloat(FK_SATURATION_PCT, 84.73125, 5);
+    w.addFloat(FK_SALINITY, 15.0, 3);
+    w.addInt(FK_BAT_PERCENT, 76);
+    w.addInt(FK_IS_HISTORY, 0);
+    w.addString(FK_NEAREST, "Farm-North-Block-016,Farm-North-Block-018");
+    w.addString(FK_TIME_BUFFER, "2025-06-01 10:15:23");
+    w.addInt(FK_UP_TIME, 3600);
+    w.addInt(FK_LAST_PNAME_CHECK_TIME, epoch - 5);
+    w.addInt(FK_PNAME_CHECKING_CNTR, 12);
+    w.endObject();
+    return w.ok() ? w.position() : 0;
+}
+
+void test_probe_overhead(void)
+{
+    shim_clock_run();
+    char frame[2200];
+    volatile size_t sink = 0;
+    double build = 1e30, probe = 1e30;
+
+    /* Best of a few rounds each, so a preemption does not count against either */
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < BENCH_FRAMES; i++)
+            sink = sink + build_frame(frame, sizeof(frame), (long)i);
+        auto t1 = std::chrono::steady_clock::now();
+        for (unsigned long i = 0; i < BENCH_FRAMES; i++)
+        {
+            uint32_t start = PERF_NOW();
+            PERF_RECORD(PERF_FRAME_BUILD, start);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        double b = std::chrono::duration<double, std::nano>(t1 - t0).count() / BENCH_FRAMES;
+        double p = std::chrono::duration<double, std::nano>(t2 - t1).count() / BENCH_FRAMES;
+        if (b < build) build = b;
+        if (p < probe) probe = p;
+    }
+    TEST_ASSERT_TRUE(sink > 0);
+
+    struct perf_hist h;
+    perf_metrics_get(PERF_FRAME_BUILD, &h);
+    TEST_ASSERT_EQUAL(BENCH_FRAMES * BENCH_ROUNDS, h.count);
+
+    char line[160];
+    snprintf(line, sizeof(line), "perf metrics: probe %.0f ns, frame build %.0f ns, probe on a frame build %.2f %%",
+             probe, build, 100.0 * probe / build);
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_bucket_limits_grow_by_four);
+    RUN_TEST(test_bucket_boundaries);
+    RUN_TEST(test_count_total_and_max);
+    RUN_TEST(test_percentiles);
+    RUN_TEST(test_percentile_of_one_sample);
+    RUN_TEST(test_out_of_range_probe_ignored);
+    RUN_TEST(test_probe_overhead);
+    return UNITY_END();
+}
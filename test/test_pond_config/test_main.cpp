@@ -0,0 +1,216 @@
+/**
+ * @file test_main.cpp
+ * @brief Pond config loader on the host: multi-MB files, and reloads while the list is read
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The config file is streamed through json_stream, so a file of several MB
+ * must load in the RAM of the pond list alone, with header fields found
+ * after the arrays. The Frame task reloads the list while the App task
+ * walks it; a reader thread here does what GetCurrentPondName and
+ * finalizeNearestPonds do and checks every entry it sees is whole.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "shim_heap.h"
+#include "CPondConfig.h"
+#include "json_stream.h"
+
+#define BIG_CONFIG_LINES 30000          /* ~2.5 MB of pond lines, far over TOTAL_PONDS */
+#define BIG_PAD_ELEMENTS 70000          /* Past the old 16-bit element counter */
+#define SMALL_CONFIG_PONDS 10
+#define RELOADS 40
+
+static FILESYSTEM s_fs;
+
+/**
+ * @brief Write an idsConfig.txt, pond i named P<i> with salinity base + i
+ * @return File size
+ */
+static size_t write_config(uint32_t ponds, int salinity_base, uint32_t pad, int version)
+{
+    File f = SPIFFS.open(FILENAME_IDSCONFIG, FILE_WRITE);
+    TEST_ASSERT_TRUE((bool)f);
+    size_t size = 0;
+    std::string chunk = "{\"tenantId\":\"farm-7\",\"config\":[";
+    for (uint32_t i = 0; i < ponds; i++)
+    {
+        char line[160];
+        snprintf(line, sizeof(line), "%s\"3|P%u|pond-%08u-4f1c-9a7e-%012u|%d|loc-%08u-77aa-4c1b-8d2e-%012u|1\"",
+                 i ? "," : "", (unsigned)i, (unsigned)i, (unsigned)i, salinity_base + (int)i, (unsigned)i, (unsigned)i);
+        chunk += line;
+        if (chunk.size() > 8192)
+        {
+            size += f.write((const uint8_t *)chunk.data(), chunk.size());
+            chunk.clear();
+        }
+    }
+    chunk += "],\"pad\":[";
+    for (uint32_t i = 0; i < pad; i++)
+    {
+        chunk += i ? ",7" : "7";
+        if (chunk.size() > 8192)
+        {
+            size += f.write((const uint8_t *)chunk.data(), chunk.size());
+            chunk.clear();
+        }
+    }
+    chunk += "],\"version\":" + std::to_string(version) + ",\"offset\":400}";
+    size += f.write((const uint8_t *)chunk.data(), chunk.size());
+    f.close();
+    s_fs.invalidate(FILENAME_IDSCONFIG);
+    return size;
+}
+
+static bool pond_whole(const CPond &pond, int salinity_base)
+{
+    unsigned n;
+    char id[50];
+    if (sscanf(pond.m_cPondname, "P%u", &n) != 1) return false;
+    snprintf(id, sizeof(id), "pond-%08u-4f1c-9a7e-%012u", n, n);
+    return pond.m_iSalinity == salinity_base + (int)n && strcmp(pond.m_cPondId, id) == 0;
+}
+
+void setUp(void)
+{
+    SPIFFS.begin(true);
+    SPIFFS.format();
+    s_fs.begin();
+    Serial.quiet = true;
+}
+
+void tearDown(void)
+{
+    Serial.quiet = false;
+}
+
+void test_index_counts_past_64k(void)
+{
+    struct json_stream js;
+    static uint32_t last;
+    last = 0;
+    json_stream_init(&js, [](struct json_stream *s, uint8_t ev, const char *, size_t) -> uint8_t {
+        if (ev == JSON_EV_NUMBER) last = json_stream_index(s, 0);
+        return 1;
+    }, NULL);
+    TEST_ASSERT_TRUE(json_stream_feed(&js, "[", 1));
+    for (uint32_t i = 0; i < BIG_PAD_ELEMENTS; i++)
+        TEST_ASSERT_TRUE(json_stream_feed(&js, i ? ",1" : "1", i ? 2 : 1));
+    TEST_ASSERT_TRUE(json_stream_feed(&js, "]", 1));
+    TEST_ASSERT_TRUE(json_stream_finish(&js));
+    TEST_ASSERT_EQUAL_UINT32(BIG_PAD_ELEMENTS - 1, last);
+}
+
+void test_multi_mb_config_loads(void)
+{
+    size_t size = write_config(BIG_CONFIG_LINES, 100, BIG_PAD_ELEMENTS, 4242);
+    static CPondConfig config(&s_fs);
+
+    long base = shim_heap_live();
+    shim_heap_reset_peak();
+    auto t0 = std::chrono::steady_clock::now();
+    TEST_ASSERT_EQUAL(1, config.loadPondConfig());
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    long peak = shim_heap_peak_since(base);
+
+    /* Header fields after both arrays, list capped, every entry intact */
+    TEST_ASSERT_EQUAL(4242, (int)config.m_i64ConfigIdsVersion);
+    TEST_ASSERT_EQUAL_STRING("farm-7", config.m_cTenantId);
+    TEST_ASSERT_EQUAL(400, config.m_iOffset);
+    TEST_ASSERT_EQUAL(TOTAL_PONDS, config.m_u8TotalNoOfPonds);
+    TEST_ASSERT_EQUAL(TOTAL_PONDS, config.m_oPondList.size());
+    for (const CPond &pond : config.m_oPondList) TEST_ASSERT_TRUE(pond_whole(pond, 100));
+
+    /* RAM is the pond list and status map, not the file */
+    TEST_ASSERT_LESS_THAN(256 * 1024, peak);
+
+    char line[160];
+    snprintf(line, sizeof(line), "pond config: %u byte file, %u ponds in %.0f ms, heap peak %ld bytes",
+             (unsigned)size, (unsigned)config.m_oPondList.size(), ms, peak);
+    TEST_MESSAGE(line);
+}
+
+void test_broken_file_leaves_no_ponds(void)
+{
+    static CPondConfig config(&s_fs);
+    write_config(20, 0, 0, 1);
+    TEST_ASSERT_EQUAL(1, config.loadPondConfig());
+    TEST_ASSERT_EQUAL(20, config.m_u8TotalNoOfPonds);
+
+    File f = SPIFFS.open(FILENAME_IDSCONFIG, FILE_WRITE);
+    f.print("{\"config\":[\"1|P1|a|0|b|1\",");
+    f.close();
+    s_fs.invalidate(FILENAME_IDSCONFIG);
+    TEST_ASSERT_EQUAL(0, config.loadPondConfig());
+    TEST_ASSERT_EQUAL(0, config.m_u8TotalNoOfPonds);
+    TEST_ASSERT_EQUAL(0, config.m_oPondList.size());
+}
+
+void test_reload_while_reading(void)
+{
+    static CPondConfig config(&s_fs);
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned long> walks(0), torn(0), found(0);
+
+    /* App task: walk the list for the nearest pond, then look the winner up */
+    std::thread reader([&]() {
+        while (!stop)
+        {
+            int base = -1;
+            if (config.lockPondList())
+            {
+                if (config.m_u8TotalNoOfPonds != config.m_oPondList.size()) torn++;
+                for (const CPond &pond : config.m_oPondList)
+                {
+                    if (base < 0) base = pond.m_iSalinity;
+                    if (!pond_whole(pond, base)) torn++;
+                }
+                config.unlockPondList();
+            }
+            CPond pond;
+            if (config.findPond("P7", pond))
+            {
+                found++;
+                if (pond.m_iSalinity != 7 && pond.m_iSalinity != 1007) torn++;
+            }
+            walks++;
+        }
+    });
+
+    /* Frame task: a new config after each download, boundary entries refreshed */
+    for (int i = 0; i < RELOADS; i++)
+    {
+        bool big = i & 1;
+        write_config(big ? TOTAL_PONDS : SMALL_CONFIG_PONDS, big ? 0 : 1000, 0, i);
+        TEST_ASSERT_EQUAL(1, config.loadPondConfig());
+        config.updateBoundaryIndex("P3");
+    }
+    stop = true;
+    reader.join();
+
+    TEST_ASSERT_EQUAL(0, torn.load());
+    TEST_ASSERT_GREATER_THAN(0, found.load());
+    char line[120];
+    snprintf(line, sizeof(line), "pond config: %d reloads, %lu walks, %lu lookups hit",
+             RELOADS, walks.load(), found.load());
+    TEST_MESSAGE(line);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_index_counts_past_64k);
+    RUN_TEST(test_multi_mb_config_loads);
+    RUN_TEST(test_broken_file_leaves_no_ponds);
+    RUN_TEST(test_reload_while_reading);
+    return UNITY_END();
+}
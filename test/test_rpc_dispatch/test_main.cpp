@@ -0,0 +1,190 @@
+/**
+ * @file test_main.cpp
+ * @brief RPC dispatch: route lookup, in-place event parsing, events/s and heap per RPC
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The route table carries the firmware's method names with a handler that
+ * replies like the real ones. The benchmark runs whole Socket.IO events
+ * (unwrap, dispatch, reply into a fixed buffer) and reports events/s and
+ * the heap peak per event, which must stay at zero. A linear strcmp scan,
+ * the way mjson's jsonrpc_export list was searched, is timed alongside.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include "shim_heap.h"
+#include "rpc_dispatch.h"
+
+#define BENCH_EVENTS 200000UL
+
+static uint32_t s_calls;
+
+static void handler(struct jsonrpc_request *r)
+{
+    s_calls++;
+    jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\"}");
+}
+
+static constexpr struct rpc_route s_routes[] = {
+    {"ActivateSafeMode", handler}, {"ClearBackupFiles", handler}, {"ClearNonBackupFiles", handler},
+    {"FOTA", handler}, {"ResetPondStatus", handler}, {"SetPondMapResetTime", handler},
+    {"SimulatePosts", handler}, {"calibrate", handler}, {"deleteFile", handler},
+    {"getCalStatus", handler}, {"getCalValues", handler}, {"getConfig", handler},
+    {"getFileChunk", handler}, {"getFileContent", handler}, {"getFileList", handler},
+    {"getLiveFrame", handler}, {"getMetrics", handler}, {"getPower", handler},
+    {"getPressure", handler}, {"getSalinity", handler}, {"getWifiStats", handler},
+    {"listFiles", handler}, {"serverConfig", handler}, {"setAuxProbe", handler},
+    {"setCalValues", handler}, {"setDataFrequency", handler}, {"setFieldTrace", handler},
+    {"setFrameTransport", handler}, {"setGpsProtocol", handler}, {"setLocalTimeOffset", handler},
+    {"setOperationMode", handler}, {"setPingMetrics", handler}, {"setPressure", handler},
+    {"setSalinity", handler}, {"setTraceConfig", handler}, {"setWifiNetworks", handler},
+    {"syncRTC", handler}, {"sysReboot", handler}, {"updateConfig", handler},
+    {"whoAreYou", handler}, {"wifiConfig", handler},
+};
+
+#define ROUTE_COUNT (sizeof(s_routes) / sizeof(s_routes[0]))
+
+static_assert(rpc_routes_sorted(s_routes, ROUTE_COUNT), "test routes must be sorted");
+
+static char s_reply[512];
+static struct mjson_fixedbuf s_fb;
+
+static void reply_reset(void)
+{
+    s_fb.ptr = s_reply;
+    s_fb.size = sizeof(s_reply);
+    s_fb.len = 0;
+    s_reply[0] = '\0';
+}
+
+/**
+ * @brief Run one Socket.IO event the way processRPC does
+ */
+static uint8_t run_event(const char *event)
+{
+    int len;
+    const char *obj = rpc_event_object(event, strlen(event), &len);
+    if (!obj) return 0;
+    reply_reset();
+    rpc_dispatch(s_routes, ROUTE_COUNT, obj, len, mjson_print_fixed_buf, &s_fb);
+    return 1;
+}
+
+static const struct rpc_route *linear_find(const char *method, int len)
+{
+    for (size_t i = 0; i < ROUTE_COUNT; i++)
+    {
+        if (strncmp(s_routes[i].method, method, len) == 0 && s_routes[i].method[len] == '\0') return &s_routes[i];
+    }
+    return NULL;
+}
+
+void setUp(void)
+{
+    s_calls = 0;
+    reply_reset();
+}
+
+void tearDown(void) {}
+
+void test_every_route_found(void)
+{
+    for (size_t i = 0; i < ROUTE_COUNT; i++)
+    {
+        const char *m = s_routes[i].method;
+        TEST_ASSERT_EQUAL(&s_routes[i], rpc_route_find(s_routes, ROUTE_COUNT, m, (int)strlen(m)));
+    }
+    /* Prefixes and extensions of real names are not routes */
+    TEST_ASSERT_NULL(rpc_route_find(s_routes, ROUTE_COUNT, "getFile", 7));
+    TEST_ASSERT_NULL(rpc_route_find(s_routes, ROUTE_COUNT, "getConfigs", 10));
+    TEST_ASSERT_NULL(rpc_route_find(s_routes, ROUTE_COUNT, "", 0));
+    TEST_ASSERT_NULL(rpc_route_find(s_routes, ROUTE_COUNT, "zzz", 3));
+}
+
+void test_event_dispatched_in_place(void)
+{
+    TEST_ASSERT_TRUE(run_event("[\"rpc\",{\"id\":7,\"method\":\"whoAreYou\",\"params\":{}}]"));
+    TEST_ASSERT_EQUAL(1, s_calls);
+    TEST_ASSERT_EQUAL_STRING("{\"id\":7,\"result\":{\"statusCode\":200,\"statusMsg\":\"Success.\"}}\n", s_reply);
+}
+
+void test_unknown_method_and_bad_requests(void)
+{
+    TEST_ASSERT_TRUE(run_event("[\"rpc\",{\"id\":\"a\",\"method\":\"formatFlash\"}]"));
+    TEST_ASSERT_EQUAL(0, s_calls);
+    TEST_ASSERT_NOT_NULL(strstr(s_reply, "\"code\":-32601"));
+    TEST_ASSERT_NOT_NULL(strstr(s_reply, "\"id\":\"a\""));
+
+    TEST_ASSERT_TRUE(run_event("[\"rpc\",{\"id\":1,\"params\":{}}]"));
+    TEST_ASSERT_NOT_NULL(strstr(s_reply, "\"code\":-32700"));
+
+    /* A notification runs but gets no reply */
+    TEST_ASSERT_TRUE(run_event("[\"rpc\",{\"method\":\"syncRTC\"}]"));
+    TEST_ASSERT_EQUAL(1, s_calls);
+    TEST_ASSERT_EQUAL_STRING("", s_reply);
+
+    /* Element [1] must be an object */
+    TEST_ASSERT_FALSE(run_event("[\"rpc\",\"whoAreYou\"]"));
+    TEST_ASSERT_FALSE(run_event("{\"method\":\"whoAreYou\"}"));
+}
+
+void test_events_per_second_and_heap(void)
+{
+    static const char *events[] = {
+        "[\"rpc\",{\"jsonrpc\":\"2.0\",\"id\":101,\"method\":\"getLiveFrame\",\"params\":{}}]",
+        "[\"rpc\",{\"jsonrpc\":\"2.0\",\"id\":102,\"method\":\"setDataFrequency\",\"params\":{\"interval\":60}}]",
+        "[\"rpc\",{\"jsonrpc\":\"2.0\",\"id\":103,\"method\":\"whoAreYou\",\"params\":{}}]",
+        "[\"rpc\",{\"jsonrpc\":\"2.0\",\"id\":104,\"method\":\"ActivateSafeMode\",\"params\":{\"on\":false}}]",
+    };
+    run_event(events[0]);
+    long base = shim_heap_live();
+    shim_heap_reset_peak();
+
+    uint32_t t0 = micros();
+    for (uint32_t i = 0; i < BENCH_EVENTS; i++) run_event(events[i & 3]);
+    uint32_t us = micros() - t0;
+    long peak = shim_heap_peak_since(base);
+    unsigned long allocs = shim_heap_allocs();
+
+    /* Lookup alone, binary search against a linear scan */
+    static const char *names[] = {"getLiveFrame", "setDataFrequency", "whoAreYou", "ActivateSafeMode"};
+    uint32_t found = 0;
+    t0 = micros();
+    for (uint32_t i = 0; i < BENCH_EVENTS; i++)
+        found += rpc_route_find(s_routes, ROUTE_COUNT, names[i & 3], (int)strlen(names[i & 3])) != NULL;
+    uint32_t binaryUs = micros() - t0;
+    t0 = micros();
+    for (uint32_t i = 0; i < BENCH_EVENTS; i++) found += linear_find(names[i & 3], (int)strlen(names[i & 3])) != NULL;
+    uint32_t linearUs = micros() - t0;
+
+    char line[200];
+    snprintf(line, sizeof(line),
+             "rpc: %.0f events/s, heap peak %ld B over %lu events (%lu allocations); lookup %.0f ns binary, %.0f ns linear",
+             BENCH_EVENTS * 1e6 / (us ? us : 1), peak, BENCH_EVENTS, allocs,
+             binaryUs * 1000.0 / BENCH_EVENTS, linearUs * 1000.0 / BENCH_EVENTS);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL(BENCH_EVENTS + 1, s_calls);
+    TEST_ASSERT_EQUAL(2 * BENCH_EVENTS, found);
+    TEST_ASSERT_EQUAL(0, peak);
+    TEST_ASSERT_EQUAL(0, allocs);
+
+    /* The counter does see allocations */
+    void *p = malloc(64);
+    TEST_ASSERT_GREATER_OR_EQUAL(64, shim_heap_peak_since(base));
+    free(p);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_every_route_found);
+    RUN_TEST(test_event_dispatched_in_place);
+    RUN_TEST(test_unknown_method_and_bad_requests);
+    RUN_TEST(test_events_per_second_and_heap);
+    return UNITY_END();
+}
@@ -0,0 +1,318 @@
+/**
+ * @file test_main.cpp
+ * @brief RPC reply slots: framing, the large buffer, and a full 255-pond getConfig
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Requests go through rpc_dispatch into a reply slot and out through a fake
+ * Socket.IO send, the way processRPC runs them. getConfig is routed to
+ * config_page over an idsConfig.txt written to the SPIFFS shim, and the
+ * client side pages through it until "next" is -1.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <string>
+#include <vector>
+#include "rpc_dispatch.h"
+#include "rpc_reply_queue.h"
+#include "config_page.h"
+
+#define CONFIG_PATH "/idsConfig.txt"
+#define FULL_PONDS 255
+
+static struct rpc_reply_queue s_queue;
+static std::vector<std::string> s_sent;
+static bool s_linkUp;
+static std::string s_blob;              /* Result for the "blob" route */
+
+static uint8_t link_send(const char *data, size_t len)
+{
+    if (!s_linkUp) return 0;
+    s_sent.emplace_back(data, len);
+    return 1;
+}
+
+static void rpc_get_config(struct jsonrpc_request *r)
+{
+    double cursor = 0, limit = CONFIG_PAGE_MAX;
+    mjson_get_number(r->params, r->params_len, "$.cursor", &cursor);
+    mjson_get_number(r->params, r->params_len, "$.limit", &limit);
+    struct config_page page;
+    config_page_init(&page, CONFIG_PATH, (uint16_t)cursor, (uint16_t)limit);
+    jsonrpc_return_success(r, "%M", config_page_print, &page);
+}
+
+static void rpc_blob(struct jsonrpc_request *r)
+{
+    jsonrpc_return_success(r, "%Q", s_blob.c_str());
+}
+
+static void rpc_who(struct jsonrpc_request *r)
+{
+    jsonrpc_return_success(r, "{\"statusCode\":200,\"statusMsg\":\"Success.\"}");
+}
+
+static constexpr struct rpc_route s_routes[] = {
+    {"blob", rpc_blob},
+    {"getConfig", rpc_get_config},
+    {"whoAreYou", rpc_who},
+};
+
+#define ROUTE_COUNT (sizeof(s_routes) / sizeof(s_routes[0]))
+
+/**
+ * @brief One request through a slot, as processRPC does it
+ */
+static void rpc(const char *request)
+{
+    int len = (int)strlen(request);
+    rpc_reply_slot_t *slot = rpc_reply_begin(&s_queue);
+    rpc_dispatch(s_routes, ROUTE_COUNT, request, len, rpc_reply_write, slot);
+    rpc_reply_commit(&s_queue, slot, request, len);
+    rpc_reply_flush(&s_queue, link_send);
+}
+
+/**
+ * @brief Pond line of realistic size: 24-hex ids and a long pond name
+ */
+static std::string pond_line(int i)
+{
+    char line[160];
+    snprintf(line, sizeof(line), "%ld|Farm-North-Block-%03d|6650f0c1a2b3c4d5e6f7%04x|%d|6650f0c1a2b3c4d5e6f8%04x|%d",
+             1760000000000L + i, i, i, 10 + i % 20, i, i % 7 ? 1 : 0);
+    return line;
+}
+
+static void write_config(const std::vector<std::string> &lines)
+{
+    std::string doc = "{\"version\":1760000000123,\"tenantId\":\"watermon-demo\",\"offset\":330,\"config\":[";
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        doc += i ? ",\"" : "\"";
+        doc += lines[i];
+        doc += "\"";
+    }
+    doc += "]}";
+    File f = SPIFFS.open(CONFIG_PATH, FILE_WRITE);
+    f.write((const uint8_t *)doc.data(), doc.size());
+    f.close();
+}
+
+/**
+ * @brief Page through getConfig like the app does
+ * @return Lines collected, in order
+ */
+static std::vector<std::string> fetch_config(uint32_t *pages, size_t *largest)
+{
+    std::vector<std::string> lines;
+    int cursor = 0;
+    *pages = 0;
+    *largest = 0;
+    while (cursor >= 0 && *pages < 100)
+    {
+        char req[96];
+        snprintf(req, sizeof(req), "{\"id\":%u,\"method\":\"getConfig\",\"params\":{\"cursor\":%d}}", *pages + 1, cursor);
+        s_sent.clear();
+        rpc(req);
+        TEST_ASSERT_EQUAL(1, s_sent.size());
+        const std::string &ev = s_sent[0];
+        if (ev.size() > *largest) *largest = ev.size();
+        (*pages)++;
+
+        double status = 0, next = -2, total = 0;
+        TEST_ASSERT_TRUE(mjson_get_number(ev.data(), (int)ev.size(), "$[1].result.statusCode", &status));
+        TEST_ASSERT_EQUAL(200, (int)status);
+        TEST_ASSERT_TRUE(mjson_get_number(ev.data(), (int)ev.size(), "$[1].result.next", &next));
+        TEST_ASSERT_TRUE(mjson_get_number(ev.data(), (int)ev.size(), "$[1].result.total", &total));
+        for (int i = 0;; i++)
+        {
+            char path[48], line[JSON_STREAM_TOKEN_MAX + 1];
+            snprintf(path, sizeof(path), "$[1].result.config[%d]", i);
+            if (mjson_get_string(ev.data(), (int)ev.size(), path, line, sizeof(line)) < 0) break;
+            lines.push_back(line);
+        }
+        cursor = (int)next;
+    }
+    return lines;
+}
+
+void setUp(void)
+{
+    SPIFFS.begin(true);
+    SPIFFS.format();
+    rpc_reply_queue_init(&s_queue);
+    s_sent.clear();
+    s_linkUp = true;
+}
+
+void tearDown(void) {}
+
+void test_small_reply_framed_in_slot(void)
+{
+    rpc("{\"id\":7,\"method\":\"whoAreYou\"}");
+    TEST_ASSERT_EQUAL(1, s_sent.size());
+    TEST_ASSERT_EQUAL_STRING("[\"rpcr\",{\"id\":7,\"result\":{\"statusCode\":200,\"statusMsg\":\"Success.\"}}\n]",
+                             s_sent[0].c_str());
+    TEST_ASSERT_EQUAL(0, s_queue.large_used);
+
+    /* A notification sends nothing and frees its slot */
+    rpc("{\"method\":\"whoAreYou\"}");
+    TEST_ASSERT_EQUAL(1, s_sent.size());
+    for (int i = 0; i < RPC_REPLY_SLOTS; i++) TEST_ASSERT_FALSE(s_queue.slots[i].in_use);
+}
+
+void test_full_config_pages_through(void)
+{
+    std::vector<std::string> lines;
+    for (int i = 0; i < FULL_PONDS; i++) lines.push_back(pond_line(i));
+    write_config(lines);
+
+    uint32_t pages;
+    size_t largest;
+    std::vector<std::string> got = fetch_config(&pages, &largest);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "getConfig: %u ponds, file %d B, %u pages, largest event %u B, slot %u B, large buffer %u B",
+             FULL_PONDS, (int)SPIFFS.open(CONFIG_PATH).size(), (unsigned)pages, (unsigned)largest,
+             RPC_REPLY_SLOT_SIZE, RPC_REPLY_LARGE_SIZE);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL(FULL_PONDS, got.size());
+    for (int i = 0; i < FULL_PONDS; i++) TEST_ASSERT_EQUAL_STRING(lines[i].c_str(), got[i].c_str());
+    TEST_ASSERT_EQUAL((FULL_PONDS + CONFIG_PAGE_MAX - 1) / CONFIG_PAGE_MAX, pages);
+    TEST_ASSERT_EQUAL(0, s_queue.oversized);
+    TEST_ASSERT_EQUAL(0, s_queue.dropped);
+    TEST_ASSERT_GREATER_THAN(RPC_REPLY_SLOT_SIZE, largest);
+    TEST_ASSERT_NULL(s_queue.large_owner);
+}
+
+void test_header_fields_and_small_config_whole(void)
+{
+    std::vector<std::string> lines = {"1|P1|a|15|b|1", "2|P2|c|15|d|0"};
+    write_config(lines);
+    rpc("{\"id\":1,\"method\":\"getConfig\",\"params\":{}}");
+    TEST_ASSERT_EQUAL(1, s_sent.size());
+    TEST_ASSERT_EQUAL_STRING("[\"rpcr\",{\"id\":1,\"result\":{\"config\":[\"1|P1|a|15|b|1\",\"2|P2|c|15|d|0\"],"
+                             "\"version\":1760000000123,\"tenantId\":\"watermon-demo\",\"offset\":330,"
+                             "\"total\":2,\"next\":-1,\"statusCode\":200}}\n]",
+                             s_sent[0].c_str());
+}
+
+void test_longest_lines_fill_a_page(void)
+{
+    /* Every line as long as the tokenizer passes whole */
+    std::vector<std::string> lines;
+    for (int i = 0; i < CONFIG_PAGE_MAX + 3; i++)
+    {
+        std::string l = pond_line(i);
+        l.resize(JSON_STREAM_TOKEN_MAX, 'x');
+        lines.push_back(l);
+    }
+    write_config(lines);
+    uint32_t pages;
+    size_t largest;
+    std::vector<std::string> got = fetch_config(&pages, &largest);
+    TEST_ASSERT_EQUAL(lines.size(), got.size());
+    TEST_ASSERT_EQUAL(2, pages);
+    TEST_ASSERT_EQUAL(0, s_queue.oversized);
+    TEST_ASSERT_LESS_OR_EQUAL(RPC_REPLY_LARGE_SIZE, largest);
+}
+
+void test_missing_or_broken_file(void)
+{
+    rpc("{\"id\":2,\"method\":\"getConfig\"}");
+    TEST_ASSERT_NOT_NULL(strstr(s_sent[0].c_str(), "\"total\":0,\"next\":-1,\"statusCode\":300"));
+
+    File f = SPIFFS.open(CONFIG_PATH, FILE_WRITE);
+    f.print("{\"version\":3,\"config\":[\"1|P1|a|15|b|1\",\"2|P2");
+    f.close();
+    rpc("{\"id\":3,\"method\":\"getConfig\"}");
+    const std::string &ev = s_sent[1];
+    double status = 0;
+    TEST_ASSERT_TRUE(mjson_get_number(ev.data(), (int)ev.size(), "$[1].result.statusCode", &status));
+    TEST_ASSERT_EQUAL(300, (int)status);
+}
+
+void test_max_result_fits_larger_is_error(void)
+{
+    /* A 64-digit id is the longest an error reply keeps */
+    std::string id(64, '9');
+    std::string req = "{\"id\":" + id + ",\"method\":\"blob\"}";
+
+    s_blob.assign(RPC_REPLY_MAX_RESULT - 2, 'a');
+    rpc(req.c_str());
+    TEST_ASSERT_EQUAL(1, s_sent.size());
+    TEST_ASSERT_EQUAL(0, s_queue.oversized);
+    TEST_ASSERT_EQUAL(1, s_queue.large_used);
+
+    s_blob.assign(RPC_REPLY_LARGE_SIZE, 'a');
+    rpc(req.c_str());
+    TEST_ASSERT_EQUAL(2, s_sent.size());
+    TEST_ASSERT_EQUAL(1, s_queue.oversized);
+    std::string expect = "[\"rpcr\",{\"id\":" + id + ",\"error\":{\"code\":-32000,\"message\":\"response too large\"}}]";
+    TEST_ASSERT_EQUAL_STRING(expect.c_str(), s_sent[1].c_str());
+    TEST_ASSERT_NULL(s_queue.large_owner);
+}
+
+void test_one_large_reply_waits_at_a_time(void)
+{
+    s_blob.assign(4000, 'b');
+    s_linkUp = false;
+    rpc("{\"id\":1,\"method\":\"blob\"}");
+    TEST_ASSERT_NOT_NULL(s_queue.large_owner);
+
+    /* The large buffer is taken: this one becomes an error, small ones still go */
+    rpc("{\"id\":2,\"method\":\"blob\"}");
+    rpc("{\"id\":3,\"method\":\"whoAreYou\"}");
+    TEST_ASSERT_EQUAL(1, s_queue.oversized);
+
+    s_linkUp = true;
+    TEST_ASSERT_EQUAL(3, rpc_reply_flush(&s_queue, link_send));
+    TEST_ASSERT_EQUAL(3, s_sent.size());
+    TEST_ASSERT_EQUAL(4000 + 30, s_sent[0].size()); /* ["rpcr",{"id":1,"result":"..."}\n] */
+    TEST_ASSERT_NOT_NULL(strstr(s_sent[1].c_str(), "\"id\":2,\"error\""));
+    TEST_ASSERT_NOT_NULL(strstr(s_sent[2].c_str(), "\"id\":3,\"result\""));
+    TEST_ASSERT_NULL(s_queue.large_owner);
+
+    /* Free again for the next large reply */
+    rpc("{\"id\":4,\"method\":\"blob\"}");
+    TEST_ASSERT_EQUAL(4, s_sent.size());
+    TEST_ASSERT_EQUAL(1, s_queue.oversized);
+}
+
+void test_reset_frees_large_buffer(void)
+{
+    s_blob.assign(3000, 'c');
+    s_linkUp = false;
+    rpc("{\"id\":1,\"method\":\"blob\"}");
+    rpc("{\"id\":2,\"method\":\"whoAreYou\"}");
+    rpc("{\"id\":3,\"method\":\"whoAreYou\"}");
+    rpc("{\"id\":4,\"method\":\"whoAreYou\"}");
+    TEST_ASSERT_EQUAL(1, s_queue.dropped);
+
+    rpc_reply_queue_reset(&s_queue);
+    TEST_ASSERT_NULL(s_queue.large_owner);
+    s_linkUp = true;
+    rpc("{\"id\":5,\"method\":\"blob\"}");
+    TEST_ASSERT_EQUAL(1, s_sent.size());
+    TEST_ASSERT_NOT_NULL(strstr(s_sent[0].c_str(), "\"id\":5,\"result\""));
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_small_reply_framed_in_slot);
+    RUN_TEST(test_full_config_pages_through);
+    RUN_TEST(test_header_fields_and_small_config_whole);
+    RUN_TEST(test_longest_lines_fill_a_page);
+    RUN_TEST(test_missing_or_broken_file);
+    RUN_TEST(test_max_result_fits_larger_is_error);
+    RUN_TEST(test_one_large_reply_waits_at_a_time);
+    RUN_TEST(test_reset_frees_large_buffer);
+    return UNITY_END();
+}
@@ -0,0 +1,320 @@
+/**
+ * @file test_main.cpp
+ * @brief Sensor bus request queue: results by ticket, order, release, one transaction in flight
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Two probes are do_sensor_ops tables over in-memory registers that count
+ * how many transactions are on the wire at once. Requests are posted the
+ * way the RPC handlers and the pond lookup do, and sensor_bus_service()
+ * plays the Modbus task. The stress test posts from several threads while
+ * another services the bus and checks that no two transactions overlap.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "sensor_bus_ops.h"
+
+#define STRESS_POSTERS 3
+#define STRESS_REQUESTS 300
+
+struct mock_probe {
+    float salinity;
+    float pressure;
+    float k;
+    float b;
+    uint8_t fail;                       /* Fail every transaction */
+};
+
+static mock_probe s_regs[2];
+static std::atomic<int> s_inFlight(0);
+static std::atomic<int> s_maxInFlight(0);
+static std::atomic<uint32_t> s_transactions(0);
+
+/**
+ * @brief Registers of the probe behind a sensor, and the wire check around each transaction
+ */
+static mock_probe *begin_transaction(struct do_sensor_device *sensor)
+{
+    int now = ++s_inFlight;
+    int seen = s_maxInFlight.load();
+    while (now > seen && !s_maxInFlight.compare_exchange_weak(seen, now)) {}
+    s_transactions++;
+    std::this_thread::yield();
+    return &s_regs[sensor->slave_id - 1];
+}
+
+static uint8_t end_transaction(mock_probe *p)
+{
+    s_inFlight--;
+    return !p->fail;
+}
+
+static uint8_t mock_init(struct do_sensor_device *sensor, Stream *serial, uint8_t slave_id)
+{
+    (void)serial;
+    sensor->slave_id = slave_id;
+    sensor->is_initialized = 1;
+    return 1;
+}
+
+static uint8_t mock_read_values(struct do_sensor_device *sensor)
+{
+    mock_probe *p = begin_transaction(sensor);
+    sensor->do_percent = 95.0f;
+    return end_transaction(p);
+}
+
+static uint8_t mock_get_calibration(struct do_sensor_device *sensor)
+{
+    mock_probe *p = begin_transaction(sensor);
+    sensor->cal_k = p->k;
+    sensor->cal_b = p->b;
+    return end_transaction(p);
+}
+
+static uint8_t mock_set_salinity(struct do_sensor_device *sensor, float salinity)
+{
+    mock_probe *p = begin_transaction(sensor);
+    if (!p->fail) p->salinity = salinity;
+    sensor->salinity = salinity;
+    return end_transaction(p);
+}
+
+static uint8_t mock_get_salinity(struct do_sensor_device *sensor)
+{
+    mock_probe *p = begin_transaction(sensor);
+    sensor->salinity = p->salinity;
+    return end_transaction(p);
+}
+
+static uint8_t mock_set_pressure(struct do_sensor_device *sensor, float pressure)
+{
+    mock_probe *p = begin_transaction(sensor);
+    if (!p->fail) p->pressure = pressure;
+    sensor->pressure = pressure;
+    return end_transaction(p);
+}
+
+static uint8_t mock_get_pressure(struct do_sensor_device *sensor)
+{
+    mock_probe *p = begin_transaction(sensor);
+    sensor->pressure = p->pressure;
+    return end_transaction(p);
+}
+
+static const struct do_sensor_ops s_mockOps = {
+    mock_init, mock_read_values, NULL, NULL, NULL, mock_get_calibration,
+    mock_set_salinity, mock_get_salinity, mock_set_pressure, mock_get_pressure, NULL,
+};
+
+class NullSerial : public Stream
+{
+public:
+    size_t write(uint8_t c) override { (void)c; return 1; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+static NullSerial s_serial;
+static struct sensor_bus s_bus;
+static struct do_sensor_device s_probe1;
+static struct do_sensor_device s_probe2;
+
+void setUp(void)
+{
+    shim_clock_set_ms(1000);
+    memset(s_regs, 0, sizeof(s_regs));
+    s_regs[0].k = 1.25f;
+    s_regs[0].b = -0.5f;
+    s_inFlight = 0;
+    s_maxInFlight = 0;
+    s_transactions = 0;
+
+    do_sensor_init(&s_probe1, "DO1", &s_mockOps);
+    do_sensor_init(&s_probe2, "DO2", &s_mockOps);
+    TEST_ASSERT_EQUAL(1, sensor_bus_init(&s_bus, "RS485", &s_serial));
+    TEST_ASSERT_EQUAL(1, sensor_bus_attach(&s_bus, &s_probe1, 1, 1000));
+    TEST_ASSERT_EQUAL(1, sensor_bus_attach(&s_bus, &s_probe2, 2, 1000));
+}
+
+void tearDown(void)
+{
+    shim_clock_run();
+}
+
+void test_result_after_service(void)
+{
+    s_regs[0].pressure = 1013.0f;
+    uint32_t ticket = sensor_bus_post(&s_bus, 1, SENSOR_BUS_OP_GET_PRESSURE, 0);
+    TEST_ASSERT_TRUE(ticket != 0);
+
+    /* Nothing touches the probe until the Modbus task runs */
+    float value = -1.0f;
+    TEST_ASSERT_EQUAL(SENSOR_BUS_RES_PENDING, sensor_bus_result(&s_bus, ticket, &value, NULL));
+    TEST_ASSERT_EQUAL(0, s_transactions.load());
+    TEST_ASSERT_EQUAL(0, sensor_bus_idle_ms(&s_bus, millis()));
+
+    sensor_bus_service(&s_bus);
+    TEST_ASSERT_EQUAL(SENSOR_BUS_RES_OK, sensor_bus_result(&s_bus, ticket, &value, NULL));
+    TEST_ASSERT_EQUAL_FLOAT(1013.0f, value);
+
+    /* Collected once, then the entry is free */
+    TEST_ASSERT_EQUAL(SENSOR_BUS_RES_NONE, sensor_bus_result(&s_bus, ticket, &value, NULL));
+}
+
+void test_get_calibration_returns_k_and_b(void)
+{
+    uint32_t ticket = sensor_bus_post(&s_bus, 1, SENSOR_BUS_OP_GET_CALIBRATION, 0);
+    sensor_bus_service(&s_bus);
+
+    float k = 0.0f, b = 0.0f;
+    TEST_ASSERT_EQUAL(SENSOR_BUS_RES_OK, sensor_bus_result(&s_bus, ticket, &k, &b));
+    TEST_ASSERT_EQUAL_FLOAT(1.25f, k);
+    TEST_ASSERT_EQUAL_FLOAT(-0.5f, b);
+}
+
+void test_requests_run_oldest_first(void)
+{
+    /* A set and the read behind it, on the second probe */
+    uint32_t set = sensor_bus_post(&s_bus, 2, SENSOR_BUS_OP_SET_SALINITY, 17.5f);
+    uint32_t get = sensor_bus_post(&s_bus, 2, SENSOR_BUS_OP_GET_SALINITY, 0);
+    sensor_bus_service(&s_bus);
+
+    float value = 0.0f;
+    TEST_ASSERT_EQUAL(SENSOR_BUS_RES_OK, sensor_bus_result(&s_bus, get, &value, NULL));
+    TEST_ASSERT_EQUAL_FLOAT(17.5f, value);
+    TEST_ASSERT_EQUAL(SENSOR_BUS_RES_OK, sensor_bus_result(&s_bus, set, NULL, NULL));
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, s_regs[0].salinity);
+}
+
+void test_failed_transaction_reported(void)
+{
+    s_regs[0].fail = 1;
+    uint32_t ticket = sensor_bus_post(&s_bus, 1, SENSOR_BUS_OP_SET_PRESSURE, 990.0f);
+    sensor_bus_service(&s_bus);
+    TEST_ASSERT_EQUAL(SENSOR_BUS_RES_FAILED, sensor_bus_result(&s_bus, ticket, NULL, NULL));
+}
+
+void test_unknown_slave_and_full_queue_refused(void)
+{
+    TEST_ASSERT_EQUAL(0, sensor_bus_post(&s_bus, 7, SENSOR_BUS_OP_GET_SALINITY, 0));
+
+    for (int i = 0; i < SENSOR_BUS_MAX_REQUESTS; i++)
+        TEST_ASSERT_TRUE(sensor_bus_post(&s_bus, 1, SENSOR_BUS_OP_GET_SALINITY, 0) != 0);
+    TEST_ASSERT_EQUAL(0, sensor_bus_post(&s_bus, 1, SENSOR_BUS_OP_GET_SALINITY, 0));
+}
+
+void test_released_request_still_runs_and_frees(void)
+{
+    /* Fill the queue, give up on every request, as a timed-out RPC would */
+    uint32_t tickets[SENSOR_BUS_MAX_REQUESTS];
+    for (int i = 0; i < SENSOR_BUS_MAX_REQUESTS; i++)
+    {
+        tickets[i] = sensor_bus_post(&s_bus, 1, SENSOR_BUS_OP_SET_SALINITY, 10.0f + i);
+        sensor_bus_release(&s_bus, tickets[i]);
+        TEST_ASSERT_EQUAL(SENSOR_BUS_RES_NONE, sensor_bus_result(&s_bus, tickets[i], NULL, NULL));
+    }
+    TEST_ASSERT_EQUAL(0, sensor_bus_post(&s_bus, 1, SENSOR_BUS_OP_GET_SALINITY, 0));
+
+    sensor_bus_service(&s_bus);
+    TEST_ASSERT_EQUAL_FLOAT(10.0f + SENSOR_BUS_MAX_REQUESTS - 1, s_regs[0].salinity);
+    TEST_ASSERT_TRUE(sensor_bus_post(&s_bus, 1, SENSOR_BUS_OP_GET_SALINITY, 0) != 0);
+}
+
+void test_requests_ahead_of_polls(void)
+{
+    /* Both probes due, one request queued: the request goes first, polls follow */
+    shim_clock_advance_ms(2000);
+    uint32_t ticket = sensor_bus_post(&s_bus, 1, SENSOR_BUS_OP_GET_SALINITY, 0);
+    TEST_ASSERT_EQUAL(3, sensor_bus_service(&s_bus));
+    TEST_ASSERT_EQUAL(SENSOR_BUS_RES_OK, sensor_bus_result(&s_bus, ticket, NULL, NULL));
+    TEST_ASSERT_EQUAL(1, s_bus.slots[0].polls);
+    TEST_ASSERT_EQUAL(1, s_bus.slots[1].polls);
+}
+
+void test_slot_found_by_slave_id(void)
+{
+    /* The primary probe failed setup, the auxiliary one took slot 0 */
+    struct sensor_bus bus;
+    sensor_bus_init(&bus, "RS485", &s_serial);
+    TEST_ASSERT_EQUAL(1, sensor_bus_attach(&bus, &s_probe2, 2, 1000));
+    TEST_ASSERT_TRUE(sensor_bus_find_slot(&bus, 1) == NULL);
+    TEST_ASSERT_TRUE(sensor_bus_find(&bus, 1) == NULL);
+
+    shim_clock_advance_ms(2000);
+    sensor_bus_service(&s_bus);
+    sensor_bus_slot_t *slot = sensor_bus_find_slot(&s_bus, 2);
+    TEST_ASSERT_TRUE(slot == &s_bus.slots[1]);
+    TEST_ASSERT_EQUAL(millis(), slot->last_ok_ms);
+    TEST_ASSERT_TRUE(sensor_bus_find(&s_bus, 2) == &s_probe2);
+}
+
+void test_one_transaction_in_flight(void)
+{
+    shim_clock_run();
+    std::atomic<bool> stop(false);
+    std::thread modbus([&]() {
+        while (!stop)
+        {
+            sensor_bus_service(&s_bus);
+            std::this_thread::yield();
+        }
+    });
+
+    /* Posters wait for each result, as the RPC handlers do */
+    std::vector<std::thread> posters;
+    std::atomic<int> ok(0), wrong(0), refused(0);
+    for (int t = 0; t < STRESS_POSTERS; t++)
+    {
+        posters.emplace_back([&, t]() {
+            for (int i = 0; i < STRESS_REQUESTS; i++)
+            {
+                uint8_t slave = (uint8_t)(1 + (i + t) % 2);
+                uint32_t ticket = sensor_bus_post(&s_bus, slave, SENSOR_BUS_OP_GET_CALIBRATION, 0);
+                if (!ticket)
+                {
+                    refused++;
+                    continue;
+                }
+                float k = 0.0f, b = 0.0f;
+                uint8_t res;
+                while ((res = sensor_bus_result(&s_bus, ticket, &k, &b)) == SENSOR_BUS_RES_PENDING)
+                    std::this_thread::yield();
+                if (res == SENSOR_BUS_RES_OK && k == s_regs[slave - 1].k && b == s_regs[slave - 1].b)
+                    ok++;
+                else
+                    wrong++;
+            }
+        });
+    }
+    for (auto &p : posters) p.join();
+    stop = true;
+    modbus.join();
+
+    TEST_ASSERT_EQUAL(0, wrong.load());
+    TEST_ASSERT_EQUAL(STRESS_POSTERS * STRESS_REQUESTS, ok.load() + refused.load());
+    TEST_ASSERT_TRUE(ok.load() > 0);
+    TEST_ASSERT_EQUAL(1, s_maxInFlight.load());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_result_after_service);
+    RUN_TEST(test_get_calibration_returns_k_and_b);
+    RUN_TEST(test_requests_run_oldest_first);
+    RUN_TEST(test_failed_transaction_reported);
+    RUN_TEST(test_unknown_slave_and_full_queue_refused);
+    RUN_TEST(test_released_request_still_runs_and_frees);
+    RUN_TEST(test_requests_ahead_of_polls);
+    RUN_TEST(test_slot_found_by_slave_id);
+    RUN_TEST(test_one_transaction_in_flight);
+    return UNITY_END();
+}
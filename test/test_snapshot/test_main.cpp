@@ -0,0 +1,140 @@
+/**
+ * @file test_main.cpp
+ * @brief CSnapshot under contention: one writer thread, several reader threads
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * The writer fills every field of a sensor-sized record from one counter,
+ * so a copy mixing two writes shows up as fields that disagree. Readers
+ * also check that the counter and version() never go backwards.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "CSnapshot.h"
+
+#define STRESS_WRITES 2000000UL
+#define STRESS_READERS 3
+
+struct stress_record {
+    uint32_t seq;
+    float doMgl;
+    float temperature;
+    double lat;
+    double lng;
+    char pond[24];
+    uint32_t check;                     /* seq again, last field */
+};
+
+static CSnapshot<stress_record> s_snapshot;
+static std::atomic<bool> s_stop;
+
+static void fill(stress_record *r, uint32_t n)
+{
+    r->seq = n;
+    r->doMgl = (float)n;
+    r->temperature = (float)(n & 0xFFFF);
+    r->lat = n * 0.5;
+    r->lng = -(double)n;
+    snprintf(r->pond, sizeof(r->pond), "P%010u", (unsigned)n);
+    r->check = n;
+}
+
+static bool consistent(const stress_record &r)
+{
+    char pond[24];
+    snprintf(pond, sizeof(pond), "P%010u", (unsigned)r.seq);
+    return r.check == r.seq && r.doMgl == (float)r.seq && r.temperature == (float)(r.seq & 0xFFFF) &&
+           r.lat == r.seq * 0.5 && r.lng == -(double)r.seq && strcmp(r.pond, pond) == 0;
+}
+
+struct reader_stats {
+    uint64_t reads = 0;
+    uint64_t torn = 0;
+    uint64_t backwards = 0;
+};
+
+static void reader(reader_stats *stats)
+{
+    uint32_t lastSeq = 0, lastVersion = 0;
+    while (!s_stop.load(std::memory_order_relaxed))
+    {
+        uint32_t version = s_snapshot.version();
+        stress_record r = s_snapshot.read();
+        stats->reads++;
+        if (!consistent(r)) stats->torn++;
+        if (r.seq < lastSeq || version < lastVersion) stats->backwards++;
+        lastSeq = r.seq;
+        lastVersion = version;
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_single_thread_round_trip(void)
+{
+    CSnapshot<stress_record> snap;
+    TEST_ASSERT_EQUAL(0, snap.version());
+    stress_record in;
+    fill(&in, 42);
+    snap.write(in);
+    stress_record out = snap.read();
+    TEST_ASSERT_TRUE(consistent(out));
+    TEST_ASSERT_EQUAL(42, out.seq);
+    TEST_ASSERT_EQUAL(1, snap.version());
+}
+
+void test_readers_never_see_torn_writes(void)
+{
+    stress_record r;
+    fill(&r, 0);
+    s_snapshot.write(r);
+    s_stop = false;
+    std::vector<reader_stats> stats(STRESS_READERS);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < STRESS_READERS; i++) readers.emplace_back(reader, &stats[i]);
+
+    uint32_t t0 = micros();
+    for (uint32_t n = 1; n <= STRESS_WRITES; n++)
+    {
+        fill(&r, n);
+        s_snapshot.write(r);
+    }
+    uint32_t writeUs = micros() - t0;
+    s_stop = true;
+    for (auto &t : readers) t.join();
+
+    uint64_t reads = 0, torn = 0, backwards = 0;
+    for (const auto &s : stats)
+    {
+        reads += s.reads;
+        torn += s.torn;
+        backwards += s.backwards;
+    }
+    char line[160];
+    snprintf(line, sizeof(line), "snapshot: %lu writes in %u ms, %llu reads by %d readers",
+             STRESS_WRITES, (unsigned)(writeUs / 1000), (unsigned long long)reads, STRESS_READERS);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_EQUAL(0, torn);
+    TEST_ASSERT_EQUAL(0, backwards);
+    TEST_ASSERT_GREATER_THAN(0, reads);
+    TEST_ASSERT_EQUAL(STRESS_WRITES + 1, s_snapshot.version());
+    TEST_ASSERT_EQUAL(STRESS_WRITES, s_snapshot.read().seq);
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_single_thread_round_trip);
+    RUN_TEST(test_readers_never_see_torn_writes);
+    return UNITY_END();
+}
@@ -0,0 +1,261 @@
+/**
+ * @file test_main.cpp
+ * @brief UBX framing on the host: checksums, resync after damage, NAV-PVT/NAV-DOP decoding
+ * @author Watermon Team
+ * @date 2025
+ *
+ * @details
+ * Frames are built with ubx_build() and fed one byte at a time, as the GPS
+ * task does, between NMEA left-overs and line noise. A damaged checksum or
+ * length must cost that frame only; the next good frame is still decoded.
+ */
+
+#include <unity.h>
+#include <Arduino.h>
+#include <random>
+#include <vector>
+#include "ubx_parser.h"
+
+static struct ubx_parser s_parser;
+
+static void put_u4(uint8_t *b, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) b[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void put_u2(uint8_t *b, uint16_t v)
+{
+    b[0] = (uint8_t)v;
+    b[1] = (uint8_t)(v >> 8);
+}
+
+static std::vector<uint8_t> frame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+    std::vector<uint8_t> out(len + 8);
+    TEST_ASSERT_EQUAL(len + 8, ubx_build(out.data(), out.size(), cls, id, payload, len));
+    return out;
+}
+
+static std::vector<uint8_t> nav_pvt(uint32_t itow, int32_t lat, int32_t lon, uint16_t pdop)
+{
+    uint8_t pl[UBX_NAV_PVT_LEN] = {0};
+    put_u4(pl + 0, itow);
+    put_u2(pl + 4, 2025);
+    pl[6] = 3;
+    pl[7] = 14;
+    pl[8] = 9;
+    pl[9] = 26;
+    pl[10] = 53;
+    pl[11] = UBX_PVT_VALID_DATE | UBX_PVT_VALID_TIME;
+    pl[20] = UBX_FIX_3D;
+    pl[21] = UBX_PVT_GNSS_FIX_OK;
+    pl[23] = 11;
+    put_u4(pl + 24, (uint32_t)lon);
+    put_u4(pl + 28, (uint32_t)lat);
+    put_u4(pl + 36, 4200);
+    put_u4(pl + 40, 1800);
+    put_u4(pl + 60, 1250);
+    put_u2(pl + 76, pdop);
+    return frame(UBX_CLASS_NAV, UBX_ID_NAV_PVT, pl, sizeof(pl));
+}
+
+static std::vector<uint8_t> nav_dop(uint32_t itow, uint16_t pdop, uint16_t hdop, uint16_t vdop)
+{
+    uint8_t pl[UBX_NAV_DOP_LEN] = {0};
+    put_u4(pl + 0, itow);
+    put_u2(pl + 4, 250);
+    put_u2(pl + 6, pdop);
+    put_u2(pl + 8, 110);
+    put_u2(pl + 10, vdop);
+    put_u2(pl + 12, hdop);
+    return frame(UBX_CLASS_NAV, UBX_ID_NAV_DOP, pl, sizeof(pl));
+}
+
+/**
+ * @brief Feed bytes, decoding the NAV-PVT frames that complete
+ * @return NAV-PVT frames decoded; the itow of each goes to itows
+ */
+static int feed(const std::vector<uint8_t> &bytes, std::vector<uint32_t> *itows = NULL)
+{
+    int decoded = 0;
+    for (uint8_t c : bytes)
+    {
+        struct ubx_nav_pvt pvt;
+        if (ubx_parser_feed(&s_parser, c) && ubx_decode_nav_pvt(&s_parser, &pvt))
+        {
+            decoded++;
+            if (itows) itows->push_back(pvt.itow_ms);
+        }
+    }
+    return decoded;
+}
+
+static void append(std::vector<uint8_t> &out, const std::vector<uint8_t> &bytes)
+{
+    out.insert(out.end(), bytes.begin(), bytes.end());
+}
+
+void setUp(void)
+{
+    ubx_parser_init(&s_parser);
+}
+
+void tearDown(void) {}
+
+void test_cfg_rate_matches_reference(void)
+{
+    /* 5 Hz, one solution per measurement, UTC aligned */
+    const uint8_t expect[] = {0xB5, 0x62, 0x06, 0x08, 0x06, 0x00, 0xC8, 0x00, 0x01, 0x00, 0x00, 0x00, 0xDD, 0x68};
+    uint8_t msg[16];
+    TEST_ASSERT_EQUAL(sizeof(expect), ubx_build_cfg_rate(msg, sizeof(msg), 200));
+    TEST_ASSERT_EQUAL_MEMORY(expect, msg, sizeof(expect));
+    TEST_ASSERT_EQUAL(0, ubx_build_cfg_rate(msg, 13, 200));
+
+    /* The parser accepts what the builder frames */
+    std::vector<uint8_t> bytes(msg, msg + sizeof(expect));
+    uint8_t done = 0;
+    for (uint8_t c : bytes) done = ubx_parser_feed(&s_parser, c);
+    TEST_ASSERT_TRUE(done);
+    TEST_ASSERT_EQUAL_HEX8(UBX_CLASS_CFG, s_parser.cls);
+    TEST_ASSERT_EQUAL_HEX8(UBX_ID_CFG_RATE, s_parser.id);
+    TEST_ASSERT_EQUAL(6, s_parser.len);
+}
+
+void test_nav_pvt_and_dop_decode(void)
+{
+    std::vector<uint8_t> bytes;
+    append(bytes, nav_dop(345600000, 187, 92, 151));
+    append(bytes, nav_pvt(345600000, 165432109, 815678901, 187));
+
+    struct ubx_nav_dop dop = {};
+    struct ubx_nav_pvt pvt = {};
+    int dops = 0, pvts = 0;
+    for (uint8_t c : bytes)
+    {
+        if (!ubx_parser_feed(&s_parser, c)) continue;
+        if (ubx_decode_nav_dop(&s_parser, &dop)) dops++;
+        if (ubx_decode_nav_pvt(&s_parser, &pvt)) pvts++;
+    }
+    TEST_ASSERT_EQUAL(1, dops);
+    TEST_ASSERT_EQUAL(1, pvts);
+
+    TEST_ASSERT_EQUAL_UINT32(345600000, dop.itow_ms);
+    TEST_ASSERT_EQUAL(92, dop.hdop);
+    TEST_ASSERT_EQUAL(187, dop.pdop);
+    TEST_ASSERT_EQUAL(151, dop.vdop);
+
+    TEST_ASSERT_EQUAL_UINT32(dop.itow_ms, pvt.itow_ms);
+    TEST_ASSERT_EQUAL(2025, pvt.year);
+    TEST_ASSERT_EQUAL(3, pvt.month);
+    TEST_ASSERT_EQUAL(14, pvt.day);
+    TEST_ASSERT_EQUAL(53, pvt.sec);
+    TEST_ASSERT_EQUAL(UBX_FIX_3D, pvt.fix_type);
+    TEST_ASSERT_EQUAL(11, pvt.num_sv);
+    TEST_ASSERT_EQUAL_INT32(165432109, pvt.lat);
+    TEST_ASSERT_EQUAL_INT32(815678901, pvt.lon);
+    TEST_ASSERT_EQUAL_UINT32(1800, pvt.h_acc_mm);
+    TEST_ASSERT_EQUAL_INT32(1250, pvt.g_speed_mms);
+    TEST_ASSERT_EQUAL(187, pvt.pdop);
+    TEST_ASSERT_EQUAL(2, s_parser.frames);
+}
+
+void test_bad_checksum_costs_one_frame(void)
+{
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> bad = nav_pvt(1000, 1, 2, 100);
+    bad[30] ^= 0x01;                    /* Payload bit flip */
+    append(bytes, bad);
+    bad = nav_pvt(1200, 1, 2, 100);
+    bad[bad.size() - 1] ^= 0x80;        /* CK_B */
+    append(bytes, bad);
+    append(bytes, nav_pvt(1400, 1, 2, 100));
+
+    std::vector<uint32_t> itows;
+    TEST_ASSERT_EQUAL(1, feed(bytes, &itows));
+    TEST_ASSERT_EQUAL_UINT32(1400, itows[0]);
+    TEST_ASSERT_EQUAL(2, s_parser.errors);
+}
+
+void test_corrupt_length_resyncs(void)
+{
+    /* A length byte hit by noise must not swallow the frames behind it */
+    std::vector<uint8_t> bytes;
+    std::vector<uint8_t> bad = nav_pvt(2000, 1, 2, 100);
+    bad[5] = 0xF0;                      /* 92 -> 61532 */
+    append(bytes, bad);
+    append(bytes, nav_pvt(2200, 1, 2, 100));
+    append(bytes, nav_pvt(2400, 1, 2, 100));
+
+    std::vector<uint32_t> itows;
+    TEST_ASSERT_EQUAL(2, feed(bytes, &itows));
+    TEST_ASSERT_EQUAL_UINT32(2200, itows[0]);
+    TEST_ASSERT_EQUAL_UINT32(2400, itows[1]);
+    TEST_ASSERT_EQUAL(1, s_parser.oversized);
+}
+
+void test_long_frame_refused_then_resync(void)
+{
+    /* NAV-SAT style frame, too long to keep: refused, the following epoch decodes */
+    std::vector<uint8_t> big(UBX_MAX_PAYLOAD + 1, 0x33);
+    std::vector<uint8_t> bytes = frame(UBX_CLASS_NAV, 0x35, big.data(), (uint16_t)big.size());
+    append(bytes, nav_pvt(3000, 1, 2, 100));
+
+    std::vector<uint32_t> itows;
+    TEST_ASSERT_EQUAL(1, feed(bytes, &itows));
+    TEST_ASSERT_EQUAL_UINT32(3000, itows[0]);
+    TEST_ASSERT_EQUAL(1, s_parser.oversized);
+}
+
+void test_noisy_stream(void)
+{
+    /* NMEA left over from before the port switch, random noise and sync look-alikes */
+    std::mt19937 rng(43);
+    std::vector<uint8_t> bytes;
+    const char *nmea = "$GPGGA,092653.00,1632.59,N,08134.07,E,1,11,0.92,4.2,M,,,,*5C\r\n";
+    bytes.insert(bytes.end(), nmea, nmea + strlen(nmea));
+    const int epochs = 500;
+    for (int i = 0; i < epochs; i++)
+    {
+        int noise = rng() % 12;
+        for (int n = 0; n < noise; n++)
+        {
+            /* Never a full sync pair, that would be a frame of its own */
+            uint8_t c = (rng() % 4 == 0) ? UBX_SYNC_1 : (uint8_t)rng();
+            bytes.push_back(c == UBX_SYNC_2 ? c + 1 : c);
+        }
+        append(bytes, nav_dop(i * 200, 180, 90, 150));
+        append(bytes, nav_pvt(i * 200, 1, 2, 180));
+    }
+
+    std::vector<uint32_t> itows;
+    TEST_ASSERT_EQUAL(epochs, feed(bytes, &itows));
+    for (int i = 0; i < epochs; i++) TEST_ASSERT_EQUAL_UINT32(i * 200, itows[i]);
+    TEST_ASSERT_EQUAL(2 * epochs, s_parser.frames);
+}
+
+void test_fuzz_never_overruns(void)
+{
+    /* Random bytes with sync pairs sprinkled in: any length field, no overrun */
+    std::mt19937 rng(7);
+    for (int i = 0; i < 200000; i++)
+    {
+        uint8_t c = (rng() % 16 == 0) ? ((i & 1) ? UBX_SYNC_2 : UBX_SYNC_1) : (uint8_t)rng();
+        ubx_parser_feed(&s_parser, c);
+        TEST_ASSERT_TRUE(s_parser.idx <= UBX_MAX_PAYLOAD);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_cfg_rate_matches_reference);
+    RUN_TEST(test_nav_pvt_and_dop_decode);
+    RUN_TEST(test_bad_checksum_costs_one_frame);
+    RUN_TEST(test_corrupt_length_resyncs);
+    RUN_TEST(test_long_frame_refused_then_resync);
+    RUN_TEST(test_noisy_stream);
+    RUN_TEST(test_fuzz_never_overruns);
+    return UNITY_END();
+}
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""Decode, replay and compare field traces (src/field_trace.h).
+
+  trace_tool.py decode trace_*.bin           timeline of every record
+  trace_tool.py replay trace_*.bin           pipeline outputs and timings
+  trace_tool.py diff old/ new/               first differences between two replays
+  trace_tool.py gps trace_*.bin > gps.raw    receiver bytes, to feed a bench device
+  trace_tool.py size trace_*.bin             raw and deflated size
+
+Segments are fetched with the getFileChunk RPC ("/trace_0.bin" ..) and may
+be given in any order: blocks are sorted by their seq. A directory stands
+for the trace_*.bin files in it.
+
+replay decodes the recorded inputs the way the firmware reads them: GPS
+bytes into fixes, Modbus request/response pairs into transaction results
+and bus latency, button edges into presses, uplink records into latency
+and loss, next to the pond each lookup settled on. The output has no
+timestamps, so two replays of the same inputs diff clean and a behaviour
+change shows as the first differing line. To run the recorded fixes
+through the pond lookup itself, play the gps output into the GPS UART of
+a bench device at the receiver baud rate.
+"""
+
+import struct
+import sys
+import zlib
+from pathlib import Path
+
+MAGIC = 0x31544657
+BLOCK = struct.Struct("<IIqHHI")
+UPLINK = struct.Struct("<BBHI")
+TYPES = {1: "gps", 2: "modbusTx", 3: "modbusRx", 4: "button", 5: "uplink", 6: "pond"}
+TRANSPORTS = {0: "http", 1: "socket"}
+
+
+def trace_files(args):
+    files = []
+    for arg in args:
+        path = Path(arg)
+        files += sorted(path.glob("trace_*.bin")) if path.is_dir() else [path]
+    return files
+
+
+def varint(buf, pos):
+    value = shift = 0
+    while True:
+        b = buf[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if b < 0x80:
+            return value, pos
+        shift += 7
+
+
+def read_blocks(files):
+    blocks = []
+    for path in files:
+        data = path.read_bytes()
+        pos = 0
+        while pos + BLOCK.size <= len(data):
+            magic, seq, base_us, length, dropped, _ = BLOCK.unpack_from(data, pos)
+            body = data[pos + BLOCK.size:pos + BLOCK.size + length]
+            if magic != MAGIC or len(body) != length:
+                break                   # Torn by a reset
+            blocks.append((seq, base_us, dropped, body))
+            pos += BLOCK.size + length
+    return sorted(blocks)
+
+
+def records(files):
+    """(time us, type, payload) in recording order; a gap is (time, 0, dropped count)."""
+    for _, base_us, dropped, body in read_blocks(files):
+        t = base_us
+        if dropped:
+            yield t, 0, dropped
+        pos = 0
+        while pos < len(body):
+            kind = body[pos]
+            dt, pos = varint(body, pos + 1)
+            length, pos = varint(body, pos)
+            t += dt
+            yield t, kind, body[pos:pos + length]
+            pos += length
+
+
+def describe(kind, payload):
+    if kind == 0:
+        return f"{payload} records dropped"
+    if kind in (2, 3):
+        return payload.hex(" ") or "timeout"
+    if kind == 4:
+        return "pressed" if payload[0] else "released"
+    if kind == 5:
+        transport, ok, frames, ms = UPLINK.unpack(payload)
+        return f"{TRANSPORTS.get(transport, transport)} {frames} frame(s) {'ok' if ok else 'FAIL'} {ms} ms"
+    if kind == 6:
+        return f"{payload[1:].decode(errors='replace') or '-'} {payload[0]}%"
+    return repr(payload.decode("ascii", errors="replace"))
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def modbus_result(tx, rx):
+    if not rx:
+        return "timeout"
+    if len(rx) < 5 or crc16(rx[:-2]) != rx[-2] | (rx[-1] << 8):
+        return "bad crc"
+    if rx[1] & 0x80:
+        return f"exception {rx[2]}"
+    return "ok " + rx[3:-2].hex() if rx[1] in (3, 4) else "ok"
+
+
+def nmea_degrees(value, hemi):
+    if not value:
+        return None
+    head, minutes = divmod(float(value), 100)
+    deg = head + minutes / 60
+    return -deg if hemi in ("S", "W") else deg
+
+
+class GpsParser:
+    """NMEA GGA and UBX NAV-PVT, whichever the receiver sends."""
+
+    def __init__(self):
+        self.buf = b""
+
+    def feed(self, data):
+        self.buf += data
+        fixes = []
+        while True:
+            ubx = self.buf.find(b"\xb5\x62")
+            nmea = self.buf.find(b"$")
+            starts = [i for i in (ubx, nmea) if i >= 0]
+            if not starts:
+                self.buf = b""
+                return fixes
+            start = min(starts)
+            self.buf = self.buf[start:]
+            if start == ubx:
+                if len(self.buf) < 6:
+                    return fixes
+                length = self.buf[4] | (self.buf[5] << 8)
+                if len(self.buf) < length + 8:
+                    return fixes
+                frame, self.buf = self.buf[:length + 8], self.buf[length + 8:]
+                if frame[2:4] == b"\x01\x07" and length == 92:
+                    p = frame[6:]
+                    lon, lat = struct.unpack_from("<ii", p, 24)
+                    h_acc = struct.unpack_from("<I", p, 40)[0]
+                    fixes.append(f"fix {lat * 1e-7:.6f} {lon * 1e-7:.6f} type {p[20]} hAcc {h_acc / 1000:.1f} m")
+            else:
+                end = self.buf.find(b"\n")
+                if end < 0:
+                    return fixes
+                line, self.buf = self.buf[:end].strip().decode("ascii", "replace"), self.buf[end + 1:]
+                f = line.split("*")[0].split(",")
+                if f[0][3:] == "GGA" and len(f) > 8 and f[6] not in ("", "0"):
+                    fixes.append(f"fix {nmea_degrees(f[2], f[3]):.6f} {nmea_degrees(f[4], f[5]):.6f}"
+                                 f" sats {f[7]} hdop {f[8]}")
+
+
+def replay(files):
+    """Pipeline outputs without timestamps, plus timing figures."""
+    out, bus_ms, uplink_ms = [], [], []
+    gps = GpsParser()
+    tx = None
+    pressed_at = None
+    for t, kind, payload in records(files):
+        if kind == 0:
+            out.append(f"gap {payload} records")
+        elif kind == 1:
+            out += gps.feed(payload)
+        elif kind == 2:
+            tx = (t, payload)
+        elif kind == 3 and tx:
+            bus_ms.append((t - tx[0]) / 1000)
+            out.append(f"modbus {tx[1][:6].hex()} {modbus_result(tx[1], payload)}")
+            tx = None
+        elif kind == 4:
+            if payload[0]:
+                pressed_at = t
+            elif pressed_at is not None:
+                out.append(f"button {'long' if t - pressed_at > 2_000_000 else 'short'}")
+                pressed_at = None
+        elif kind == 5:
+            transport, ok, frames, ms = UPLINK.unpack(payload)
+            uplink_ms.append(ms)
+            out.append(f"uplink {TRANSPORTS.get(transport, transport)} {frames} {'ok' if ok else 'fail'}")
+        elif kind == 6:
+            out.append(f"pond {payload[1:].decode(errors='replace') or '-'} {payload[0]}%")
+    return out, bus_ms, uplink_ms
+
+
+def stats(label, values):
+    if not values:
+        return f"{label:<12} none"
+    values = sorted(values)
+    pick = lambda p: values[min(len(values) - 1, int(p / 100 * len(values)))]
+    return f"{label:<12} n {len(values)}  p50 {pick(50):.1f}  p90 {pick(90):.1f}  max {values[-1]:.1f} ms"
+
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[1] not in ("decode", "replay", "diff", "gps", "size"):
+        sys.exit(__doc__)
+    cmd, args = sys.argv[1], sys.argv[2:]
+
+    if cmd == "diff":
+        if len(args) != 2:
+            sys.exit("diff takes two traces, a directory or a segment each")
+        a, b = (replay(trace_files([arg]))[0] for arg in args)
+        for i, (x, y) in enumerate(zip(a, b)):
+            if x != y:
+                print(f"output {i}:\n- {x}\n+ {y}")
+                sys.exit(1)
+        if len(a) != len(b):
+            print(f"same first {min(len(a), len(b))} outputs, then {len(a)} vs {len(b)}")
+            sys.exit(1)
+        print(f"{len(a)} outputs, no difference")
+        return
+
+    files = trace_files(args)
+    if cmd == "decode":
+        first = prev = None
+        for t, kind, payload in records(files):
+            if prev is not None and t < prev:
+                print("--- clock restarted, the device rebooted")
+                first = t
+            first = t if first is None else first
+            prev = t
+            print(f"{(t - first) / 1e6:12.6f} {TYPES.get(kind, 'gap'):<9} {describe(kind, payload)}")
+    elif cmd == "replay":
+        out, bus_ms, uplink_ms = replay(files)
+        print("\n".join(out))
+        print(stats("modbus", bus_ms), file=sys.stderr)
+        print(stats("uplink", uplink_ms), file=sys.stderr)
+    elif cmd == "gps":
+        for _, kind, payload in records(files):
+            if kind == 1:
+                sys.stdout.buffer.write(payload)
+    else:
+        raw = b"".join(path.read_bytes() for path in files)
+        packed = zlib.compress(raw, 9)
+        print(f"{len(raw)} bytes, {len(packed)} deflated ({100 * len(packed) / max(len(raw), 1):.0f} %)")
+
+
+if __name__ == "__main__":
+    main()